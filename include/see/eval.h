@@ -7,6 +7,7 @@ struct SEE_string;
 struct SEE_value;
 struct SEE_interpreter;
 struct SEE_input;
+struct SEE_program;
 
 /* Execution scope chain */
 struct SEE_scope {
@@ -23,6 +24,17 @@ void SEE_eval(struct SEE_interpreter *i, struct SEE_input *input,
 	struct SEE_object *thisobj, struct SEE_object *variable, 
 	struct SEE_scope *scope, struct SEE_value *res);
 
+/* Compiles program text in a cloned interpreter, for SEE_program_run */
+struct SEE_program *SEE_program_compile(struct SEE_interpreter *i,
+	struct SEE_input *input);
+
+/* Evaluates a compiled program in the Global scope of a clone */
+void SEE_program_run(struct SEE_interpreter *i, struct SEE_program *program,
+	struct SEE_value *res);
+
+/* Frees a compiled program once no clone is running it */
+void SEE_program_free(struct SEE_program *program);
+
 /* Constructs a new function object from inputs */
 struct SEE_object *SEE_Function_new(struct SEE_interpreter *i, 
 	struct SEE_string *name, struct SEE_input *param_input, 
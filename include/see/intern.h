@@ -7,6 +7,19 @@ struct SEE_interpreter;
 struct SEE_string;
 
 void _SEE_intern_init(struct SEE_interpreter *i);
+void _SEE_intern_global_init(void);
+void _SEE_intern_foreach(struct SEE_interpreter *i,
+	void (*fn)(struct SEE_string *, void *), void *closure);
+
+/*
+ * Shared interned strings for each Latin-1 character, indexed by
+ * character code, and for the integers 0 to _SEE_INTERN_NINTS-1.
+ * They are read-only, and valid once an interpreter has been made.
+ */
+#define _SEE_INTERN_NCHARS	256
+#define _SEE_INTERN_NINTS	1024
+extern struct SEE_string *_SEE_intern_chars[_SEE_INTERN_NCHARS];
+extern struct SEE_string *_SEE_intern_ints[_SEE_INTERN_NINTS];
 
 /*
  * Internalises a string local to the intepreter. Returns a string
@@ -33,4 +46,19 @@ struct SEE_string *SEE_intern_ascii(struct SEE_interpreter *i, const char *s);
  */
 struct SEE_string *SEE_intern_global(const char *s);
 
+/*
+ * Statistics about an interpreter's intern table and the global table.
+ * Tables grow as they fill, keeping chains short.
+ */
+struct SEE_intern_stats {
+	unsigned int count;		/* strings in the interpreter's table */
+	unsigned int size;		/* buckets in the interpreter's table */
+	unsigned int longest;		/* longest chain in that table */
+	unsigned int global_count;	/* strings in the global table */
+	unsigned int global_size;	/* buckets in the global table */
+};
+
+void SEE_intern_stats(struct SEE_interpreter *i,
+	struct SEE_intern_stats *stats);
+
 #endif /* _SEE_h_intern_ */
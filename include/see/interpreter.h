@@ -67,6 +67,8 @@ struct SEE_interpreter {
 	struct SEE_traceback *traceback;/* call chain for traceback */
 	void **module_private;		/* private pointers for each module */
 	void *intern_tab;		/* interned string table */
+	void *shape_tab;		/* native object shapes */
+	void *gc_heap;			/* heap of the built-in collector */
 	unsigned int random_seed;	/* used by Math.random() */
 	const char *locale;		/* current locale (may be NULL) */
 	int recursion_limit;		/* -1 means don't care */
@@ -78,6 +80,10 @@ struct SEE_interpreter {
 
 	/* Regex implementation used by Regex object (experimental) */
 	const struct SEE_regex_engine *regex_engine;
+	void *regex_cache;		/* recently compiled regexs */
+	void *number_cache;		/* recently converted numbers */
+	void *dst_cache;		/* daylight saving by kind of year */
+	void *snapshot;			/* template heap record/image */
 };
 
 /* Compatibility flags */
@@ -121,6 +127,18 @@ void SEE_interpreter_init(struct SEE_interpreter *i);
 /* Initialises an interpreter with specific behaviour */
 void SEE_interpreter_init_compat(struct SEE_interpreter *i, int compat_flags);
 
+/* Initialises an interpreter that others will be cloned from */
+void SEE_interpreter_init_template(struct SEE_interpreter *i,
+	int compat_flags);
+
+/* Initialises a template whose clones share its cfunction objects */
+void SEE_interpreter_init_shared_template(struct SEE_interpreter *i,
+	int compat_flags);
+
+/* Initialises an interpreter as a copy of a template */
+void SEE_interpreter_clone(struct SEE_interpreter *i,
+	struct SEE_interpreter *from);
+
 /* Saves interpreter state for concurrent access */
 struct SEE_interpreter_state *SEE_interpreter_save_state(
 	struct SEE_interpreter *i);
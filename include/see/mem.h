@@ -47,6 +47,7 @@ struct SEE_growable {
     SEE_size_t element_size;	/* Size of an element */
     SEE_size_t allocated;	/* Bytes of storage addressed by *data_ptr */
     unsigned int is_string : 1;	/* Use SEE_malloc_string */
+    const void *layout;		/* Template layout of elements */
 };
 
 /* Sets the new length of a growable array */
@@ -59,6 +60,7 @@ void	SEE_grow_to(struct SEE_interpreter *i, struct SEE_growable *grow,
 	(g)->element_size = sizeof (ptr)[0];		\
 	(g)->allocated = 0;				\
 	(g)->is_string = 0;				\
+	(g)->layout = 0;				\
     } while (0)
 void	_SEE_grow_to_debug(struct SEE_interpreter *i, 
 		    struct SEE_growable *grow,
@@ -76,6 +78,29 @@ void	_SEE_grow_to_debug(struct SEE_interpreter *i,
 	    *(g)->length_ptr = (l);			\
     } while (0)
 
+/*
+ * The built-in collector. SEE_gc_install() points the SEE_system
+ * memory hooks at it; each interpreter then gets a heap of its own.
+ */
+#define SEE_GC_GENERATIONAL	0x01	/* collect young objects separately */
+
+struct SEE_gc_stats {
+	SEE_size_t heap_size;		/* bytes of memory held by the heap */
+	SEE_size_t in_use;		/* bytes in allocated objects */
+	SEE_size_t live;		/* bytes in use after the last GC */
+	unsigned long collections;	/* number of collections */
+	unsigned long minor_collections;/* collections of young objects */
+};
+
+void	SEE_gc_install(int flags);
+void	SEE_gc_stack_base(struct SEE_interpreter *i, void *base);
+void	SEE_gc_add_root(struct SEE_interpreter *i, void *base,
+		SEE_size_t len);
+void	SEE_gc_remove_root(struct SEE_interpreter *i, void *base);
+void	SEE_gc_stats(struct SEE_interpreter *i, struct SEE_gc_stats *stats);
+void	SEE_gc_release(struct SEE_interpreter *i);
+int	SEE_gc_fault(void *addr);
+
 /* Convenience macros */
 #define SEE_NEW(i, t)		(t *)SEE_malloc(i, sizeof (t))
 #define SEE_NEW_FINALIZE(i, t, f, c) \
@@ -24,13 +24,30 @@
 
 struct SEE_interpreter;
 struct SEE_property;
+struct SEE_shape;
 
-/* A native object is a primitive object plus a hash table of properties */
-#define SEE_NATIVE_HASHLEN  257
+/*
+ * A native object is a primitive object plus a table of properties.
+ * Objects with only a few properties keep them in a small inline array
+ * that is searched linearly. When that fills up, the properties move
+ * into an open-addressed hash table whose size is a power of two.
+ * The shape describes the property layout for the bytecode's inline
+ * caches; it is NULL when it needs to be recomputed.
+ */
+#define SEE_NATIVE_SMALL    8
 struct SEE_native {
 	struct SEE_object       object;
-	struct SEE_property *   properties[SEE_NATIVE_HASHLEN];
+	unsigned int		nprops;		/* number of properties */
+	unsigned int		tabsize;	/* 0 while using props.small */
+	unsigned int		used;		/* non-empty hash slots */
+	union {
+	    struct SEE_property *small[SEE_NATIVE_SMALL];
+	    struct {
+		struct SEE_property **slots;	/* [tabsize] */
+	    } hash;
+	} props;
 	struct SEE_property *   lru;
+	struct SEE_shape *	shape;		/* layout, or NULL if unknown */
 };
 
 /* Object class methods that assume the object is a struct SEE_native */
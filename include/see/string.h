@@ -16,6 +16,12 @@
  * Practically there are only two string implementations: growable and 
  * non-growable.
  *
+ * SEE_string_concat() may also return a 'rope' that only refers to its
+ * two parts, leaving data[] NULL until the content is first needed.
+ * Code that reads the data[] of a string it did not make itself, and
+ * that did not come from SEE_ToString(), must call SEE_STRING_FLATTEN()
+ * first. The SEE_string_*() functions do this themselves.
+ *
  * The lifetime of a string is as it passes through the following stages:
  *   1. new, mutable; can be modified, grown and kept private
  *   2. public, immutable; must not be changed, can be referenced anywhere
@@ -35,9 +41,11 @@ struct SEE_string {
 	struct SEE_stringclass	*stringclass;	/* NULL means static */
 	struct SEE_interpreter	*interpreter;
 	int 			 flags;
+	unsigned int		 hash;		/* valid if FLAG_HASHED */
 };
 #define SEE_STRING_FLAG_INTERNED  1
 #define SEE_STRING_FLAG_STATIC    2		/* Deprecated. Do not use. */
+#define SEE_STRING_FLAG_HASHED    4		/* hash field is valid */
 
 #define SEE_STRING_DECL(chararray) \
 	{ sizeof (chararray) / sizeof (SEE_char_t), (chararray), \
@@ -45,8 +53,15 @@ struct SEE_string {
 
 struct SEE_stringclass {
 	void (*growby)(struct SEE_string *, unsigned int);
+	void (*flatten)(struct SEE_string *);	/* optional */
 };
 
+/* Ensures that a string's data[] is present */
+#define SEE_STRING_FLATTEN(s) \
+	((s)->stringclass && (s)->stringclass->flatten \
+	    ? (*(s)->stringclass->flatten)((struct SEE_string *)(s)) \
+	    : (void)0)
+
 void	SEE_string_addch(struct SEE_string *s, /* SEE_char_t */ int ch);
 void	SEE_string_append(struct SEE_string *s, const struct SEE_string *sffx);
 void	SEE_string_append_ascii(struct SEE_string *s, const char *ascii);
@@ -83,4 +98,8 @@ SEE_size_t SEE_string_utf8_size(struct SEE_interpreter *interp,
 
 struct SEE_string *_SEE_string_dup_fix(struct SEE_interpreter *,
 	        struct SEE_string *);
+int	_SEE_string_search(const struct SEE_string *s,
+			const struct SEE_string *t, unsigned int start);
+int	_SEE_string_rsearch(const struct SEE_string *s,
+			const struct SEE_string *t, unsigned int start);
 #endif /* _SEE_h_string_ */
@@ -39,6 +39,7 @@ enum SEE_type {
 struct _SEE_reference {
 	struct SEE_object *base;
 	struct SEE_string *property;
+	SEE_uint32_t _index;		/* array index, when property is NULL */
 };
 
 /* This structure is not part of the public API and may change */
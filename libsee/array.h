@@ -15,6 +15,10 @@ void	SEE_Array_push(struct SEE_interpreter *i, struct SEE_object *a,
 		struct SEE_value *val);
 SEE_uint32_t SEE_Array_length(struct SEE_interpreter *i, struct SEE_object *a);
 int	SEE_to_array_index(struct SEE_string *, SEE_uint32_t *);
+void	_SEE_Array_get_index(struct SEE_interpreter *i, struct SEE_object *a,
+		SEE_uint32_t index, struct SEE_value *res);
+void	_SEE_Array_put_index(struct SEE_interpreter *i, struct SEE_object *a,
+		SEE_uint32_t index, struct SEE_value *val);
 
 
 #endif /* _SEE_h_array_ */
@@ -53,6 +53,7 @@
 
 #include "stringdefs.h"
 #include "cfunction_private.h"
+#include "snapshot.h"
 
 /*
  * cfunction
@@ -80,6 +81,14 @@ struct cfunction {
 	void *sec_domain;
 };
 
+static const struct snapshot_word cfunction_words[] = {
+	SNAPSHOT_OBJECT(struct cfunction, object),
+	SNAPSHOT_PTR(struct cfunction, name),
+	SNAPSHOT_PTR(struct cfunction, sec_domain),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(cfunction_layout, struct cfunction, cfunction_words);
+
 static struct cfunction *tocfunction(struct SEE_interpreter *interp,
 	struct SEE_object *o);
 static void cfunction_get(struct SEE_interpreter *, struct SEE_object *, 
@@ -130,6 +139,7 @@ SEE_cfunction_make(interp, func, name, length)
 	struct cfunction *f;
 
 	f = SEE_NEW(interp, struct cfunction);
+	SNAPSHOT_LAYOUT(interp, f, &cfunction_layout);
 	f->object.objectclass = &SEE_cfunction_class;
 	f->object.Prototype = interp->Function_prototype;	/* 15 */
 	f->object.host_data = NULL;
@@ -137,6 +147,8 @@ SEE_cfunction_make(interp, func, name, length)
 	f->name = name;
 	f->length = length;
 	f->sec_domain = interp->sec_domain;
+	if (interp->snapshot)
+		_SEE_snapshot_share(interp, f);
 
 	return (struct SEE_object *)f;
 }
@@ -166,11 +178,12 @@ cfunction_get(interp, o, p, res)
 	struct cfunction *f = (struct cfunction *)o;
 
 	if (p == STR(__proto__) && (SEE_COMPAT_JS(interp, >=, JS11)))
-		SEE_SET_OBJECT(res, o->Prototype);
+		SEE_SET_OBJECT(res, _SEE_CFUNCTION_PROTOTYPE(interp, o));
 	else if (p == STR(length))
 		SEE_SET_NUMBER(res, f->length);
 	else
-		SEE_OBJECT_GET(interp, o->Prototype, p, res);
+		SEE_OBJECT_GET(interp, _SEE_CFUNCTION_PROTOTYPE(interp, o), p,
+		    res);
 }
 
 static int
@@ -181,7 +194,8 @@ cfunction_hasproperty(interp, o, p)
 {
 	if (p == STR(length))
 		return 1;
-	return SEE_OBJECT_HASPROPERTY(interp, o->Prototype, p);
+	return SEE_OBJECT_HASPROPERTY(interp,
+	    _SEE_CFUNCTION_PROTOTYPE(interp, o), p);
 }
 
 static void
@@ -226,6 +240,16 @@ SEE_cfunction_getname(interp, o)
 	return f->name;
 }
 
+/* Returns the C function of a cfunction object, or NULL if o is not one */
+SEE_call_fn_t
+SEE_cfunction_getfunc(o)
+	struct SEE_object *o;
+{
+	if (!o || o->objectclass != &SEE_cfunction_class)
+		return NULL;
+	return ((struct cfunction *)o)->func;
+}
+
 /* Converts a SEE_string of ASCII chars into a C string */
 static char *
 to_ascii_string(interp, s)
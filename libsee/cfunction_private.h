@@ -3,14 +3,31 @@
 #ifndef _SEE_h_cfunction_private_
 #define _SEE_h_cfunction_private_
 
+#include <see/object.h>
+
 struct SEE_interpreter;
 struct SEE_object;
 struct SEE_value;
 struct SEE_string;
 
+extern struct SEE_objectclass SEE_cfunction_class;
+
+/*
+ * The [[Prototype]] of o. A cfunction's is always the Function.prototype
+ * of the interpreter that made it; clones of a shared template share
+ * the template's cfunctions, so for those it is the Function.prototype
+ * of the interpreter using them. Code that walks a prototype chain
+ * that may pass through a cfunction uses this instead of o->Prototype.
+ */
+#define _SEE_CFUNCTION_PROTOTYPE(interp, o)				\
+	((o)->objectclass == &SEE_cfunction_class			\
+	    ? (interp)->Function_prototype : (o)->Prototype)
+
 struct SEE_string *SEE_cfunction_getname(struct SEE_interpreter *i,
         struct SEE_object *o);
 
+SEE_call_fn_t SEE_cfunction_getfunc(struct SEE_object *o);
+
 void SEE_cfunction_toString(struct SEE_interpreter *,
     struct SEE_object *, struct SEE_object *,
     int, struct SEE_value **, struct SEE_value *);
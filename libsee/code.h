@@ -7,6 +7,7 @@ struct SEE_interpreter;
 struct SEE_value;
 struct SEE_context;
 struct SEE_string;
+struct SEE_object;
 struct function;
 
 /*
@@ -30,7 +31,9 @@ enum SEE_code_op1 {
 	SEE_CODE_CALL, 			/* any any1..anyn | val */
 	SEE_CODE_END,			/*              - | -   */
 	SEE_CODE_VREF, 			/*                | ref */
-	SEE_CODE_PUTVALUEA		/*        ref val | -   */
+	SEE_CODE_PUTVALUEA,		/*        ref val | -   */
+	SEE_CODE_LOADLOCAL,		/*              - | val */
+	SEE_CODE_STORELOCAL		/*            val | -   */
 };
 
 /* Operand-less operators that work on the stack, virtual registers etc. */
@@ -47,7 +50,7 @@ enum SEE_code_op0 {
 	SEE_CODE_OBJECT,		/*           - | obj	    */
 	SEE_CODE_ARRAY,			/*           - | obj	    */
 	SEE_CODE_REGEXP,		/*           - | obj	    */
-	SEE_CODE_REF,			/*     obj str | ref	    */
+	SEE_CODE_REF,			/*     obj any | ref	    */
 	SEE_CODE_GETVALUE,		/*         ref | val	    */
 	SEE_CODE_LOOKUP,		/*         str | ref	    */
 	SEE_CODE_PUTVALUE,		/*     ref val | -	    */
@@ -131,6 +134,13 @@ struct SEE_code_class {
 	/* Adds a variable */
 	unsigned int (*gen_var)(struct SEE_code *co, struct SEE_string *ident);
 
+	/* Keeps variables in a frame of slots instead of the variable
+	 * object, for use by LOADLOCAL and STORELOCAL. The first nparams
+	 * variables added are the function's formal parameters. Must be 
+	 * called before any variable is added. Framed code can still be
+	 * run by exec(), which uses the variable object instead. */
+	void	(*gen_frame)(struct SEE_code *co, int nparams);
+
 	/* Generates an instruction referring to an address. 
 	 * If patchp is not NULL, then addr is ignored and a patch ref 
 	 * is stored in *patchp for later use by the patch method.
@@ -156,14 +166,23 @@ struct SEE_code_class {
 	 * last content of the C register. */
 	void	(*exec)(struct SEE_code *co, struct SEE_context *ctxt,
 	        	struct SEE_value *res);
+
+	/* Executes framed code as a function call. The context has no
+	 * activation or variable object: one is only made (from the
+	 * callee and arguments) if something needs to see it. */
+	void	(*call)(struct SEE_code *co, struct SEE_context *ctxt,
+			struct SEE_object *callee, int argc,
+			struct SEE_value **argv, struct SEE_value *res);
 };
 
 /* Public fields of the code context superclass */
 struct SEE_code {
 	struct SEE_code_class *code_class;
 	struct SEE_interpreter *interpreter;
+	int framed;			/* gen_frame() was called */
 };
 
 struct SEE_code *_SEE_code1_alloc(struct SEE_interpreter *interp);
+struct SEE_code *_SEE_code1_threaded_alloc(struct SEE_interpreter *interp);
 
 #endif /* _SEE_h_code_ */
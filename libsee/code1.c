@@ -61,6 +61,9 @@
 #include "enumerate.h"
 #include "code1.h"
 #include "replace.h"
+#include "shape.h"
+#include "array.h"
+#include "snapshot.h"
 
 struct block {
     enum { 
@@ -77,24 +80,73 @@ struct block {
 	    struct enum_context *prev;
 	} enum_context;
 	struct SEE_scope *with;
-	struct {
-	    SEE_try_context_t context;
+	struct {			/* CATCH, FINALLY and FINALLY2 */
 	    struct block *last_try_block;
 	    SEE_int32_t handler;
 	    unsigned int stack;
-	    SEE_int32_t resume;
-	} finally;
-	struct {
-	    SEE_try_context_t context;
-	    struct block *last_try_block;
-	    SEE_int32_t handler;
-	    unsigned int stack;
-	    struct SEE_string *ident;
+	    struct SEE_scope *scope;	/* NULL when it was ctxt->scope */
+	    struct enum_context *enum_context;
+	    struct SEE_throw_location *location;
+	    struct SEE_string *ident;	/* CATCH */
             struct SEE_object *obj;
-	} catch;
+	    SEE_int32_t resume;		/* FINALLY2 */
+	    int threw;
+	    struct SEE_value thrown;
+	    const char *throw_file;
+	    int throw_line;
+	    struct SEE_traceback *traceback;
+	} try;
     } u;
 };
 
+/*
+ * The state of a code1_run(), where code1_loop() leaves it when it
+ * returns to have a try context set up, or to throw to a try block in
+ * the same code. Exceptions thrown from deeper down find the innermost
+ * try block here after the longjmp, because code1_loop()'s own
+ * variables are lost by then.
+ */
+struct run {
+    struct code1 *co;
+    struct SEE_context *ctxt;
+    struct frame *frame;
+    struct SEE_value *res;
+    struct SEE_value *stackbottom;
+    struct SEE_value **argv;
+    struct block *blockbottom;
+    int threaded;			/* run the decoded instructions */
+
+    SEE_int32_t resume;			/* where to continue */
+    struct SEE_value *stack;
+    struct SEE_scope *scope;
+    int blocklevel;
+    struct enum_context *enum_context;
+    struct SEE_throw_location *location;
+
+    struct block *try_block;		/* innermost try block, or NULL */
+    int armed;				/* run_armed() will catch */
+    struct SEE_value thrown;		/* for RUN_THROW */
+    const char *throw_file;
+    int throw_line;
+    struct SEE_traceback *traceback;
+};
+
+/* Why code1_loop() returned */
+#define RUN_DONE	0		/* the code finished */
+#define RUN_ARM		1		/* a try block needs a try context */
+#define RUN_THROW	2		/* st->thrown goes to st->try_block */
+
+/* The vars of framed code called as a function */
+struct frame {
+    struct SEE_object *callee;
+    int argc;
+    struct SEE_value **argv;
+    struct SEE_value *local;	/* slot for each var */
+};
+
+/* The name of a var, as an interned string */
+#define VAR_NAME(co, i)	((co)->literal[(co)->var[i]].u.string)
+
 #ifdef NDEBUG
 # define CAST_CODE(c)	((struct code1 *)(c))
 #else
@@ -109,6 +161,7 @@ static void code1_gen_literal(struct SEE_code *co, const struct SEE_value *v);
 static void code1_gen_func(struct SEE_code *co, struct function *f);
 static void code1_gen_loc(struct SEE_code *co, struct SEE_throw_location *loc);
 static unsigned int code1_gen_var(struct SEE_code *co, struct SEE_string *name);
+static void code1_gen_frame(struct SEE_code *co, int nparams);
 static void code1_gen_opa(struct SEE_code *co, enum SEE_code_opa op,
 		SEE_code_patchable_t *patchp, SEE_code_addr_t addr);
 static SEE_code_addr_t code1_here(struct SEE_code *co);
@@ -119,6 +172,16 @@ static void code1_maxblock(struct SEE_code *co, int);
 static void code1_close(struct SEE_code *co);
 static void code1_exec(struct SEE_code *co, struct SEE_context *ctxt,
 		struct SEE_value *res);
+static void code1_call(struct SEE_code *co, struct SEE_context *ctxt,
+		struct SEE_object *callee, int argc, struct SEE_value **argv,
+		struct SEE_value *res);
+struct frame;
+static void code1_run(struct SEE_code *co, struct SEE_context *ctxt,
+		struct frame *frame, struct SEE_value *res);
+static int code1_loop(struct run *st);
+static void run_armed(struct run *st);
+static void run_catch(struct run *st, struct SEE_value *v, const char *file,
+		int line, struct SEE_traceback *traceback);
 
 static unsigned int add_literal(struct code1 *code, 
 		const struct SEE_value *val);
@@ -126,6 +189,7 @@ static unsigned int add_location(struct code1 *code,
 		const struct SEE_throw_location *location);
 static unsigned int add_function(struct code1 *code, struct function *f);
 static unsigned int add_var(struct code1 *code, struct SEE_string *ident);
+static unsigned int add_cache(struct code1 *code);
 static void add_byte(struct code1 *code, unsigned int c);
 static unsigned int here(struct code1 *code);
 
@@ -138,19 +202,65 @@ static struct SEE_code_class code1_class = {
     code1_gen_func,
     code1_gen_loc,
     code1_gen_var,
+    code1_gen_frame,
     code1_gen_opa,
     code1_here,
     code1_patch,
     code1_maxstack,
     code1_maxblock,
     code1_close,
-    code1_exec
+    code1_exec,
+    code1_call
+};
+
+/* Where the pointers are, for interpreter templates (snapshot.c) */
+static const struct snapshot_word code1_words[] = {
+    SNAPSHOT_PTR(struct code1, code.code_class),
+    SNAPSHOT_PTR(struct code1, code.interpreter),
+    SNAPSHOT_PTR(struct code1, inst),
+    SNAPSHOT_PTR(struct code1, literal),
+    SNAPSHOT_PTR(struct code1, location),
+    SNAPSHOT_PTR(struct code1, func),
+    SNAPSHOT_PTR(struct code1, var),
+    SNAPSHOT_GROWABLE(struct code1, ginst),
+    SNAPSHOT_GROWABLE(struct code1, gliteral),
+    SNAPSHOT_GROWABLE(struct code1, glocation),
+    SNAPSHOT_GROWABLE(struct code1, gfunc),
+    SNAPSHOT_GROWABLE(struct code1, gvar),
+    SNAPSHOT_PTR(struct code1, cache),
+    SNAPSHOT_PTR(struct code1, tinst),
+    SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(code1_layout, struct code1, code1_words);
+
+static const struct snapshot_word location_words[] = {
+    SNAPSHOT_PTR(struct SEE_throw_location, filename),
+    SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(location_layout, struct SEE_throw_location,
+    location_words);
+
+/* One CACHE_ENTRY() for each of the SHAPE_CACHE_WAYS */
+#define CACHE_ENTRY(i)							\
+    SNAPSHOT_PTR(struct shape_cache, entry[i].shape),			\
+    SNAPSHOT_PTR(struct shape_cache, entry[i].mid),			\
+    SNAPSHOT_PTR(struct shape_cache, entry[i].mid_shape),		\
+    SNAPSHOT_PTR(struct shape_cache, entry[i].holder),			\
+    SNAPSHOT_PTR(struct shape_cache, entry[i].holder_shape)
+static const struct snapshot_word cache_words[] = {
+    SNAPSHOT_PTR(struct shape_cache, name),
+    CACHE_ENTRY(0), CACHE_ENTRY(1), CACHE_ENTRY(2), CACHE_ENTRY(3),
+    SNAPSHOT_WORDS_END
 };
+#undef CACHE_ENTRY
+SNAPSHOT_LAYOUT_DEFINE(cache_layout, struct shape_cache, cache_words);
 
 #ifndef NDEBUG
 extern int SEE_eval_debug;
 int SEE_code_debug;
 static SEE_int32_t disasm(struct code1 *, SEE_int32_t pc);
+static void disasm_cache(struct code1 *, SEE_int32_t);
+static void disasm_var(struct code1 *, SEE_int32_t);
 #endif
 
 struct SEE_code *
@@ -160,17 +270,44 @@ _SEE_code1_alloc(interp)
     struct code1 *co;
     
     co = SEE_NEW(interp, struct code1);
+    SNAPSHOT_LAYOUT(interp, co, &code1_layout);
     co->code.code_class = &code1_class;
     co->code.interpreter = interp;
+    co->code.framed = 0;
 
     SEE_GROW_INIT(interp, &co->ginst, co->inst, co->ninst);
+    /* Bytecode holds no pointers, so must not be relocated (snapshot.c) */
+    co->ginst.is_string = 1;
     SEE_GROW_INIT(interp, &co->gliteral, co->literal, co->nliteral);
+    co->gliteral.layout = &_SEE_snapshot_values;
     SEE_GROW_INIT(interp, &co->gfunc, co->func, co->nfunc);
+    co->gfunc.layout = &_SEE_snapshot_pointers;
     SEE_GROW_INIT(interp, &co->glocation, co->location, co->nlocation);
+    co->glocation.layout = &location_layout;
     SEE_GROW_INIT(interp, &co->gvar, co->var, co->nvar);
+    co->gvar.is_string = 1;
     co->maxstack = -1;
     co->maxblock = -1;
     co->maxargc = 0;
+    co->cache = NULL;
+    co->ncache = 0;
+    co->nparams = 0;
+    co->threaded = 0;
+    co->tinst = NULL;
+    co->ntinst = 0;
+    co->tresolved = 0;
+    return (struct SEE_code *)co;
+}
+
+/* Allocates code that is run by the threaded loop once closed */
+struct SEE_code *
+_SEE_code1_threaded_alloc(interp)
+    struct SEE_interpreter *interp;
+{
+    struct code1 *co;
+
+    co = (struct code1 *)_SEE_code1_alloc(interp);
+    co->threaded = 1;
     return (struct SEE_code *)co;
 }
 
@@ -298,6 +435,15 @@ add_var(code, ident)
     return i;
 }
 
+/* Reserves an inline cache for an instruction, returning its index.
+ * The caches themselves are allocated when the code is closed. */
+static unsigned int
+add_cache(code)
+    struct code1 *code;
+{
+    return code->ncache++;
+}
+
 /* Appends a byte to the code stream  */
 static void
 add_byte(code, c)
@@ -412,9 +558,11 @@ code1_gen_op0(sco, op)
 	case SEE_CODE_ARRAY:	add_byte(co, INST_ARRAY); break;
 	case SEE_CODE_REGEXP:	add_byte(co, INST_REGEXP); break;
 	case SEE_CODE_REF:	add_byte(co, INST_REF); break;
-	case SEE_CODE_GETVALUE:	add_byte(co, INST_GETVALUE); break;
+	case SEE_CODE_GETVALUE:	add_byte_arg(co, INST_GETVALUE, add_cache(co));
+				break;
 	case SEE_CODE_LOOKUP:	add_byte(co, INST_LOOKUP); break;
-	case SEE_CODE_PUTVALUE:	add_byte(co, INST_PUTVALUE); break;
+	case SEE_CODE_PUTVALUE:	add_byte_arg(co, INST_PUTVALUE, add_cache(co));
+				break;
 	case SEE_CODE_DELETE:	add_byte(co, INST_DELETE); break;
 	case SEE_CODE_TYPEOF:	add_byte(co, INST_TYPEOF); break;
 	case SEE_CODE_TOOBJECT:	add_byte(co, INST_TOOBJECT); break;
@@ -472,8 +620,13 @@ code1_gen_op1(sco, op, n)
 	case SEE_CODE_NEW:	add_byte_arg(co, INST_NEW, n); break;
 	case SEE_CODE_CALL:	add_byte_arg(co, INST_CALL, n); break;
 	case SEE_CODE_END:	add_byte_arg(co, INST_END, n); break;
-	case SEE_CODE_VREF:	add_byte_arg(co, INST_VREF, n); break;
-	case SEE_CODE_PUTVALUEA:add_byte_arg(co, INST_PUTVALUE, n); break;
+	case SEE_CODE_VREF:	SEE_ASSERT(sco->interpreter, !sco->framed);
+				add_byte_arg(co, INST_VREF, n); break;
+	case SEE_CODE_PUTVALUEA:add_byte_arg(co, INST_PUTVALUEA, n); break;
+	case SEE_CODE_LOADLOCAL:SEE_ASSERT(sco->interpreter, sco->framed);
+				add_byte_arg(co, INST_LOADLOCAL, n); break;
+	case SEE_CODE_STORELOCAL:SEE_ASSERT(sco->interpreter, sco->framed);
+				add_byte_arg(co, INST_STORELOCAL, n); break;
 	default: SEE_ASSERT(sco->interpreter, !"bad op1");
 	}
 
@@ -560,6 +713,18 @@ code1_gen_var(sco, ident)
 	return id;
 }
 
+static void
+code1_gen_frame(sco, nparams)
+	struct SEE_code *sco;
+	int nparams;
+{
+	struct code1 *co = CAST_CODE(sco);
+
+	SEE_ASSERT(sco->interpreter, co->nvar == 0);
+	sco->framed = 1;
+	co->nparams = nparams;
+}
+
 static void
 code1_gen_opa(sco, opa, patchp, addr)
 	struct SEE_code *sco;
@@ -641,11 +806,174 @@ code1_maxblock(sco, maxblock)
 	co->maxblock = maxblock;
 }
 
+/* Fetch next instruction byte into op,arg and increment pc */
+#define FETCH_INST(pc, op, arg)	 do {			    \
+            op = *pc++;					    \
+            if ((op & INST_ARG_MASK) == INST_ARG_NONE) 	    \
+                arg = 0;				    \
+            else if ((op & INST_ARG_MASK) == INST_ARG_BYTE) \
+                arg = *pc++;				    \
+            else {					    \
+                memcpy(&arg, pc, sizeof arg);		    \
+                pc += sizeof arg;			    \
+            }						    \
+        } while (0)
+
+/*
+ * Replaces common pairs of decoded instructions with superinstructions.
+ * The second instruction of each pair is kept, so that branches to it
+ * and the instruction indices stay valid; the superinstruction steps
+ * over it when run.
+ */
+#ifndef NDEBUG
+static const char * const fused_name[] = {
+	"VREF_GETVALUE", "LOOKUP_GETVALUE", "REF_GETVALUE",
+	"LITERAL_ADD", "LT_B_TRUE"
+};
+#endif
+
+static void
+fuse_code(co)
+	struct code1 *co;
+{
+	struct code1_tinst *t = co->tinst;
+	unsigned int i;
+	unsigned char fused;
+
+	for (i = 0; i + 1 < co->ntinst; i++) {
+	    switch (t[i].op << 8 | t[i + 1].op) {
+	    case INST_VREF << 8 | INST_GETVALUE:
+		fused = INST_VREF_GETVALUE; break;
+	    case INST_LOOKUP << 8 | INST_GETVALUE:
+		fused = INST_LOOKUP_GETVALUE; break;
+	    case INST_REF << 8 | INST_GETVALUE:
+		fused = INST_REF_GETVALUE; break;
+	    case INST_LITERAL << 8 | INST_ADD:
+		fused = INST_LITERAL_ADD; break;
+	    case INST_LT << 8 | INST_B_TRUE:
+		fused = INST_LT_B_TRUE; break;
+	    default:
+		continue;
+	    }
+#ifndef NDEBUG
+	    if (SEE_code_debug > 1)
+		dprintf("code1: fused %s at [%u]\n", fused_name[fused - 
+		    INST_VREF_GETVALUE], i);
+#endif
+	    t[i].op = fused;
+	    i++;
+	}
+}
+
+/* 
+ * Decodes the byte instructions into an array of wide instructions
+ * for the threaded loop, converting branch addresses to indices.
+ */
+static void
+thread_code(co)
+	struct code1 *co;
+{
+	struct SEE_interpreter *interp = co->code.interpreter;
+	unsigned char *pc, *endpc = co->inst + co->ninst;
+	unsigned char op;
+	SEE_int32_t arg, *index;
+	unsigned int n;
+
+	/* Pass 1: number the instructions by byte offset */
+	index = SEE_NEW_STRING_ARRAY(interp, SEE_int32_t, co->ninst + 1);
+	n = 0;
+	pc = co->inst;
+	while (pc < endpc) {
+	    index[pc - co->inst] = n++;
+	    FETCH_INST(pc, op, arg);
+	}
+	index[co->ninst] = n;
+
+	/* Pass 2: decode the instructions and their branch targets */
+	co->tinst = SEE_NEW_STRING_ARRAY(interp, struct code1_tinst, n);
+	co->ntinst = n;
+	n = 0;
+	pc = co->inst;
+	while (pc < endpc) {
+	    FETCH_INST(pc, op, arg);
+	    switch (op & INST_OP_MASK) {
+	    case INST_B_ALWAYS:
+	    case INST_B_TRUE:
+	    case INST_B_ENUM:
+	    case INST_S_TRYC:
+	    case INST_S_TRYF:
+		SEE_ASSERT(interp, arg >= 0 && (unsigned int)arg <= co->ninst);
+		arg = index[arg];
+		break;
+	    }
+	    co->tinst[n].label = NULL;
+	    co->tinst[n].arg = arg;
+	    co->tinst[n].op = op & INST_OP_MASK;
+	    n++;
+	}
+	SEE_free(interp, (void **)&index);
+	fuse_code(co);
+}
+
+/*
+ * Retargets branches that land on an unconditional branch, so that a
+ * chain of jumps is taken in one step. Branches are always encoded
+ * with word arguments, so the byte code keeps its layout.
+ */
+static void
+thread_jumps(co)
+	struct code1 *co;
+{
+	unsigned char *pc, *endpc = co->inst + co->ninst;
+	unsigned char op;
+	SEE_int32_t arg, target, hops;
+
+	pc = co->inst;
+	while (pc < endpc) {
+	    FETCH_INST(pc, op, arg);
+	    switch (op & INST_OP_MASK) {
+	    case INST_B_ALWAYS:
+	    case INST_B_TRUE:
+	    case INST_B_ENUM:
+		break;
+	    default:
+		continue;
+	    }
+	    /* The hop limit guards against empty infinite loops */
+	    for (target = arg, hops = 0; hops < 16 && 
+		    (unsigned int)target + 1 + sizeof target <= co->ninst &&
+		    co->inst[target] == (INST_B_ALWAYS | INST_ARG_WORD);
+		    hops++)
+		memcpy(&target, co->inst + target + 1, sizeof target);
+	    if (target != arg) {
+#ifndef NDEBUG
+		if (SEE_code_debug > 1)
+		    dprintf("code1: branch at 0x%x: 0x%x -> 0x%x\n",
+			(int)(pc - co->inst) - 1 - (int)sizeof arg, arg,
+			target);
+#endif
+		put_word(co, target, (pc - co->inst) - sizeof arg);
+	    }
+	}
+}
+
 static void
 code1_close(sco)
 	struct SEE_code *sco;
 {
-	/* Not implemented */
+	struct code1 *co = CAST_CODE(sco);
+	unsigned int i;
+
+	if (co->ncache) {
+	    co->cache = SEE_NEW_ARRAY(sco->interpreter, struct shape_cache,
+		co->ncache);
+	    SNAPSHOT_LAYOUT(sco->interpreter, co->cache, &cache_layout);
+	    for (i = 0; i < co->ncache; i++)
+		_SEE_shape_cache_init(&co->cache[i]);
+	}
+	thread_jumps(co);
+	if (co->threaded)
+	    thread_code(co);
 }
 
 /*------------------------------------------------------------
@@ -663,7 +991,75 @@ GetValue(interp, vp)
 	    struct SEE_string *prop = vp->u.reference.property;
 	    if (base == NULL)
 		SEE_error_throw_string(interp, interp->ReferenceError, prop);
-	    SEE_OBJECT_GET(interp, base, SEE_intern(interp, prop), vp);
+	    if (prop == NULL)
+		_SEE_Array_get_index(interp, base, vp->u.reference._index, vp);
+	    else
+		SEE_OBJECT_GET(interp, base, SEE_intern(interp, prop), vp);
+	}
+}
+
+/* Converts a reference to a value, in situ, through an inline cache */
+static void
+GetValueCached(interp, vp, cache)
+	struct SEE_interpreter *interp;
+	struct SEE_value *vp;
+	struct shape_cache *cache;
+{
+	if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE) {
+	    struct SEE_object *base = vp->u.reference.base;
+	    struct SEE_string *prop = vp->u.reference.property;
+	    if (base == NULL)
+		SEE_error_throw_string(interp, interp->ReferenceError, prop);
+	    if (prop == NULL) {
+		_SEE_Array_get_index(interp, base, vp->u.reference._index, vp);
+		return;
+	    }
+	    /* The cached name is interned, so a match skips SEE_intern */
+	    if (prop != cache->name)
+		prop = SEE_intern(interp, prop);
+	    _SEE_native_get_cached(interp, base, prop, vp, cache);
+	}
+}
+
+/* Returns the interned property name of a reference */
+static struct SEE_string *
+RefName(interp, vp)
+	struct SEE_interpreter *interp;
+	struct SEE_value *vp;
+{
+	struct SEE_value v, s;
+
+	if (vp->u.reference.property)
+	    return SEE_intern(interp, vp->u.reference.property);
+	SEE_SET_NUMBER(&v, vp->u.reference._index);
+	SEE_ToString(interp, &v, &s);
+	return SEE_intern(interp, s.u.string);
+}
+
+/* Adds two primitive values (11.6.1). The result may overwrite x */
+static void
+Add(interp, x, y, res)
+	struct SEE_interpreter *interp;
+	struct SEE_value *x, *y, *res;
+{
+	struct SEE_value u, v;
+	struct SEE_string *str;
+
+	if (SEE_VALUE_GET_TYPE(x) == SEE_STRING ||
+		SEE_VALUE_GET_TYPE(y) == SEE_STRING)
+	{
+	    if (SEE_VALUE_GET_TYPE(x) != SEE_STRING)
+		SEE_ToString(interp, x, &u), x = &u;
+	    if (SEE_VALUE_GET_TYPE(y) != SEE_STRING)
+		SEE_ToString(interp, y, &v), y = &v;
+	    str = SEE_string_concat(interp, x->u.string, y->u.string);
+	    SEE_SET_STRING(res, str);
+	} else {
+	    if (SEE_VALUE_GET_TYPE(x) != SEE_NUMBER)
+		SEE_ToNumber(interp, x, &u), x = &u;
+	    if (SEE_VALUE_GET_TYPE(y) != SEE_NUMBER)
+		SEE_ToNumber(interp, y, &v), y = &v;
+	    SEE_SET_NUMBER(res, x->u.number + y->u.number);
 	}
 }
 
@@ -700,6 +1096,8 @@ AbstractRelational(interp, x, y, res)
 	    else 
 	        SEE_SET_BOOLEAN(res, r4.u.number < r5.u.number);
 	} else {
+	    SEE_STRING_FLATTEN(r1.u.string);
+	    SEE_STRING_FLATTEN(r2.u.string);
 	    for (k = 0; 
 		 k < r1.u.string->length && k < r2.u.string->length;
 		 k++)
@@ -802,36 +1200,319 @@ Eq(interp, x, y)
                 return 0;
 }
 
+/*
+ * Makes the activation object for framed code that something is about 
+ * to observe through its context. The frame's slots are moved into 
+ * the activation object, and the LOADLOCAL and STORELOCAL instructions
+ * use it from then on. Returns the scope chain with the activation 
+ * object put beneath any scopes that catch blocks have pushed.
+ */
+static struct SEE_scope *
+frame_activation(co, ctxt, frame, scope)
+	struct code1 *co;
+	struct SEE_context *ctxt;
+	struct frame *frame;
+	struct SEE_scope *scope;
+{
+	struct SEE_interpreter *interp = co->code.interpreter;
+	struct SEE_object *activation;
+	struct SEE_scope *inner, *s;
+	unsigned int i;
+
+	activation = _SEE_function_activation(interp, frame->callee,
+	    frame->argc, frame->argv);
+	for (i = 0; i < co->nvar; i++)
+	    SEE_OBJECT_PUT(interp, activation, VAR_NAME(co, i), 
+		&frame->local[i], ctxt->varattr);
+
+	inner = SEE_NEW(interp, struct SEE_scope);
+	SNAPSHOT_LAYOUT(interp, inner, &_SEE_snapshot_pointers);
+	inner->obj = activation;
+	inner->next = ctxt->scope;
+	if (scope == ctxt->scope)
+	    scope = inner;
+	else {
+	    for (s = scope; s->next != ctxt->scope; s = s->next)
+		;
+	    s->next = inner;
+	}
+
+	ctxt->activation = activation;
+	ctxt->variable = activation;
+	ctxt->scope = inner;
+	return scope;
+}
+
 static void
 code1_exec(sco, ctxt, res)
 	struct SEE_code *sco;
 	struct SEE_context *ctxt;
 	struct SEE_value *res;
+{
+	code1_run(sco, ctxt, NULL, res);
+}
+
+static void
+code1_call(sco, ctxt, callee, argc, argv, res)
+	struct SEE_code *sco;
+	struct SEE_context *ctxt;
+	struct SEE_object *callee;
+	int argc;
+	struct SEE_value **argv;
+	struct SEE_value *res;
+{
+	struct frame frame;
+
+	SEE_ASSERT(ctxt->interpreter, sco->framed);
+	SEE_ASSERT(ctxt->interpreter, ctxt->variable == NULL);
+	frame.callee = callee;
+	frame.argc = argc;
+	frame.argv = argv;
+	code1_run(sco, ctxt, &frame, res);
+}
+
+/* Executes the code. If frame is not NULL, the code is framed */
+static void
+code1_run(sco, ctxt, frame, res)
+	struct SEE_code *sco;
+	struct SEE_context *ctxt;
+	struct frame *frame;
+	struct SEE_value *res;
 {
 	struct SEE_interpreter * const interp = ctxt->interpreter;
 	struct code1 * const co = CAST_CODE(sco);
+	struct SEE_value undefined;
+	struct run st;
+	int i;
+
+#ifndef NDEBUG
+    /*SEE_eval_debug = 2; */
+    if (SEE_eval_debug) {
+	dprintf("code     = %p\n", co);
+	dprintf("ninst    = 0x%x\n", co->ninst);
+	dprintf("nlocation= %d\n", co->nlocation);
+	dprintf("nvar=      %d\n", co->nvar);
+	if (sco->framed)
+	    dprintf("nparams  = %d (framed)\n", co->nparams);
+	dprintf("maxstack = %d\n", co->maxstack);
+	dprintf("maxargc  = %d\n", co->maxargc);
+	dprintf("ncache   = %u\n", co->ncache);
+	if (co->nliteral) {
+	    dprintf("-- literals:\n");
+	    for (i = 0; i < co->nliteral; i++) {
+		dprintf("[%d] ", i);
+		dprintv(interp, co->literal + i);
+		dprintf("\n");
+	    }
+	}
+	if (co->nfunc) {
+	    dprintf("-- functions:\n");
+	    for (i = 0; i < co->nfunc; i++) {
+	        struct function *f = co->func[i];
+		dprintf("[%d] %p nparams=%d", i, f, f->nparams);
+		if (f->name) {
+		  dprintf(" name=");
+		  dprints(f->name);
+		}
+		if (f->is_empty)
+		    dprintf(" is_empty");
+		dprintf("\n");
+	    }
+	}
+	dprintf("-- code:\n");
+	i = 0;
+	while (i < co->ninst)
+	    i += disasm(co, i);
+	dprintf("--\n");
+    }
+#endif
+
+    SEE_ASSERT(interp, co->maxstack >= 0);
+
+    /* Storage that must outlive code1_loop() if it is thrown out of */
+    st.stackbottom = SEE_ALLOCA(interp, struct SEE_value, co->maxstack);
+    st.argv = SEE_ALLOCA(interp, struct SEE_value *, co->maxargc);
+    st.blockbottom = SEE_ALLOCA(interp, struct block, co->maxblock);
+
+    SEE_SET_UNDEFINED(&undefined);
+
+    SEE_SET_UNDEFINED(res);	    /* C = undefined */
+
+    if (frame) {
+	/* Fill the frame slots from the arguments */
+	frame->local = SEE_ALLOCA(interp, struct SEE_value, co->nvar);
+	for (i = 0; i < co->nvar; i++)
+	    if (i < co->nparams && i < frame->argc)
+		SEE_VALUE_COPY(&frame->local[i], frame->argv[i]);
+	    else
+		SEE_SET_UNDEFINED(&frame->local[i]);
+    } else
+	/* Initialise all vars, and build lookups */
+	for (i = 0; i < co->nvar; i++) {
+	    struct SEE_string *ident;
+	    SEE_ASSERT(interp, co->var[i] < co->nliteral);
+	    SEE_ASSERT(interp, 
+		SEE_VALUE_GET_TYPE(&co->literal[co->var[i]]) == SEE_STRING);
+	    ident = co->literal[co->var[i]].u.string;
+	    if (!SEE_OBJECT_HASPROPERTY(interp, ctxt->variable, ident))
+		SEE_OBJECT_PUT(interp, ctxt->variable, ident, &undefined,
+				    ctxt->varattr);
+	}
+
+    st.co = co;
+    st.ctxt = ctxt;
+    st.frame = frame;
+    st.res = res;
+    st.threaded = co->tinst != NULL
+#ifndef NDEBUG
+	&& !SEE_eval_debug
+#endif
+	;
+    st.resume = 0;
+    st.stack = st.stackbottom;
+    st.scope = ctxt->scope;
+    st.blocklevel = 0;
+    st.enum_context = NULL;
+    st.location = NULL;
+    st.try_block = NULL;
+    st.armed = 0;
+
+    /*
+     * Code without try blocks runs with no try context at all. The
+     * first try block entered makes code1_loop() return, so that the
+     * rest of the run has one set up for it.
+     */
+    if (code1_loop(&st) == RUN_ARM)
+	run_armed(&st);
+}
+
+/*
+ * Runs the rest of code that has entered a try block. One try context
+ * catches everything thrown while the code runs; the exception goes
+ * to the innermost try block on the block stack, and the code resumes
+ * at its handler. THROW and ENDF hand an exception for a try block of
+ * the same code back as RUN_THROW, which needs no longjmp. Exceptions
+ * that arrive with no try block active are passed on.
+ */
+static void
+run_armed(st)
+	struct run *st;
+{
+	struct SEE_interpreter * const interp = st->ctxt->interpreter;
+	SEE_try_context_t c;
+
+	for (;;) {
+	    c.done = 0;
+	    _SEE_TRY_INIT(interp, c);
+	    if (!_SEE_TRY_SETJMP(interp, c))
+		break;
+	    /* Thrown from below; the context has been finalized */
+	    st->armed = 0;
+	    if (!st->try_block)
+		SEE_RETHROW(interp, c);
+	    run_catch(st, SEE_CAUGHT(c), c.throw_file, c.throw_line,
+		c.traceback);
+	}
+	st->armed = 1;
+	while (code1_loop(st) == RUN_THROW)
+	    run_catch(st, &st->thrown, st->throw_file, st->throw_line,
+		st->traceback);
+	st->armed = 0;
+	c.done = 1;
+	_SEE_TRY_FINI(interp, c);
+}
+
+/*
+ * Unwinds the blocks above the innermost try block, and arranges for
+ * code1_loop() to resume in its handler with the thrown value v.
+ */
+static void
+run_catch(st, v, file, line, traceback)
+	struct run *st;
+	struct SEE_value *v;
+	const char *file;
+	int line;
+	struct SEE_traceback *traceback;
+{
+	struct SEE_interpreter * const interp = st->ctxt->interpreter;
+	struct block *block = st->try_block;
+	struct SEE_object *obj;
+
+	SEE_ASSERT(interp, block != NULL);
+	st->try_block = block->u.try.last_try_block;
+	st->blocklevel = block - st->blockbottom + 1;
+	st->stack = st->stackbottom + block->u.try.stack;
+	/* (A frame's activation may have been made since the try began) */
+	st->scope = block->u.try.scope ? block->u.try.scope : st->ctxt->scope;
+	st->enum_context = block->u.try.enum_context;
+	st->location = block->u.try.location;
+	st->resume = block->u.try.handler;
+
+	if (block->type == BLOCK_CATCH) {
+#ifndef NDEBUG
+	    if (SEE_eval_debug) {
+		dprintf("CATCH block caught exception ");
+		dprintv(interp, v);
+		dprintf("\n");
+	    }
+#endif
+	    /* Create a scope object to hold the exception */
+	    obj = SEE_Object_new(interp);
+	    SEE_OBJECT_PUT(interp, obj, block->u.try.ident, v,
+		SEE_ATTR_DONTDELETE);
+	    block->u.try.obj = obj;
+	    /* The handler begins with S_CATCH */
+	} else {
+	    SEE_ASSERT(interp, block->type == BLOCK_FINALLY);
+	    /* Run the finally handler as a FINALLY2 that rethrows at ENDF */
+	    block->type = BLOCK_FINALLY2;
+	    block->u.try.threw = 1;
+	    SEE_VALUE_COPY(&block->u.try.thrown, v);
+	    block->u.try.throw_file = file;
+	    block->u.try.throw_line = line;
+	    block->u.try.traceback = traceback;
+#ifndef NDEBUG
+	    block->u.try.resume = -1; /* Store a bogus resume point */
+#endif
+	}
+}
+
+/*
+ * Runs instructions from st->resume until the code ends, or until it
+ * needs run_armed() or run_catch(). Nothing here calls setjmp, so the
+ * compiler is free to keep the interpreter's registers in registers.
+ */
+static int
+code1_loop(st)
+	struct run *st;
+{
+	struct SEE_context * const ctxt = st->ctxt;
+	struct SEE_interpreter * const interp = ctxt->interpreter;
+	struct code1 * const co = st->co;
+	struct frame * const frame = st->frame;
+	struct SEE_value * const res = st->res;
+	struct SEE_value * const stackbottom = st->stackbottom;
+	struct SEE_value ** const argv = st->argv;
+	struct block * const blockbottom = st->blockbottom;
 	struct SEE_string *str;
-	struct SEE_value t, u, v;		/* scratch values */
-	struct SEE_value *up, *vp, *wp;
-	struct SEE_value **argv;
+	struct SEE_value t, v;		/* scratch values */
+	struct SEE_value *up, *vp;
 	struct SEE_value undefined, Number;
 	struct SEE_object *obj, *baseobj;
-	struct SEE_throw_location *location = NULL;
+	struct SEE_throw_location *location = st->location;
 	unsigned char op;
 	SEE_int32_t arg;
 	SEE_int32_t int32;
 	SEE_uint32_t uint32;
 	int i, new_blocklevel;
 	SEE_number_t number;
-#define VOLATILE /* volatile */
-	VOLATILE unsigned char *pc;
-	VOLATILE struct SEE_value *stackbottom;
-	VOLATILE struct SEE_value *stack;
-	VOLATILE struct block *blockbottom, *block;
-	VOLATILE struct block *try_block = NULL;
-	VOLATILE int blocklevel;
-	VOLATILE struct enum_context *enum_context = NULL;
-	VOLATILE struct SEE_scope *scope;
+	unsigned char *pc;
+	struct code1_tinst *ip;
+	struct SEE_value *stack = st->stack;
+	struct block *block;
+	int blocklevel = st->blocklevel;
+	struct enum_context *enum_context = st->enum_context;
+	struct SEE_scope *scope = st->scope;
 
 /*
  * The PUSH() and POP() macros work by setting /pointers/ into
@@ -879,9 +1560,13 @@ code1_exec(sco, ctxt, res)
 	if (SEE_system.periodic)			\
 	    (*SEE_system.periodic)(interp);		\
 	interp->try_location = location;		\
-	if (interp->trace) 				\
+	if (interp->trace) {				\
+	    if (frame && !ctxt->variable)		\
+		scope = frame_activation(co, ctxt,	\
+		    frame, scope);			\
 	    (*interp->trace)(interp, location,		\
 		ctxt, event);				\
+	}						\
     } while (0)
 
 /* TONUMBER() ensures that the value pointer vp points at a number value.
@@ -900,77 +1585,63 @@ code1_exec(sco, ctxt, res)
     }							\
  } while (0)
 
+/* IS_INDEX_REF() tests if key vp is an array index of obj, setting idx */
+#define IS_INDEX_REF(obj, vp, idx)			\
+    (SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER &&		\
+     SEE_is_Array(obj) &&				\
+     (vp)->u.number >= 0 &&				\
+     (vp)->u.number < 4294967295.0 &&			\
+     ((idx) = (SEE_uint32_t)(vp)->u.number) == (vp)->u.number)
+
 #define NOT_IMPLEMENTED					\
 	SEE_error_throw_string(interp, interp->Error,	\
 	    STR(not_implemented));
 
-#ifndef NDEBUG
-    /*SEE_eval_debug = 2; */
-    if (SEE_eval_debug) {
-	dprintf("code     = %p\n", co);
-	dprintf("ninst    = 0x%x\n", co->ninst);
-	dprintf("nlocation= %d\n", co->nlocation);
-	dprintf("nvar=      %d\n", co->nvar);
-	dprintf("maxstack = %d\n", co->maxstack);
-	dprintf("maxargc  = %d\n", co->maxargc);
-	if (co->nliteral) {
-	    dprintf("-- literals:\n");
-	    for (i = 0; i < co->nliteral; i++) {
-		dprintf("[%d] ", i);
-		dprintv(interp, co->literal + i);
-		dprintf("\n");
-	    }
-	}
-	if (co->nfunc) {
-	    dprintf("-- functions:\n");
-	    for (i = 0; i < co->nfunc; i++) {
-	        struct function *f = co->func[i];
-		dprintf("[%d] %p nparams=%d", i, f, f->nparams);
-		if (f->name) {
-		  dprintf(" name=");
-		  dprints(f->name);
-		}
-		if (f->is_empty)
-		    dprintf(" is_empty");
-		dprintf("\n");
-	    }
-	}
-	dprintf("-- code:\n");
-	i = 0;
-	while (i < co->ninst)
-	    i += disasm(co, i);
-	dprintf("--\n");
-    }
-#endif
+/* Keeps the registers in st, for code1_loop() to resume from later */
+#define SAVE_STATE() do {				\
+	st->resume = PC_OFFSET;				\
+	st->stack = stack;				\
+	st->scope = scope;				\
+	st->blocklevel = blocklevel;			\
+	st->enum_context = enum_context;		\
+	st->location = location;			\
+    } while (0)
 
-    SEE_ASSERT(interp, co->maxstack >= 0);
+/* Makes block the innermost try block, with its handler at addr */
+#define TRY_ENTER(block, addr) do {			\
+	(block)->u.try.handler = (addr);		\
+	(block)->u.try.stack = stack - stackbottom;	\
+	(block)->u.try.scope = 				\
+	    scope == ctxt->scope ? NULL : scope;	\
+	(block)->u.try.enum_context = enum_context;	\
+	(block)->u.try.location = location;		\
+	(block)->u.try.last_try_block = st->try_block;	\
+	st->try_block = (block);			\
+	if (!st->armed) {				\
+	    /* Have run_armed() set up a try context */	\
+	    SAVE_STATE();				\
+	    return RUN_ARM;				\
+	}						\
+    } while (0)
 
-    stackbottom = SEE_ALLOCA(interp, struct SEE_value, co->maxstack);
-    argv = SEE_ALLOCA(interp, struct SEE_value *, co->maxargc);
-    blockbottom = SEE_ALLOCA(interp, struct block, co->maxblock);
-    blocklevel = 0;
+/* Throws to the innermost try block, which is in this code */
+#define THROW_LOCAL(vp, file, line, tb) do {		\
+	SEE_ASSERT(interp, st->armed);			\
+	SEE_VALUE_COPY(&st->thrown, vp);		\
+	st->throw_file = (file);			\
+	st->throw_line = (line);			\
+	st->traceback = (tb);				\
+	SEE_throw();	/* debugger hook */		\
+	return RUN_THROW;				\
+    } while (0)
 
-    /* Constants */
     SEE_SET_UNDEFINED(&undefined);
     SEE_SET_OBJECT(&Number, interp->Number);
 
-    SEE_SET_UNDEFINED(res);	    /* C = undefined */
-
-    /* Initialise all vars, and build lookups */
-    for (i = 0; i < co->nvar; i++) {
-	struct SEE_string *ident;
-	SEE_ASSERT(interp, co->var[i] < co->nliteral);
-	SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(&co->literal[co->var[i]]) == 
-			    SEE_STRING);
-	ident = co->literal[co->var[i]].u.string;
-	if (!SEE_OBJECT_HASPROPERTY(interp, ctxt->variable, ident))
-	    SEE_OBJECT_PUT(interp, ctxt->variable, ident, &undefined,
-	                        ctxt->varattr);
-    }
+    if (st->threaded)
+	goto threaded;
 
-    pc = co->inst;
-    stack = stackbottom;
-    scope = ctxt->scope;
+    pc = co->inst + st->resume;
     for (;;) {
 
 	SEE_ASSERT(interp, pc >= co->inst);
@@ -1011,17 +1682,17 @@ code1_exec(sco, ctxt, res)
                         dprintf(" WITH"); 
                         break; 
                     case BLOCK_CATCH: 
-                        dprintf(" CATCH<%x>", block->u.catch.handler); 
+                        dprintf(" CATCH<%x>", block->u.try.handler); 
                         break; 
                     case BLOCK_FINALLY: 
                         dprintf(" FINALLY<%x/%u>", 
-                                block->u.finally.handler,
-                                block->u.finally.stack); 
+                                block->u.try.handler,
+                                block->u.try.stack); 
                         break; 
                     case BLOCK_FINALLY2: 
                         dprintf(" FINALLY2<%x/%u>", 
-                                block->u.finally.resume,
-                                block->u.finally.stack); 
+                                block->u.try.resume,
+                                block->u.try.stack); 
                         break;
                     default:
                         dprintf(" ?");
@@ -1033,767 +1704,84 @@ code1_exec(sco, ctxt, res)
 	}
 #endif
 
-	/* Fetch next instruction byte into op,arg and increment pc */
-#define FETCH_INST(pc, op, arg)	 do {			    \
-            op = *pc++;					    \
-            if ((op & INST_ARG_MASK) == INST_ARG_NONE) 	    \
-                arg = 0;				    \
-            else if ((op & INST_ARG_MASK) == INST_ARG_BYTE) \
-                arg = *pc++;				    \
-            else {					    \
-                memcpy(&arg, pc, sizeof arg);		    \
-                pc += sizeof arg;			    \
-            }						    \
-        } while (0)
 
 	FETCH_INST(pc, op, arg);
 
 	switch (op & INST_OP_MASK) {
-	case INST_NOP:
-	    break;
-
-	case INST_DUP:
-	    TOP(vp);
-	    PUSH(up);
-	    SEE_VALUE_COPY(up, vp);
-	    break;
-
-	case INST_POP:
-	    POP0();
-	    break;
-
-	case INST_EXCH:
-	    SEE_VALUE_COPY(&t, stack - 1);
-	    SEE_VALUE_COPY(stack - 1, stack - 2);
-	    SEE_VALUE_COPY(stack - 2, &t);
-	    break;
-	
-	case INST_ROLL3:
-	    SEE_VALUE_COPY(&t, stack - 1);
-	    SEE_VALUE_COPY(stack - 1, stack - 2);
-	    SEE_VALUE_COPY(stack - 2, stack - 3);
-	    SEE_VALUE_COPY(stack - 3, &t);
-	    break;
-
-	case INST_THROW:
-	    POP(up);	/* val */
-	    TRACE(SEE_TRACE_THROW);
-	    SEE_THROW(interp, up);
-	    /* NOTREACHED */
-	    break;
-
-	case INST_SETC:
-	    POP(vp);
-	    SEE_VALUE_COPY(res, vp);
-	    break;
-
-	case INST_GETC:
-	    PUSH(vp);
-	    SEE_VALUE_COPY(vp, res);
-	    break;
-
-	case INST_THIS:
-	    PUSH(vp);
-	    SEE_SET_OBJECT(vp, ctxt->thisobj);
-	    break;
-
-	case INST_OBJECT:
-	    PUSH(vp);
-	    SEE_SET_OBJECT(vp, interp->Object);
-	    break;
-
-	case INST_ARRAY:
-	    PUSH(vp);
-	    SEE_SET_OBJECT(vp, interp->Array);
-	    break;
-
-	case INST_REGEXP:
-	    PUSH(vp);	/* obj */
-	    SEE_SET_OBJECT(vp, interp->RegExp);
-	    break;
-
-	case INST_REF:
-	    POP(up);	/* str */
-	    TOP(vp);	/* obj */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_STRING);
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT);
-	    str = up->u.string;
-	    obj = vp->u.object;
-	    _SEE_SET_REFERENCE(vp, obj, str);
-	    break;
-
-	case INST_GETVALUE:
-	    TOP(vp);	/* any -> val */
-	    GetValue(interp, vp);	    /* [in situ] */
-	    break;
-
-	case INST_LOOKUP:
-	    TOP(vp);	/* str */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_STRING);
-	    str = SEE_intern(interp, vp->u.string);
-	    SEE_scope_lookup(interp, scope, str, vp);
-	    break;
-
-	case INST_PUTVALUE:
-	    POP(up);	/* val */
-	    POP(vp);	/* ref */
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE) {
-		struct SEE_object *base = vp->u.reference.base;
-		struct SEE_string *prop = vp->u.reference.property;
-		if (base == NULL)
-		    base = interp->Global;
-		SEE_OBJECT_PUT(interp, base, SEE_intern(interp, prop), up,
-		    arg);
-	    } else
-		SEE_error_throw_string(interp, interp->ReferenceError,
-		    STR(bad_lvalue));
-	    break;
-
-	case INST_VREF:
-	    SEE_ASSERT(interp, arg >= 0);
-	    SEE_ASSERT(interp, arg < co->nvar);
-	    PUSH(vp);	/* ref */
-	    SEE_ASSERT(interp, co->var[arg] < co->nliteral);
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(&co->literal[co->var[arg]])
-				    == SEE_STRING);
-	    _SEE_SET_REFERENCE(vp, ctxt->variable, 
-		    co->literal[co->var[arg]].u.string);
-	    break;
-
-	case INST_DELETE:
-	    TOP(vp);	/* any -> bool */
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE) {
-		struct SEE_object *base = vp->u.reference.base;
-		struct SEE_string *prop = vp->u.reference.property;
-		if (base == NULL || 
-		    SEE_OBJECT_DELETE(interp, base, SEE_intern(interp, prop)))
-			SEE_SET_BOOLEAN(vp, 1);
-		else
-			SEE_SET_BOOLEAN(vp, 0);
-	    } else
-		SEE_SET_BOOLEAN(vp, 0);
-	    break;
-
-	case INST_TYPEOF:
-	    TOP(vp);	/* any -> str */
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE &&
-		vp->u.reference.base == NULL) 
-		    SEE_SET_STRING(vp, STR(undefined));
-	    else {
-		struct SEE_string *s;
-		GetValue(interp, vp);
-		switch (SEE_VALUE_GET_TYPE(vp)) {
-		case SEE_UNDEFINED:	s = STR(undefined); break;
-		case SEE_NULL:     	s = STR(object);    break;
-		case SEE_BOOLEAN:  	s = STR(boolean);   break;
-		case SEE_NUMBER:   	s = STR(number);    break;
-		case SEE_STRING:   	s = STR(string);    break;
-		case SEE_OBJECT:   	s = SEE_OBJECT_HAS_CALL(vp->u.object)
-					  ? STR(function)
-					  : STR(object);    break;
-		default:		s = STR(unknown);
-		}
-		SEE_SET_STRING(vp, s);
-	    }
-	    break;
-
-	case INST_TOOBJECT:
-	    TOP(vp);	    /* val -> obj */
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT) {
-		struct SEE_value tmp;
-		SEE_VALUE_COPY(&tmp, vp);
-		SEE_ToObject(interp, &tmp, vp);
-	    }
-	    break;
-
-	case INST_TONUMBER:
-	    TOP(vp);	    /* val -> num */
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_NUMBER) {
-		struct SEE_value tmp;
-		SEE_VALUE_COPY(&tmp, vp);
-		SEE_ToNumber(interp, &tmp, vp);
-	    }
-	    break;
-
-	case INST_TOBOOLEAN:
-	    TOP(vp);	    /* val -> bool */
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_BOOLEAN) {
-		struct SEE_value tmp;
-		SEE_VALUE_COPY(&tmp, vp);
-		SEE_ToBoolean(interp, &tmp, vp);
-	    }
-	    break;
-
-	case INST_TOSTRING:
-	    TOP(vp);	    /* val -> str */
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_STRING) {
-		struct SEE_value tmp;
-		SEE_VALUE_COPY(&tmp, vp);
-		SEE_ToString(interp, &tmp, vp);
-	    }
-	    break;
-
-	case INST_TOPRIMITIVE:
-	    TOP(vp);	    /* val -> str */
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT) {
-		struct SEE_object *obj = vp->u.object;
-		SEE_OBJECT_DEFAULTVALUE(interp, obj, NULL, vp);
-	    }
-	    break;
-
-	case INST_NEG:
-	    TOP(vp);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
-	    vp->u.number = -vp->u.number;
-	    break;
-
-	case INST_INV:
-	    TOP(vp);
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) != SEE_REFERENCE);
-	    int32 = SEE_ToInt32(interp, vp);
-	    SEE_SET_NUMBER(vp, ~int32);
-	    break;
-
-	case INST_NOT:
-	    TOP(vp);
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_BOOLEAN);
-	    vp->u.boolean = !vp->u.boolean;
-	    break;
-
-	case INST_MUL:
-	    POP(vp);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
-	    TOP(up);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
-	    number = up->u.number * vp->u.number;
-	    SEE_SET_NUMBER(up, number);
-	    break;
-
-	case INST_DIV:
-	    POP(vp);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
-	    TOP(up);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
-	    number = up->u.number / vp->u.number;
-	    SEE_SET_NUMBER(up, number);
-	    break;
-
-	case INST_MOD:
-	    POP(vp);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
-	    TOP(up);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
-	    number = NUMBER_fmod(up->u.number, vp->u.number);
-	    SEE_SET_NUMBER(up, number);
-	    break;
-
-	case INST_ADD:
-	    POP(vp);	/* prim */
-	    TOP(up);	/* prim -> num/str */
-	    wp = up;
-	    if (SEE_VALUE_GET_TYPE(up) == SEE_STRING ||
-		    SEE_VALUE_GET_TYPE(vp) == SEE_STRING)
-	    {
-		if (SEE_VALUE_GET_TYPE(up) != SEE_STRING)
-		    SEE_ToString(interp, up, &u), up = &u;
-		if (SEE_VALUE_GET_TYPE(vp) != SEE_STRING)
-		    SEE_ToString(interp, vp, &v), vp = &v;
-		str = SEE_string_concat(interp,
-		    up->u.string, vp->u.string);
-		SEE_SET_STRING(wp, str);
-	    } else {
-		if (SEE_VALUE_GET_TYPE(up) != SEE_NUMBER)
-		    SEE_ToNumber(interp, up, &u), up = &u;
-		if (SEE_VALUE_GET_TYPE(vp) != SEE_NUMBER)
-		    SEE_ToNumber(interp, vp, &v), vp = &v;
-		number = up->u.number + vp->u.number;
-		SEE_SET_NUMBER(wp, number);
-	    }
-	    break;
-
-	case INST_SUB:
-	    POP(vp);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
-	    TOP(up);	    /* num */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
-	    number = up->u.number - vp->u.number;
-	    SEE_SET_NUMBER(up, number);
-	    break;
-
-	case INST_LSHIFT:
-	    POP(vp);	/* val2 */
-	    TOP(up);	/* val1 */
-	    int32 = SEE_ToInt32(interp, up) << 
-		(SEE_ToUint32(interp, vp) & 0x1f);
-	    SEE_SET_NUMBER(up, int32);
-	    break;
-
-	case INST_RSHIFT:
-	    POP(vp);	/* val2 */
-	    TOP(up);	/* val1 */
-	    int32 = SEE_ToInt32(interp, up) >> 
-		    (SEE_ToUint32(interp, vp) & 0x1f);
-	    SEE_SET_NUMBER(up, int32);
-	    break;
-
-	case INST_URSHIFT:
-	    POP(vp);	/* val2 */
-	    TOP(up);	/* val1 */
-	    uint32 = SEE_ToUint32(interp, up) >> 
-		    (SEE_ToUint32(interp, vp) & 0x1f);
-	    SEE_SET_NUMBER(up, uint32);
-	    break;
-
-	case INST_LT:
-	    POP(vp);	/* y */
-	    TOP(up);	/* x */
-	    AbstractRelational(interp, up, vp, up);
-	    if (SEE_VALUE_GET_TYPE(up) == SEE_UNDEFINED)
-		SEE_SET_BOOLEAN(up, 0);
-	    break;
-
-	case INST_GT:
-	    POP(vp);	/* y */
-	    TOP(up);	/* x */
-	    AbstractRelational(interp, vp, up, up);
-	    if (SEE_VALUE_GET_TYPE(up) == SEE_UNDEFINED)
-		SEE_SET_BOOLEAN(up, 0);
-	    break;
-
-	case INST_LE:
-	    POP(vp);	/* y */
-	    TOP(up);	/* x */
-	    AbstractRelational(interp, vp, up, up);
-	    if (SEE_VALUE_GET_TYPE(up) == SEE_UNDEFINED)
-		SEE_SET_BOOLEAN(up, 0);
-	    else
-		up->u.boolean = !up->u.boolean;
-	    break;
-
-	case INST_GE:
-	    POP(vp);	/* y */
-	    TOP(up);	/* x */
-	    AbstractRelational(interp, up, vp, up);
-	    if (SEE_VALUE_GET_TYPE(up) == SEE_UNDEFINED)
-		SEE_SET_BOOLEAN(up, 0);
-	    else
-		up->u.boolean = !up->u.boolean;
-	    break;
-
-	case INST_INSTANCEOF:
-	    POP(vp);	/* val */
-	    TOP(up);	/* val */
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT)
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(instanceof_not_object));
-	    i = SEE_object_instanceof(interp, up, vp->u.object);
-	    SEE_SET_BOOLEAN(up, i);
-	    break;
-
-	case INST_IN:
-	    POP(vp);	/* val */
-	    TOP(up);	/* str */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_STRING);
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT)
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(in_not_object));
-	    i = SEE_OBJECT_HASPROPERTY(interp, /* [in situ] */
-		vp->u.object, SEE_intern(interp, up->u.string));
-	    SEE_SET_BOOLEAN(up, i);
-	    break;
-
-	case INST_EQ:
-	    POP(vp);
-	    TOP(up);
-	    i = Eq(interp, up, vp);
-	    SEE_SET_BOOLEAN(up, i);
-	    break;
-
-	case INST_SEQ:
-	    POP(vp);
-	    TOP(up);
-	    i = Seq(up, vp);
-	    SEE_SET_BOOLEAN(up, i);
-	    break;
-
-	case INST_BAND:
-	    POP(vp);	    /* val */
-	    TOP(up);	    /* val */
-	    int32 = SEE_ToInt32(interp, up) & SEE_ToInt32(interp, vp);
-	    SEE_SET_NUMBER(up, int32);
-	    break;
-
-	case INST_BXOR:
-	    POP(vp);	    /* val */
-	    TOP(up);	    /* val */
-	    int32 = SEE_ToInt32(interp, up) ^ SEE_ToInt32(interp, vp);
-	    SEE_SET_NUMBER(up, int32);
-	    break;
-
-	case INST_BOR:
-	    POP(vp);	    /* val */
-	    TOP(up);	    /* val */
-	    int32 = SEE_ToInt32(interp, up) | SEE_ToInt32(interp, vp);
-	    SEE_SET_NUMBER(up, int32);
-	    break;
-
-	case INST_S_ENUM:
-	    POP(vp);	    /* obj */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT);
-	    block = &blockbottom[blocklevel];
-	    block->type = BLOCK_ENUM;
-	    block->u.enum_context.props0 =
-		block->u.enum_context.props =
-		    SEE_enumerate(interp, vp->u.object);
-	    block->u.enum_context.obj = vp->u.object;
-	    block->u.enum_context.prev = enum_context;
-	    blocklevel++;
-	    enum_context = &block->u.enum_context;
-	    break;
-
-	case INST_S_WITH:
-	    POP(vp);	    /* obj */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT);
-	    block = &blockbottom[blocklevel];
-	    block->type = BLOCK_WITH;
-	    block->u.with = SEE_NEW(interp, struct SEE_scope);
-	    block->u.with->next = scope;
-	    block->u.with->obj = vp->u.object;
-	    scope = block->u.with;
-	    blocklevel++;
-	    break;
-
-        case INST_S_CATCH:
-            /* Check that the top block really is a CATCH block */
-            SEE_ASSERT(interp, blocklevel > 0);
-	    block = &blockbottom[blocklevel - 1];
-            SEE_ASSERT(interp, block->type == BLOCK_CATCH);
-            obj = block->u.catch.obj;
-
-            /* Convert the topmost CATCH block into a WITH block */
-            block->type = BLOCK_WITH;
-	    block->u.with = SEE_NEW(interp, struct SEE_scope);
-	    block->u.with->next = scope;
-	    block->u.with->obj = obj;
-            scope = block->u.with;     /* Push a new scope */
-            break;
-
-        case INST_ENDF:
-            /*
-             * End a finally handler in a way that restores
-             * the circumstances the moment it was triggered.
-             */
-            SEE_ASSERT(interp, blocklevel > 0);
-            block = &blockbottom[--blocklevel];
-            SEE_ASSERT(interp, block->type == BLOCK_FINALLY2);
-
-            /* If we had an exception we re-throw it */
-            if (SEE_CAUGHT(block->u.finally.context)) {
-                TRACE(SEE_TRACE_THROW);
-                SEE_DEFAULT_CATCH(interp, block->u.finally.context);
-            }
-
-            SEE_ASSERT(interp, block->u.finally.resume != -1);
-            pc = co->inst + block->u.finally.resume;
-            break;
-
-	/*--------------------------------------------------
-	 * Instructions that take one argument
-	 */
-
-	case INST_NEW:
-	    SEE_ASSERT(interp, stack >= stackbottom + arg + 1);
-	    stack -= arg;
-	    SEE_ASSERT(interp, arg <= co->maxargc);
-	    for (i = 0; i < arg; i++)
-		argv[i] = stack + i;
-	    POP(vp);        /* obj */
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_UNDEFINED)
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(no_such_function));
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT)
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(not_a_function));
-	    obj = vp->u.object;
-	    if (!SEE_OBJECT_HAS_CONSTRUCT(obj))
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(not_a_constructor));
-	    PUSH(up);
-	    TRACE(SEE_TRACE_CALL);
-	    SEE_OBJECT_CONSTRUCT(interp, obj, NULL, arg, argv, up);
-	    TRACE(SEE_TRACE_RETURN);
-	    break;
-
-	case INST_CALL:
-	    SEE_ASSERT(interp, stack >= stackbottom + arg + 1);
-	    stack -= arg;
-	    SEE_ASSERT(interp, arg <= co->maxargc);
-	    for (i = 0; i < arg; i++)
-		argv[i] = stack + i;
-	    TOP(vp);      /* ref */
-
-	    baseobj = NULL;
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE) {
-		baseobj = vp->u.reference.base;
-		if (baseobj && IS_ACTIVATION_OBJECT(baseobj))
-		    baseobj = NULL;
-		GetValue(interp, vp);
-	    }
-	    if (!baseobj)
-		baseobj = interp->Global;
-	    if (SEE_VALUE_GET_TYPE(vp) == SEE_UNDEFINED)
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(no_such_function));
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT)
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(not_a_function));
-	    obj = vp->u.object;
-	    if (!SEE_OBJECT_HAS_CALL(obj))
-		SEE_error_throw_string(interp, interp->TypeError,
-		    STR(not_callable));
-	    TRACE(SEE_TRACE_CALL);
-	    if (obj == interp->Global_eval) {
-		struct SEE_context context2;
-		memcpy(&context2, ctxt, sizeof context2);
-		context2.scope = scope;
-		context2.thisobj = baseobj;
-		if (arg == 0)
-		    SEE_SET_UNDEFINED(vp);
-		else if (SEE_VALUE_GET_TYPE(argv[0]) != SEE_STRING)
-		    SEE_VALUE_COPY(vp, argv[0]);
-		else
-		    SEE_context_eval(&context2, argv[0]->u.string, vp);
-	    } else 
-		SEE_OBJECT_CALL(interp, obj, baseobj, arg, argv, vp);
-	    TRACE(SEE_TRACE_RETURN);
-	    break;
-
-	/*
-	 * Ending one or more blocks
-	 */
-	case INST_END:
-	    new_blocklevel = arg;
-    	    if (blocklevel < new_blocklevel)
-                break;
-            /* 
-             * END is a special instruction that only
-             * advance PC when it is a no-op.
-             * Because PC is advanced during instruction reads,
-             * and because END,n is always two bytes, we can
-             * reverse it easily.
-             */
-            pc -= 2; 
-
-            /* When there are no blocks left, then return */
-            if (blocklevel == 0)
-                return;
-
-            block = &blockbottom[--blocklevel];
-            switch (block->type) {
-            case BLOCK_ENUM:
-                /* Ending an ENUM block terminates the enumerator */
-#ifndef NDEBUG
-		    if (SEE_eval_debug)
-			dprintf("ending ENUM\n");
-#endif
-		    SEE_ASSERT(interp, enum_context == &block->u.enum_context);
-		    SEE_enumerate_free(interp, enum_context->props0);
-		    enum_context = enum_context->prev;
-                    break;
-
-            case BLOCK_WITH:
-		    /* Ending a WITH block restores the scope chain */
-#ifndef NDEBUG
-		    if (SEE_eval_debug)
-			dprintf("ending WITH\n");
-#endif
-		    scope = block->u.with->next;
-                    break;
-
-            case BLOCK_CATCH:
-		    /* Ending a CATCH block only happens when an
-                     * exception has not been caught.
-                     * Simply finalize the unused try context.
-                     */
-#ifndef NDEBUG
-		    if (SEE_eval_debug)
-			dprintf("ending CATCH\n");
-#endif
-                    SEE_ASSERT(interp, block == try_block);
-                    block->u.catch.context.done = 1;
-                    _SEE_TRY_FINI(interp, block->u.catch.context);
-                    try_block = block->u.catch.last_try_block;
-                    break;
-
-            case BLOCK_FINALLY:
-		    /* Ending a FINALLY (try-finally) converts into a FINALLY2
-		     * block and branches to the finally handler */
-#ifndef NDEBUG
-		    if (SEE_eval_debug)
-			dprintf("ending FINALLY\n");
-#endif
-                    /* 1. finalise the context */
-                    SEE_ASSERT(interp, block == try_block);
-                    try_block = block->u.finally.last_try_block;
-                    block->u.finally.context.done = 1;
-                    _SEE_TRY_FINI(interp, block->u.finally.context);
-
-                    /* 2. convert to a new FINALLY2 block */
-		    block->type = BLOCK_FINALLY2;
-		    blocklevel++; /* Re-add the block */
-
-                    /* Resume this END instruction later */
-                    block->u.finally.resume = pc - co->inst;
-
-                    /* Change the pc so that the current END is interrupted */
-                    pc = co->inst + block->u.finally.handler;
-		    break;
-
-            case BLOCK_FINALLY2:
-		    /* Ending a finally handler abnormally. */
-#ifndef NDEBUG
-		    if (SEE_eval_debug)
-			dprintf("ending FINALLY2\n");
-#endif
-                    break;
-#ifndef NDEBUG
-            default:
-                    SEE_ASSERT(interp, "invalid block type");
-#endif
-            }
-
-	    break;
-
-	/*--------------------------------------------------
-	 * Instructions that take an address argument
-	 */
-
-	case INST_B_ALWAYS:
-	    pc = co->inst + arg;
-	    break;
-
-	case INST_B_TRUE:
-	    POP(vp);
-	    if (SEE_VALUE_GET_TYPE(vp) != SEE_BOOLEAN) {
-		SEE_ToBoolean(interp, vp, &v);
-		vp = &v;
-	    }
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_BOOLEAN);
-	    if (vp->u.boolean)
-		pc = co->inst + arg;
-	    break;
-
-	case INST_B_ENUM:
-	    SEE_ASSERT(interp, enum_context != NULL);
-	    while (*enum_context->props && !SEE_OBJECT_HASPROPERTY(interp, 
-			enum_context->obj, *enum_context->props))
-		enum_context->props++;
-	    if (*enum_context->props) {
-		PUSH(vp);
-		SEE_SET_STRING(vp, *enum_context->props);
-		pc = co->inst + arg;
-		enum_context->props++;
-	    }
-	    break;
-
-	case INST_S_TRYC:
-	    POP(vp);
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_STRING);
-	    block = &blockbottom[blocklevel++];
-	    block->type = BLOCK_CATCH;
-	    block->u.catch.handler = arg;
-	    block->u.catch.stack = stack - stackbottom;
-	    block->u.catch.ident = vp->u.string;
-	    block->u.catch.last_try_block = try_block;
-
-	    try_block = block;
-	    try_block->u.catch.context.done = 0;
-	    _SEE_TRY_INIT(interp, try_block->u.catch.context);
-	    if (_SEE_TRY_SETJMP(interp, try_block->u.catch.context)) {
-                /* Executed when an exception has been caught by this block: */
-                /* Note: _SEE_TRY_FINI will have been called */
-                block = try_block;
-                SEE_ASSERT(interp, block->type == BLOCK_CATCH);
-                try_block = block->u.catch.last_try_block;
-                vp = SEE_CAUGHT(block->u.catch.context);
-#ifndef NDEBUG
-                if (SEE_eval_debug) {
-                    dprintf("CATCH block caught exception ");
-                    dprintv(interp, vp);
-                    dprintf("\n");
-                }
-#endif
-                /* Create a scope object to hold the exception */
-                obj = SEE_Object_new(interp);
-                SEE_OBJECT_PUT(interp, obj, block->u.catch.ident,
-                    vp, SEE_ATTR_DONTDELETE);
-                block->u.catch.obj = obj;
-                /* Restore the stack */
-                stack = stackbottom + block->u.catch.stack;
-                /* Set the PC to the catch handler */
-                pc = co->inst + block->u.catch.handler;
-                /* Resume processing instuctions in the handler. 
-                 * Hopefully there will be a S.CATCH real soon. */
-            }
-	    break;
-
-	case INST_S_TRYF:
-	    block = &blockbottom[blocklevel++];
-	    block->type = BLOCK_FINALLY;
-	    block->u.finally.handler = arg;
-	    block->u.finally.stack = stack - stackbottom;
-	    block->u.finally.last_try_block = try_block;
-	    try_block = block;
-	    _SEE_TRY_INIT(interp, try_block->u.finally.context);
-	    try_block->u.finally.context.done = 0;
-	    if (_SEE_TRY_SETJMP(interp, try_block->u.finally.context)) {
-                /* Executed when an exception has been caught by this block. */
-                /* Note: _SEE_TRY_FINI will have been called */
-                block = try_block;
-                SEE_ASSERT(interp, block->type == BLOCK_FINALLY);
-                try_block = block->u.finally.last_try_block;
-
-                /* Restore the stack */
-                stack = stackbottom + block->u.finally.stack;
-		/* Convert the block into a FINALLY2. */
-                block->type = BLOCK_FINALLY2;
-                /* Leave context.done==0 to indicate that an exception
-                 * had been caught. No need to save the current PC */
-                pc = co->inst + block->u.finally.handler;
-                /* Continue execution in the handler, which is usually 
-                 * an END instruction to clean up earlier blocks. */
-#ifndef NDEBUG
-                block->u.finally.resume = -1; /* Store a bogus resume point */
-#endif
-	    }
-	    break;
-
-	case INST_FUNC:
-	    SEE_ASSERT(interp, arg >= 0);
-	    SEE_ASSERT(interp, arg < co->nfunc);
-	    PUSH(vp);
-	    SEE_SET_OBJECT(vp, SEE_function_inst_create(interp,
-		co->func[arg], scope));
-	    break;
-
-	case INST_LITERAL:
-	    SEE_ASSERT(interp, arg >= 0);
-	    SEE_ASSERT(interp, arg < co->nliteral);
-	    PUSH(vp);
-	    SEE_VALUE_COPY(vp, co->literal + arg);
-	    break;
-
-	case INST_LOC:
-	    SEE_ASSERT(interp, arg >= 0);
-	    SEE_ASSERT(interp, arg < co->nlocation);
-	    location = co->location + arg;
-	    TRACE(SEE_TRACE_STATEMENT);
-	    break;
+#define INST(name)	case INST_##name
+#define NEXT		break
+#define JUMP(addr)	pc = co->inst + (addr)
+#define PC_OFFSET	(pc - co->inst)
+#define REWIND_END()	pc -= 2		/* END,n is always two bytes */
+#include "code1_inst.inc"
+	default:
+	    SEE_ASSERT(interp, !"bad instruction");
+	}
+    }
 
+    /*
+     * The threaded loop runs the instructions decoded by code1_close().
+     * Branches are instruction indices, and ip points at the next
+     * instruction. With GNU C, each body jumps straight to the body
+     * of the next instruction through its label address.
+     */
+  threaded:
+#undef JUMP
+#undef PC_OFFSET
+#undef REWIND_END
+#define JUMP(addr)	ip = co->tinst + (addr)
+#define PC_OFFSET	(ip - co->tinst)
+#define REWIND_END()	ip--
+#define SKIP()		do { arg = ip->arg; ip++; } while (0)
+    ip = co->tinst + st->resume;
+#if __GNUC__
+#undef INST
+#undef NEXT
+#define INST(name)	L_##name
+#define NEXT		do { arg = ip->arg; goto *(ip++)->label; } while (0)
+    if (!co->tresolved) {
+	/* Indexed by opcode */
+	static const void * const labels[] = {
+	    &&L_NOP, &&L_DUP, &&L_POP, &&L_EXCH, &&L_ROLL3, &&L_THROW,
+	    &&L_SETC, &&L_GETC, &&L_THIS, &&L_OBJECT, &&L_ARRAY,
+	    &&L_REGEXP, &&L_REF, &&L_GETVALUE, &&L_LOOKUP, &&L_PUTVALUE,
+	    &&L_VREF, &&L_PUTVALUEA, &&L_DELETE, &&L_TYPEOF, &&L_TOOBJECT,
+	    &&L_TONUMBER, &&L_TOBOOLEAN, &&L_TOSTRING, &&L_TOPRIMITIVE,
+	    &&L_NEG, &&L_INV, &&L_NOT, &&L_MUL, &&L_DIV, &&L_MOD, &&L_ADD,
+	    &&L_SUB, &&L_LSHIFT, &&L_RSHIFT, &&L_URSHIFT, &&L_LT, &&L_GT,
+	    &&L_LE, &&L_GE, &&L_INSTANCEOF, &&L_IN, &&L_EQ, &&L_SEQ,
+	    &&L_BAND, &&L_BXOR, &&L_BOR, &&L_S_ENUM, &&L_S_WITH, &&L_NEW,
+	    &&L_CALL, &&L_END, &&L_B_ALWAYS, &&L_B_TRUE, &&L_B_ENUM,
+	    &&L_S_TRYC, &&L_S_TRYF, &&L_FUNC, &&L_LITERAL, &&L_LOC,
+	    &&L_S_CATCH, &&L_ENDF, &&L_LOADLOCAL, &&L_STORELOCAL,
+	    &&L_VREF_GETVALUE, &&L_LOOKUP_GETVALUE, &&L_REF_GETVALUE,
+	    &&L_LITERAL_ADD, &&L_LT_B_TRUE
+	};
+	for (i = 0; i < co->ntinst; i++)
+	    co->tinst[i].label = labels[co->tinst[i].op];
+	co->tresolved = 1;
+    }
+    NEXT;
+#include "code1_inst.inc"
+#else
+    for (;;) {
+	SEE_ASSERT(interp, ip < co->tinst + co->ntinst);
+	op = ip->op;
+	arg = ip->arg;
+	ip++;
+	switch (op) {
+#include "code1_inst.inc"
 	default:
 	    SEE_ASSERT(interp, !"bad instruction");
 	}
     }
+#endif
+#undef INST
+#undef NEXT
+#undef JUMP
+#undef PC_OFFSET
+#undef REWIND_END
+#undef SKIP
 }
 
 #ifdef notyet
@@ -1841,6 +1829,43 @@ build_basic_blocks(co)
 #endif
 
 #ifndef NDEBUG
+/* Prints the state of an inline cache, if the code has been closed */
+static void
+disasm_cache(co, arg)
+	struct code1 *co;
+	SEE_int32_t arg;
+{
+	struct shape_cache *cache;
+	int i, used = 0;
+
+	if (!co->cache || arg < 0 || arg >= co->ncache)
+	    return;
+	cache = co->cache + arg;
+	for (i = 0; i < SHAPE_CACHE_WAYS; i++)
+	    if (cache->entry[i].shape)
+		used++;
+	if (cache->disabled)
+	    dprintf(" disabled");
+	else if (cache->name) {
+	    dprintf(" ");
+	    dprints(cache->name);
+	    dprintf(" x%d", used);
+	}
+}
+
+/* Prints the name of a var */
+static void
+disasm_var(co, arg)
+	struct code1 *co;
+	SEE_int32_t arg;
+{
+	if (arg >= 0 && arg < co->nvar && co->var[arg] < co->nliteral &&
+	    SEE_VALUE_GET_TYPE(co->literal + co->var[arg]) == SEE_STRING)
+	    dprints(VAR_NAME(co, arg));
+	else
+	    dprintf("<invalid!>");
+}
+
 static SEE_int32_t
 disasm(co, pc)
 	struct code1 *co;
@@ -1885,13 +1910,14 @@ disasm(co, pc)
 	case INST_ARRAY:	dprintf("ARRAY"); break;
 	case INST_REGEXP:	dprintf("REGEXP"); break;
 	case INST_REF:		dprintf("REF"); break;
-	case INST_GETVALUE:	dprintf("GETVALUE"); break;
+	case INST_GETVALUE:	dprintf("GETVALUE,%-4d  ; cache", arg);
+				disasm_cache(co, arg);
+				break;
 	case INST_LOOKUP:	dprintf("LOOKUP"); break;
-	case INST_PUTVALUE:	if (len == 1) {
-				    dprintf("PUTVALUE"); 
-				    break;
-				}
-				dprintf("PUTVALUE,%-4d  ;", arg);
+	case INST_PUTVALUE:	dprintf("PUTVALUE,%-4d  ; cache", arg);
+				disasm_cache(co, arg);
+				break;
+	case INST_PUTVALUEA:	dprintf("PUTVALUEA,%-4d ;", arg);
 				if (arg & SEE_ATTR_READONLY)
 				    dprintf(" ReadOnly");
 				if (arg & SEE_ATTR_DONTENUM)
@@ -1902,13 +1928,13 @@ disasm(co, pc)
 				    dprintf(" Internal");
 				break;
 	case INST_VREF:		dprintf("VREF,%-4d      ; ", arg);
-				if (arg >= 0 && arg < co->nvar &&
-				    co->var[arg] < co->nliteral &&
-				    SEE_VALUE_GET_TYPE(co->literal +
-					co->var[arg]) == SEE_STRING)
-				    dprints(co->literal[co->var[arg]].u.string);
-				else
-				    dprintf("<invalid!>");
+				disasm_var(co, arg);
+				break;
+	case INST_LOADLOCAL:	dprintf("LOADLOCAL,%-4d ; ", arg);
+				disasm_var(co, arg);
+				break;
+	case INST_STORELOCAL:	dprintf("STORELOCAL,%-4d; ", arg);
+				disasm_var(co, arg);
 				break;
 	case INST_DELETE:	dprintf("DELETE"); break;
 	case INST_TYPEOF:	dprintf("TYPEOF"); break;
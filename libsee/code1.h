@@ -16,6 +16,11 @@
  *	1 0	- a signed 32 bit value (native endian) (ARG_WORD)
  *	1 1	- reserved
  *
+ *  The integer following GETVALUE and PUTVALUE indexes the code object's
+ *  array of inline caches (see shape.h). PUTVALUEA carries attributes.
+ *  LOADLOCAL and STORELOCAL index the frame slots of framed code, which
+ *  are named by the var array; the parameters take the first slots.
+ *
  */
 
 /* Instruction byte argument descriptor */
@@ -43,7 +48,7 @@
 #define INST_LOOKUP		0x0e
 #define INST_PUTVALUE		0x0f
 #define INST_VREF  		0x10
-                             /* 0x11 was INST_VAR */
+#define INST_PUTVALUEA		0x11	/* was INST_VAR */
 #define INST_DELETE		0x12
 #define INST_TYPEOF		0x13
 
@@ -99,14 +104,32 @@
 #define INST_S_CATCH		0x3c
 #define INST_ENDF   		0x3d
 
-                             /* 0x3e unused */
-                             /* 0x3f unused */
+#define INST_LOADLOCAL		0x3e
+#define INST_STORELOCAL		0x3f
                              /* ---- don't exceed 0x3f! */
 
+/* Superinstructions. These only appear in decoded instructions, where
+ * they run a pair of instructions. The second of the pair is left in
+ * place, and holds the second argument. */
+#define INST_VREF_GETVALUE	0x40
+#define INST_LOOKUP_GETVALUE	0x41
+#define INST_REF_GETVALUE	0x42
+#define INST_LITERAL_ADD	0x43
+#define INST_LT_B_TRUE		0x44
+
 struct SEE_code;
 struct SEE_value;
 struct SEE_throw_location;
 struct SEE_interpreter;
+struct shape_cache;
+
+/* A pre-decoded instruction, for the threaded loop. Branch arguments
+ * are instruction indices instead of byte offsets. */
+struct code1_tinst {
+    const void		*label;		/* body address, or NULL */
+    SEE_int32_t		 arg;
+    unsigned char	 op;		/* without the INST_ARG bits */
+};
 
 struct code1 {
     struct SEE_code	 code;
@@ -118,6 +141,13 @@ struct code1 {
     unsigned int	 ninst, nliteral, nlocation, nfunc, nvar;
     struct SEE_growable	 ginst, gliteral, glocation, gfunc, gvar;
     int	maxstack, maxblock, maxargc;
+    struct shape_cache	*cache;		/* inline caches, made by close */
+    unsigned int	 ncache;
+    int			 nparams;	/* parameter slots, if framed */
+    int			 threaded;	/* decode into tinst at close */
+    struct code1_tinst	*tinst;		/* decoded instructions, or NULL */
+    unsigned int	 ntinst;
+    int			 tresolved;	/* tinst labels are set */
 };
 
 #endif /* _SEE_h_code1_ */
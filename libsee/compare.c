@@ -48,6 +48,8 @@ _SEE_RelationalExpression_sub(interp, x, y, res)
             else
                 SEE_SET_BOOLEAN(res, r4.u.number < r5.u.number);
         } else {
+            SEE_STRING_FLATTEN(r1.u.string);
+            SEE_STRING_FLATTEN(r2.u.string);
             for (k = 0;
                  k < r1.u.string->length && k < r2.u.string->length;
                  k++)
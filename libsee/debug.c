@@ -83,7 +83,10 @@ SEE_PrintValue(interp, v, f)
 	case SEE_REFERENCE:
 	    fprintf(f, "<ref base=<object %p> prop=", 
 	    	(void *)v->u.reference.base);
-	    SEE_string_fputs(v->u.reference.property, f);
+	    if (v->u.reference.property)
+		SEE_string_fputs(v->u.reference.property, f);
+	    else
+		fprintf(f, "[%lu]", (unsigned long)v->u.reference._index);
 	    fprintf(f, ">");
 	    break;
 	case SEE_COMPLETION:
@@ -192,6 +195,7 @@ SEE_PrintString(interp, s, f)
 	    fprintf(f, "<NULL>");
 	else {
 	    /* NB Replicates most of SEE_string_literal(). */
+	    SEE_STRING_FLATTEN(s);
 	    fprintf(f, "\"");
 	    for (i = 0; i < s->length; i++) {
 		SEE_char_t c = s->data[i];
@@ -7,6 +7,7 @@ double	SEE_strtod(const char *s00, char **se);
 char *	SEE_dtoa(double d, int mode, int ndigits, int *decpt, int *sign, 
 		char **rve);
 void	SEE_freedtoa(char *s);
+int	_SEE_grisu3(double v, char *buf, int *decpt);
 
 #define DTOA_MODE_SHORT			0	/* shortest string */
 #define DTOA_MODE_SHORT_SW		1	/* " w/ Steele & White rule */
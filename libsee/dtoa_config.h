@@ -4,6 +4,10 @@
  * Configuration directives for dtoa when used by SEE
  */
 
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #if STDC_HEADERS
 #include <float.h>
 #include <stdlib.h>
@@ -52,6 +56,14 @@
 /* #define Bad_float_h if your system lacks a float.h or if it does not */
 /* #define INFNAN_CHECK on IEEE systems to cause strtod to check for */
 /* #define MULTIPLE_THREADS if the system offers preemptively scheduled */
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_MUTEX_LOCK
+#include <pthread.h>
+#define MULTIPLE_THREADS
+static pthread_mutex_t dtoa_lock[2] =
+	{ PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+#define ACQUIRE_DTOA_LOCK(n)	pthread_mutex_lock(&dtoa_lock[n])
+#define FREE_DTOA_LOCK(n)	pthread_mutex_unlock(&dtoa_lock[n])
+#endif
 /* #define NO_IEEE_Scale to disable new (Feb. 1997) logic in strtod that */
 /* #define YES_ALIAS to permit aliasing certain double values with */
 /* #define USE_LOCALE to use the current locale's decimal_point value. */
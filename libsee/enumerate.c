@@ -43,6 +43,7 @@
 
 #include "enumerate.h"
 #include "array.h"
+#include "cfunction_private.h"
 
 /*
  * Enumeration of an object's properties
@@ -92,6 +93,7 @@ make_list(interp, o, depth, head)
 	struct propname_list *l;
 	struct SEE_string *s;
 	struct SEE_enum *e;
+	struct SEE_object *p;
 	int dontenum;
 	int count;
 
@@ -109,8 +111,8 @@ make_list(interp, o, depth, head)
 		}
 	}
 	/* Assumes no prototype cycles! */
-	if (o->Prototype)
-		count += make_list(interp, o->Prototype, depth + 1, head);
+	if ((p = _SEE_CFUNCTION_PROTOTYPE(interp, o)))
+		count += make_list(interp, p, depth + 1, head);
 	return count;
 }
 
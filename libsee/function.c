@@ -47,6 +47,7 @@
 #include "function.h"
 #include "parse.h"
 #include "stringdefs.h"
+#include "snapshot.h"
 
 /*
  * A function is an internal object that embodies executable code, and
@@ -60,7 +61,19 @@
  * Function instance creation (13.2) 'struct function' pointer comparison
  * is sufficient for telling if two Function instances are joined.
  */
- 
+
+static const struct snapshot_word function_words[] = {
+	SNAPSHOT_PTR(struct function, params),
+	SNAPSHOT_PTR(struct function, body),
+	SNAPSHOT_PTR(struct function, name),
+	SNAPSHOT_PTR(struct function, common),
+	SNAPSHOT_PTR(struct function, cache),
+	SNAPSHOT_PTR(struct function, next),
+	SNAPSHOT_PTR(struct function, sec_domain),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(function_layout, struct function, function_words);
+
 /*
  * Create a new function 'core' entity (struct function) with a initial
  * common function object instance.
@@ -79,6 +92,7 @@ SEE_function_make(interp, name, params, body)
 	struct SEE_object *F;
 
 	f = SEE_NEW(interp, struct function);
+	SNAPSHOT_LAYOUT(interp, f, &function_layout);
 
 	f->body = body;
 	f->sec_domain = interp->sec_domain;
@@ -93,6 +107,7 @@ SEE_function_make(interp, name, params, body)
 	    f->nparams++;
 	if (f->nparams) {
 	    f->params = SEE_NEW_ARRAY(interp, struct SEE_string *, f->nparams);
+	    SNAPSHOT_LAYOUT(interp, f->params, &_SEE_snapshot_pointers);
 	    for (i = 0, v = params; v; v = v->next, i++)
 	        f->params[i] = _SEE_INTERN_ASSERT(interp, v->name);
 	} else
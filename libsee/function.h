@@ -42,6 +42,8 @@ struct SEE_object *SEE_function_inst_create(struct SEE_interpreter *i,
 	struct function *func, struct SEE_scope *scope);
 struct SEE_string *SEE_function_getname(struct SEE_interpreter * i,
         struct SEE_object *o);
+struct SEE_object *_SEE_function_activation(struct SEE_interpreter *i,
+	struct SEE_object *callee, int argc, struct SEE_value **argv);
 /* cfunction.c */
 struct SEE_string *SEE_cfunction_getname(struct SEE_interpreter *i,
         struct SEE_object *o);
@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2007
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include <see/type.h>
+
+#include "dtoa.h"
+
+/*
+ * Shortest round-trip digits of a double, by Florian Loitsch's Grisu3
+ * ("Printing Floating-Point Numbers Quickly and Accurately with
+ * Integers", PLDI 2010).
+ *
+ * The number and the two boundaries half an ulp either side of it are
+ * scaled by a cached power of ten into 64-bit integers, and digits are
+ * generated from the scaled upper boundary until they fall inside the
+ * rounding interval. Because the scaling is inexact, the last digit is
+ * then checked against the error bound; in about 0.5% of cases the
+ * result cannot be proven shortest and closest, and _SEE_grisu3()
+ * returns 0 so that the caller can fall back to SEE_dtoa().
+ */
+
+#if SEE_NUMBER_IS_DOUBLE
+
+struct diyfp {
+	SEE_uint64_t f;		/* significand */
+	int e;			/* binary exponent */
+};
+
+#define HI(f)		((SEE_uint64_t)(f) << 32)
+#define HIDDEN_BIT	HI(0x00100000)			/* 2^52 */
+#define FRAC_MASK	(HIDDEN_BIT - 1)
+#define EXP_BIAS	(0x3ff + 52)
+#define DENORM_EXP	(1 - EXP_BIAS)
+
+/* Target range of the scaled binary exponent */
+#define MIN_TARGET_EXP	(-60)
+#define MAX_TARGET_EXP	(-32)
+
+/*
+ * Normalized 64-bit significands of 10^k for k = -348, -340 ... 340,
+ * with their binary exponents.
+ */
+static const struct cached_power {
+	SEE_uint32_t hi, lo;
+	short binary_exp, decimal_exp;
+} cached_powers[] = {
+	{ 0xfa8fd5a0, 0x081c0288, -1220, -348 },
+	{ 0xbaaee17f, 0xa23ebf76, -1193, -340 },
+	{ 0x8b16fb20, 0x3055ac76, -1166, -332 },
+	{ 0xcf42894a, 0x5dce35ea, -1140, -324 },
+	{ 0x9a6bb0aa, 0x55653b2d, -1113, -316 },
+	{ 0xe61acf03, 0x3d1a45df, -1087, -308 },
+	{ 0xab70fe17, 0xc79ac6ca, -1060, -300 },
+	{ 0xff77b1fc, 0xbebcdc4f, -1034, -292 },
+	{ 0xbe5691ef, 0x416bd60c, -1007, -284 },
+	{ 0x8dd01fad, 0x907ffc3c,  -980, -276 },
+	{ 0xd3515c28, 0x31559a83,  -954, -268 },
+	{ 0x9d71ac8f, 0xada6c9b5,  -927, -260 },
+	{ 0xea9c2277, 0x23ee8bcb,  -901, -252 },
+	{ 0xaecc4991, 0x4078536d,  -874, -244 },
+	{ 0x823c1279, 0x5db6ce57,  -847, -236 },
+	{ 0xc2109436, 0x4dfb5637,  -821, -228 },
+	{ 0x9096ea6f, 0x3848984f,  -794, -220 },
+	{ 0xd77485cb, 0x25823ac7,  -768, -212 },
+	{ 0xa086cfcd, 0x97bf97f4,  -741, -204 },
+	{ 0xef340a98, 0x172aace5,  -715, -196 },
+	{ 0xb23867fb, 0x2a35b28e,  -688, -188 },
+	{ 0x84c8d4df, 0xd2c63f3b,  -661, -180 },
+	{ 0xc5dd4427, 0x1ad3cdba,  -635, -172 },
+	{ 0x936b9fce, 0xbb25c996,  -608, -164 },
+	{ 0xdbac6c24, 0x7d62a584,  -582, -156 },
+	{ 0xa3ab6658, 0x0d5fdaf6,  -555, -148 },
+	{ 0xf3e2f893, 0xdec3f126,  -529, -140 },
+	{ 0xb5b5ada8, 0xaaff80b8,  -502, -132 },
+	{ 0x87625f05, 0x6c7c4a8b,  -475, -124 },
+	{ 0xc9bcff60, 0x34c13053,  -449, -116 },
+	{ 0x964e858c, 0x91ba2655,  -422, -108 },
+	{ 0xdff97724, 0x70297ebd,  -396, -100 },
+	{ 0xa6dfbd9f, 0xb8e5b88f,  -369,  -92 },
+	{ 0xf8a95fcf, 0x88747d94,  -343,  -84 },
+	{ 0xb9447093, 0x8fa89bcf,  -316,  -76 },
+	{ 0x8a08f0f8, 0xbf0f156b,  -289,  -68 },
+	{ 0xcdb02555, 0x653131b6,  -263,  -60 },
+	{ 0x993fe2c6, 0xd07b7fac,  -236,  -52 },
+	{ 0xe45c10c4, 0x2a2b3b06,  -210,  -44 },
+	{ 0xaa242499, 0x697392d3,  -183,  -36 },
+	{ 0xfd87b5f2, 0x8300ca0e,  -157,  -28 },
+	{ 0xbce50864, 0x92111aeb,  -130,  -20 },
+	{ 0x8cbccc09, 0x6f5088cc,  -103,  -12 },
+	{ 0xd1b71758, 0xe219652c,   -77,   -4 },
+	{ 0x9c400000, 0x00000000,   -50,    4 },
+	{ 0xe8d4a510, 0x00000000,   -24,   12 },
+	{ 0xad78ebc5, 0xac620000,     3,   20 },
+	{ 0x813f3978, 0xf8940984,    30,   28 },
+	{ 0xc097ce7b, 0xc90715b3,    56,   36 },
+	{ 0x8f7e32ce, 0x7bea5c70,    83,   44 },
+	{ 0xd5d238a4, 0xabe98068,   109,   52 },
+	{ 0x9f4f2726, 0x179a2245,   136,   60 },
+	{ 0xed63a231, 0xd4c4fb27,   162,   68 },
+	{ 0xb0de6538, 0x8cc8ada8,   189,   76 },
+	{ 0x83c7088e, 0x1aab65db,   216,   84 },
+	{ 0xc45d1df9, 0x42711d9a,   242,   92 },
+	{ 0x924d692c, 0xa61be758,   269,  100 },
+	{ 0xda01ee64, 0x1a708dea,   295,  108 },
+	{ 0xa26da399, 0x9aef774a,   322,  116 },
+	{ 0xf209787b, 0xb47d6b85,   348,  124 },
+	{ 0xb454e4a1, 0x79dd1877,   375,  132 },
+	{ 0x865b8692, 0x5b9bc5c2,   402,  140 },
+	{ 0xc83553c5, 0xc8965d3d,   428,  148 },
+	{ 0x952ab45c, 0xfa97a0b3,   455,  156 },
+	{ 0xde469fbd, 0x99a05fe3,   481,  164 },
+	{ 0xa59bc234, 0xdb398c25,   508,  172 },
+	{ 0xf6c69a72, 0xa3989f5c,   534,  180 },
+	{ 0xb7dcbf53, 0x54e9bece,   561,  188 },
+	{ 0x88fcf317, 0xf22241e2,   588,  196 },
+	{ 0xcc20ce9b, 0xd35c78a5,   614,  204 },
+	{ 0x98165af3, 0x7b2153df,   641,  212 },
+	{ 0xe2a0b5dc, 0x971f303a,   667,  220 },
+	{ 0xa8d9d153, 0x5ce3b396,   694,  228 },
+	{ 0xfb9b7cd9, 0xa4a7443c,   720,  236 },
+	{ 0xbb764c4c, 0xa7a44410,   747,  244 },
+	{ 0x8bab8eef, 0xb6409c1a,   774,  252 },
+	{ 0xd01fef10, 0xa657842c,   800,  260 },
+	{ 0x9b10a4e5, 0xe9913129,   827,  268 },
+	{ 0xe7109bfb, 0xa19c0c9d,   853,  276 },
+	{ 0xac2820d9, 0x623bf429,   880,  284 },
+	{ 0x80444b5e, 0x7aa7cf85,   907,  292 },
+	{ 0xbf21e440, 0x03acdd2d,   933,  300 },
+	{ 0x8e679c2f, 0x5e44ff8f,   960,  308 },
+	{ 0xd433179d, 0x9c8cb841,   986,  316 },
+	{ 0x9e19db92, 0xb4e31ba9,  1013,  324 },
+	{ 0xeb96bf6e, 0xbadf77d9,  1039,  332 },
+	{ 0xaf87023b, 0x9bf0ee6b,  1066,  340 },
+};
+#define CACHED_POWERS_OFFSET	348	/* -decimal_exp of cached_powers[0] */
+#define CACHED_POWERS_STEP	8
+
+/* Returns x * y rounded to 64 bits */
+static struct diyfp
+multiply(x, y)
+	struct diyfp x, y;
+{
+	SEE_uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+	SEE_uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+	SEE_uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	SEE_uint64_t tmp;
+	struct diyfp r;
+
+	tmp = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff);
+	tmp += (SEE_uint64_t)1 << 31;			/* round */
+	r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	r.e = x.e + y.e + 64;
+	return r;
+}
+
+/* Shifts a non-zero diyfp left until its top bit is set */
+static struct diyfp
+normalize(x)
+	struct diyfp x;
+{
+	while (!(x.f & HI(0xffc00000))) {
+		x.f <<= 10;
+		x.e -= 10;
+	}
+	while (!(x.f & HI(0x80000000))) {
+		x.f <<= 1;
+		x.e -= 1;
+	}
+	return x;
+}
+
+/*
+ * Returns the cached power of ten c whose product with a number of
+ * binary exponent e has an exponent in [MIN_TARGET_EXP, MAX_TARGET_EXP].
+ * Sets *decimal_exp to the power of ten.
+ */
+static struct diyfp
+cached_power(e, decimal_exp)
+	int e;
+	int *decimal_exp;
+{
+	double dk = (MIN_TARGET_EXP - (e + 64) + 63) * 0.30102999566398114;
+	int k = (int)dk, i;
+	struct diyfp c;
+
+	if (k < dk)
+		k++;					/* ceil */
+	i = (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1;
+	c.f = HI(cached_powers[i].hi) | cached_powers[i].lo;
+	c.e = cached_powers[i].binary_exp;
+	*decimal_exp = cached_powers[i].decimal_exp;
+	return c;
+}
+
+/*
+ * Moves the last generated digit towards w while that stays inside the
+ * safe interval, then checks that the digits are provably closest.
+ * Returns 0 if they cannot be trusted.
+ */
+static int
+round_weed(buf, len, dist_too_high_w, unsafe_interval, rest, ten_kappa, unit)
+	char *buf;
+	int len;
+	SEE_uint64_t dist_too_high_w, unsafe_interval, rest, ten_kappa, unit;
+{
+	SEE_uint64_t small_dist = dist_too_high_w - unit;
+	SEE_uint64_t big_dist = dist_too_high_w + unit;
+
+	while (rest < small_dist &&
+	       unsafe_interval - rest >= ten_kappa &&
+	       (rest + ten_kappa < small_dist ||
+		small_dist - rest >= rest + ten_kappa - small_dist))
+	{
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+	if (rest < big_dist &&
+	    unsafe_interval - rest >= ten_kappa &&
+	    (rest + ten_kappa < big_dist ||
+	     big_dist - rest > rest + ten_kappa - big_dist))
+		return 0;
+	return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+/*
+ * Generates the shortest digits of w that lie strictly between low
+ * and high (all scaled, with the same exponent). Returns the number
+ * of digits, or 0 on failure; sets *kappa to the power of ten of the
+ * last digit.
+ */
+static int
+digit_gen(low, w, high, buf, kappa)
+	struct diyfp low, w, high;
+	char *buf;
+	int *kappa;
+{
+	SEE_uint64_t unit = 1;
+	SEE_uint64_t too_low = low.f - unit, too_high = high.f + unit;
+	SEE_uint64_t unsafe_interval = too_high - too_low;
+	int shift = -w.e;
+	SEE_uint64_t one = (SEE_uint64_t)1 << shift;
+	SEE_uint32_t integrals = (SEE_uint32_t)(too_high >> shift);
+	SEE_uint64_t fractionals = too_high & (one - 1);
+	SEE_uint32_t divisor;
+	SEE_uint64_t rest;
+	int len = 0, digit;
+
+	/* The largest power of ten not above the integral part */
+	for (divisor = 1, *kappa = 1; integrals / 10 >= divisor; (*kappa)++)
+		divisor *= 10;
+
+	while (*kappa > 0) {
+		digit = integrals / divisor;
+		buf[len++] = '0' + digit;
+		integrals %= divisor;
+		(*kappa)--;
+		rest = ((SEE_uint64_t)integrals << shift) + fractionals;
+		if (rest < unsafe_interval)
+			return round_weed(buf, len, too_high - w.f,
+			    unsafe_interval, rest,
+			    (SEE_uint64_t)divisor << shift, unit) ? len : 0;
+		divisor /= 10;
+	}
+	for (;;) {
+		fractionals *= 10;
+		unit *= 10;
+		unsafe_interval *= 10;
+		digit = (int)(fractionals >> shift);
+		buf[len++] = '0' + digit;
+		fractionals &= one - 1;
+		(*kappa)--;
+		if (fractionals < unsafe_interval)
+			return round_weed(buf, len, (too_high - w.f) * unit,
+			    unsafe_interval, fractionals, one, unit) ? len : 0;
+	}
+}
+
+/*
+ * Writes the shortest digits that read back as the finite, positive
+ * number v into buf (at least 18 chars, not nul-terminated), and sets
+ * *decpt to the position of the decimal point relative to the first
+ * digit, as SEE_dtoa() does. Returns the number of digits, or 0 if
+ * SEE_dtoa() must be used instead.
+ */
+int
+_SEE_grisu3(v, buf, decpt)
+	double v;
+	char *buf;
+	int *decpt;
+{
+	SEE_uint64_t bits;
+	struct diyfp w, m_plus, m_minus, c;
+	int biased_e, mk, kappa, len;
+
+	memcpy(&bits, &v, sizeof bits);
+	biased_e = (int)(bits >> 52) & 0x7ff;
+	if (biased_e == 0) {
+		w.f = bits & FRAC_MASK;
+		w.e = DENORM_EXP;
+	} else {
+		w.f = (bits & FRAC_MASK) | HIDDEN_BIT;
+		w.e = biased_e - EXP_BIAS;
+	}
+
+	/* Boundaries halfway to the neighbouring doubles */
+	m_plus.f = (w.f << 1) + 1;
+	m_plus.e = w.e - 1;
+	m_plus = normalize(m_plus);
+	if (w.f == HIDDEN_BIT && biased_e > 1) {
+		/* The next double down is only half as far away */
+		m_minus.f = (w.f << 2) - 1;
+		m_minus.e = w.e - 2;
+	} else {
+		m_minus.f = (w.f << 1) - 1;
+		m_minus.e = w.e - 1;
+	}
+	m_minus.f <<= m_minus.e - m_plus.e;
+	m_minus.e = m_plus.e;
+
+	w = normalize(w);
+	c = cached_power(w.e, &mk);
+	len = digit_gen(multiply(m_minus, c), multiply(w, c),
+	    multiply(m_plus, c), buf, &kappa);
+	*decpt = len + kappa - mk;
+	return len;
+}
+
+#else /* !SEE_NUMBER_IS_DOUBLE */
+
+int
+_SEE_grisu3(v, buf, decpt)
+	double v;
+	char *buf;
+	int *decpt;
+{
+	return 0;
+}
+
+#endif /* !SEE_NUMBER_IS_DOUBLE */
@@ -106,6 +106,7 @@ SEE_input_string(interp, s)
 {
 	struct input_string *inps;
 
+	SEE_STRING_FLATTEN(s);
 	inps = SEE_NEW(interp, struct input_string);
 	inps->cur = s->data;
 	inps->end = s->data + s->length;
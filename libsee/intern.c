@@ -48,6 +48,7 @@
 
 #include "stringdefs.h"
 #include "dprint.h"
+#include "snapshot.h"
 
 /*
  * Internalised strings.
@@ -70,28 +71,53 @@
  * read-only).
  */
 
-#define HASHTABSZ	257
-#define HASHLENMAX	8		/* prefix of string hashed on */
+#define INITIAL_SIZE	256		/* initial buckets; a power of 2 */
+
+/* Fowler-Noll-Vo (FNV-1a) hash over the string's 16-bit units */
+#define HASH_INIT	2166136261U
+#define HASH_STEP(h, c)	(((h) ^ (c)) * 16777619U)
 
 struct intern {				/* element in the intern hash table */
 	struct intern *next;
 	struct SEE_string *string;
 };
-typedef struct intern *(intern_tab_t[HASHTABSZ]);
+
+struct intern_tab {
+	unsigned int size;		/* number of buckets; a power of 2 */
+	unsigned int count;		/* number of entries */
+	struct intern **bucket;
+};
+
+static const struct snapshot_word intern_tab_words[] = {
+	SNAPSHOT_PTR(struct intern_tab, bucket),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(intern_tab_layout, struct intern_tab,
+	intern_tab_words);
 
 /* Prototypes */
-static struct intern *  make(struct SEE_interpreter *, struct SEE_string *);
+static struct intern *  make(struct SEE_interpreter *, struct SEE_string *,
+			     unsigned int);
 static unsigned int     hash(const struct SEE_string *);
-static struct intern ** find(intern_tab_t *, struct SEE_string *,
+static struct intern ** find(struct intern_tab *, struct SEE_string *,
+			     unsigned int);
+static void		tab_init(struct SEE_interpreter *, struct intern_tab *,
 			     unsigned int);
+static struct SEE_string *insert(struct SEE_interpreter *,
+			     struct intern_tab *, struct intern **,
+			     struct SEE_string *, unsigned int);
 static int internalized(struct SEE_interpreter *interp,
 			const struct SEE_string *s);
-static void global_init(void);
+static struct SEE_string *global_add(const SEE_char_t *, unsigned int);
 
 /** System-wide intern table */
-static intern_tab_t	global_intern_tab;
+static struct intern_tab global_intern_tab;
 static int		global_intern_tab_initialized;
 
+/** Interned strings of every Latin-1 character, and of small integers */
+struct SEE_string *_SEE_intern_chars[_SEE_INTERN_NCHARS];
+struct SEE_string *_SEE_intern_ints[_SEE_INTERN_NINTS];
+
 #ifndef NDEBUG
 static int		global_intern_tab_locked = 0;
 int			SEE_debug_intern;
@@ -111,18 +137,22 @@ string_only_contains_ascii(s)
 
 /**
  * Make an intern entry in the hash table containing the string s,
- *  and flag s as being interned.
+ *  and flag s as being interned. The string's hash is cached in it
+ *  so that later lookups and table growth need not recompute it.
  */
 static struct intern *
-make(interp, s)
+make(interp, s, h)
 	struct SEE_interpreter *interp;		/* may be NULL */
 	struct SEE_string *s;
+	unsigned int h;
 {
 	struct intern *i;
 
 	i = SEE_NEW(interp, struct intern);
+	SNAPSHOT_LAYOUT(interp, i, &_SEE_snapshot_pointers);
 	i->string = s;
-	s->flags |= SEE_STRING_FLAG_INTERNED;
+	s->hash = h;
+	s->flags |= SEE_STRING_FLAG_INTERNED | SEE_STRING_FLAG_HASHED;
 	i->next = NULL;
 	return i;
 }
@@ -132,10 +162,13 @@ static unsigned int
 hash(s)
 	const struct SEE_string *s;
 {
-	unsigned int j, h = 0;
-	for (j = 0; j < HASHLENMAX && j < s->length; j++)
-		h = (h << 1) ^ s->data[j];
-	return h % HASHTABSZ;
+	unsigned int j, h = HASH_INIT;
+
+	if (s->flags & SEE_STRING_FLAG_HASHED)
+		return s->hash;
+	for (j = 0; j < s->length; j++)
+		h = HASH_STEP(h, s->data[j]);
+	return h;
 }
 
 /** 
@@ -149,28 +182,92 @@ hash_ascii(s, lenret)
 	const char *s;
 	unsigned int *lenret;
 {
-	unsigned int j, h = 0;
+	unsigned int h = HASH_INIT;
 	const char *t;
 
-	for (j = 0, t = s; j < HASHLENMAX && *t; j++, t++)
-		h = (h << 1) ^ *t;
-	while (*t) t++;
+	for (t = s; *t; t++)
+		h = HASH_STEP(h, (unsigned char)*t);
 	*lenret = t - s;
-	return h % HASHTABSZ;
+	return h;
+}
+
+/** Allocates an empty table with the given number of buckets */
+static void
+tab_init(interp, tab, size)
+	struct SEE_interpreter *interp;		/* may be NULL */
+	struct intern_tab *tab;
+	unsigned int size;
+{
+	unsigned int i;
+
+	tab->bucket = SEE_NEW_ARRAY(interp, struct intern *, size);
+	SNAPSHOT_LAYOUT(interp, tab->bucket, &_SEE_snapshot_pointers);
+	for (i = 0; i < size; i++)
+		tab->bucket[i] = NULL;
+	tab->size = size;
+	tab->count = 0;
+}
+
+/**
+ * Doubles the number of buckets in a table, moving the entries
+ * across using their cached hashes.
+ */
+static void
+grow(interp, tab)
+	struct SEE_interpreter *interp;		/* may be NULL */
+	struct intern_tab *tab;
+{
+	struct intern **old = tab->bucket, *i, *next;
+	unsigned int j, oldsize = tab->size, count = tab->count;
+
+	tab_init(interp, tab, oldsize * 2);
+	for (j = 0; j < oldsize; j++)
+		for (i = old[j]; i; i = next) {
+			next = i->next;
+			i->next = tab->bucket[i->string->hash & (tab->size - 1)];
+			tab->bucket[i->string->hash & (tab->size - 1)] = i;
+		}
+	tab->count = count;
+	SEE_free(interp, (void **)&old);
+}
+
+/**
+ * Adds a string at the empty chain end x (as returned by find()),
+ * growing the table once it averages more than one entry per bucket.
+ */
+static struct SEE_string *
+insert(interp, tab, x, s, h)
+	struct SEE_interpreter *interp;		/* may be NULL */
+	struct intern_tab *tab;
+	struct intern **x;
+	struct SEE_string *s;
+	unsigned int h;
+{
+	*x = make(interp, s, h);
+	if (++tab->count > tab->size)
+		grow(interp, tab);
+	return s;
 }
 
 /** Find an interned string */
 static struct intern **
 find(intern_tab, s, hash)
-	intern_tab_t *intern_tab;
+	struct intern_tab *intern_tab;
 	struct SEE_string *s;
 	unsigned int hash;
 {
 	struct intern **x;
-
-	x = &(*intern_tab)[hash];
-	while (*x && SEE_string_cmp((*x)->string, s) != 0)
-		x = &((*x)->next);
+	struct SEE_string *t;
+
+	x = &intern_tab->bucket[hash & (intern_tab->size - 1)];
+	for (; *x; x = &((*x)->next)) {
+		t = (*x)->string;
+		if (t == s)
+			break;
+		if (t->hash == hash && t->length == s->length &&
+		    SEE_string_cmp(t, s) == 0)
+			break;
+	}
 	return x;
 }
 
@@ -196,16 +293,21 @@ ascii_eq(str, s)
 
 /** Find an interned ASCII string */
 static struct intern **
-find_ascii(intern_tab, s, hash)
-	intern_tab_t *intern_tab;
+find_ascii(intern_tab, s, len, hash)
+	struct intern_tab *intern_tab;
 	const char *s;
+	unsigned int len;
 	unsigned int hash;
 {
 	struct intern **x;
+	struct SEE_string *t;
 
-	x = &(*intern_tab)[hash];
-	while (*x && !ascii_eq((*x)->string, s))
-		x = &((*x)->next);
+	x = &intern_tab->bucket[hash & (intern_tab->size - 1)];
+	for (; *x; x = &((*x)->next)) {
+		t = (*x)->string;
+		if (t->hash == hash && t->length == len && ascii_eq(t, s))
+			break;
+	}
 	return x;
 }
 
@@ -214,22 +316,28 @@ void
 _SEE_intern_init(interp)
 	struct SEE_interpreter *interp;
 {
-	intern_tab_t *intern_tab;
-	unsigned int i;
+	struct intern_tab *intern_tab;
 
-	global_init();
+	_SEE_intern_global_init();
 #ifndef NDEBUG
 	global_intern_tab_locked = 1;
 #endif
 
-	intern_tab = SEE_NEW(interp, intern_tab_t);
-	for (i = 0; i < HASHTABSZ; i++)
-		(*intern_tab)[i] = NULL;
-
+	intern_tab = SEE_NEW(interp, struct intern_tab);
+	SNAPSHOT_LAYOUT(interp, intern_tab, &intern_tab_layout);
+	tab_init(interp, intern_tab, INITIAL_SIZE);
 	interp->intern_tab = intern_tab;
 }
 
-/* Returns true if the string is already internalized */
+/*
+ * Returns true if the string is already internalized.
+ * This is the fast exit taken by most calls to SEE_intern().
+ */
+#define INTERNALIZED(interp, s)						\
+	((((s)->flags & SEE_STRING_FLAG_INTERNED) &&			\
+	  (!(s)->interpreter || (s)->interpreter == (interp))) ||	\
+	 ((s) >= STRn(0) && (s) < STRn(SEE_nstringtab)))
+
 static int
 internalized(interp, s)
 	struct SEE_interpreter *interp;
@@ -240,10 +348,7 @@ internalized(interp, s)
 	 *  - is already internalized in this interpreter or the global hash
 	 *  - is one of the static resource strings
 	 */
-	return 
-	    ((!s->interpreter || s->interpreter == interp) &&
-	     (s->flags & SEE_STRING_FLAG_INTERNED)) ||
-	    (s >= STRn(0) && s < STRn(SEE_nstringtab));
+	return INTERNALIZED(interp, s);
 }
 
 /**
@@ -260,6 +365,7 @@ SEE_intern(interp, s)
 	struct SEE_string *s;
 {
 	struct intern **x;
+	struct SEE_string *is;
 	unsigned int h;
 #ifndef NDEBUG
 	const char *where = NULL;
@@ -272,7 +378,7 @@ SEE_intern(interp, s)
 	if (!s)
 	    return NULL;
 
-	if (internalized(interp, s)) {
+	if (INTERNALIZED(interp, s)) {
 #ifndef NDEBUG
 		if (SEE_debug_intern) {
 		    dprintf("INTERN ");
@@ -283,6 +389,8 @@ SEE_intern(interp, s)
 		return s;
 	}
 
+	SEE_STRING_FLATTEN(s);
+
 	/* If the string is from another interpreter, then it must
 	 * have been intern'd already. This is to prevent race conditions
 	 * with string whose content is changing. */
@@ -293,11 +401,16 @@ SEE_intern(interp, s)
 	h = hash(s);
 	x = find(&global_intern_tab, s, h);
 	WHERE("global");
-	if (!*x) {
+	if (*x)
+		is = (*x)->string;
+	else {
 		x = find(interp->intern_tab, s, h);
 		WHERE("local");
-		if (!*x) {
-			*x = make(interp, _SEE_string_dup_fix(interp, s));
+		if (*x)
+			is = (*x)->string;
+		else {
+			is = insert(interp, interp->intern_tab, x,
+			    _SEE_string_dup_fix(interp, s), h);
 			WHERE("new");
 		}
 	}
@@ -305,10 +418,10 @@ SEE_intern(interp, s)
 	if (SEE_debug_intern) {
 	    dprintf("INTERN ");
 	    dprints(s);
-	    dprintf(" -> %p [%s h=%d]\n", (*x)->string, where, h);
+	    dprintf(" -> %p [%s h=%08x]\n", is, where, h);
 	}
 #endif
-	return (*x)->string;
+	return is;
 
 }
 
@@ -331,14 +444,19 @@ SEE_intern_ascii(interp, s)
 	SEE_ASSERT(interp, string_only_contains_ascii(s));
 
 	h = hash_ascii(s, &len);
-	x = find_ascii(&global_intern_tab, s, h);
+	x = find_ascii(&global_intern_tab, s, len, h);
 	WHERE("global");
-	if (!*x) {
-	    x = find_ascii(interp->intern_tab, s, h);
+	if (*x)
+	    str = (*x)->string;
+	else {
+	    x = find_ascii(interp->intern_tab, s, len, h);
 	    WHERE("local");
-	    if (!*x) {
+	    if (*x)
+		str = (*x)->string;
+	    else {
 		WHERE("new");
 		str = SEE_NEW(interp, struct SEE_string);
+		SNAPSHOT_LAYOUT(interp, str, &_SEE_snapshot_string);
 		str->length = len;
 		str->data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, len);
 		for (c = str->data, t = s; *t;)
@@ -347,15 +465,15 @@ SEE_intern_ascii(interp, s)
 		str->stringclass = NULL;
 		str->flags = 0;
 	    	SEE_ASSERT(interp, hash(str) == h);
-		*x = make(interp, str);
+		insert(interp, interp->intern_tab, x, str, h);
 		}
 	    }
 #ifndef NDEBUG
 	if (SEE_debug_intern)
-	    dprintf("INTERN %s -> %p [%s h=%d ascii]\n", 
-		s, (*x)->string, where, h);
+	    dprintf("INTERN %s -> %p [%s h=%08x ascii]\n", 
+		s, str, where, h);
 #endif
-	return (*x)->string;
+	return str;
 }
 
 /*
@@ -381,21 +499,76 @@ SEE_intern_and_free(interp, sp)
 	*sp = is;
 }
 
-static void
-global_init()
+/**
+ * Returns the global interned string with the given characters, adding
+ * a copy of them to the global table if they are not already there.
+ */
+static struct SEE_string *
+global_add(data, len)
+	const SEE_char_t *data;
+	unsigned int len;
 {
-	unsigned int i, h;
+	struct SEE_string key, *str;
 	struct intern **x;
+	unsigned int h, i;
+
+	key.length = len;
+	key.data = (SEE_char_t *)data;
+	key.interpreter = NULL;
+	key.stringclass = NULL;
+	key.flags = 0;
+	h = hash(&key);
+	x = find(&global_intern_tab, &key, h);
+	if (*x)
+		return (*x)->string;
+
+	str = SEE_NEW(NULL, struct SEE_string);
+	str->length = len;
+	str->data = SEE_NEW_STRING_ARRAY(NULL, SEE_char_t, len);
+	for (i = 0; i < len; i++)
+		str->data[i] = data[i];
+	str->interpreter = NULL;
+	str->stringclass = NULL;
+	str->flags = 0;
+	return insert(NULL, &global_intern_tab, x, str, h);
+}
+
+/**
+ * Fills the system-wide intern table with the predefined strings,
+ * then with the single characters and small integers that builtins
+ * such as String.prototype.charAt() return without allocating.
+ */
+void
+_SEE_intern_global_init()
+{
+	unsigned int i, h, n, len;
+	struct intern **x;
+	SEE_char_t digits[10];
 
 	if (global_intern_tab_initialized)
 		return;
 
 	/* Add all the predefined strings to the global intern table */
+	tab_init(NULL, &global_intern_tab, INITIAL_SIZE);
 	for (i = 0; i < SEE_nstringtab; i++) {
 		h = hash(STRn(i));
 		x = find(&global_intern_tab, STRn(i), h);
 		if (*x == NULL) 
-			*x = make(NULL, STRn(i));
+			insert(NULL, &global_intern_tab, x, STRn(i), h);
+	}
+
+	for (i = 0; i < _SEE_INTERN_NCHARS; i++) {
+		digits[0] = i;
+		_SEE_intern_chars[i] = global_add(digits, 1);
+	}
+	for (i = 0; i < _SEE_INTERN_NINTS; i++) {
+		len = 0;
+		n = i;
+		do {
+			digits[9 - len++] = '0' + n % 10;
+			n /= 10;
+		} while (n);
+		_SEE_intern_ints[i] = global_add(digits + 10 - len, len);
 	}
 	global_intern_tab_initialized = 1;
 }
@@ -419,10 +592,10 @@ SEE_intern_global(s)
 	if (global_intern_tab_locked)
 		SEE_ABORT(NULL, "SEE_intern_global: table is now read-only");
 #endif
-	global_init();
+	_SEE_intern_global_init();
 
 	h = hash_ascii(s, &len);
-	x = find_ascii(&global_intern_tab, s, h);
+	x = find_ascii(&global_intern_tab, s, len, h);
 	if (*x) return (*x)->string;
 
 	str = SEE_NEW(NULL, struct SEE_string);
@@ -433,8 +606,7 @@ SEE_intern_global(s)
 	str->interpreter = NULL;
 	str->stringclass = NULL;
 	str->flags = 0;
-	*x = make(NULL, str);
-	return (*x)->string;
+	return insert(NULL, &global_intern_tab, x, str, h);
 }
 
 /**
@@ -452,3 +624,42 @@ _SEE_intern_assert(interp, s)
 #endif
 	return s;
 }
+
+/** Reports the size and occupancy of the intern tables */
+void
+SEE_intern_stats(interp, stats)
+	struct SEE_interpreter *interp;
+	struct SEE_intern_stats *stats;
+{
+	struct intern_tab *tab = interp->intern_tab;
+	struct intern *i;
+	unsigned int j, len;
+
+	stats->count = tab->count;
+	stats->size = tab->size;
+	stats->longest = 0;
+	for (j = 0; j < tab->size; j++) {
+		for (len = 0, i = tab->bucket[j]; i; i = i->next)
+			len++;
+		if (len > stats->longest)
+			stats->longest = len;
+	}
+	stats->global_count = global_intern_tab.count;
+	stats->global_size = global_intern_tab.size;
+}
+
+/** Calls fn for each string in the interpreter's own intern table */
+void
+_SEE_intern_foreach(interp, fn, closure)
+	struct SEE_interpreter *interp;
+	void (*fn)(struct SEE_string *, void *);
+	void *closure;
+{
+	struct intern_tab *tab = interp->intern_tab;
+	struct intern *i;
+	unsigned int j;
+
+	for (j = 0; j < tab->size; j++)
+		for (i = tab->bucket[j]; i; i = i->next)
+			(*fn)(i->string, closure);
+}
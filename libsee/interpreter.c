@@ -47,6 +47,10 @@
 #include <see/error.h>
 
 #include "init.h"
+#include "shape.h"
+#include "snapshot.h"
+
+static void init(struct SEE_interpreter *, int);
 
 /**
  * Initialises/reinitializes an interpreter structure
@@ -72,6 +76,69 @@ void
 SEE_interpreter_init_compat(interp, compat_flags)
 	struct SEE_interpreter *interp;
 	int compat_flags;
+{
+	interp->gc_heap = NULL;
+	interp->snapshot = NULL;
+	init(interp, compat_flags);
+}
+
+/**
+ * Initialises an interpreter that is to be a template for others.
+ * The host may go on to add its own objects and functions to it;
+ * everything it allocates up to the first call to
+ * SEE_interpreter_clone() becomes part of every clone.
+ * The template should not be used after it has been cloned, except to
+ * make more clones, and must outlive them.
+ */
+void
+SEE_interpreter_init_template(interp, compat_flags)
+	struct SEE_interpreter *interp;
+	int compat_flags;
+{
+	interp->gc_heap = NULL;
+	interp->snapshot = NULL;
+	_SEE_snapshot_begin(interp, 0);
+	init(interp, compat_flags);
+}
+
+/**
+ * Initialises a template whose clones share one copy of its
+ * cfunction objects (the built-in functions and any the host adds)
+ * instead of each having its own. A clone's changes to the objects
+ * that hold those functions are still its own.
+ */
+void
+SEE_interpreter_init_shared_template(interp, compat_flags)
+	struct SEE_interpreter *interp;
+	int compat_flags;
+{
+	interp->gc_heap = NULL;
+	interp->snapshot = NULL;
+	_SEE_snapshot_begin(interp, 1);
+	init(interp, compat_flags);
+}
+
+/**
+ * Initialises an interpreter as a copy of a template made with
+ * SEE_interpreter_init_template(). This copies the template's heap
+ * in one block rather than building the built-in objects again.
+ * The clone keeps its own host_data, and changes made to its objects
+ * are not seen by the template or by other clones.
+ * The first clone of a template must not race with other clones.
+ */
+void
+SEE_interpreter_clone(interp, from)
+	struct SEE_interpreter *interp, *from;
+{
+	SEE_ASSERT(from, from->snapshot != NULL);
+	_SEE_snapshot_clone(interp, from);
+}
+
+/* Sets up the fields and objects of a new interpreter */
+static void
+init(interp, compat_flags)
+	struct SEE_interpreter *interp;
+	int compat_flags;
 {
 	interp->try_context = NULL;
 	interp->try_location = NULL;
@@ -84,6 +151,9 @@ SEE_interpreter_init_compat(interp, compat_flags)
 	interp->recursion_limit = SEE_system.default_recursion_limit;
 	interp->sec_domain = NULL;
 	interp->regex_engine = SEE_system.default_regex_engine;
+	interp->regex_cache = NULL;
+	interp->number_cache = NULL;
+	interp->dst_cache = NULL;
 
 	/* Allocate object storage first, since dependencies are complex */
 	SEE_Array_alloc(interp);
@@ -102,6 +172,9 @@ SEE_interpreter_init_compat(interp, compat_flags)
 	/* Initialise the per-interpreter intern table now */
 	_SEE_intern_init(interp);
 
+	/* Native objects start out with the root shape */
+	_SEE_shape_init(interp);
+
 	/* Initialise the objects; order *shouldn't* matter */
 	SEE_Array_init(interp);
 	SEE_Boolean_init(interp);
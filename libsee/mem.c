@@ -49,6 +49,7 @@
 
 #include "stringdefs.h"
 #include "dprint.h"
+#include "snapshot.h"
 
 #ifndef NDEBUG
 int SEE_mem_debug = 0;
@@ -81,6 +82,8 @@ _SEE_malloc(interp, size, file, line)
 	data = (*SEE_system.malloc)(interp, size, file, line);
 	if (data == NULL) 
 		(*SEE_system.mem_exhausted)(interp);
+	if (interp && interp->snapshot)
+		_SEE_snapshot_alloc(interp, data, size, 0);
 	return data;
 }
 
@@ -114,6 +117,8 @@ _SEE_malloc_finalize(interp, size, finalizefn, closure, file, line)
 	    file, line);
 	if (data == NULL) 
 		(*SEE_system.mem_exhausted)(interp);
+	if (interp && interp->snapshot)
+		_SEE_snapshot_alloc(interp, data, size, 0);
 	return data;
 }
 
@@ -150,6 +155,8 @@ _SEE_malloc_string(interp, size, file, line)
 		data = (*SEE_system.malloc)(interp, size, 0, 0);
 	if (data == NULL) 
 		(*SEE_system.mem_exhausted)(interp);
+	if (interp && interp->snapshot)
+		_SEE_snapshot_alloc(interp, data, size, 1);
 	return data;
 }
 
@@ -172,7 +179,9 @@ _SEE_free(interp, memp, file, line)
 	int line;
 {
 	if (*memp) {
-		(*SEE_system.free)(interp, *memp, 0, 0);
+		if (!interp || !interp->snapshot ||
+		    _SEE_snapshot_free(interp, *memp))
+			(*SEE_system.free)(interp, *memp, 0, 0);
 		*memp = NULL;
 	}
 }
@@ -358,6 +367,9 @@ _SEE_grow_to(interp, grow, new_len, file, line)
 		    file, line);
 	    else
 		new_ptr = _SEE_malloc_debug(interp, new_alloc, file, line);
+	    if (grow->layout)
+		SNAPSHOT_LAYOUT(interp, new_ptr,
+		    (const struct snapshot_layout *)grow->layout);
 	    if (*grow->length_ptr)
 		memcpy(new_ptr, *grow->data_ptr, 
 		    *grow->length_ptr * grow->element_size);
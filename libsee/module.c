@@ -37,6 +37,7 @@
 #include <see/mem.h>
 
 #include "init.h"
+#include "snapshot.h"
 
 #ifndef MAXMODULES
 # define MAXMODULES 256
@@ -80,6 +81,8 @@ _SEE_module_alloc(interp)
 	unsigned int i;
 
 	interp->module_private = SEE_NEW_ARRAY(interp, void *, _SEE_nmodules);
+	SNAPSHOT_LAYOUT(interp, interp->module_private,
+	    &_SEE_snapshot_pointers);
 	for (i = 0; i < _SEE_nmodules; i++)
 		if (_SEE_modules[i]->alloc)
 			(*_SEE_modules[i]->alloc)(interp);
@@ -32,6 +32,10 @@
 # include <config.h>
 #endif
 
+#if STDC_HEADERS
+# include <stddef.h>
+#endif
+
 #if HAVE_STRING_H
 # include <string.h>
 #endif
@@ -47,10 +51,23 @@
 
 #include "stringdefs.h"
 #include "dprint.h"
+#include "shape.h"
+#include "cfunction_private.h"
+#include "snapshot.h"
 
 static unsigned int hashfn(struct SEE_string *);
-static struct SEE_property **find(struct SEE_interpreter *,
+static struct SEE_property *find(struct SEE_interpreter *,
 	struct SEE_object *, struct SEE_string *);
+static struct SEE_property *insert(struct SEE_interpreter *,
+	struct SEE_native *, struct SEE_string *, int);
+static void rehash(struct SEE_interpreter *, struct SEE_native *,
+	unsigned int);
+static void remove_property(struct SEE_native *, struct SEE_property *);
+static int find_slot(struct SEE_native *, struct SEE_string *);
+static struct SEE_shape *native_shape(struct SEE_interpreter *,
+	struct SEE_native *);
+static void cache_fill(struct SEE_interpreter *, struct shape_cache *,
+	struct SEE_native *, struct SEE_string *, int);
 static void native_enum_reset(struct SEE_interpreter *,
 	struct SEE_enum *);
 static struct SEE_string *native_enum_next(struct SEE_interpreter *,
@@ -62,46 +79,209 @@ int SEE_native_debug = 0;
 
 /*------------------------------------------------------------
  * Native objects
- *  - maintains a simple hash table of named properties
+ *  - maintains a table of named properties
  *  - cannot be called as functions
  *  - cannot be called as a constructor
+ *
+ * The first SEE_NATIVE_SMALL properties are kept in an inline array
+ * in insertion order. Beyond that, the properties are moved into
+ * an open-addressed (linear probe) hash table that is kept at most
+ * three-quarters full. Deleted hash slots hold the 'deleted' marker
+ * so that probe sequences are not broken. Property structures are
+ * never moved, so the lru pointer survives a rehash.
+ *
+ * Objects in the small array carry a shared shape that is advanced
+ * as properties are added (see shape.c). Any other change to the
+ * layout clears the shape, and it is recomputed when next needed.
  */
 
 struct SEE_property {
-        struct SEE_property *next;
         struct SEE_string *name;
         int attr;
         struct SEE_value value;
 };
 
-/* Return a hash value for an interned string, in range [0..HASHLEN) */
+static const struct snapshot_word property_words[] = {
+	SNAPSHOT_PTR(struct SEE_property, name),
+	SNAPSHOT_VAL(struct SEE_property, value),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(property_layout, struct SEE_property, property_words);
+
+/* Marker for a hash slot whose property was deleted */
+static struct SEE_property deleted_property;
+#define DELETED		(&deleted_property)
+
+/* Initial size of the hash table; must be a power of 2 */
+#define NATIVE_HASH_INITIAL	(SEE_NATIVE_SMALL * 4)
+
+/*
+ * Return a hash value for an interned string. Caller masks the result.
+ * The hash is taken from the string's contents rather than its address
+ * so that a table keeps its layout when the heap is copied elsewhere
+ * (see snapshot.c).
+ */
 static unsigned int
 hashfn(s)
 	struct SEE_string *s;
 {
-        return (unsigned)(s - (struct SEE_string *)0) % SEE_NATIVE_HASHLEN;
+	unsigned int h = s->hash;	/* interned strings are hashed */
+
+	h *= 0x9e3779b1;
+	return h ^ (h >> 16);
 }
 
 /*
  * Find an object property, if it exists.
  * Assumes property is interned.
- * Returns either a pointer to the pointer to the property,
- * or a pointer to the NULL pointer at the end of a hash list.
- * (ie never returns NULL);
+ * Returns a pointer to the property, or NULL if it is not found.
  */
-static struct SEE_property **
+static struct SEE_property *
 find(interp, o, ip)
 	struct SEE_interpreter *interp;
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
 	struct SEE_native *n = (struct SEE_native *)o;
-	struct SEE_property **x;
+	struct SEE_property *p;
+	unsigned int i, mask;
 
-	x = &n->properties[hashfn(_SEE_INTERN_ASSERT(interp, ip))];
-	while (*x && (*x)->name != ip)
-		x = &((*x)->next);
-	return x;
+	_SEE_INTERN_ASSERT(interp, ip);
+	if (!n->tabsize) {
+		for (i = 0; i < n->nprops; i++)
+		    if (n->props.small[i]->name == ip)
+			return n->props.small[i];
+		return NULL;
+	}
+	mask = n->tabsize - 1;
+	for (i = hashfn(ip) & mask; (p = n->props.hash.slots[i]) != NULL;
+	     i = (i + 1) & mask)
+		if (p->name == ip && p != DELETED)
+		    return p;
+	return NULL;
+}
+
+/*
+ * Move the properties of a native object into a new hash table
+ * of the given size. Deleted markers are discarded.
+ */
+static void
+rehash(interp, n, newsize)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+	unsigned int newsize;
+{
+	struct SEE_property **slots, *p;
+	unsigned int i, j, mask;
+
+	slots = SEE_NEW_ARRAY(interp, struct SEE_property *, newsize);
+	SNAPSHOT_LAYOUT(interp, slots, &_SEE_snapshot_pointers);
+	for (i = 0; i < newsize; i++)
+		slots[i] = NULL;
+	mask = newsize - 1;
+
+#define REHASH_ADD(p) do {						\
+		for (j = hashfn((p)->name) & mask; slots[j]; 		\
+		     j = (j + 1) & mask)				\
+			;						\
+		slots[j] = (p);						\
+	} while (0)
+
+	if (!n->tabsize)
+		for (i = 0; i < n->nprops; i++)
+		    REHASH_ADD(n->props.small[i]);
+	else {
+		for (i = 0; i < n->tabsize; i++)
+		    if ((p = n->props.hash.slots[i]) && p != DELETED)
+			REHASH_ADD(p);
+		SEE_free(interp, (void **)&n->props.hash.slots);
+	}
+#undef REHASH_ADD
+
+	n->tabsize = newsize;
+	n->props.hash.slots = slots;
+	n->used = n->nprops;
+	n->shape = NULL;
+}
+
+/*
+ * Add a new property to a native object. 
+ * Assumes that the property does not already exist.
+ * Returns the new property, with the given attributes and
+ * an uninitialised value.
+ */
+static struct SEE_property *
+insert(interp, n, ip, attr)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+	struct SEE_string *ip;
+	int attr;
+{
+	struct SEE_property *prop, **x;
+	unsigned int i, mask, newsize;
+
+	prop = SEE_NEW(interp, struct SEE_property);
+	SNAPSHOT_LAYOUT(interp, prop, &property_layout);
+	prop->name = ip;
+	prop->attr = attr;
+
+	if (!n->tabsize && n->nprops < SEE_NATIVE_SMALL) {
+		n->props.small[n->nprops++] = prop;
+		if (n->shape)
+		    n->shape = _SEE_shape_add(interp, n->shape, ip, attr);
+		return prop;
+	}
+
+	/* Grow (or just clean) the hash table when it gets too full */
+	if (!n->tabsize || (n->used + 1) * 4 > n->tabsize * 3) {
+		newsize = n->tabsize ? n->tabsize : NATIVE_HASH_INITIAL;
+		while ((n->nprops + 1) * 2 > newsize)
+			newsize *= 2;
+		rehash(interp, n, newsize);
+	}
+
+	/* Re-use the first deleted slot on the probe sequence */
+	mask = n->tabsize - 1;
+	x = NULL;
+	for (i = hashfn(ip) & mask; n->props.hash.slots[i]; 
+	     i = (i + 1) & mask)
+		if (!x && n->props.hash.slots[i] == DELETED)
+		    x = &n->props.hash.slots[i];
+	if (!x) {
+		x = &n->props.hash.slots[i];
+		n->used++;
+	}
+	*x = prop;
+	n->nprops++;
+	n->shape = NULL;
+	return prop;
+}
+
+/* Remove an existing property from a native object */
+static void
+remove_property(n, prop)
+	struct SEE_native *n;
+	struct SEE_property *prop;
+{
+	unsigned int i, mask;
+
+	if (n->lru == prop)
+		n->lru = NULL;
+	n->shape = NULL;
+	if (!n->tabsize) {
+		for (i = 0; n->props.small[i] != prop; i++)
+		    ;
+		/* Shift down to preserve insertion order */
+		for (; i + 1 < n->nprops; i++)
+		    n->props.small[i] = n->props.small[i + 1];
+	} else {
+		mask = n->tabsize - 1;
+		for (i = hashfn(prop->name) & mask;
+		     n->props.hash.slots[i] != prop; i = (i + 1) & mask)
+		    ;
+		n->props.hash.slots[i] = DELETED;
+	}
+	n->nprops--;
 }
 
 /* [[Get]] 8.6.2.1 */
@@ -112,7 +292,7 @@ SEE_native_get(interp, o, ip, res)
 	struct SEE_string *ip;
 	struct SEE_value *res;
 {
-	struct SEE_property **x;
+	struct SEE_property *x;
 	struct SEE_native *n = (struct SEE_native *)o;
 
 	if (n->lru && n->lru->name == ip) {
@@ -140,18 +320,18 @@ SEE_native_get(interp, o, ip, res)
 	    dprintf(" ip=");
 	    dprints(ip);
 	    dprintf("(%p)", ip);
-	    if (*x) { 
+	    if (x) { 
 		dprintf(" -> ");
-		dprintv(interp, &(*x)->value);
+		dprintv(interp, &x->value);
 		dprintf("\n");
 	    } else 
 		dprintf(" -> not found\n");
 	}
 #endif
 
-	if (*x) {
-	    n->lru = *x;
-	    SEE_VALUE_COPY(res, &(*x)->value);
+	if (x) {
+	    n->lru = x;
+	    SEE_VALUE_COPY(res, &x->value);
 	} else if (SEE_GET_JS_COMPAT(interp) &&
 		 ip == STR(__proto__)) {
 	    if (o->Prototype)
@@ -184,7 +364,7 @@ SEE_native_put(interp, o, ip, val, attr)
 	struct SEE_value *val;
 	int attr;
 {
-	struct SEE_property **x;
+	struct SEE_property *x;
 	struct SEE_native *n = (struct SEE_native *)o;
 
 	SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(val) != SEE_REFERENCE);
@@ -219,7 +399,8 @@ SEE_native_put(interp, o, ip, val, attr)
 			SEE_error_throw_string(interp, interp->TypeError, 
 				STR(internal_error));
 		/* Check for recursive prototype */
-		for (po = val->u.object; po; po = po->Prototype)
+		for (po = val->u.object; po;
+		     po = _SEE_CFUNCTION_PROTOTYPE(interp, po))
 		    if (SEE_OBJECT_JOINED(o, po))
 			SEE_error_throw_string(interp, interp->TypeError, 
 				STR(internal_error));
@@ -236,17 +417,14 @@ SEE_native_put(interp, o, ip, val, attr)
 	if (!attr && !SEE_OBJECT_CANPUT(interp, o, ip))
 		return;
 	x = find(interp, o, ip);
-	if (!*x) {
-		struct SEE_property *prop;
-		prop = SEE_NEW(interp, struct SEE_property);
-		prop->next = NULL;
-		prop->name = ip;
-		prop->attr = attr;
-		*x = prop;
-	} else if (attr)
-		(*x)->attr = attr;
-	n->lru = *x;
-	SEE_VALUE_COPY(&(*x)->value, val);
+	if (!x)
+		x = insert(interp, n, ip, attr);
+	else if (attr && x->attr != attr) {
+		x->attr = attr;
+		n->shape = NULL;
+	}
+	n->lru = x;
+	SEE_VALUE_COPY(&x->value, val);
 
 #ifndef NDEBUG
 	if (SEE_native_debug) {
@@ -276,7 +454,7 @@ SEE_native_canput(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
+	struct SEE_property *x;
 	struct SEE_native *n = (struct SEE_native *)o;
 
 	if (n->lru && n->lru->name == ip) {
@@ -294,7 +472,7 @@ SEE_native_canput(interp, o, ip)
 	}
 
 	x = find(interp, o, ip);
-	if (*x) {
+	if (x) {
 #ifndef NDEBUG
 		if (SEE_native_debug) {
 		    dprintf("native_canput: o=");
@@ -302,11 +480,11 @@ SEE_native_canput(interp, o, ip)
 		    dprintf(" ip=");
 		    dprints(ip);
 		    dprintf("(%p) -> %d\n", ip,
-			((*x)->attr & SEE_ATTR_READONLY) ? 0 : 1);
+			(x->attr & SEE_ATTR_READONLY) ? 0 : 1);
 		}
 #endif
-		n->lru = *x;
-		return ((*x)->attr & SEE_ATTR_READONLY) ? 0 : 1;
+		n->lru = x;
+		return (x->attr & SEE_ATTR_READONLY) ? 0 : 1;
 	}
 	if (!o->Prototype)
 		return 1;
@@ -320,7 +498,7 @@ native_hasownproperty(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
+	struct SEE_property *x;
 	struct SEE_native *n = (struct SEE_native *)o;
 
 	if (n->lru && n->lru->name == ip) {
@@ -343,10 +521,10 @@ native_hasownproperty(interp, o, ip)
 	    dprinto(interp, o);
 	    dprintf(" ip=");
 	    dprints(ip);
-	    dprintf(" -> %d\n", *x ? 1 : 0);
+	    dprintf(" -> %d\n", x ? 1 : 0);
 	}
 #endif
-	return *x ? 1 : 0;
+	return x ? 1 : 0;
 }
 
 /* [[HasProperty]] 8.6.2.4 */
@@ -385,10 +563,10 @@ SEE_native_getownattr(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
+	struct SEE_property *x;
 
 	x = find(interp, o, ip);
-	return *x ? (*x)->attr : 0;
+	return x ? x->attr : 0;
 }
 
 /* [[Delete]] 8.6.2.5 */
@@ -398,17 +576,15 @@ SEE_native_delete(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
+	struct SEE_property *x;
 	struct SEE_native *n = (struct SEE_native *)o;
 
 	x = find(interp, o, ip);
-	if (!*x)
+	if (!x)
 		return 1;
-	if ((*x)->attr & SEE_ATTR_DONTDELETE)
+	if (x->attr & SEE_ATTR_DONTDELETE)
 		return 0;
-	if (n->lru == *x)
-	    n->lru = NULL;
-	*x = (*x)->next;
+	remove_property(n, x);
 	return 1;
 }
 
@@ -502,8 +678,7 @@ SEE_native_defaultvalue(interp, o, hint, res)
 struct native_enum {
 	struct SEE_enum	base;
 	struct SEE_native *native;
-	int next_column;
-	struct SEE_property *next_prop;
+	unsigned int next_index;
 };
 
 static void
@@ -512,8 +687,7 @@ native_enum_reset(interp, e)
 	struct SEE_enum *e;
 {
 	struct native_enum *ne = (struct native_enum *)e;
-	ne->next_column = 0;
-	ne->next_prop = NULL;
+	ne->next_index = 0;
 }
 
 static struct SEE_string *
@@ -526,13 +700,16 @@ native_enum_next(interp, e, dont_enump)
 	struct SEE_native *n = ne->native;
 	struct SEE_property *p;
 
-	while (ne->next_prop == NULL) {
-	    if (ne->next_column >= SEE_NATIVE_HASHLEN)
+	if (!n->tabsize) {
+	    if (ne->next_index >= n->nprops)
 		    return NULL;
-	    ne->next_prop = n->properties[ne->next_column++];
-	}
-	p = ne->next_prop;
-	ne->next_prop = p->next;
+	    p = n->props.small[ne->next_index++];
+	} else
+	    do {
+		if (ne->next_index >= n->tabsize)
+		    return NULL;
+		p = n->props.hash.slots[ne->next_index++];
+	    } while (p == NULL || p == DELETED);
 
 	if (dont_enump)
 		*dont_enump = (p->attr & SEE_ATTR_DONTENUM);
@@ -559,6 +736,249 @@ SEE_native_enumerator(interp, o)
 	return (struct SEE_enum *)ne;
 }
 
+/*------------------------------------------------------------
+ * Inline caches
+ *
+ * The bytecode keeps a shape_cache for each property access
+ * instruction. A cache entry records a receiver shape and the slot
+ * where the property was found, either in the receiver itself or in
+ * one of its first two prototypes. Because shapes change whenever
+ * properties are added, removed or have their attributes changed,
+ * the prototype shapes held in an entry also serve to invalidate it
+ * when a prototype is mutated.
+ */
+
+/* The property in a slot of a native object */
+#define SLOT(n, i)	((n)->tabsize ? (n)->props.hash.slots[i]	\
+				      : (n)->props.small[i])
+
+/* Tests if an object's methods are the ones the caches understand */
+#define CACHEABLE_GET(o)  ((o)->objectclass->Get == SEE_native_get)
+#define CACHEABLE_PUT(o)  ((o)->objectclass->Put == SEE_native_put && \
+			   (o)->objectclass->CanPut == SEE_native_canput)
+
+/* Returns the slot index of an own property, or -1 if not found */
+static int
+find_slot(n, ip)
+	struct SEE_native *n;
+	struct SEE_string *ip;
+{
+	struct SEE_property *p;
+	unsigned int i, mask;
+
+	if (!n->tabsize) {
+		for (i = 0; i < n->nprops; i++)
+		    if (n->props.small[i]->name == ip)
+			return i;
+		return -1;
+	}
+	mask = n->tabsize - 1;
+	for (i = hashfn(ip) & mask; (p = n->props.hash.slots[i]) != NULL;
+	     i = (i + 1) & mask)
+		if (p->name == ip && p != DELETED)
+		    return i;
+	return -1;
+}
+
+/* Returns the shape of a native object, computing it if needed */
+static struct SEE_shape *
+native_shape(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct SEE_shape *s;
+	unsigned int i;
+
+	if (n->shape)
+		return n->shape;
+	if (n->tabsize)
+		s = _SEE_shape_dictionary(interp);
+	else {
+		s = _SEE_shape_root(interp);
+		for (i = 0; i < n->nprops; i++)
+		    s = _SEE_shape_add(interp, s, n->props.small[i]->name,
+			n->props.small[i]->attr);
+	}
+	n->shape = s;
+	return s;
+}
+
+/*
+ * Records in the cache where property ip of n was found.
+ * For [[Put]], only writable own properties are recorded.
+ * A cache that sees a second property name is disabled, since
+ * it belongs to a computed member access like a[i].
+ */
+static void
+cache_fill(interp, cache, n, ip, put)
+	struct SEE_interpreter *interp;
+	struct shape_cache *cache;
+	struct SEE_native *n;
+	struct SEE_string *ip;
+	int put;
+{
+	struct shape_cache_entry *e;
+	struct SEE_native *mid = NULL, *holder = NULL;
+	struct SEE_object *o;
+	struct SEE_shape *shape;
+	unsigned int i;
+	int slot;
+
+	if (cache->disabled)
+		return;
+	if (cache->name != ip) {
+		if (cache->name) {
+		    cache->disabled = 1;
+		    return;
+		}
+		cache->name = ip;
+	}
+	if (ip == STR(__proto__))
+		return;
+
+	slot = find_slot(n, ip);
+	if (slot < 0 && !put) {
+	    o = n->object.Prototype;
+	    if (o && CACHEABLE_GET(o)) {
+		holder = (struct SEE_native *)o;
+		slot = find_slot(holder, ip);
+		if (slot < 0 && (o = o->Prototype) && CACHEABLE_GET(o)) {
+		    mid = holder;
+		    holder = (struct SEE_native *)o;
+		    slot = find_slot(holder, ip);
+		}
+	    }
+	}
+	if (slot < 0)
+		return;
+	if (put && (SLOT(n, slot)->attr & SEE_ATTR_READONLY))
+		return;
+
+	/* Replace any stale entry for the same shape */
+	shape = native_shape(interp, n);
+	for (i = 0; i < SHAPE_CACHE_WAYS; i++)
+		if (cache->entry[i].shape == shape)
+		    break;
+	if (i == SHAPE_CACHE_WAYS) {
+		i = cache->next;
+		cache->next = (i + 1) % SHAPE_CACHE_WAYS;
+	}
+	e = &cache->entry[i];
+	e->shape = shape;
+	e->slot = slot;
+	e->mid = mid;
+	e->mid_shape = mid ? native_shape(interp, mid) : NULL;
+	e->holder = holder;
+	e->holder_shape = holder ? native_shape(interp, holder) : NULL;
+}
+
+/*
+ * [[Get]] for a property access instruction with an inline cache.
+ * Works with any object, but only native objects use the cache.
+ * Assumes property is interned.
+ */
+void
+_SEE_native_get_cached(interp, o, ip, res, cache)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	struct SEE_string *ip;
+	struct SEE_value *res;
+	struct shape_cache *cache;
+{
+	struct SEE_native *n = (struct SEE_native *)o;
+	struct SEE_native *h;
+	struct SEE_object *p;
+	struct shape_cache_entry *e;
+	struct SEE_shape *shape;
+	unsigned int i;
+
+	if (!CACHEABLE_GET(o)) {
+		/* Remembering the name still lets the caller skip interning */
+		if (!cache->name)
+		    cache->name = ip;
+		SEE_OBJECT_GET(interp, o, ip, res);
+		return;
+	}
+
+	if (ip == cache->name) {
+	    shape = native_shape(interp, n);
+	    for (i = 0; i < SHAPE_CACHE_WAYS; i++) {
+		e = &cache->entry[i];
+		if (e->shape != shape)
+		    continue;
+		h = n;
+		if (e->holder) {
+		    p = o->Prototype;
+		    if (e->mid) {
+			if (p != (struct SEE_object *)e->mid ||
+			    native_shape(interp, e->mid) != e->mid_shape)
+			    break;
+			p = p->Prototype;
+		    }
+		    if (p != (struct SEE_object *)e->holder ||
+			native_shape(interp, e->holder) != e->holder_shape)
+			break;
+		    h = e->holder;
+		}
+#ifndef NDEBUG
+		if (SEE_native_debug) {
+		    dprintf("native_get_cached: o=");
+		    dprinto(interp, o);
+		    dprintf(" ip=");
+		    dprints(ip);
+		    dprintf(" HIT [%u] slot %u\n", i, e->slot);
+		}
+#endif
+		SEE_VALUE_COPY(res, &SLOT(h, e->slot)->value);
+		return;
+	    }
+	}
+
+	SEE_native_get(interp, o, ip, res);
+	cache_fill(interp, cache, n, ip, 0);
+}
+
+/*
+ * [[Put]] with default attributes for a property access instruction
+ * with an inline cache. Assumes property is interned.
+ */
+void
+_SEE_native_put_cached(interp, o, ip, val, cache)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	struct SEE_string *ip;
+	struct SEE_value *val;
+	struct shape_cache *cache;
+{
+	struct SEE_native *n = (struct SEE_native *)o;
+	struct shape_cache_entry *e;
+	struct SEE_shape *shape;
+	unsigned int i;
+
+	if (!CACHEABLE_PUT(o)) {
+		if (!cache->name)
+		    cache->name = ip;
+		SEE_OBJECT_PUT(interp, o, ip, val, 0);
+		return;
+	}
+
+	if (ip == cache->name) {
+	    shape = native_shape(interp, n);
+	    for (i = 0; i < SHAPE_CACHE_WAYS; i++) {
+		e = &cache->entry[i];
+		if (e->shape == shape && !e->holder) {
+		    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(val) !=
+			SEE_REFERENCE);
+		    SEE_VALUE_COPY(&SLOT(n, e->slot)->value, val);
+		    return;
+		}
+	    }
+	}
+
+	SEE_native_put(interp, o, ip, val, 0);
+	cache_fill(interp, cache, n, ip, 1);
+}
+
 /*------------------------------------------------------------
  * The 'default' native object.
  */
@@ -585,6 +1005,7 @@ SEE_native_new(interp)
 	struct SEE_native *n;
 
 	n = SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, n, &_SEE_snapshot_native);
 	SEE_native_init(n, interp, &native_class, NULL);
 	return (struct SEE_object *)n;
 }
@@ -597,12 +1018,11 @@ SEE_native_init(n, interp, objectclass, prototype)
 	struct SEE_objectclass *objectclass;
 	struct SEE_object *prototype;
 {
-	int i;
-
 	n->object.objectclass = objectclass;
 	n->object.Prototype = prototype;
 	n->object.host_data = NULL;
 	n->lru = NULL;
-	for (i = 0; i < SEE_NATIVE_HASHLEN; i++)
-		n->properties[i] = NULL;
+	n->nprops = 0;
+	n->tabsize = 0;
+	n->shape = _SEE_shape_root(interp);
 }
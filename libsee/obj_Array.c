@@ -32,6 +32,10 @@
 # include <config.h>
 #endif
 
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
 #include <see/mem.h>
 #include <see/value.h>
 #include <see/string.h>
@@ -42,24 +46,58 @@
 #include <see/interpreter.h>
 #include <see/debug.h>
 #include <see/intern.h>
+#include <see/system.h>
 
 #include "stringdefs.h"
 #include "array.h"
 #include "parse.h"
 #include "init.h"
 #include "nmath.h"
+#include "cfunction_private.h"
+#include "snapshot.h"
 
 /*
  * The Array object.
  * 15.4 
  */
 
-/* structure of array instances */
+/*
+ * Structure of array instances.
+ *
+ * Elements with indices below ndense are kept in the dense vector
+ * rather than as native properties. Elements missing from the vector
+ * are holes. Elements with attributes, or too far beyond the end of
+ * the vector, are kept as native properties instead; once there is
+ * such a sparse element the vector stops growing, so that an element
+ * is never held in both places.
+ */
 struct array_object {
 	struct SEE_native native;
 	SEE_uint32_t length;
+	struct SEE_value *dense;	/* [ndense] */
+	unsigned int ndense;
+	struct SEE_growable gdense;
+	int sparse;			/* native has index properties */
 };
 
+static const struct snapshot_word array_words[] = {
+	SNAPSHOT_NATIVE(struct array_object, native),
+	SNAPSHOT_PTR(struct array_object, dense),
+	SNAPSHOT_GROWABLE(struct array_object, gdense),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(array_layout, struct array_object, array_words);
+
+/* A hole uses the internal reference type, never a property's value */
+#define IS_HOLE(vp)	(SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE)
+#define SET_HOLE(vp)	_SEE_VALUE_SET_TYPE(vp, SEE_REFERENCE)
+
+/* Tests if the element at index i is in the dense vector */
+#define DENSE_HAS(ao, i) ((i) < (ao)->ndense && !IS_HOLE(&(ao)->dense[i]))
+
+/* The vector may grow by this many holes, or by its own length */
+#define DENSE_SLACK	16
+
 
 /* Prototypes */
 static void intstr_p(struct SEE_string *, SEE_uint32_t);
@@ -95,14 +133,11 @@ static void array_proto_shift(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_object *, int, struct SEE_value **, struct SEE_value *);
 static void array_proto_slice(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_object *, int, struct SEE_value **, struct SEE_value *);
-static int SortCompare(struct SEE_interpreter *, struct SEE_value *,
-	struct SEE_value *, struct SEE_object *);
-static int qs_partition(struct SEE_interpreter *, struct SEE_object *,
-	SEE_uint32_t, SEE_uint32_t, struct SEE_object *, struct SEE_string **,
-	struct SEE_string **);
-static void qs_sort(struct SEE_interpreter *, struct SEE_object *,
-	SEE_uint32_t, SEE_uint32_t, struct SEE_object *, struct SEE_string **,
-	struct SEE_string **);
+struct sort_item;
+static int SortCompare(struct SEE_interpreter *, struct sort_item *,
+	struct sort_item *, struct SEE_object *);
+static void merge_sort(struct SEE_interpreter *, struct sort_item *,
+	struct sort_item *, SEE_uint32_t, SEE_uint32_t, struct SEE_object *);
 static void array_proto_sort(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_object *, int, struct SEE_value **, struct SEE_value *);
 static void array_proto_splice(struct SEE_interpreter *, struct SEE_object *,
@@ -112,14 +147,39 @@ static void array_proto_unshift(struct SEE_interpreter *, struct SEE_object *,
 static void array_setlength(struct SEE_interpreter *, struct array_object *,
 	struct SEE_value *);
 
+static void dense_grow(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t);
+static void dense_to_sparse(struct SEE_interpreter *, struct array_object *);
+static int element_canput(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t, struct SEE_string *);
+static void put_element(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t, struct SEE_string *, struct SEE_value *, int);
+static void get_element(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t, struct SEE_string *, struct SEE_value *);
+static struct array_object *dense_array(struct SEE_object *);
+static void dense_append(struct SEE_interpreter *, struct array_object *,
+	struct SEE_value *, SEE_uint32_t);
+static void get_index(struct SEE_interpreter *, struct SEE_object *,
+	SEE_uint32_t, struct SEE_string **, struct SEE_value *);
+static int get_present(struct SEE_interpreter *, struct SEE_object *,
+	SEE_uint32_t, struct SEE_string **, struct SEE_value *);
+static void put_index(struct SEE_interpreter *, struct SEE_object *,
+	SEE_uint32_t, struct SEE_string **, struct SEE_value *);
+static void delete_index(struct SEE_interpreter *, struct SEE_object *,
+	SEE_uint32_t, struct SEE_string **);
+
 static void array_get(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_string *, struct SEE_value *);
 static void array_put(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_string *, struct SEE_value *, int);
+static int array_canput(struct SEE_interpreter *, struct SEE_object *,
+	struct SEE_string *);
 static int array_hasproperty(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_string *);
 static int array_delete(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_string *);
+static struct SEE_enum *array_enumerator(struct SEE_interpreter *,
+	struct SEE_object *);
 
 /* object class for Array constructor */
 static struct SEE_objectclass array_const_class = {
@@ -140,11 +200,11 @@ static struct SEE_objectclass array_inst_class = {
 	"Array",			/* Class */
 	array_get,			/* Get */
 	array_put,			/* Put */
-	SEE_native_canput,		/* CanPut */
+	array_canput,			/* CanPut */
 	array_hasproperty,		/* HasProperty */
 	array_delete,			/* Delete */
 	SEE_native_defaultvalue,	/* DefaultValue */
-	SEE_native_enumerator		/* enumerator */
+	array_enumerator		/* enumerator */
 };
 
 void
@@ -155,6 +215,8 @@ SEE_Array_alloc(interp)
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Array_prototype = 
 		(struct SEE_object *)SEE_NEW(interp, struct array_object);
+	SNAPSHOT_LAYOUT(interp, interp->Array, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Array_prototype, &array_layout);
 }
 
 void
@@ -264,7 +326,7 @@ intstr_p(s, i)
 /*
  * If sp is null, allocates a new empty string.
  * Clears the string *sp and puts unsigned integer i into it.
- * Returns an intern'd string
+ * Returns an intern'd string; small integers have a shared one.
  */
 static struct SEE_string *
 intstr(interp, sp, i)
@@ -272,18 +334,8 @@ intstr(interp, sp, i)
 	struct SEE_string **sp;
 	SEE_uint32_t i;
 {
-	switch (i) {
-	case 0: return STR(zero_digit);
-	case 1: return STR(1);
-	case 2: return STR(2);
-	case 3: return STR(3);
-	case 4: return STR(4);
-	case 5: return STR(5);
-	case 6: return STR(6);
-	case 7: return STR(7);
-	case 8: return STR(8);
-	case 9: return STR(9);
-	}
+	if (i < _SEE_INTERN_NINTS)
+		return _SEE_intern_ints[i];
 
 	if (!*sp)
 		*sp = SEE_string_new(interp, 9);
@@ -333,12 +385,10 @@ SEE_Array_push(interp, o, v)
 	struct SEE_value *v;
 {
 	struct array_object *a;
-	struct SEE_string *s = NULL;
 
 	a = toarray(interp, o);
 	check_too_long(interp, a->length, 1);
-	SEE_native_put(interp, o, intstr(interp, &s, a->length), v, 0);
-	a->length++;
+	put_element(interp, a, a->length, NULL, v, 0);
 }
 
 SEE_uint32_t
@@ -360,6 +410,9 @@ array_init(ao, interp, length)
 	SEE_native_init(&ao->native, interp, &array_inst_class, 
 	    interp->Array_prototype);
 	ao->length = length;
+	SEE_GROW_INIT(interp, &ao->gdense, ao->dense, ao->ndense);
+	ao->gdense.layout = &_SEE_snapshot_values;
+	ao->sparse = 0;
 }
 
 /* 15.4.4.2 */
@@ -374,7 +427,6 @@ array_construct(interp, self, thisobj, argc, argv, res)
 	struct array_object *ao;
 	int i;
 	SEE_uint32_t length;
-	struct SEE_string *s = NULL;
 
 	if (argc == 1 && SEE_VALUE_GET_TYPE(argv[0]) == SEE_NUMBER &&
 		!SEE_COMPAT_JS(interp, ==, JS12))
@@ -384,14 +436,16 @@ array_construct(interp, self, thisobj, argc, argv, res)
 		SEE_error_throw_string(interp, interp->RangeError, 
 		   STR(array_badlen));
 	    ao = SEE_NEW(interp, struct array_object);
+	    SNAPSHOT_LAYOUT(interp, ao, &array_layout);
 	    array_init(ao, interp, length);
 	} else {
 	    ao = SEE_NEW(interp, struct array_object);
+	    SNAPSHOT_LAYOUT(interp, ao, &array_layout);
 	    array_init(ao, interp, argc);
-	    for (i = 0; i < argc; i++) {
-		SEE_native_put(interp, (struct SEE_object *)&ao->native, 
-			intstr(interp, &s, i), argv[i], 0);
-	    }
+	    if (argc)
+		dense_grow(interp, ao, argc);
+	    for (i = 0; i < argc; i++)
+		SEE_VALUE_COPY(&ao->dense[i], argv[i]);
 	}
 	SEE_SET_OBJECT(res, (struct SEE_object *)ao);
 }
@@ -432,6 +486,7 @@ array_proto_toString(interp, self, thisobj, argc, argv, res)
 		    	lastundef = 1;
 			break;
 		    case SEE_STRING:
+			SEE_STRING_FLATTEN(v.u.string);
 			SEE_string_addch(s, '"');
 			for (j = 0; j < v.u.string->length; j++) {
 			    if (v.u.string->data[j] == '\"' ||
@@ -488,7 +543,7 @@ array_proto_toLocaleString(interp, self, thisobj, argc, argv, res)
 	    for (i = 0; i < length; i++) {
 		if (i)
 		    SEE_string_append(s, separator);
-		SEE_OBJECT_GET(interp, thisobj, intstr(interp, &n, i), &r6);
+		get_index(interp, thisobj, i, &n, &r6);
 		if (!(SEE_VALUE_GET_TYPE(&r6) == SEE_UNDEFINED || 
 		      SEE_VALUE_GET_TYPE(&r6) == SEE_NULL)) 
 		{
@@ -521,9 +576,10 @@ array_proto_concat(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_value v, *E, thisv;
 	struct SEE_object *A;
+	struct array_object *Aa, *Ea;
 	SEE_uint32_t n, k;
 	int i;
-	struct SEE_string *nsbuf = NULL, *ns;
+	struct SEE_string *nsbuf = NULL;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -531,6 +587,7 @@ array_proto_concat(interp, self, thisobj, argc, argv, res)
 
 	SEE_OBJECT_CONSTRUCT(interp, interp->Array, NULL, 0, NULL, &v);
 	A = v.u.object;
+	Aa = (struct array_object *)A;
 	n = 0;
 	SEE_SET_OBJECT(&thisv, thisobj);
 	E = &thisv;
@@ -539,20 +596,22 @@ array_proto_concat(interp, self, thisobj, argc, argv, res)
 	    if (SEE_VALUE_GET_TYPE(E) == SEE_OBJECT && 
 	    	SEE_is_Array(E->u.object)) 
 	    {
-		struct array_object *Ea = (struct array_object *)E->u.object;
-		for (k = 0; k < Ea->length; k++) {
-		    check_too_long(interp, n, 1);
-		    ns = intstr(interp, &nsbuf, k);
-		    if (SEE_OBJECT_HASPROPERTY(interp, E->u.object, ns)) {
-			SEE_OBJECT_GET(interp, E->u.object, ns, &v);
-			SEE_OBJECT_PUT(interp, A, intstr(interp, &nsbuf, n),
-			    &v, 0);
+		Ea = (struct array_object *)E->u.object;
+		check_too_long(interp, n, Ea->length);
+		if (dense_array(E->u.object) && !Aa->sparse &&
+		    Aa->ndense == n && Aa->length == n)
+		{
+		    dense_append(interp, Aa, Ea->dense, Ea->length);
+		    n += Ea->length;
+		} else
+		    for (k = 0; k < Ea->length; k++) {
+			if (get_present(interp, E->u.object, k, &nsbuf, &v))
+			    put_index(interp, A, n, &nsbuf, &v);
+			n++;
 		    }
-		    n++;
-		}
 	    } else {
 	        check_too_long(interp, n, 1);
-		SEE_OBJECT_PUT(interp, A, intstr(interp, &nsbuf, n), E, 0);
+		put_index(interp, A, n, &nsbuf, E);
 		n++;
 	    }
 	    if (i >= argc) break;
@@ -572,7 +631,11 @@ array_proto_join(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_value v, r6, r7;
 	struct SEE_string *separator, *s, *n = NULL;
+	struct SEE_string **strs;
+	unsigned int nstrs;
+	struct SEE_growable gstrs;
 	SEE_uint32_t length, i;
+	SEE_size_t total;
 	int use_comma;
 
 	if (!thisobj)
@@ -598,20 +661,42 @@ array_proto_join(interp, self, thisobj, argc, argv, res)
 		separator = v.u.string;
 	}
 
-	s = SEE_string_new(interp, 0);
-	if (length) {
-	    for (i = 0; i < length; i++) {
-		if (i)
-		    SEE_string_append(s, separator);
-		SEE_OBJECT_GET(interp, thisobj, intstr(interp, &n, i), &r6);
-		if (!(SEE_VALUE_GET_TYPE(&r6) == SEE_UNDEFINED || 
-		      SEE_VALUE_GET_TYPE(&r6) == SEE_NULL)) 
-		{
+	if (length == 0) {
+	    SEE_SET_STRING(res, STR(empty_string));
+	    return;
+	}
+
+	/*
+	 * Convert the elements first, so that the result can be
+	 * made in one piece. A null entry stands for an empty string.
+	 */
+	SEE_GROW_INIT(interp, &gstrs, strs, nstrs);
+	SEE_GROW_TO(interp, &gstrs, length);
+	total = (SEE_size_t)(length - 1) * separator->length;
+	for (i = 0; i < length; i++) {
+	    get_index(interp, thisobj, i, &n, &r6);
+	    if (SEE_VALUE_GET_TYPE(&r6) == SEE_UNDEFINED || 
+		SEE_VALUE_GET_TYPE(&r6) == SEE_NULL)
+		strs[i] = NULL;
+	    else {
+		if (SEE_VALUE_GET_TYPE(&r6) == SEE_STRING)
+		    strs[i] = r6.u.string;
+		else {
 		    SEE_ToString(interp, &r6, &r7);
-		    SEE_string_append(s, r7.u.string);
+		    strs[i] = r7.u.string;
 		}
+		total += strs[i]->length;
 	    }
 	}
+
+	s = SEE_string_new(interp, 
+	    total == (unsigned int)total ? (unsigned int)total : 0);
+	for (i = 0; i < length; i++) {
+	    if (i)
+		SEE_string_append(s, separator);
+	    if (strs[i])
+		SEE_string_append(s, strs[i]);
+	}
 	SEE_SET_STRING(res, s);
 }
 
@@ -667,8 +752,7 @@ array_proto_push(interp, self, thisobj, argc, argv, res)
         n = SEE_ToUint32(interp, &v);
 	for (i = 0; i < argc; i++) {
 	    check_too_long(interp, n, 1);
-	    SEE_OBJECT_PUT(interp, thisobj, intstr(interp, &np, n), 
-	        argv[i], 0);
+	    put_index(interp, thisobj, n, &np, argv[i]);
 	    n++;
 	}
 	SEE_SET_NUMBER(res, n);
@@ -686,6 +770,7 @@ array_proto_reverse(interp, self, thisobj, argc, argv, res)
 	struct SEE_value v, r9, r10;
 	struct SEE_string *r7, *r7s = NULL, *r8, *r8s = NULL;
 	SEE_uint32_t k, r2, r3, r6;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -694,6 +779,15 @@ array_proto_reverse(interp, self, thisobj, argc, argv, res)
 	SEE_OBJECT_GET(interp, thisobj, STR(length), &v);
 	r2 = SEE_ToUint32(interp, &v);
 	r3 = r2 / 2;	/* NB implicit floor() from integer div */
+	if ((ao = dense_array(thisobj)) != NULL) {
+	    for (k = 0; k < r3; k++) {
+		SEE_VALUE_COPY(&r9, &ao->dense[k]);
+		SEE_VALUE_COPY(&ao->dense[k], &ao->dense[r2 - k - 1]);
+		SEE_VALUE_COPY(&ao->dense[r2 - k - 1], &r9);
+	    }
+	    SEE_SET_OBJECT(res, thisobj);
+	    return;
+	}
 	for (k = 0; k < r3; k++) {
 	    r6 = r2 - k - 1;
 	    r7 = intstr(interp, &r7s, k);
@@ -728,8 +822,9 @@ array_proto_shift(interp, self, thisobj, argc, argv, res)
 	struct SEE_value **argv, *res;
 {
 	struct SEE_value v;
-	struct SEE_string *s = NULL, *p;
+	struct SEE_string *s = NULL;
 	SEE_uint32_t k, r2;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -743,18 +838,21 @@ array_proto_shift(interp, self, thisobj, argc, argv, res)
 	    SEE_SET_UNDEFINED(res);
 	    return;
 	}
+	if ((ao = dense_array(thisobj)) != NULL) {
+	    SEE_VALUE_COPY(res, &ao->dense[0]);
+	    memmove(ao->dense, ao->dense + 1, (r2 - 1) * sizeof *ao->dense);
+	    SEE_GROW_TO(interp, &ao->gdense, r2 - 1);
+	    ao->length = r2 - 1;
+	    return;
+	}
 	SEE_OBJECT_GET(interp, thisobj, STR(zero_digit), res);
 	for (k = 1; k < r2; k++) {
-	    p = intstr(interp, &s, k);
-	    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, p)) {
-		SEE_OBJECT_GET(interp, thisobj, p, &v);
-		SEE_OBJECT_PUT(interp, thisobj, intstr(interp, &s, k - 1), 
-		    &v, 0);
-	    } else {
-		SEE_OBJECT_DELETE(interp, thisobj, intstr(interp, &s, k - 1));
-	    }
+	    if (get_present(interp, thisobj, k, &s, &v))
+		put_index(interp, thisobj, k - 1, &s, &v);
+	    else
+		delete_index(interp, thisobj, k - 1, &s);
 	}
-	SEE_OBJECT_DELETE(interp, thisobj, intstr(interp, &s, r2 - 1));
+	delete_index(interp, thisobj, r2 - 1, &s);
 	SEE_SET_NUMBER(&v, r2 - 1);
 	SEE_OBJECT_PUT(interp, thisobj, STR(length), &v, 0);
 }
@@ -769,8 +867,9 @@ array_proto_slice(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_object *A;
 	SEE_uint32_t r3, r5, r8, k, n;
-	struct SEE_string *s = NULL, *p;
+	struct SEE_string *s = NULL;
 	struct SEE_value v;
+	struct array_object *ao;
 
 	if (argc < 1) {
 		SEE_SET_UNDEFINED(res);
@@ -801,43 +900,48 @@ array_proto_slice(interp, self, thisobj, argc, argv, res)
 	    	 v.u.number < r3  ? (SEE_uint32_t)v.u.number :
 		 		    r3;
 	}
-	for (k = r5, n = 0; k < r8; k++, n++) {
-	    p = intstr(interp, &s, k);
-	    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, p)) {
-		SEE_OBJECT_GET(interp, thisobj, p, &v);
-		SEE_OBJECT_PUT(interp, A, intstr(interp, &s, n), &v, 0);
-	    }
+	if (r5 < r8 && (ao = dense_array(thisobj)) != NULL &&
+	    ao->length == r3)
+	{
+	    dense_append(interp, (struct array_object *)A, ao->dense + r5,
+		r8 - r5);
+	    SEE_SET_OBJECT(res, A);
+	    return;
 	}
+	for (k = r5, n = 0; k < r8; k++, n++)
+	    if (get_present(interp, thisobj, k, &s, &v))
+		put_index(interp, A, n, &s, &v);
 	SEE_SET_NUMBER(&v, n);
 	SEE_OBJECT_PUT(interp, A, STR(length), &v, 0);
 	SEE_SET_OBJECT(res, A);
 }
 
+/*
+ * Sorting gathers the elements into an array of sort items, which are
+ * merge sorted (stably) and then put back. Elements that are undefined
+ * or missing are kept out of the sort, since they always go last.
+ * Without a comparison function, each element's string is found once,
+ * before sorting, instead of on each comparison.
+ */
+struct sort_item {
+	struct SEE_value value;
+	struct SEE_string *key;		/* ToString(value) if no cmpfn */
+};
+
 /*
  * A sort comparison function similar to that in 15.4.4.11,
- * except that our quicksort has already used get/put/hasproperty
- * on the array, and we represent this with pointers x and y.
- * If the pointers are NULL, then the elements don't exist in the
- * array, and should be sorted higher than anything else. If the
- * pointers point to undefined, then they should be sorted second-highest.
+ * for defined elements.
  */
 static int
 SortCompare(interp, x, y, cmpfn)
 	struct SEE_interpreter *interp;
-	struct SEE_value *x, *y;
+	struct sort_item *x, *y;
 	struct SEE_object *cmpfn;
 {
-	if (!x && !y)   return 0;
-	if (!x)		return 1;
-	if (!y)		return -1;
-	if (SEE_VALUE_GET_TYPE(x) == SEE_UNDEFINED && 
-	    SEE_VALUE_GET_TYPE(y) == SEE_UNDEFINED) return 0;
-	if (SEE_VALUE_GET_TYPE(x) == SEE_UNDEFINED) return 1;
-	if (SEE_VALUE_GET_TYPE(y) == SEE_UNDEFINED) return -1;
 	if (cmpfn) {
 		struct SEE_value vn, *arg[2];
-		arg[0] = x;
-		arg[1] = y;
+		arg[0] = &x->value;
+		arg[1] = &y->value;
 		SEE_OBJECT_CALL(interp, cmpfn, cmpfn, 2, arg, &vn);
 		if (SEE_VALUE_GET_TYPE(&vn) != SEE_NUMBER || 
 		    SEE_NUMBER_ISNAN(&vn)) 
@@ -846,95 +950,50 @@ SortCompare(interp, x, y, cmpfn)
 		if (vn.u.number < 0) return -1;
 		if (vn.u.number > 0) return 1;
 		return 0;
-	} else {
-		struct SEE_value xs, ys;
-		SEE_ToString(interp, x, &xs);
-		SEE_ToString(interp, y, &ys);
-		return SEE_string_cmp(xs.u.string, ys.u.string);
-	}
-}
-
-/**
- * Quicksort partition: partitions the given segment into numbers
- * smaller, then larger than the first element, using swaps.
- * Returns the index of the pivot point.
- */
-static int
-qs_partition(interp, thisobj, lo, hi, cmpfn, s1, s2)
-	struct SEE_interpreter *interp;
-	struct SEE_object *thisobj;
-	SEE_uint32_t lo, hi;
-	struct SEE_object *cmpfn;
-	struct SEE_string **s1, **s2;
-{
-	struct SEE_value xv, iv, jv;
-	struct SEE_value *xvp = NULL, *ivp = NULL, *jvp = NULL;
-	struct SEE_string *s1p, *s2p = NULL;
-	SEE_uint32_t i = lo - 1;
-	SEE_uint32_t j = hi + 1;
-
-	s1p = intstr(interp, s1, lo - 1);
-	if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s1p)) {
-		SEE_OBJECT_GET(interp, thisobj, s1p, &xv);
-		xvp = &xv;
 	} else
-		xvp = NULL;
-
-	for (;;) {
-	    do {
-		if (j == lo) break;
-		j--;
-		s2p = intstr(interp, s2, j - 1);
-		if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s2p)) {
-			SEE_OBJECT_GET(interp, thisobj, s2p, &jv);
-			jvp = &jv;
-		} else
-			jvp = NULL;
-	    } while (SortCompare(interp, xvp, jvp, cmpfn) < 0);
-	    do {
-		if (i == hi) break;
-		i++;
-		s1p = intstr(interp, s1, i - 1);
-		if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s1p)) {
-			SEE_OBJECT_GET(interp, thisobj, s1p, &iv);
-			ivp = &iv;
-		} else
-			ivp = NULL;
-	    } while (SortCompare(interp, ivp, xvp, cmpfn) < 0);
-	    if (i < j) {
-		/*
-		 * At this stage, s1p will always be "i" and s2p will
-		 * always be "j".
-		 */
-
-		if (ivp) SEE_OBJECT_PUT(interp, thisobj, s2p, ivp, 0);
-		else	 SEE_OBJECT_DELETE(interp, thisobj, s2p);
-		if (jvp) SEE_OBJECT_PUT(interp, thisobj, s1p, &jv, 0);
-		else     SEE_OBJECT_DELETE(interp, thisobj, s1p);
-	    } else
-		return j;
-	}
+		return SEE_string_cmp(x->key, y->key);
 }
 
-/**
- * Sorts the array segment by partitioning, and then sorting the
- * partitions. ("Quicksort", Cormen et al "Introduction to Algorithms").
+/*
+ * Sorts items[lo..hi-1] stably, using tmp[lo..hi-1] as scratch space.
+ * The merge is skipped when the two sorted halves are already in order.
  */
 static void
-qs_sort(interp, thisobj, lo, hi, cmpfn, s1, s2)
+merge_sort(interp, items, tmp, lo, hi, cmpfn)
 	struct SEE_interpreter *interp;
-	struct SEE_object *thisobj;
+	struct sort_item *items, *tmp;
 	SEE_uint32_t lo, hi;
 	struct SEE_object *cmpfn;
-	struct SEE_string **s1, **s2;
 {
-	SEE_uint32_t q;
-
-	if (lo < hi) {
-	    q = qs_partition(interp, thisobj, lo, hi, cmpfn, s1, s2);
-	    qs_sort(interp, thisobj, lo, q, cmpfn, s1, s2);
-	    qs_sort(interp, thisobj, q + 1, hi, cmpfn, s1, s2);
+	SEE_uint32_t mid, i, j, k;
+	struct sort_item t;
+
+	if (hi - lo < 8) {
+	    /* Insertion sort for short runs */
+	    for (i = lo + 1; i < hi; i++) {
+		t = items[i];
+		for (j = i; j > lo && 
+		    SortCompare(interp, &items[j - 1], &t, cmpfn) > 0; j--)
+			items[j] = items[j - 1];
+		items[j] = t;
+	    }
+	    return;
 	}
+	mid = lo + (hi - lo) / 2;
+	merge_sort(interp, items, tmp, lo, mid, cmpfn);
+	merge_sort(interp, items, tmp, mid, hi, cmpfn);
+	if (SortCompare(interp, &items[mid - 1], &items[mid], cmpfn) <= 0)
+	    return;
+	memcpy(tmp + lo, items + lo, (hi - lo) * sizeof *items);
+	for (i = lo, j = mid, k = lo; i < mid && j < hi; k++)
+	    if (SortCompare(interp, &tmp[j], &tmp[i], cmpfn) < 0)
+		items[k] = tmp[j++];
+	    else
+		items[k] = tmp[i++];
+	while (i < mid)
+	    items[k++] = tmp[i++];
+	while (j < hi)
+	    items[k++] = tmp[j++];
 }
 
 /* 15.4.4.11 */
@@ -945,10 +1004,13 @@ array_proto_sort(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct SEE_string *s1 = NULL, *s2 = NULL;
-	SEE_uint32_t length;
-	struct SEE_value v;
+	struct SEE_string *s = NULL;
+	SEE_uint32_t length, i, ndefined, nundefined;
+	struct SEE_value v, undefined;
 	struct SEE_object *cmpfn;
+	struct sort_item *items, *tmp;
+	unsigned int nitems, ntmp;
+	struct SEE_growable gitems, gtmp;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -966,7 +1028,47 @@ array_proto_sort(interp, self, thisobj, argc, argv, res)
 		SEE_error_throw_string(interp, interp->TypeError,
 			STR(bad_arg));
 
-	qs_sort(interp, thisobj, 1, length, cmpfn, &s1, &s2);
+	/* Gather the defined elements, counting the undefined ones */
+	SEE_GROW_INIT(interp, &gitems, items, nitems);
+	ndefined = nundefined = 0;
+	for (i = 0; i < length; i++) {
+	    if (!get_present(interp, thisobj, i, &s, &v))
+		continue;
+	    if (SEE_VALUE_GET_TYPE(&v) == SEE_UNDEFINED) {
+		nundefined++;
+		continue;
+	    }
+	    SEE_GROW_TO(interp, &gitems, ndefined + 1);
+	    SEE_VALUE_COPY(&items[ndefined].value, &v);
+	    items[ndefined].key = NULL;
+	    ndefined++;
+	}
+
+	if (!cmpfn)
+	    for (i = 0; i < ndefined; i++) {
+		if (SEE_VALUE_GET_TYPE(&items[i].value) == SEE_STRING)
+		    items[i].key = items[i].value.u.string;
+		else {
+		    SEE_ToString(interp, &items[i].value, &v);
+		    items[i].key = v.u.string;
+		}
+	    }
+
+	if (ndefined > 1) {
+	    SEE_GROW_INIT(interp, &gtmp, tmp, ntmp);
+	    SEE_GROW_TO(interp, &gtmp, ndefined);
+	    merge_sort(interp, items, tmp, 0, ndefined, cmpfn);
+	}
+
+	/* Put the sorted elements back, then undefineds, then holes */
+	for (i = 0; i < ndefined; i++)
+	    put_index(interp, thisobj, i, &s, &items[i].value);
+	SEE_SET_UNDEFINED(&undefined);
+	for (; i < ndefined + nundefined; i++)
+	    put_index(interp, thisobj, i, &s, &undefined);
+	for (; i < length; i++)
+	    delete_index(interp, thisobj, i, &s);
+
 	/*
 	 * NOTE: the standard does not say that the length
 	 * of the array should be updated after sorting.
@@ -988,7 +1090,8 @@ array_proto_splice(interp, self, thisobj, argc, argv, res)
 	struct SEE_value v;
 	struct SEE_object *A;
 	SEE_uint32_t r3, r5, r6, r17, k;
-	struct SEE_string *s = NULL, *s9, *s11, *s22, *s33, *s39;
+	struct SEE_string *s = NULL;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -1007,49 +1110,50 @@ array_proto_splice(interp, self, thisobj, argc, argv, res)
 /*6*/	if (argc < 2) SEE_SET_NUMBER(&v, 0);
 	else SEE_ToInteger(interp, argv[1], &v);
 	r6 = MIN(v.u.number < 0 ? 0 : (SEE_uint32_t)v.u.number, r3 - r5);
+/*17*/	r17 = argc < 2 ? 0 : argc - 2;
+
+	if ((ao = dense_array(thisobj)) != NULL &&
+	    ao->length == r3)
+	{
+	    /* Move the tail of the vector over the deleted elements */
+	    dense_append(interp, (struct array_object *)A, ao->dense + r5, r6);
+	    if (r17 > r6)
+		dense_grow(interp, ao, r3 - r6 + r17);
+	    memmove(ao->dense + r5 + r17, ao->dense + r5 + r6,
+		(r3 - r5 - r6) * sizeof *ao->dense);
+	    for (k = 0; k < r17; k++)
+		SEE_VALUE_COPY(&ao->dense[r5 + k], argv[k + 2]);
+	    SEE_GROW_TO(interp, &ao->gdense, r3 - r6 + r17);
+	    ao->length = r3 - r6 + r17;
+	    SEE_SET_OBJECT(res, A);
+	    return;
+	}
+
 /*7*/	for (k = 0; k < r6; k++) {
-/*9*/	    s9 = intstr(interp, &s, r5 + k);
-/*10*/	    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s9)) {
-/*12*/		SEE_OBJECT_GET(interp, thisobj, s9, &v);
-/*11*/		s11 = intstr(interp, &s, k);
-/*13*/		SEE_OBJECT_PUT(interp, A, s11, &v, 0);
-	    }
+/*9-12*/    if (get_present(interp, thisobj, r5 + k, &s, &v))
+/*11,13*/	put_index(interp, A, k, &s, &v);
 	}
 /*16*/	SEE_SET_NUMBER(&v, r6); SEE_OBJECT_PUT(interp, A, STR(length), &v, 0);
-/*17*/	r17 = argc < 2 ? 0 : argc - 2;
 /*18*/	if (r17 != r6) {
 /*19*/	    if (r17 <= r6) {
 /*20*/		for (k = r5; k < r3 - r6; k++) {
-/*22*/		    s22 = intstr(interp, &s, k + r6);
-/*23*/		    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s22)) {
-/*25*/			SEE_OBJECT_GET(interp, thisobj, s22, &v);
-/*26*/			SEE_OBJECT_PUT(interp, thisobj, 
-			    intstr(interp, &s, k + r17), &v, 0);
-		    } else {
-/*28*/			SEE_OBJECT_DELETE(interp, thisobj, 
-			    intstr(interp, &s, k + r17));
-		    }
-		}
-/*31*/		for (k = r3; k > r3-r6+r17; k--) {
-/*33*/		    s33 = intstr(interp, &s, k - 1);
-/*34*/		    SEE_OBJECT_DELETE(interp, thisobj, s33);
+/*22-25*/	    if (get_present(interp, thisobj, k + r6, &s, &v))
+/*26*/			put_index(interp, thisobj, k + r17, &s, &v);
+		    else
+/*28*/			delete_index(interp, thisobj, k + r17, &s);
 		}
+/*31*/		for (k = r3; k > r3-r6+r17; k--)
+/*33,34*/	    delete_index(interp, thisobj, k - 1, &s);
 	    } else
 /*37*/		for (k = r3 - r6; k > r5; k--) {
-/*39*/		    s39 = intstr(interp, &s, k + r6 - 1);
-/*41*/		    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s39)) {
-/*43*/			SEE_OBJECT_GET(interp, thisobj, s39, &v);
-/*44*/			SEE_OBJECT_PUT(interp, thisobj, 
-			    intstr(interp, &s, k + r17 - 1), &v, 0);
-		    } else {
-/*45*/			SEE_OBJECT_DELETE(interp, thisobj, 
-			    intstr(interp, &s, k + r17 - 1));
-		    }
+/*39-43*/	    if (get_present(interp, thisobj, k + r6 - 1, &s, &v))
+/*44*/			put_index(interp, thisobj, k + r17 - 1, &s, &v);
+		    else
+/*45*/			delete_index(interp, thisobj, k + r17 - 1, &s);
 		}
 	}
 /*48*/	for (k = 2; k < (unsigned int)argc; k++) {
-/*50*/	    SEE_OBJECT_PUT(interp, thisobj, intstr(interp, &s, k - 2 + r5),
-		argv[k], 0);
+/*50*/	    put_index(interp, thisobj, k - 2 + r5, &s, argv[k]);
 	}
 /*53*/	SEE_SET_NUMBER(&v, r3-r6+r17);
 	SEE_OBJECT_PUT(interp, thisobj, STR(length), &v, 0);
@@ -1066,7 +1170,8 @@ array_proto_unshift(interp, self, thisobj, argc, argv, res)
 {
 	SEE_uint32_t r2, r3, k;
 	struct SEE_value v;
-	struct SEE_string *s = NULL, *p;
+	struct SEE_string *s = NULL;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -1076,21 +1181,23 @@ array_proto_unshift(interp, self, thisobj, argc, argv, res)
 	r2 = SEE_ToUint32(interp, &v);
 	r3 = argc;
 	check_too_long(interp, r2, r3);
-	for (k = r2; k > 0; k--) {
-	    p = intstr(interp, &s, k - 1);
-	    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, p)) {
-		SEE_OBJECT_GET(interp, thisobj, p, &v);
-		SEE_OBJECT_PUT(interp, thisobj, 
-		    intstr(interp, &s, k + r3 - 1), &v, 0);
-	    } else {
-		SEE_OBJECT_DELETE(interp, thisobj,
-		    intstr(interp, &s, k + r3 - 1));
-	    }
+	if ((ao = dense_array(thisobj)) != NULL) {
+	    dense_grow(interp, ao, r2 + r3);
+	    memmove(ao->dense + r3, ao->dense, r2 * sizeof *ao->dense);
+	    for (k = 0; k < r3; k++)
+		SEE_VALUE_COPY(&ao->dense[k], argv[k]);
+	    ao->length = r2 + r3;
+	    SEE_SET_NUMBER(res, r2 + r3);
+	    return;
 	}
-	for (k = 0; k < r3; k++) {
-	    SEE_OBJECT_PUT(interp, thisobj, intstr(interp, &s, k), 
-	        argv[k], 0);
+	for (k = r2; k > 0; k--) {
+	    if (get_present(interp, thisobj, k - 1, &s, &v))
+		put_index(interp, thisobj, k + r3 - 1, &s, &v);
+	    else
+		delete_index(interp, thisobj, k + r3 - 1, &s);
 	}
+	for (k = 0; k < r3; k++)
+	    put_index(interp, thisobj, k, &s, argv[k]);
 	SEE_SET_NUMBER(res, r2 + r3);
 	SEE_OBJECT_PUT(interp, thisobj, STR(length), res, 0);
 }
@@ -1120,8 +1227,10 @@ array_setlength(interp, ao, val)
 	int flags;
 
 	newlen = SEE_ToUint32(interp, val);
-	if (ao->length > newlen) {
-	    e = SEE_OBJECT_ENUMERATOR(interp, 
+	if (newlen < ao->ndense)
+	    SEE_GROW_TO(interp, &ao->gdense, newlen);
+	if (ao->length > newlen && ao->sparse) {
+	    e = SEE_native_enumerator(interp, 
 	    	(struct SEE_object *)&ao->native);
 	    while ((s = SEE_ENUM_NEXT(interp, e, &flags))) 
 		if (SEE_to_array_index(s, &i) && i >= newlen) {
@@ -1137,6 +1246,288 @@ array_setlength(interp, ao, val)
 	ao->length = newlen;
 }
 
+/* Extends the dense vector to n elements, filling it with holes */
+static void
+dense_grow(interp, ao, n)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t n;
+{
+	unsigned int i = ao->ndense;
+
+	SEE_GROW_TO(interp, &ao->gdense, n);
+	for (; i < n; i++)
+	    SET_HOLE(&ao->dense[i]);
+}
+
+/*
+ * Moves the dense elements into native properties, so that one can
+ * be given attributes. The vector is never used again.
+ */
+static void
+dense_to_sparse(interp, ao)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+{
+	unsigned int i;
+	struct SEE_string *s = NULL;
+
+	/* The elements stay in the vector until copied, for CanPut */
+	for (i = 0; i < ao->ndense; i++)
+	    if (!IS_HOLE(&ao->dense[i]))
+		SEE_native_put(interp, (struct SEE_object *)&ao->native,
+		    intstr(interp, &s, i), &ao->dense[i], 0);
+	SEE_GROW_TO(interp, &ao->gdense, 0);
+	ao->sparse = 1;
+}
+
+/*
+ * Returns true if the prototypes would let a new element be added at
+ * index i. Dense arrays on the prototype chain are checked without
+ * making a name. Object.prototype is assumed to have no read-only
+ * index properties, since scripts cannot make any, so the usual chain
+ * never needs the name either.
+ */
+static int
+element_canput(interp, ao, i, name)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t i;
+	struct SEE_string *name;
+{
+	struct SEE_object *o;
+	struct array_object *po;
+	struct SEE_string *s = NULL;
+
+	for (o = ao->native.object.Prototype; o;
+	     o = _SEE_CFUNCTION_PROTOTYPE(interp, o))
+	{
+	    if (SEE_is_Array(o) && !((struct array_object *)o)->sparse) {
+		po = (struct array_object *)o;
+		if (DENSE_HAS(po, i))
+		    return 1;
+		continue;
+	    }
+	    if (o == interp->Object_prototype && 
+		    o->objectclass->CanPut == SEE_native_canput)
+		return 1;
+	    if (!name)
+		name = intstr(interp, &s, i);
+	    return SEE_OBJECT_CANPUT(interp, o, name);
+	}
+	return 1;
+}
+
+/*
+ * Puts the element at index i, in the dense vector when possible.
+ * The name is the index as an interned string, or NULL if it has not
+ * been made yet.
+ */
+static void
+put_element(interp, ao, i, name, val, attr)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t i;
+	struct SEE_string *name;
+	struct SEE_value *val;
+	int attr;
+{
+	struct SEE_string *s = NULL;
+	SEE_uint32_t slack;
+
+	slack = ao->ndense < DENSE_SLACK ? DENSE_SLACK : ao->ndense;
+	if (!attr && i < ao->ndense) {
+	    if (IS_HOLE(&ao->dense[i]) && 
+		    !element_canput(interp, ao, i, name))
+		return;
+	    SEE_VALUE_COPY(&ao->dense[i], val);
+	} else if (!attr && !ao->sparse && i - ao->ndense < slack) {
+	    if (!element_canput(interp, ao, i, name))
+		return;
+	    dense_grow(interp, ao, i + 1);
+	    SEE_VALUE_COPY(&ao->dense[i], val);
+	} else {
+	    if (attr && ao->ndense)
+		dense_to_sparse(interp, ao);
+	    ao->sparse = 1;
+	    if (!name)
+		name = intstr(interp, &s, i);
+	    SEE_native_put(interp, (struct SEE_object *)&ao->native, 
+		name, val, attr);
+	}
+	if (i >= ao->length)
+	    ao->length = i + 1;
+}
+
+/*
+ * Gets the element at index i, looking in the dense vector before the
+ * prototypes. The name is as for put_element().
+ */
+static void
+get_element(interp, ao, i, name, res)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t i;
+	struct SEE_string *name;
+	struct SEE_value *res;
+{
+	struct SEE_object *proto = ao->native.object.Prototype;
+	struct SEE_string *s = NULL;
+
+	if (DENSE_HAS(ao, i))
+	    SEE_VALUE_COPY(res, &ao->dense[i]);
+	else if (!proto)
+	    SEE_SET_UNDEFINED(res);
+	else {
+	    if (!name)
+		name = intstr(interp, &s, i);
+	    SEE_OBJECT_GET(interp, proto, name, res);
+	}
+}
+
+/*
+ * Returns the array if o is an array whose elements are all in its
+ * dense vector, with no holes, otherwise NULL. The Array.prototype
+ * methods work on the vector of such an array directly.
+ */
+static struct array_object *
+dense_array(o)
+	struct SEE_object *o;
+{
+	struct array_object *ao;
+	unsigned int i;
+
+	if (!SEE_is_Array(o))
+	    return NULL;
+	ao = (struct array_object *)o;
+	if (ao->sparse || ao->ndense != ao->length)
+	    return NULL;
+	for (i = 0; i < ao->ndense; i++)
+	    if (IS_HOLE(&ao->dense[i]))
+		return NULL;
+	return ao;
+}
+
+/* Appends n values to an array whose elements are all in its vector */
+static void
+dense_append(interp, ao, vals, n)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	struct SEE_value *vals;
+	SEE_uint32_t n;
+{
+	unsigned int base = ao->ndense;
+
+	SEE_ASSERT(interp, !ao->sparse && ao->length == ao->ndense);
+	check_too_long(interp, base, n);
+	SEE_GROW_TO(interp, &ao->gdense, base + n);
+	memcpy(ao->dense + base, vals, n * sizeof *vals);
+	ao->length = base + n;
+}
+
+/*
+ * Element access for the Array.prototype methods, which work on any
+ * object. The elements of an array's dense vector need no names; other
+ * names are built in *sp.
+ */
+
+/* Gets element i of o, as [[Get]] would */
+static void
+get_index(interp, o, i, sp, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t i;
+	struct SEE_string **sp;
+	struct SEE_value *res;
+{
+	if (SEE_is_Array(o) && DENSE_HAS((struct array_object *)o, i))
+	    SEE_VALUE_COPY(res, &((struct array_object *)o)->dense[i]);
+	else
+	    SEE_OBJECT_GET(interp, o, intstr(interp, sp, i), res);
+}
+
+/* Gets element i of o, if [[HasProperty]] finds it. Returns false if not */
+static int
+get_present(interp, o, i, sp, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t i;
+	struct SEE_string **sp;
+	struct SEE_value *res;
+{
+	struct SEE_string *p;
+
+	if (SEE_is_Array(o) && DENSE_HAS((struct array_object *)o, i)) {
+	    SEE_VALUE_COPY(res, &((struct array_object *)o)->dense[i]);
+	    return 1;
+	}
+	p = intstr(interp, sp, i);
+	if (!SEE_OBJECT_HASPROPERTY(interp, o, p))
+	    return 0;
+	SEE_OBJECT_GET(interp, o, p, res);
+	return 1;
+}
+
+/* Puts element i of o, as [[Put]] would */
+static void
+put_index(interp, o, i, sp, val)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t i;
+	struct SEE_string **sp;
+	struct SEE_value *val;
+{
+	if (SEE_is_Array(o))
+	    put_element(interp, (struct array_object *)o, i, NULL, val, 0);
+	else
+	    SEE_OBJECT_PUT(interp, o, intstr(interp, sp, i), val, 0);
+}
+
+/* Deletes element i of o, as [[Delete]] would */
+static void
+delete_index(interp, o, i, sp)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t i;
+	struct SEE_string **sp;
+{
+	struct array_object *ao = (struct array_object *)o;
+
+	if (SEE_is_Array(o) && (i < ao->ndense || !ao->sparse)) {
+	    if (i < ao->ndense)
+		SET_HOLE(&ao->dense[i]);
+	} else
+	    SEE_OBJECT_DELETE(interp, o, intstr(interp, sp, i));
+}
+
+/* Gets an array element by index, without making its name if it can */
+void
+_SEE_Array_get_index(interp, o, i, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t i;
+	struct SEE_value *res;
+{
+	struct array_object *ao = (struct array_object *)o;
+	struct SEE_string *s = NULL;
+
+	if (i < ao->ndense || !ao->sparse)
+	    get_element(interp, ao, i, NULL, res);
+	else
+	    SEE_native_get(interp, o, intstr(interp, &s, i), res);
+}
+
+/* Puts an array element by index, without making its name if it can */
+void
+_SEE_Array_put_index(interp, o, i, val)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t i;
+	struct SEE_value *val;
+{
+	put_element(interp, (struct array_object *)o, i, NULL, val, 0);
+}
+
 static void
 array_get(interp, o, p, res)
 	struct SEE_interpreter *interp;
@@ -1145,9 +1536,12 @@ array_get(interp, o, p, res)
 	struct SEE_value *res;
 {
 	struct array_object *ao = (struct array_object *)o;
+	SEE_uint32_t i;
 
 	if (p == STR(length))
 	    SEE_SET_NUMBER(res, ao->length);
+	else if (SEE_to_array_index(p, &i) && (i < ao->ndense || !ao->sparse))
+	    get_element(interp, ao, i, p, res);
 	else
 	    SEE_native_get(interp, o, p, res);
 }
@@ -1165,12 +1559,25 @@ array_put(interp, o, p, val, attr)
 
 	if (p == STR(length))
 	    array_setlength(interp, ao, val);
-	else {
+	else if (SEE_to_array_index(p, &i))
+	    put_element(interp, ao, i, p, val, attr);
+	else
 	    SEE_native_put(interp, o, p, val, attr);
-	    if (SEE_to_array_index(p, &i))
-		if (i >= ao->length)
-		    ao->length = i + 1;
-	}
+}
+
+static int
+array_canput(interp, o, p)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	struct SEE_string *p;
+{
+	struct array_object *ao = (struct array_object *)o;
+	SEE_uint32_t i;
+
+	if (SEE_to_array_index(p, &i) && (i < ao->ndense || !ao->sparse))
+	    return DENSE_HAS(ao, i) || element_canput(interp, ao, i, p);
+	else
+	    return SEE_native_canput(interp, o, p);
 }
 
 static int
@@ -1179,8 +1586,14 @@ array_hasproperty(interp, o, p)
 	struct SEE_object *o;
 	struct SEE_string *p;
 {
+	struct array_object *ao = (struct array_object *)o;
+	SEE_uint32_t i;
+
 	if (p == STR(length))
 	    return 1;
+	else if (SEE_to_array_index(p, &i) && (i < ao->ndense || !ao->sparse))
+	    return DENSE_HAS(ao, i) || (o->Prototype &&
+		SEE_OBJECT_HASPROPERTY(interp, o->Prototype, p));
 	else
 	    return SEE_native_hasproperty(interp, o, p);
 }
@@ -1191,8 +1604,70 @@ array_delete(interp, o, p)
 	struct SEE_object *o;
 	struct SEE_string *p;
 {
+	struct array_object *ao = (struct array_object *)o;
+	SEE_uint32_t i;
+
 	if (p == STR(length))
 	    return 0;
-	else
+	else if (SEE_to_array_index(p, &i) && (i < ao->ndense || !ao->sparse))
+	{
+	    if (i < ao->ndense)
+		SET_HOLE(&ao->dense[i]);
+	    return 1;
+	} else
 	    return SEE_native_delete(interp, o, p);
 }
+
+/*
+ * Array enumeration lists the dense elements in index order, and then
+ * the native properties.
+ */
+struct array_enum {
+	struct SEE_enum base;
+	struct array_object *ao;
+	SEE_uint32_t next_index;
+	struct SEE_string *s;
+	struct SEE_enum *native;
+};
+
+static struct SEE_string *
+array_enum_next(interp, e, dont_enump)
+	struct SEE_interpreter *interp;
+	struct SEE_enum *e;
+	int *dont_enump;
+{
+	struct array_enum *ae = (struct array_enum *)e;
+	struct array_object *ao = ae->ao;
+	SEE_uint32_t i;
+
+	while ((i = ae->next_index) < ao->ndense) {
+	    ae->next_index++;
+	    if (!IS_HOLE(&ao->dense[i])) {
+		if (dont_enump)
+		    *dont_enump = 0;
+		return intstr(interp, &ae->s, i);
+	    }
+	}
+	return SEE_ENUM_NEXT(interp, ae->native, dont_enump);
+}
+
+static struct SEE_enumclass array_enumclass = {
+	0,
+	array_enum_next
+};
+
+static struct SEE_enum *
+array_enumerator(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	struct array_enum *ae;
+
+	ae = SEE_NEW(interp, struct array_enum);
+	ae->base.enumclass = &array_enumclass;
+	ae->ao = (struct array_object *)o;
+	ae->next_index = 0;
+	ae->s = NULL;
+	ae->native = SEE_native_enumerator(interp, o);
+	return (struct SEE_enum *)ae;
+}
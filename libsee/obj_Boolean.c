@@ -43,6 +43,7 @@
 
 #include "stringdefs.h"
 #include "init.h"
+#include "snapshot.h"
 
 /*
  * 15.6 The Boolean object.
@@ -54,6 +55,13 @@ struct boolean_object {
 	SEE_boolean_t boolean;		/* Value */
 };
 
+static const struct snapshot_word boolean_words[] = {
+	SNAPSHOT_NATIVE(struct boolean_object, native),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(boolean_layout, struct boolean_object,
+	boolean_words);
+
 static struct boolean_object *toboolean(struct SEE_interpreter *,
 	struct SEE_object *);
 
@@ -105,6 +113,8 @@ SEE_Boolean_alloc(interp)
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Boolean_prototype = 
 	    (struct SEE_object *)SEE_NEW(interp, struct boolean_object);
+	SNAPSHOT_LAYOUT(interp, interp->Boolean, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Boolean_prototype, &boolean_layout);
 }
 
 void
@@ -178,6 +188,7 @@ boolean_construct(interp, self, thisobj, argc, argv, res)
 		SEE_ToBoolean(interp, argv[0], &v);
 
 	bo = SEE_NEW(interp, struct boolean_object);
+	SNAPSHOT_LAYOUT(interp, bo, &boolean_layout);
 	SEE_native_init(&bo->native, interp, &_SEE_boolean_inst_class,
 		interp->Boolean_prototype);
 	bo->boolean = v.u.boolean;
@@ -51,17 +51,34 @@
 #include "dprint.h"
 #include "nmath.h"
 #include "platform.h"
+#include "snapshot.h"
 
 /*
  * 15.9 The Date object.
  */
 
+/* a time value broken down into calendar fields (see date_fields()) */
+struct date_fields {
+	SEE_number_t t;		/* time value the fields are for, or NaN */
+	unsigned int tzstamp;	/* timezone the local fields are for */
+	SEE_number_t local;	/* LocalTime(t), or t for UTC fields */
+	SEE_int32_t year, month, date, day;
+	SEE_int32_t hours, minutes, seconds, ms;
+};
+
 /* structure of date instances */
 struct date_object {
 	struct SEE_native native;
 	SEE_number_t t;		/* time value with 53 bit precision */
+	struct date_fields local, utc;	/* shared by the getters */
 };
 
+static const struct snapshot_word date_words[] = {
+	SNAPSHOT_NATIVE(struct date_object, native),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(date_layout, struct date_object, date_words);
+
 #define SGN(x)  ((x) < 0 ? -1 : 1)
 #define ABS(x)  ((x) < 0 ? -(x) : (x))
 
@@ -92,14 +109,22 @@ static SEE_number_t DayFromYear(SEE_number_t);		/* 15.9.1.3 */
 static SEE_number_t YearFromTime(SEE_number_t);		/* 15.9.1.3 */
 #define InLeapYear(t)	isleapyear(YearFromTime(t))	/* 15.9.1.3 */
 static int isleapyear(SEE_number_t);
+#define ISLEAP(y)	((y) % 4 == 0 && ((y) % 100 != 0 || (y) % 400 == 0))
 #define DayWithinYear(t) \
 		(Day(t) - DayFromYear(YearFromTime(t)))
 static SEE_number_t MonthFromTime(SEE_number_t);	/* 15.9.1.4 */
 static SEE_number_t DateFromTime(SEE_number_t);			/* 15.9.1.5 */
 #define WeekDay(t)		modulo(Day(t) + 4, 7.0)	/* 15.9.1.6 */
 
-#define LocalTZA(i)	_SEE_platform_tza(i)		/* 15.9.1.7(8) */
+#define LocalTZA(i)	dst_tza(i)			/* 15.9.1.7(8) */
+static SEE_number_t dst_tza(struct SEE_interpreter *);
 static SEE_number_t DaylightSavingTA(struct SEE_interpreter *, SEE_number_t);
+static int civil(SEE_number_t, SEE_int32_t *, SEE_int32_t *, 
+	SEE_int32_t *, SEE_int32_t *);
+static void breakdown(struct SEE_interpreter *, SEE_number_t, int,
+	struct date_fields *);
+static const struct date_fields *date_fields(struct SEE_interpreter *, 
+	struct date_object *, int);
 static SEE_number_t UTC(struct SEE_interpreter *, SEE_number_t);
 static SEE_number_t LocalTime(struct SEE_interpreter *, SEE_number_t);
 
@@ -338,6 +363,35 @@ LocalTime(interp, t)
 	return t + LocalTZA(interp) + DaylightSavingTA(interp, t);
 }
 
+/*
+ * DaylightSavingTA() may only depend on the time within the year, whether
+ * the year is a leap year and the weekday it starts on (15.9.1.8), so
+ * there are just fourteen kinds of year. For each kind, the times at
+ * which the adjustment changes are found once (by dst_compute()) and
+ * kept with the interpreter, rather than the platform being asked about
+ * every time value converted, which costs two mktime() calls.
+ */
+#define DST_MAXCHANGES	8		/* changes kept per kind of year */
+#define DST_STEP	(7 * msPerDay)	/* sampling interval */
+#define DST_UNKNOWN	(-1)		/* nchanges: not computed yet */
+#define DST_UNCACHED	(-2)		/* nchanges: too many to keep */
+
+struct dst_year {
+	int nchanges;
+	SEE_number_t change[DST_MAXCHANGES];	 /* ysec of each change */
+	SEE_number_t adjust[DST_MAXCHANGES + 1]; /* adjustment from then */
+};
+
+struct dst_cache {
+	unsigned int tzstamp;		/* timezone the years are for */
+	SEE_number_t tza;		/* LocalTZA() of that timezone */
+	struct dst_year year[2][7];	/* [leap year][weekday of Jan 1] */
+};
+
+static struct dst_cache *dst_cache(struct SEE_interpreter *);
+static void dst_compute(struct SEE_interpreter *, struct dst_year *,
+	int, int);
+
 /*
  * Can only use the following four properties for computing DST:
  *   ysec - time since beginning of year
@@ -351,11 +405,113 @@ DaylightSavingTA(interp, t)
 	struct SEE_interpreter *interp;
 	SEE_number_t t;
 {
-	SEE_number_t ysec = t - TimeFromYear(YearFromTime(t));
-	int ily = InLeapYear(t);
-	int wstart = WeekDay(TimeFromYear(YearFromTime(t)));
+	SEE_number_t ysec;
+	SEE_int32_t day, year, yday, ms;
+	int ily, wstart, i;
+	struct dst_year *dy;
+
+	/* A time that is not finite has no year to index the cache with */
+	if (!SEE_ISFINITE(t))
+	    return 0;
+	if (civil(t, &day, &year, &yday, &ms)) {
+	    ysec = yday * msPerDay + ms;
+	    ily = ISLEAP(year);
+	    wstart = ((day - yday + 4) % 7 + 7) % 7;
+	} else {
+	    ysec = t - TimeFromYear(YearFromTime(t));
+	    ily = InLeapYear(t);
+	    wstart = WeekDay(TimeFromYear(YearFromTime(t)));
+	}
+
+	dy = &dst_cache(interp)->year[ily][wstart];
+	if (dy->nchanges == DST_UNKNOWN)
+	    dst_compute(interp, dy, ily, wstart);
+	if (dy->nchanges == DST_UNCACHED)
+	    return _SEE_platform_dst(interp, ysec, ily, wstart);
+	for (i = 0; i < dy->nchanges && ysec >= dy->change[i]; i++)
+	    ;
+	return dy->adjust[i];
+}
+
+/*
+ * Returns the interpreter's DST cache, emptying it first if the
+ * timezone has changed since it was filled.
+ */
+static struct dst_cache *
+dst_cache(interp)
+	struct SEE_interpreter *interp;
+{
+	struct dst_cache *cache = (struct dst_cache *)interp->dst_cache;
+	unsigned int tzstamp = _SEE_platform_tzstamp(interp);
+	int ily, wstart;
+
+	if (!cache) {
+	    cache = (struct dst_cache *)SEE_malloc_string(interp,
+		sizeof (struct dst_cache));
+	    interp->dst_cache = cache;
+	} else if (cache->tzstamp == tzstamp)
+	    return cache;
+	for (ily = 0; ily < 2; ily++)
+	    for (wstart = 0; wstart < 7; wstart++)
+		cache->year[ily][wstart].nchanges = DST_UNKNOWN;
+	cache->tza = _SEE_platform_tza(interp);
+	cache->tzstamp = tzstamp;
+	return cache;
+}
+
+/* Returns LocalTZA for the timezone the interpreter's DST cache is for */
+static SEE_number_t
+dst_tza(interp)
+	struct SEE_interpreter *interp;
+{
+	return dst_cache(interp)->tza;
+}
 
-	return _SEE_platform_dst(interp, ysec, ily, wstart);
+/*
+ * Finds where the DST adjustment changes during one kind of year.
+ * The platform is asked about each week, and each week where the answer
+ * changes is bisected down to the second, which is as fine as the
+ * platform goes. (An adjustment that comes and goes within one week
+ * would be missed.) If there are too many changes to keep, the year
+ * is marked so that the platform is asked every time instead.
+ */
+static void
+dst_compute(interp, dy, ily, wstart)
+	struct SEE_interpreter *interp;
+	struct dst_year *dy;
+	int ily, wstart;
+{
+	SEE_number_t end = (365 + ily) * msPerDay - msPerSecond;
+	SEE_number_t lo, hi, mid, t, prev, adjust;
+	int n = 0;
+
+	prev = _SEE_platform_dst(interp, 0, ily, wstart);
+	dy->adjust[0] = prev;
+	for (lo = 0; lo < end; lo = t) {
+	    t = lo + DST_STEP;
+	    if (t > end)
+		t = end;
+	    adjust = _SEE_platform_dst(interp, t, ily, wstart);
+	    if (adjust == prev)
+		continue;
+	    /* The change is in (lo, t]: keep prev at lo and not at hi */
+	    for (hi = t; hi - lo > msPerSecond; ) {
+		mid = lo + NUMBER_floor((hi - lo) / 2 / msPerSecond) 
+		    * msPerSecond;
+		if (_SEE_platform_dst(interp, mid, ily, wstart) == prev)
+		    lo = mid;
+		else
+		    hi = mid;
+	    }
+	    if (n == DST_MAXCHANGES) {
+		dy->nchanges = DST_UNCACHED;
+		return;
+	    }
+	    dy->change[n++] = hi;
+	    dy->adjust[n] = adjust;
+	    prev = adjust;
+	}
+	dy->nchanges = n;
 }
 
 void
@@ -366,6 +522,8 @@ SEE_Date_alloc(interp)
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Date_prototype = 
 	    (struct SEE_object *)SEE_NEW(interp, struct date_object);
+	SNAPSHOT_LAYOUT(interp, interp->Date, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Date_prototype, &date_layout);
 }
 
 void
@@ -403,6 +561,8 @@ SEE_Date_init(interp)
 	SEE_native_init((struct SEE_native *)Date_prototype, interp,
 		&date_inst_class, interp->Object_prototype);
 	((struct date_object *)Date_prototype)->t = SEE_NaN;
+	((struct date_object *)Date_prototype)->local.t = SEE_NaN;
+	((struct date_object *)Date_prototype)->utc.t = SEE_NaN;
 
 	/* 15.9.5.1 Date.prototype.constructor */
 	SEE_SET_OBJECT(&v, Date);
@@ -487,6 +647,8 @@ YearFromTime(t0)
 	 */
 	SEE_number_t y, t;
 
+	if (!SEE_ISFINITE(t0))
+		return SEE_NaN;
 	y = 0;
 	t = t0 + T1970;
 	y += 400 * NUMBER_floor(t / msPerY400);
@@ -521,6 +683,110 @@ isleapyear(y)
 	return 1;
 }
 
+/* Days before each month, in normal and leap years */
+static const short monthstart[2][13] = {
+    { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+    { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+};
+
+/*
+ * Splits a time value into its day number, year, day within the year
+ * and ms within the day, like YearFromTime() and DayWithinYear() but
+ * with integer arithmetic on the day number instead of floating point
+ * division. Returns false for NaN or for times too far outside the
+ * range of TimeClip() to fit.
+ */
+static int
+civil(t, dayp, yearp, ydayp, msp)
+	SEE_number_t t;
+	SEE_int32_t *dayp, *yearp, *ydayp, *msp;
+{
+	SEE_number_t day;
+	SEE_int32_t z, era, doe, yoe, doy, y;
+
+	if (!(t >= minTime - 2 * msPerDay && t <= maxTime + 2 * msPerDay))
+		return 0;
+	day = Day(t);
+	*dayp = (SEE_int32_t)day;
+	*msp = (SEE_int32_t)(t - day * msPerDay);
+
+	/* Count in 400-year eras of 146097 days from 1 March 0000 */
+	z = *dayp + 719468;
+	era = (z >= 0 ? z : z - 146096) / 146097;
+	doe = z - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	y = yoe + era * 400;
+
+	/* Move the start of the year back from 1 March to 1 January */
+	if (doy >= 306) {
+		y++;
+		doy -= 306;
+	} else
+		doy += 59 + ISLEAP(y);
+	*yearp = y;
+	*ydayp = doy;
+	return 1;
+}
+
+/* Fills in the calendar fields for t (not NaN) in local or UTC time */
+static void
+breakdown(interp, t, utc, f)
+	struct SEE_interpreter *interp;
+	SEE_number_t t;
+	int utc;
+	struct date_fields *f;
+{
+	SEE_number_t lt = utc ? t : LocalTime(interp, t);
+	SEE_int32_t day, yday, ms, month;
+	const short *start;
+
+	f->t = t;
+	f->local = lt;
+	if (civil(lt, &day, &f->year, &yday, &ms)) {
+		start = monthstart[ISLEAP(f->year)];
+		for (month = 0; yday >= start[month + 1]; month++)
+			;
+		f->month = month;
+		f->date = yday - start[month] + 1;
+		f->day = ((day + 4) % 7 + 7) % 7;
+		f->hours = ms / 3600000;
+		f->minutes = ms / 60000 % 60;
+		f->seconds = ms / 1000 % 60;
+		f->ms = ms % 1000;
+	} else {
+		f->year = YearFromTime(lt);
+		f->month = MonthFromTime(lt);
+		f->date = DateFromTime(lt);
+		f->day = WeekDay(lt);
+		f->hours = HourFromTime(lt);
+		f->minutes = MinFromTime(lt);
+		f->seconds = SecFromTime(lt);
+		f->ms = msFromTime(lt);
+	}
+}
+
+/*
+ * Returns the calendar fields of a date object whose time is not NaN.
+ * They are kept in the object until its time or the timezone changes,
+ * so that a run of getters works them out only once.
+ */
+static const struct date_fields *
+date_fields(interp, d, utc)
+	struct SEE_interpreter *interp;
+	struct date_object *d;
+	int utc;
+{
+	struct date_fields *f = utc ? &d->utc : &d->local;
+	unsigned int tzstamp = utc ? 0 : _SEE_platform_tzstamp(interp);
+
+	if (f->t != d->t || f->tzstamp != tzstamp) {
+		breakdown(interp, d->t, utc, f);
+		f->tzstamp = tzstamp;
+	}
+	return f;
+}
+
 /* 15.9.1.4 */
 static SEE_number_t
 MonthFromTime(t)
@@ -947,32 +1213,26 @@ repr_baddate(interp)
 		return STR(NaN);
 }
 
-/* ref 15.9.5.2 */
+/* ref 15.9.5.2; f is NULL for an invalid date */
 static struct SEE_string *
-reprdatetime(interp, t, utc)
+reprdatetime(interp, f, utc)
 	struct SEE_interpreter *interp;
-	SEE_number_t t;
+	const struct date_fields *f;
 	int utc;
 {
 	SEE_int32_t wkday, day, month, year, hour, min, sec;
 	int gmtoff;
 
-	if (SEE_ISNAN(t)) return repr_baddate(interp);
-
-	if (!utc) {
-		t = LocalTime(interp, t);
-		gmtoff = (int)((t - LocalTime(interp, t)) / msPerMinute);
-	} else
-		gmtoff = 0;
-
-	wkday = WeekDay(t);
-	day = DateFromTime(t);
-	month = MonthFromTime(t);
-	year = YearFromTime(t);
-	hour = HourFromTime(t);
-	min = MinFromTime(t);
-	sec = SecFromTime(t);
+	if (!f) return repr_baddate(interp);
 
+	gmtoff = (int)((f->t - f->local) / msPerMinute);
+	wkday = f->day;
+	day = f->date;
+	month = f->month;
+	year = f->year;
+	hour = f->hours;
+	min = f->minutes;
+	sec = f->seconds;
 
 	if (SEE_GET_JS_COMPAT(interp)) {
 	    if (utc)
@@ -1055,8 +1315,14 @@ date_call(interp, self, thisobj, argc, argv, res)
 	struct SEE_value **argv;
 	struct SEE_value *res;
 {
+	SEE_number_t t = now(interp);
+	struct date_fields f;
+
 	/* Ignore arguments; equiavlent to (new Date()).toString() */
-	SEE_SET_STRING(res, reprdatetime(interp, now(interp), 0));
+	if (!SEE_ISNAN(t))
+		breakdown(interp, t, 0, &f);
+	SEE_SET_STRING(res, reprdatetime(interp, 
+	    SEE_ISNAN(t) ? NULL : &f, 0));
 }
 
 /* 15.9.3.1 */
@@ -1128,9 +1394,11 @@ date_construct(interp, self, thisobj, argc, argv, res)
 	}
 
 	d = SEE_NEW(interp, struct date_object);
+	SNAPSHOT_LAYOUT(interp, d, &date_layout);
 	SEE_native_init(&d->native, interp, &date_inst_class,
 		interp->Date_prototype);
 	d->t = t;
+	d->local.t = d->utc.t = SEE_NaN;
 
 	SEE_SET_OBJECT(res, (struct SEE_object *)d);
 }
@@ -1236,7 +1504,8 @@ date_proto_toString(interp, self, thisobj, argc, argv, res)
 {
 	struct date_object *d = todate(interp, thisobj);
 
-	SEE_SET_STRING(res, reprdatetime(interp, d->t, 0));
+	SEE_SET_STRING(res, reprdatetime(interp, 
+	    SEE_ISNAN(d->t) ? NULL : date_fields(interp, d, 0), 0));
 }
 
 /* 15.9.5.3 */
@@ -1337,8 +1606,7 @@ date_proto_getFullYear(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, 
-		    YearFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->year);
 }
 
 /* 15.9.5.11 */
@@ -1354,8 +1622,7 @@ date_proto_getUTCFullYear(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, 
-		    YearFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->year);
 }
 
 /* 15.9.5.12 */
@@ -1371,7 +1638,7 @@ date_proto_getMonth(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, MonthFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->month);
 }
 
 /* 15.9.5.13 */
@@ -1387,7 +1654,7 @@ date_proto_getUTCMonth(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, MonthFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->month);
 }
 
 /* 15.9.5.14 */
@@ -1403,7 +1670,7 @@ date_proto_getDate(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, DateFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->date);
 }
 
 /* 15.9.5.15 */
@@ -1419,7 +1686,7 @@ date_proto_getUTCDate(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, DateFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->date);
 }
 
 /* 15.9.5.16 */
@@ -1435,7 +1702,7 @@ date_proto_getDay(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, WeekDay(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->day);
 }
 
 /* 15.9.5.17 */
@@ -1451,7 +1718,7 @@ date_proto_getUTCDay(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, WeekDay(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->day);
 }
 
 /* 15.9.5.18 */
@@ -1467,7 +1734,7 @@ date_proto_getHours(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, HourFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->hours);
 }
 
 /* 15.9.5.19 */
@@ -1483,7 +1750,7 @@ date_proto_getUTCHours(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, HourFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->hours);
 }
 
 /* 15.9.5.20 */
@@ -1499,7 +1766,7 @@ date_proto_getMinutes(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, MinFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->minutes);
 }
 
 /* 15.9.5.21 */
@@ -1515,7 +1782,7 @@ date_proto_getUTCMinutes(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, MinFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->minutes);
 }
 
 /* 15.9.5.22 */
@@ -1531,7 +1798,7 @@ date_proto_getSeconds(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, SecFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->seconds);
 }
 
 /* 15.9.5.23 */
@@ -1547,7 +1814,7 @@ date_proto_getUTCSeconds(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, SecFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->seconds);
 }
 
 /* 15.9.5.24 */
@@ -1563,7 +1830,7 @@ date_proto_getMilliseconds(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, msFromTime(LocalTime(interp, d->t)));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->ms);
 }
 
 /* 15.9.5.25 */
@@ -1579,7 +1846,7 @@ date_proto_getUTCMilliseconds(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, msFromTime(d->t));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 1)->ms);
 }
 
 /* 15.9.5.26 */
@@ -1596,7 +1863,7 @@ date_proto_getTimezoneOffset(interp, self, thisobj, argc, argv, res)
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
 		SEE_SET_NUMBER(res, 
-		    (d->t - LocalTime(interp, d->t)) / msPerMinute);
+		    (d->t - date_fields(interp, d, 0)->local) / msPerMinute);
 }
 
 /* 15.9.5.27 */
@@ -2012,7 +2279,7 @@ date_proto_setFullYear(interp, self, thisobj, argc, argv, res)
 	struct date_object *d = todate(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t date, month;
-	SEE_number_t t = LocalTime(interp, d->t);
+	SEE_number_t t = SEE_ISNAN(d->t) ? 0 : LocalTime(interp, d->t);
 
 	if (argc < 1)
 		d->t = SEE_NaN;
@@ -2050,7 +2317,7 @@ date_proto_setUTCFullYear(interp, self, thisobj, argc, argv, res)
 	struct date_object *d = todate(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t date, month;
-	SEE_number_t t = d->t;
+	SEE_number_t t = SEE_ISNAN(d->t) ? 0 : d->t;
 
 	if (argc < 1)
 		d->t = SEE_NaN;
@@ -2086,7 +2353,8 @@ date_proto_toUTCString(interp, self, thisobj, argc, argv, res)
 {
 	struct date_object *d = todate(interp, thisobj);
 
-	SEE_SET_STRING(res, reprdatetime(interp, d->t, 1));
+	SEE_SET_STRING(res, reprdatetime(interp, 
+	    SEE_ISNAN(d->t) ? NULL : date_fields(interp, d, 1), 1));
 }
 
 /* B.2.4 */
@@ -2102,8 +2370,7 @@ date_proto_getYear(interp, self, thisobj, argc, argv, res)
 	if (SEE_ISNAN(d->t))
 		SEE_SET_NUMBER(res, SEE_NaN);
 	else
-		SEE_SET_NUMBER(res, 
-		    (YearFromTime(LocalTime(interp, d->t)) - 1900));
+		SEE_SET_NUMBER(res, date_fields(interp, d, 0)->year - 1900);
 }
 
 /* B.2.5 */
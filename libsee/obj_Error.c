@@ -54,6 +54,7 @@
 #include "stringdefs.h"
 #include "init.h"
 #include "dprint.h"
+#include "snapshot.h"
 
 #ifndef NDEBUG
 int SEE_Error_debug = 0;
@@ -173,6 +174,13 @@ SEE_Error_alloc(interp)
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->URIError = 
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, interp->Error, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->EvalError, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->RangeError, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->ReferenceError, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->SyntaxError, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->TypeError, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->URIError, &_SEE_snapshot_native);
 }
 
 void
@@ -220,6 +228,7 @@ SEE_Error_make(interp, name)
 	SEE_OBJECT_GET(interp, interp->Error, STR(prototype), &v);
 	Error_prototype = v.u.object;
 	new_error = (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, new_error, &_SEE_snapshot_native);
 	init_error(interp, name, new_error, Error_prototype);
 	return new_error;
 }
@@ -312,6 +321,7 @@ error_construct(interp, self, thisobj, argc, argv, res)
 		proto = NULL;			/* XXX should abort? */
 
 	obj = SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, obj, &_SEE_snapshot_native);
 	SEE_native_init(obj, interp, &error_inst_class, proto);
 
 	if (argc > 0 && SEE_VALUE_GET_TYPE(argv[0]) != SEE_UNDEFINED) {
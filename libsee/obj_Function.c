@@ -63,6 +63,7 @@
 #include "scope.h"
 #include "init.h"
 #include "nmath.h"
+#include "snapshot.h"
 
 
 /*
@@ -101,6 +102,34 @@ struct arguments {
 	SEE_boolean_t	  *deleted;
 };
 
+static const struct snapshot_word function_inst_words[] = {
+	SNAPSHOT_OBJECT(struct function_inst, object),
+	SNAPSHOT_PTR(struct function_inst, function),
+	SNAPSHOT_PTR(struct function_inst, scope),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(function_inst_layout, struct function_inst,
+	function_inst_words);
+
+static const struct snapshot_word activation_words[] = {
+	SNAPSHOT_NATIVE(struct activation, native),
+	SNAPSHOT_PTR(struct activation, function),
+	SNAPSHOT_PTR(struct activation, argv),
+	SNAPSHOT_PTR(struct activation, arguments),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(activation_layout, struct activation,
+	activation_words);
+
+static const struct snapshot_word arguments_words[] = {
+	SNAPSHOT_NATIVE(struct arguments, native),
+	SNAPSHOT_PTR(struct arguments, function),
+	SNAPSHOT_PTR(struct arguments, activation),
+	SNAPSHOT_PTR(struct arguments, deleted),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(arguments_layout, struct arguments, arguments_words);
+
 /* Prototypes */
 static struct function_inst *tofunction(struct SEE_interpreter *, 
         struct SEE_object *);
@@ -236,6 +265,9 @@ SEE_Function_alloc(interp)
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Function_prototype =
 		(struct SEE_object *)SEE_NEW(interp, struct function_inst);
+	SNAPSHOT_LAYOUT(interp, interp->Function, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Function_prototype,
+	    &function_inst_layout);
 }
 
 void
@@ -354,6 +386,7 @@ SEE_function_inst_create(interp, f, scope)
 	}
 
 	fi = SEE_NEW(interp, struct function_inst);
+	SNAPSHOT_LAYOUT(interp, fi, &function_inst_layout);
 	function_inst_init(fi, interp, f, scope);
 
 	if (!f->cache)
@@ -434,7 +467,6 @@ SEE_function_getname(interp, o)
         struct SEE_object *o;
 {
 	struct function_inst *fi;
-	extern struct SEE_objectclass SEE_cfunction_class;
 
 	if (!o)
 		return NULL;
@@ -468,7 +500,7 @@ function_inst_hasinstance(interp, f, vval)
 	o = oval.u.object;
 
 	for (;;) {
-		v = v->Prototype;
+		v = _SEE_CFUNCTION_PROTOTYPE(interp, v);
 		if (!v)
 			return 0;
 		if (SEE_OBJECT_JOINED(v, o))
@@ -486,7 +518,7 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_context context;
 	struct function_inst *fi;
-	struct SEE_object *activation;
+	struct SEE_object *activation, *common;
 	struct SEE_value v;
 	struct SEE_scope *innerscope;
 	SEE_try_context_t ctxt;
@@ -503,11 +535,31 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 		return;
 	}
 
+	/*
+	 * Functions that cannot observe their own activation object
+	 * keep their vars in a frame, and are called without one. 
+	 * (The f.arguments extension needs the activation object.)
+	 */
+	if (SEE_functionbody_hasframe(interp, fi->function) &&
+	    !SEE_COMPAT_JS(interp, >=, JS11))
+	{
+		context.interpreter = interp;
+		context.activation = NULL;
+		context.variable = NULL;
+		context.varattr = SEE_ATTR_DONTDELETE;
+		context.thisobj = thisobj ? thisobj : interp->Global;
+		context.scope = fi->scope;
+		SEE_call_functionbody(fi->function, &context, self, 
+		    argc, argv, res);
+		return;
+	}
+
 	/* 10.1.6 Create an activation object */
 	activation = activation_create(interp, self, fi->function, argc, argv);
 
 	/* 10.2.3 build the right scope chain now */
 	innerscope = SEE_NEW(interp, struct SEE_scope);
+	SNAPSHOT_LAYOUT(interp, innerscope, &_SEE_snapshot_pointers);
 	innerscope->obj = activation;
 	innerscope->next = fi->scope;
 
@@ -519,43 +571,45 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 	context.thisobj = thisobj ? thisobj : interp->Global;
 	context.scope = innerscope;
 
+	/*
+	 * Run it (adds vars and func decls to context.variable).
+	 * Without f.arguments there is nothing to undo afterwards, so
+	 * exceptions are left to pass straight through to the caller.
+	 */
+	if (!SEE_COMPAT_JS(interp, >=, JS11)) {
+		SEE_eval_functionbody(fi->function, &context, res);
+		return;
+	}
+
 	/* 
 	 * Compatibility: set f.arguments to the arguments object too,
 	 * saving the old value (It gets restored later)
 	 */
-	if (SEE_COMPAT_JS(interp, >=, JS11)) { /* EXT:11 */
-	    struct SEE_object *common = 
-	    	(struct SEE_object *)fi->function->common;
-	    if (SEE_OBJECT_HASPROPERTY(interp, common, STR(arguments))) {
-		SEE_OBJECT_GET(interp, common, STR(arguments), &old_arguments);
-		old_arguments_attr = SEE_native_getownattr(interp, common,
-			STR(arguments));
-		old_arguments_saved = 1;
-	    }
-	    SEE_SET_OBJECT(&v, ((struct activation *)activation)->arguments);
-	    SEE_OBJECT_PUT(interp, common, STR(arguments), &v, 
-		SEE_ATTR_DONTDELETE | SEE_ATTR_READONLY | SEE_ATTR_DONTENUM);
+	common = (struct SEE_object *)fi->function->common; /* EXT:11 */
+	if (SEE_OBJECT_HASPROPERTY(interp, common, STR(arguments))) {
+	    SEE_OBJECT_GET(interp, common, STR(arguments), &old_arguments);
+	    old_arguments_attr = SEE_native_getownattr(interp, common,
+		    STR(arguments));
+	    old_arguments_saved = 1;
 	}
+	SEE_SET_OBJECT(&v, ((struct activation *)activation)->arguments);
+	SEE_OBJECT_PUT(interp, common, STR(arguments), &v, 
+	    SEE_ATTR_DONTDELETE | SEE_ATTR_READONLY | SEE_ATTR_DONTENUM);
 
-	/* Run it (adds vars and func decls to context.variable) */
 	SEE_TRY(interp, ctxt) {
 		SEE_eval_functionbody(fi->function, &context, res);
 	}
 
 	/* Restore f.arguments */
-	if (SEE_COMPAT_JS(interp, >=, JS11)) { /* EXT:12 */
-	    struct SEE_object *common = 
-	    	(struct SEE_object *)fi->function->common;
-	    if (old_arguments_saved)
-		SEE_OBJECT_PUT(interp, common, STR(arguments),
-		    &old_arguments, old_arguments_attr);
-	    else {
-		/* XXX kludge to allow us to delete old arguments */
-		SEE_SET_UNDEFINED(&v);
-		SEE_OBJECT_PUT(interp, common, STR(arguments), &v, 
-		    SEE_ATTR_READONLY);
-		SEE_OBJECT_DELETE(interp, common, STR(arguments));
-	    }
+	if (old_arguments_saved)			/* EXT:12 */
+	    SEE_OBJECT_PUT(interp, common, STR(arguments),
+		&old_arguments, old_arguments_attr);
+	else {
+	    /* XXX kludge to allow us to delete old arguments */
+	    SEE_SET_UNDEFINED(&v);
+	    SEE_OBJECT_PUT(interp, common, STR(arguments), &v, 
+		SEE_ATTR_READONLY);
+	    SEE_OBJECT_DELETE(interp, common, STR(arguments));
 	}
 
 	SEE_DEFAULT_CATCH(interp, ctxt);
@@ -620,7 +674,6 @@ function_proto_toString(interp, self, thisobj, argc, argv, res)
 	     * My solution is to return a void function that has a comment
 	     * inside it, explaining.
 	     */
-	    extern struct SEE_objectclass SEE_cfunction_class;
 	    if (thisobj && thisobj->objectclass == &SEE_cfunction_class) {
 		    SEE_cfunction_toString(interp, self, thisobj, argc, argv,
 			res);
@@ -814,12 +867,14 @@ activation_create(interp, callee, function, argc, argv)
 	struct SEE_value v, undef;
 
 	activation = SEE_NEW(interp, struct activation);
+	SNAPSHOT_LAYOUT(interp, activation, &activation_layout);
 	SEE_native_init(&activation->native, interp, &SEE_activation_class,
 		NULL);
 	activation->function = function;
 	activation->argc = argc;
 	activation->argv = SEE_NEW_ARRAY(interp, struct SEE_value, 
 		MAX(function->nparams, argc));
+	SNAPSHOT_LAYOUT(interp, activation->argv, &_SEE_snapshot_values);
 
 	for (i = 0; i < argc; i++)
 		SEE_VALUE_COPY(&activation->argv[i], argv[i]);
@@ -841,6 +896,22 @@ activation_create(interp, callee, function, argc, argv)
 	return (struct SEE_object *)activation;
 }
 
+/*
+ * Creates the activation object for a call to a function instance
+ * whose body was started without one. (See SEE_call_functionbody())
+ */
+struct SEE_object *
+_SEE_function_activation(interp, callee, argc, argv)
+	struct SEE_interpreter *interp;
+	struct SEE_object *callee;
+	int argc;
+	struct SEE_value **argv;
+{
+	struct function_inst *fi = tofunction(interp, callee);
+
+	return activation_create(interp, callee, fi->function, argc, argv);
+}
+
 static int
 activation_find_index(activation, p)
 	struct activation *activation;
@@ -1021,6 +1092,7 @@ arguments_create(interp, activation, callee)
 	int i;
 
 	arguments = SEE_NEW(interp, struct arguments);
+	SNAPSHOT_LAYOUT(interp, arguments, &arguments_layout);
 	SEE_native_init(&arguments->native, interp, &arguments_class,
 		interp->Object_prototype);
 
@@ -1034,7 +1106,7 @@ arguments_create(interp, activation, callee)
 	SEE_OBJECT_PUT(interp, (struct SEE_object *)arguments, STR(length), &v,
 		SEE_ATTR_DONTENUM);
 
-	arguments->deleted = SEE_NEW_ARRAY(interp, SEE_boolean_t, 
+	arguments->deleted = SEE_NEW_STRING_ARRAY(interp, SEE_boolean_t, 
 		activation->argc);
 
 	if (activation->argc) {
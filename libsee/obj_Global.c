@@ -65,6 +65,7 @@
 #include "dprint.h"
 #include "nmath.h"
 #include "replace.h"
+#include "snapshot.h"
 
 #define POSITIVE	(1)
 #define NEGATIVE	(-1)
@@ -144,6 +145,8 @@ SEE_Global_alloc(interp)
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Global_scope = 
 		SEE_NEW(interp, struct SEE_scope);
+	SNAPSHOT_LAYOUT(interp, interp->Global, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Global_scope, &_SEE_snapshot_pointers);
 
 	/* XXX should properly check that this is never referenced */
 	interp->Global_eval = (struct SEE_object *)1;	
@@ -258,6 +261,7 @@ global_eval(interp, self, thisobj, argc, argv, res)
 
             if (thisobj) {
                 scope = SEE_NEW(interp, struct SEE_scope);
+                SNAPSHOT_LAYOUT(interp, scope, &_SEE_snapshot_pointers);
                 scope->obj = thisobj;
                 scope->next = interp->Global_scope;
             } else {
@@ -999,3 +1003,71 @@ SEE_eval(interp, inp, thisobj, variable, scope, res)
 
 	interp->traceback = old_traceback;
 }
+
+/*
+ * Compiles the program text from input so that it can be run in any
+ * clone of the same template. The interpreter must be such a clone,
+ * or an Error is thrown. Does not close the input. The program is
+ * allocated against the NULL interpreter and is kept until it is
+ * passed to SEE_program_free(); it is not changed by running it, and
+ * so can be shared between threads.
+ */
+struct SEE_program *
+SEE_program_compile(interp, inp)
+	struct SEE_interpreter *interp;
+	struct SEE_input *inp;
+{
+	struct function *f = NULL;
+	struct SEE_program *program;
+	SEE_try_context_t ctxt;
+
+	_SEE_snapshot_record(interp);
+	SEE_TRY(interp, ctxt) {
+		f = SEE_parse_program(interp, inp);
+	}
+	program = _SEE_snapshot_program(interp, f);
+	SEE_DEFAULT_CATCH(interp, ctxt);
+	return program;
+}
+
+/*
+ * Runs a compiled program in the Global context of a clone of the
+ * template that it was compiled for, or throws an Error if interp is
+ * not one. Each run evaluates a fresh copy. Returns the last value
+ * result of the last statement executed, or undefined if none.
+ */
+void
+SEE_program_run(interp, program, res)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+	struct SEE_value *res;
+{
+	struct SEE_context context;
+	struct SEE_traceback *old_traceback;
+	struct function *f;
+
+	f = (struct function *)_SEE_snapshot_load(interp, program);
+
+	old_traceback = interp->traceback;
+	interp->traceback = NULL;
+
+	init_eval_context(&context, interp, interp->Global, interp->Global,
+	    interp->Global_scope);
+
+	_SEE_eval_parsed(&context, interp->Global, f, res);
+
+	interp->traceback = old_traceback;
+}
+
+/*
+ * Frees a compiled program. Clones that are running the program, or
+ * that have run it and may call its functions again, refer to parts
+ * of it, so they must be finished with first.
+ */
+void
+SEE_program_free(program)
+	struct SEE_program *program;
+{
+	if (program)
+		_SEE_snapshot_program_free(program);
+}
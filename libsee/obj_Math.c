@@ -48,6 +48,7 @@
 #include "stringdefs.h"
 #include "init.h"
 #include "nmath.h"
+#include "snapshot.h"
 
 /*
  * 15.8 The Math object.
@@ -114,6 +115,7 @@ SEE_Math_alloc(interp)
 {
 	interp->Math = 
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, interp->Math, &_SEE_snapshot_native);
 }
 
 void
@@ -46,6 +46,7 @@
 #include "init.h"
 #include "nmath.h"
 #include "array.h"
+#include "snapshot.h"
 
 /*
  * 15.7 The Number object.
@@ -57,6 +58,12 @@ struct number_object {
 	SEE_number_t number;		/* Value */
 };
 
+static const struct snapshot_word number_words[] = {
+	SNAPSHOT_NATIVE(struct number_object, native),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(number_layout, struct number_object, number_words);
+
 /* Prototypes */
 static void radix_tostring(struct SEE_string *, SEE_number_t, int);
 static struct number_object *tonumber(struct SEE_interpreter *, 
@@ -120,6 +127,8 @@ SEE_Number_alloc(interp)
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Number_prototype = 
 	    (struct SEE_object *)SEE_NEW(interp, struct number_object);
+	SNAPSHOT_LAYOUT(interp, interp->Number, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Number_prototype, &number_layout);
 }
 
 void
@@ -223,6 +232,7 @@ number_construct(interp, self, thisobj, argc, argv, res)
 		SEE_ToNumber(interp, argv[0], &v);
 
 	no = SEE_NEW(interp, struct number_object);
+	SNAPSHOT_LAYOUT(interp, no, &number_layout);
 	SEE_native_init(&no->native, interp, &number_inst_class,
 		interp->Number_prototype);
 	no->number = v.u.number;
@@ -47,6 +47,8 @@
 
 #include "stringdefs.h"
 #include "init.h"
+#include "cfunction_private.h"
+#include "snapshot.h"
 
 /*
  * Object objects.
@@ -118,6 +120,8 @@ SEE_Object_alloc(interp)
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->Object_prototype =
 		(struct SEE_object *)SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, interp->Object, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->Object_prototype, &_SEE_snapshot_native);
 }
 
 void
@@ -274,6 +278,7 @@ object_proto_toString(interp, self, thisobj, argc, argv, res)
 			SEE_string_addch(s, ':');
 			switch (SEE_VALUE_GET_TYPE(&v)) {
 			case SEE_STRING:
+			    SEE_STRING_FLATTEN(v.u.string);
 			    SEE_string_addch(s, '"');
 			    for (j = 0; j < v.u.string->length; j++) {
 				if (v.u.string->data[j] == '\"' ||
@@ -388,7 +393,7 @@ object_proto_isPrototypeOf(interp, self, thisobj, argc, argv, res)
 	}
 	v = argv[0]->u.object;
 	for (;;) {
-/*3*/	    v = v->Prototype;
+/*3*/	    v = _SEE_CFUNCTION_PROTOTYPE(interp, v);
 /*4*/	    if (v == NULL) {
 		    SEE_SET_BOOLEAN(res, 0);
 		    return;
@@ -51,6 +51,8 @@
 #include "init.h"
 #include "nmath.h"
 #include "compare.h"
+#include "cfunction_private.h"
+#include "snapshot.h"
 
 /*
  * 15.10 The RegExp object.
@@ -64,6 +66,14 @@ struct regexp_object {
 	struct regex *regex;
 };
 
+static const struct snapshot_word regexp_words[] = {
+	SNAPSHOT_NATIVE(struct regexp_object, native),
+	SNAPSHOT_PTR(struct regexp_object, source),
+	SNAPSHOT_PTR(struct regexp_object, regex),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(regexp_layout, struct regexp_object, regexp_words);
+
 /* Prototypes */
 static struct regexp_object *toregexp(struct SEE_interpreter *, 
         struct SEE_object *);
@@ -154,6 +164,8 @@ SEE_RegExp_alloc(interp)
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->RegExp_prototype = 
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
+	SNAPSHOT_LAYOUT(interp, interp->RegExp, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->RegExp_prototype, &_SEE_snapshot_native);
 }
 
 void
@@ -224,6 +236,7 @@ regexp_construct(interp, self, thisobj, argc, argv, res)
 	int i;
 
 	ro = SEE_NEW(interp, struct regexp_object);
+	SNAPSHOT_LAYOUT(interp, ro, &regexp_layout);
 	if (SEE_COMPAT_JS(interp, >=, JS11))
 		SEE_native_init(&ro->native, interp, &regexp_JS_inst_class,
 			interp->RegExp_prototype);
@@ -388,18 +401,14 @@ regexp_proto_exec(interp, self, thisobj, argc, argv, res)
 	ncaptures = SEE_regex_count_captures(ro->regex);
 	SEE_ASSERT(interp, ncaptures > 0);
 	captures = SEE_STRING_ALLOCA(interp, struct capture, ncaptures);
-	while (!SEE_regex_match(interp, ro->regex, S, i, captures)) {
-		i++;
-		if (i > S->length) {
-		    SEE_SET_NUMBER(&v, 0);
-		    SEE_OBJECT_PUT(interp, thisobj, STR(lastIndex), &v, 0); 
-		    SEE_SET_NULL(res);
-		    for (i = 0; i < ncaptures; i++)
-			captures[i].end = -1;
-		    regexp_set_static(interp, S, ro->regex, captures, 
-		    	ro->source);
-		    return;
-		}
+	if (SEE_regex_search(interp, ro->regex, S, i, captures) < 0) {
+		SEE_SET_NUMBER(&v, 0);
+		SEE_OBJECT_PUT(interp, thisobj, STR(lastIndex), &v, 0); 
+		SEE_SET_NULL(res);
+		for (i = 0; i < ncaptures; i++)
+		    captures[i].end = -1;
+		regexp_set_static(interp, S, ro->regex, captures, ro->source);
+		return;
 	}
 	regexp_set_static(interp, S, ro->regex, captures, ro->source);
 
@@ -472,6 +481,52 @@ SEE_RegExp_match(interp, obj, text, start, captures)
 	return success;
 }
 
+/*
+ * Finds the first match at or after start, as if by calling
+ * SEE_RegExp_match() at each index in turn. Returns the index of the
+ * match, or -1.
+ */
+int
+SEE_RegExp_search(interp, obj, text, start, captures)
+	struct SEE_interpreter *interp;
+	struct SEE_object *obj;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *captures;
+{
+	struct regexp_object *ro;
+	int index;
+	unsigned int ncaptures, i;
+
+	ro = toregexp(interp, obj);
+	ncaptures = SEE_regex_count_captures(ro->regex);
+	index = SEE_regex_search(interp, ro->regex, text, start, captures);
+	if (index < 0)
+	    for (i = 0; i < ncaptures; i++)
+		captures[i].end = -1;
+	regexp_set_static(interp, text, ro->regex, captures, ro->source);
+	return index;
+}
+
+/*
+ * Returns true if the regexp's exec property is the built-in
+ * RegExp.prototype.exec(). Then callers can find matches with
+ * SEE_RegExp_search() and work on the capture offsets, instead of
+ * calling exec() and reading the array it makes. They must still
+ * update lastIndex as exec() would have.
+ */
+int
+SEE_RegExp_has_native_exec(interp, obj)
+	struct SEE_interpreter *interp;
+	struct SEE_object *obj;
+{
+	struct SEE_value v;
+
+	SEE_OBJECT_GET(interp, obj, STR(exec), &v);
+	return SEE_VALUE_GET_TYPE(&v) == SEE_OBJECT &&
+	    SEE_cfunction_getfunc(v.u.object) == regexp_proto_exec;
+}
+
 /* 15.10.6.3 RegExp.prototype.test() */
 static void
 regexp_proto_test(interp, self, thisobj, argc, argv, res)
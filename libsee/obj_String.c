@@ -56,6 +56,7 @@
 #include "init.h"
 #include "nmath.h"
 #include "replace.h"
+#include "snapshot.h"
 
 /*
  * The String object.
@@ -132,6 +133,10 @@ static void string_proto__ns_nop(struct SEE_interpreter *,
 
 static struct SEE_string *object_to_string(struct SEE_interpreter *,
 	struct SEE_object *);
+static struct SEE_string *substr(struct SEE_interpreter *,
+	struct SEE_string *, unsigned int, unsigned int);
+static struct SEE_string *convert_case(struct SEE_interpreter *,
+	struct SEE_string *, int);
 
 /* object class for String constructor */
 static struct SEE_objectclass string_const_class = {
@@ -165,6 +170,14 @@ struct string_object {
 	struct SEE_string *string;	/* Value */
 };
 
+static const struct snapshot_word string_object_words[] = {
+	SNAPSHOT_NATIVE(struct string_object, native),
+	SNAPSHOT_PTR(struct string_object, string),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(string_object_layout, struct string_object,
+	string_object_words);
+
 void
 SEE_String_alloc(interp)
 	struct SEE_interpreter *interp;
@@ -173,6 +186,9 @@ SEE_String_alloc(interp)
 	    (struct SEE_object *)SEE_NEW(interp, struct SEE_native);
 	interp->String_prototype = 
 	    (struct SEE_object *)SEE_NEW(interp, struct string_object);
+	SNAPSHOT_LAYOUT(interp, interp->String, &_SEE_snapshot_native);
+	SNAPSHOT_LAYOUT(interp, interp->String_prototype,
+	    &string_object_layout);
 }
 
 void
@@ -292,6 +308,7 @@ string_construct(interp, self, thisobj, argc, argv, res)
 		SEE_ToString(interp, argv[0], &strv);
 
 	so = SEE_NEW(interp, struct string_object);
+	SNAPSHOT_LAYOUT(interp, so, &string_object_layout);
 	SEE_native_init(&so->native, interp, &string_inst_class,
 		interp->String_prototype);
 	so->string = strv.u.string;
@@ -331,6 +348,17 @@ string_fromCharCode(interp, self, thisobj, argc, argv, res)
 	struct SEE_string *s;
 	SEE_char_t ch;
 
+	if (argc == 1) {
+		ch = SEE_ToUint16(interp, argv[0]);
+		if (ch < _SEE_INTERN_NCHARS)
+			SEE_SET_STRING(res, _SEE_intern_chars[ch]);
+		else {
+			s = SEE_string_new(interp, 1);
+			SEE_string_addch(s, ch);
+			SEE_SET_STRING(res, s);
+		}
+		return;
+	}
 	s = SEE_string_new(interp, 0);
 	for (i = 0; i < argc; i++) {
 		ch = SEE_ToUint16(interp, argv[i]);
@@ -377,6 +405,22 @@ object_to_string(interp, o)
 	return sv.u.string;
 }
 
+/*
+ * Returns a substring of s. A single Latin-1 character comes from the
+ * shared table, so scripts that work a character at a time do not
+ * allocate a string for each one.
+ */
+static struct SEE_string *
+substr(interp, s, start, len)
+	struct SEE_interpreter *interp;
+	struct SEE_string *s;
+	unsigned int start, len;
+{
+	if (len == 1 && s->data[start] < _SEE_INTERN_NCHARS)
+		return _SEE_intern_chars[s->data[start]];
+	return SEE_string_substr(interp, s, start, len);
+}
+
 /* 15.5.4.4 String.prototype.charAt() */
 static void
 string_proto_charAt(interp, self, thisobj, argc, argv, res)
@@ -397,7 +441,7 @@ string_proto_charAt(interp, self, thisobj, argc, argv, res)
 
 	if (SEE_NUMBER_ISFINITE(&vi) && vi.u.number >= 0 &&
 		vi.u.number < s->length)
-	    SEE_SET_STRING(res, SEE_string_substr(interp, s, 
+	    SEE_SET_STRING(res, substr(interp, s, 
 	    	(unsigned int)vi.u.number, 1));
 	else
 	    SEE_SET_STRING(res, STR(empty_string));
@@ -460,7 +504,7 @@ string_proto_indexOf(interp, self, thisobj, argc, argv, res)
 	struct SEE_string *s;
 	struct SEE_value vss, vi;
 	int position;
-	unsigned int k, sslen, slen;
+	unsigned int slen;
 		
 	s = object_to_string(interp, thisobj);
 	slen = s->length;
@@ -469,7 +513,6 @@ string_proto_indexOf(interp, self, thisobj, argc, argv, res)
 		SEE_SET_STRING(&vss, STR(undefined));
 	else
 		SEE_ToString(interp, argv[0], &vss);
-	sslen = vss.u.string->length;
 	if (argc < 2 || SEE_VALUE_GET_TYPE(argv[1]) == SEE_UNDEFINED)
 		position = 0;
 	else {
@@ -479,15 +522,7 @@ string_proto_indexOf(interp, self, thisobj, argc, argv, res)
 	if (position < 0) position = 0;
 	if (position > slen) position = slen;
 	
-	if (slen >= sslen)
-	    for (k = (unsigned int)position; k <= slen - sslen; k++)
-	        if (memcmp(&s->data[k], vss.u.string->data,
-		    sslen * sizeof vss.u.string->data[0]) == 0)
-	        {
-		    SEE_SET_NUMBER(res, k);
-		    return;
-	        }
-	SEE_SET_NUMBER(res, -1);
+	SEE_SET_NUMBER(res, _SEE_string_search(s, vss.u.string, position));
 }
 
 /* 15.5.4.8 String.prototype.lastIndexOf() */
@@ -500,8 +535,7 @@ string_proto_lastIndexOf(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_string *r1s, *r2s;
 	struct SEE_value r3v, r2v, r4v;
-	int k;
-	unsigned int r5, r6, r7;
+	unsigned int r5, r6;
 		
 /*1*/	r1s = object_to_string(interp, thisobj);
 
@@ -525,22 +559,7 @@ string_proto_lastIndexOf(interp, self, thisobj, argc, argv, res)
 
 /*6*/	r6 = (unsigned int)MIN(MAX(r4v.u.number, 0), r5);
 
-/*7*/	r7 = r2s->length;
-
-/*8*/
-	if (r5 < r7) {
-		SEE_SET_NUMBER(res, -1);
-		return;
-	}
-
-	for (k = MIN(r6, r5 - r7); k >= 0; k--)
-	    if (memcmp(r1s->data + k, r2s->data, 
-	    	r7 * sizeof (SEE_char_t)) == 0)
-	    {
-		SEE_SET_NUMBER(res, k);
-		return;
-	    }
-	SEE_SET_NUMBER(res, -1);
+/*7-8*/	SEE_SET_NUMBER(res, _SEE_string_rsearch(r1s, r2s, r6));
 }
 
 /* 15.5.4.9 String.prototype.localeCompare() */
@@ -592,6 +611,39 @@ regexp_arg(interp, vp)
 	}
 }
 
+/* Appends the characters of s from start up to end to out, in one go */
+static void
+append_slice(out, s, start, end)
+	struct SEE_string *out, *s;
+	unsigned int start, end;
+{
+	struct SEE_string slice;
+
+	if (end <= start)
+		return;
+	slice.length = end - start;
+	slice.data = s->data + start;
+	slice.stringclass = NULL;
+	slice.interpreter = s->interpreter;
+	slice.flags = 0;
+	SEE_string_append(out, &slice);
+}
+
+/*
+ * Sets regexp.lastIndex = 0, as RegExp.prototype.exec() leaves it after
+ * the failed match that ends a String.prototype.match() or replace().
+ */
+static void
+reset_lastIndex(interp, regexp)
+	struct SEE_interpreter *interp;
+	struct SEE_object *regexp;
+{
+	struct SEE_value v;
+
+	SEE_SET_NUMBER(&v, 0);
+	SEE_OBJECT_PUT(interp, regexp, STR(lastIndex), &v, 0);
+}
+
 /* 15.5.4.10 String.prototype.match() */
 static void
 string_proto_match(interp, self, thisobj, argc, argv, res)
@@ -605,6 +657,8 @@ string_proto_match(interp, self, thisobj, argc, argv, res)
 	struct SEE_string *s, *nstr;
 	SEE_boolean_t global;
 	int n, matches = 0;
+	unsigned int i;
+	struct capture *captures;
 	
 	regexp = regexp_arg(interp, argc < 1 ? NULL : argv[0]);
 
@@ -625,6 +679,33 @@ string_proto_match(interp, self, thisobj, argc, argv, res)
 		SEE_SET_STRING(&v, s);
 		vp = &v; vpv[0] = vp;
 		SEE_OBJECT_CALL(interp, reexec, regexp, 1, vpv, res);
+	} else if (SEE_RegExp_has_native_exec(interp, regexp)) {
+		/*
+		 * Find the matches directly, as the exec() loop below 
+		 * would, making only the result array.
+		 */
+		captures = SEE_STRING_ALLOCA(interp, struct capture,
+		    SEE_RegExp_count_captures(interp, regexp));
+		SEE_OBJECT_CONSTRUCT(interp, interp->Array, NULL,
+			0, NULL, &v);
+		a = v.u.object;
+		for (i = 0; i <= s->length; ) {
+		    if (SEE_RegExp_search(interp, regexp, s, i, captures) < 0)
+			break;
+		    SEE_SET_STRING(&v, SEE_string_substr(interp, s,
+			captures[0].start, captures[0].end - captures[0].start));
+		    SEE_Array_push(interp, a, &v);
+		    matches++;
+		    /* Step over an empty match */
+		    i = captures[0].end + (captures[0].end == captures[0].start);
+		}
+		reset_lastIndex(interp, regexp);
+
+		if (!matches && 
+		    (interp->compatibility & SEE_COMPAT_ERRATA))
+		    SEE_SET_NULL(res);
+		else
+		    SEE_SET_OBJECT(res, a);
 	} else {
 		/* regexp.lastIndex = 0 */
 		SEE_SET_NUMBER(&v, 0);
@@ -687,7 +768,7 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 {
 	struct SEE_value v, v2;
 	int n;
-	unsigned int index, i, j, k;
+	unsigned int index, i, j;
 	struct SEE_string *ns = NULL;
 	struct SEE_string *ms = NULL;
 	struct SEE_string *replace;
@@ -702,8 +783,7 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 	ms = v.u.string;
 
 	/* Copy the intermediate characters we missed */
-	for (i = *previndexp; i < index; i++)
-	    SEE_string_addch(out, source->data[i]);
+	append_slice(out, source, *previndexp, index);
 	*previndexp = index + ms->length;
 
 	if (SEE_VALUE_GET_TYPE(replacev) == SEE_OBJECT) {
@@ -743,13 +823,11 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 		    i++;
 		    continue;
 		case '`':
-		    for (k = 0; k < index; k++)
-		        SEE_string_addch(out, source->data[k]);
+		    append_slice(out, source, 0, index);
 		    i++;
 		    continue;
 		case '\'':
-		    for (k = *previndexp; k < source->length; k++)
-		        SEE_string_addch(out, source->data[k]);
+		    append_slice(out, source, *previndexp, source->length);
 		    i++;
 		    continue;
 		case '&':
@@ -785,6 +863,64 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 	    }
 }
 
+/*
+ * Appends the replace text for one match to out, expanding its $
+ * patterns from the capture offsets into source. This is what
+ * replace_helper() does when it is given the array from exec().
+ */
+static void
+replace_expand(out, source, captures, ncaps, replace)
+	struct SEE_string *out, *source, *replace;
+	struct capture *captures;
+	int ncaps;
+{
+	unsigned int i, j, n;
+
+	for (i = 0; i < replace->length; ) {
+	    /* Copy the text up to the next $ */
+	    for (j = i; j < replace->length && replace->data[j] != '$'; j++)
+		;
+	    append_slice(out, replace, i, j);
+	    if (j + 1 >= replace->length) {
+		if (j < replace->length)
+		    SEE_string_addch(out, '$');
+		break;
+	    }
+	    i = j + 1;
+
+	    switch (replace->data[i]) {
+	    case '$':
+		SEE_string_addch(out, '$');
+		i++;
+		continue;
+	    case '`':
+		append_slice(out, source, 0, captures[0].start);
+		i++;
+		continue;
+	    case '\'':
+		append_slice(out, source, captures[0].end, source->length);
+		i++;
+		continue;
+	    case '&':
+		append_slice(out, source, captures[0].start, captures[0].end);
+		i++;
+		continue;
+	    }
+	    n = 0;
+	    for (j = i; j < replace->length &&
+		replace->data[j] >= '0' && replace->data[j] <= '9'; j++)
+		    n = n * 10 + replace->data[j] - '0';
+	    if (j == i) {
+		/* Didn't see any digits */
+		SEE_string_addch(out, '$');
+		continue;
+	    }
+	    if (n < (unsigned int)ncaps && !CAPTURE_IS_UNDEFINED(captures[n]))
+		append_slice(out, source, captures[n].start, captures[n].end);
+	    i = j;
+	}
+}
+
 /* 15.5.4.11 String.prototype.replace() */
 static void
 string_proto_replace(interp, self, thisobj, argc, argv, res)
@@ -798,7 +934,8 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 	struct SEE_string *s, *out = NULL;
 	SEE_boolean_t global;
 	int ncaps;
-	unsigned int previndex = 0;
+	unsigned int previndex = 0, i;
+	struct capture *captures;
 	
 	regexp = regexp_arg(interp, argc < 1 ? NULL : argv[0]);
 	ncaps = SEE_RegExp_count_captures(interp, regexp);
@@ -828,7 +965,32 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 	/* s = String(this) */
 	s = object_to_string(interp, thisobj);
 
-	if (!global) {
+	if (SEE_VALUE_GET_TYPE(replacev) == SEE_STRING &&
+	    SEE_RegExp_has_native_exec(interp, regexp))
+	{
+		/*
+		 * Replace with text: find the matches directly, as the
+		 * exec() loops below would, and copy out slices of s.
+		 * (A function replacer is handed the exec() array.)
+		 */
+		captures = SEE_STRING_ALLOCA(interp, struct capture, ncaps);
+		for (i = 0; i <= s->length; ) {
+		    if (SEE_RegExp_search(interp, regexp, s, i, captures) < 0)
+			break;
+		    if (out == NULL)
+			out = SEE_string_new(interp, 0);
+		    append_slice(out, s, previndex, captures[0].start);
+		    replace_expand(out, s, captures, ncaps, 
+			replacev->u.string);
+		    previndex = captures[0].end;
+		    if (!global)
+			break;
+		    /* Step over an empty match */
+		    i = captures[0].end + (captures[0].end == captures[0].start);
+		}
+		if (global || out == NULL)
+		    reset_lastIndex(interp, regexp);
+	} else if (!global) {
 		SEE_SET_STRING(&v, s);
 		vp = &v; vpv[0] = vp;
 		SEE_OBJECT_CALL(interp, reexec, regexp, 1, vpv, &v2);
@@ -861,12 +1023,11 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 		    SEE_OBJECT_GET(interp, vres.u.object, STR(zero_digit), &v);
 		    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(&v) == SEE_STRING);
 
-		    if (v.u.string->length != 0) {
-		        if (out == NULL) 
-			    out = SEE_string_new(interp, 0);
-		        replace_helper(interp, &previndex, out, vres.u.object,
-			    s, replacev, ncaps);
-		    } else {
+		    if (out == NULL) 
+			out = SEE_string_new(interp, 0);
+		    replace_helper(interp, &previndex, out, vres.u.object,
+			s, replacev, ncaps);
+		    if (v.u.string->length == 0) {
 			/* Increment the index by one if it matched empty */
 			SEE_OBJECT_GET(interp, regexp, STR(lastIndex), &v);
 			SEE_ASSERT(interp, 
@@ -879,8 +1040,7 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 
 	if (out)
 	    /* Copy rest of source text */
-	    while (previndex < s->length)
-		SEE_string_addch(out, s->data[previndex++]);
+	    append_slice(out, s, previndex, s->length);
 	else
 	    out = s;
 
@@ -912,12 +1072,11 @@ string_proto_search(interp, self, thisobj, argc, argv, res)
 	 * it is a perfect candidate for calling the regex 
 	 * engine (nearly) directly.
 	 */
-	for (index = 0; index < s->length; index++)
-	    if (SEE_RegExp_match(interp, regexp, s, index, captures)) {
+	index = SEE_RegExp_search(interp, regexp, s, 0, captures);
+	if (index >= 0 && index < s->length)
 		SEE_SET_NUMBER(res, captures[0].start);
-		return;
-	    }
-	SEE_SET_NUMBER(res, -1);
+	else
+		SEE_SET_NUMBER(res, -1);
 }
 
 /* 15.5.4.13 String.prototype.slice() */
@@ -1051,11 +1210,22 @@ string_proto_split(interp, self, thisobj, argc, argv, res)
 /*9*/	if (s == 0) goto step31;
 step10:	q = p;
 step11:	if (q == s) goto step28;
-/*12*/	z = SplitMatch(interp, R, S, q, captures);
+/*12*/	/* Skip ahead to the next q where R matches, instead of trying each */
+	if (SEE_VALUE_GET_TYPE(R) == SEE_OBJECT) {
+	    i = SEE_RegExp_search(interp, R->u.object, S, q, captures);
+	    if (i < 0 || i >= s) goto step28;
+	} else {
+	    i = _SEE_string_search(S, R->u.string, q);
+	    if (i < 0) goto step28;
+	    captures[0].start = i;
+	    captures[0].end = i + R->u.string->length;
+	}
+	q = i;
+	z = 1;
 /*13*/	if (!z) goto step26;
 /*14*/	e = captures[0].end;
 /*15*/	if (e == p) goto step26;
-/*16*/	T = SEE_string_substr(interp, S, p, q-p);
+/*16*/	T = substr(interp, S, p, q-p);
 /*17*/	SEE_SET_STRING(&v, T); SEE_Array_push(interp, A, &v);
 /*18*/	if (SEE_Array_length(interp, A) == lim) return;
 /*19*/	p = e;
@@ -1072,7 +1242,7 @@ step21:	if (i == ncap - 1) goto step10;
 /*25*/	goto step21;
 step26:	q++;
 /*27*/	goto step11;
-step28:	T = SEE_string_substr(interp, S, p, s-p);
+step28:	T = substr(interp, S, p, s-p);
 /*29*/	SEE_SET_STRING(&v, T); SEE_Array_push(interp, A, &v);
 /*30*/	return;
 step31:	z = SplitMatch(interp, R, S, 0, captures);
@@ -1160,6 +1330,65 @@ string_proto_substr(interp, self, thisobj, argc, argv, res)
 	    SEE_SET_STRING(res, SEE_string_substr(interp, s, start, len));
 }
 
+/*
+ * Returns s converted to upper or lower case, or s itself if that
+ * changes nothing. Runs of ASCII are converted four characters at a
+ * time in a 64-bit word, and nothing is copied until the first
+ * character that changes.
+ */
+static struct SEE_string *
+convert_case(interp, s, upper)
+	struct SEE_interpreter *interp;
+	struct SEE_string *s;
+	int upper;
+{
+	SEE_uint64_t ones, w, mask, above, below, nonascii;
+	struct SEE_string *rs = NULL;
+	const SEE_char_t *src = s->data;
+	SEE_char_t *dst = NULL, c;
+	unsigned int i, len = s->length;
+
+	ones = ((SEE_uint64_t)0x00010001 << 16 << 16) | 0x00010001;
+	nonascii = ones * 0xff80;
+	/* Adding these sets a lane's 0x80 bit when it is >= 'A' or > 'Z' */
+	above = ones * (0x80 - (upper ? 'a' : 'A'));
+	below = ones * (0x80 - 1 - (upper ? 'z' : 'Z'));
+
+	for (i = 0; i < len; ) {
+	    if (i + 4 <= len) {
+		memcpy(&w, src + i, sizeof w);
+		if (!(w & nonascii)) {
+		    /* Flip the case bit (0x20) of letters to convert */
+		    mask = (w + above) & ~(w + below) & (ones << 7);
+		    if (mask && !dst) {
+			rs = SEE_string_new(interp, len);
+			dst = rs->data;
+			memcpy(dst, src, i * sizeof *dst);
+		    }
+		    if (dst) {
+			w ^= mask >> 2;
+			memcpy(dst + i, &w, sizeof w);
+		    }
+		    i += 4;
+		    continue;
+		}
+	    }
+	    c = upper ? UNICODE_TOUPPER(src[i]) : UNICODE_TOLOWER(src[i]);
+	    if (c != src[i] && !dst) {
+		rs = SEE_string_new(interp, len);
+		dst = rs->data;
+		memcpy(dst, src, i * sizeof *dst);
+	    }
+	    if (dst)
+		dst[i] = c;
+	    i++;
+	}
+	if (!rs)
+	    return s;
+	rs->length = len;
+	return rs;
+}
+
 /* 15.5.4.16 String.prototype.toLowerCase() */
 static void
 string_proto_toLowerCase(interp, self, thisobj, argc, argv, res)
@@ -1168,21 +1397,14 @@ string_proto_toLowerCase(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct SEE_string *s, *rs;
-	int i;
+	struct SEE_string *s;
 
 	s = object_to_string(interp, thisobj);
 	if (s->length == 0) {
 	    SEE_SET_STRING(res, STR(empty_string));
 	    return;
 	}
-
-	rs = SEE_string_new(interp, s->length);
-	for (i = 0; i < s->length; i++) {
-	    SEE_char_t c = UNICODE_TOLOWER(s->data[i]);
-	    SEE_string_addch(rs, c);
-	}
-	SEE_SET_STRING(res, rs);
+	SEE_SET_STRING(res, convert_case(interp, s, 0));
 }
 
 /* 15.5.4.17 String.prototype.toLocaleLowerCase() */
@@ -1206,21 +1428,14 @@ string_proto_toUpperCase(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct SEE_string *s, *rs;
-	int i;
+	struct SEE_string *s;
 
 	s = object_to_string(interp, thisobj);
 	if (s->length == 0) {
 	    SEE_SET_STRING(res, STR(empty_string));
 	    return;
 	}
-
-	rs = SEE_string_new(interp, s->length);
-	for (i = 0; i < s->length; i++) {
-	    SEE_char_t c = UNICODE_TOUPPER(s->data[i]);
-	    SEE_string_addch(rs, c);
-	}
-	SEE_SET_STRING(res, rs);
+	SEE_SET_STRING(res, convert_case(interp, s, 1));
 }
 
 /* 15.5.4.19 String.prototype.toLocaleUpperCase() */
@@ -45,6 +45,7 @@
 #include <see/system.h>
 
 #include "stringdefs.h"
+#include "cfunction_private.h"
 
 static void transit_sec_domain(struct SEE_interpreter *, struct SEE_object *);
 
@@ -69,7 +70,9 @@ transit_sec_domain(interp, obj)
 
 /*
  * Calls the object method, after checking that any recursion
- * limit has not been reached.
+ * limit has not been reached. If the method throws, the recursion
+ * limit and security domain are restored by whatever catches the
+ * exception (see _SEE_TRY_INIT), so no try context is needed here.
  */
 void
 SEE_object_call(interp, obj, thisobj, argc, argv, res)
@@ -80,7 +83,6 @@ SEE_object_call(interp, obj, thisobj, argc, argv, res)
 	struct SEE_value **argv;
 	struct SEE_value *res;
 {
-	SEE_try_context_t c;
 	int saved_recursion_limit = interp->recursion_limit;
 	void *saved_sec_domain = interp->sec_domain;
 
@@ -90,17 +92,14 @@ SEE_object_call(interp, obj, thisobj, argc, argv, res)
 	else if (interp->recursion_limit > 0) 
 	    interp->recursion_limit--;
 	transit_sec_domain(interp, obj);
-	SEE_TRY(interp, c) {
-	    _SEE_OBJECT_CALL(interp, obj, thisobj, argc, argv, res);
-	}
+	_SEE_OBJECT_CALL(interp, obj, thisobj, argc, argv, res);
 	interp->sec_domain = saved_sec_domain;
 	interp->recursion_limit = saved_recursion_limit;
-	SEE_DEFAULT_CATCH(interp, c);
 }
 
 /*
  * Calls the object constructor, after checking that any recursion
- * limit has not been reached.
+ * limit has not been reached. (See SEE_object_call() on exceptions.)
  */
 void
 SEE_object_construct(interp, obj, thisobj, argc, argv, res)
@@ -111,7 +110,6 @@ SEE_object_construct(interp, obj, thisobj, argc, argv, res)
 	struct SEE_value **argv;
 	struct SEE_value *res;
 {
-	SEE_try_context_t c;
 	int saved_recursion_limit = interp->recursion_limit;
 	void *saved_sec_domain = interp->sec_domain;
 
@@ -122,12 +120,9 @@ SEE_object_construct(interp, obj, thisobj, argc, argv, res)
 	} else if (interp->recursion_limit > 0) 
 	    interp->recursion_limit--;
 	transit_sec_domain(interp, obj);
-	SEE_TRY(interp, c) {
-	    _SEE_OBJECT_CONSTRUCT(interp, obj, NULL, argc, argv, res);
-	}
+	_SEE_OBJECT_CONSTRUCT(interp, obj, NULL, argc, argv, res);
 	interp->sec_domain = saved_sec_domain;
 	interp->recursion_limit = saved_recursion_limit;
-	SEE_DEFAULT_CATCH(interp, c);
 }
 
 /*
@@ -139,7 +134,7 @@ SEE_object_instanceof(interp, val, obj)
 	struct SEE_value *val;
 	struct SEE_object *obj;
 {
-	struct SEE_object *lhs;
+	struct SEE_object *lhs, *proto;
 	struct SEE_value protov;
 
         if (SEE_OBJECT_HAS_HASINSTANCE(obj))
@@ -152,9 +147,11 @@ SEE_object_instanceof(interp, val, obj)
 	    SEE_OBJECT_GET(interp, obj, STR(prototype), &protov);
 	    if (SEE_VALUE_GET_TYPE(&protov) != SEE_OBJECT)
 		return 0;
-	    for (lhs = val->u.object; lhs; lhs = lhs->Prototype)
-		if (lhs->Prototype == protov.u.object)
+	    for (lhs = val->u.object; lhs; lhs = proto) {
+		proto = _SEE_CFUNCTION_PROTOTYPE(interp, lhs);
+		if (proto == protov.u.object)
 		    return 1;
+	    }
 	    return 0;
 	} else
 	    SEE_error_throw_string(interp, interp->TypeError,
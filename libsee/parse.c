@@ -74,6 +74,7 @@
 #endif
 
 #if STDC_HEADERS
+# include <stddef.h>
 # include <stdio.h>
 #endif
 
@@ -102,6 +103,7 @@
 
 #include "parse_node.h"
 #include "parse_const.h"
+#include "snapshot.h"
 #if WITH_PARSER_PRINT
 # include "parse_print.h"
 #endif
@@ -166,6 +168,7 @@ struct parser {
 	int 		  noin;	  /* ignore 'in' in RelationalExpression */
 	int		  is_lhs; /* derived LeftHandSideExpression */
 	int		  funcdepth;
+	int		  uses_activation; /* body observes activation object */
 	struct var	**vars;		    /* list of declared variables */
 	struct labelset	 *labelsets;	    /* list of all labelsets */
 	struct label     *labels;	    /* stack of active labels */
@@ -180,6 +183,7 @@ struct parser {
 static struct node *new_node_internal(struct SEE_interpreter*interp, int sz, 
         enum nodeclass_enum nc, struct SEE_string* filename, int lineno,
 	const char *dbg_nc);
+static const struct snapshot_layout *node_layout(enum nodeclass_enum nc);
 static struct node *new_node(struct parser *parser, int sz, 
         enum nodeclass_enum nc, const char *dbg_nc);
 static void parser_init(struct parser *parser, 
@@ -350,6 +354,318 @@ static void *make_body(struct SEE_interpreter *, struct node *, int);
  * Macros for accessing the abstract syntax tree
  */
 
+/*
+ * Where the pointers of the tree are, for interpreter templates
+ * (snapshot.c). The layout of a node follows from its class.
+ */
+#define NODE_WORDS(t, f)	SNAPSHOT_PTR(t, f.location.filename)
+
+static const struct snapshot_word leaf_words[] = {
+	SNAPSHOT_PTR(struct node, location.filename),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(leaf_layout, struct node, leaf_words);
+
+static const struct snapshot_word literal_words[] = {
+	NODE_WORDS(struct Literal_node, node),
+	SNAPSHOT_VAL(struct Literal_node, value),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(literal_layout, struct Literal_node, literal_words);
+
+static const struct snapshot_word string_literal_words[] = {
+	NODE_WORDS(struct StringLiteral_node, node),
+	SNAPSHOT_PTR(struct StringLiteral_node, string),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(string_literal_layout, struct StringLiteral_node,
+	string_literal_words);
+
+static const struct snapshot_word regex_literal_words[] = {
+	NODE_WORDS(struct RegularExpressionLiteral_node, node),
+	SNAPSHOT_VAL(struct RegularExpressionLiteral_node, pattern),
+	SNAPSHOT_VAL(struct RegularExpressionLiteral_node, flags),
+	SNAPSHOT_PTR(struct RegularExpressionLiteral_node, argv[0]),
+	SNAPSHOT_PTR(struct RegularExpressionLiteral_node, argv[1]),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(regex_literal_layout,
+	struct RegularExpressionLiteral_node, regex_literal_words);
+
+static const struct snapshot_word ident_words[] = {
+	NODE_WORDS(struct PrimaryExpression_ident_node, node),
+	SNAPSHOT_PTR(struct PrimaryExpression_ident_node, string),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(ident_layout, struct PrimaryExpression_ident_node,
+	ident_words);
+
+static const struct snapshot_word array_literal_words[] = {
+	NODE_WORDS(struct ArrayLiteral_node, node),
+	SNAPSHOT_PTR(struct ArrayLiteral_node, first),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(array_literal_layout, struct ArrayLiteral_node,
+	array_literal_words);
+
+static const struct snapshot_word array_element_words[] = {
+	SNAPSHOT_PTR(struct ArrayLiteral_element, expr),
+	SNAPSHOT_PTR(struct ArrayLiteral_element, next),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(array_element_layout, struct ArrayLiteral_element,
+	array_element_words);
+
+static const struct snapshot_word object_literal_words[] = {
+	NODE_WORDS(struct ObjectLiteral_node, node),
+	SNAPSHOT_PTR(struct ObjectLiteral_node, first),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(object_literal_layout, struct ObjectLiteral_node,
+	object_literal_words);
+
+static const struct snapshot_word object_pair_words[] = {
+	SNAPSHOT_PTR(struct ObjectLiteral_pair, value),
+	SNAPSHOT_PTR(struct ObjectLiteral_pair, next),
+	SNAPSHOT_PTR(struct ObjectLiteral_pair, name),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(object_pair_layout, struct ObjectLiteral_pair,
+	object_pair_words);
+
+static const struct snapshot_word arguments_words[] = {
+	NODE_WORDS(struct Arguments_node, node),
+	SNAPSHOT_PTR(struct Arguments_node, first),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(arguments_layout, struct Arguments_node,
+	arguments_words);
+
+static const struct snapshot_word arguments_arg_words[] = {
+	SNAPSHOT_PTR(struct Arguments_arg, expr),
+	SNAPSHOT_PTR(struct Arguments_arg, next),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(arguments_arg_layout, struct Arguments_arg,
+	arguments_arg_words);
+
+static const struct snapshot_word new_words[] = {
+	NODE_WORDS(struct MemberExpression_new_node, node),
+	SNAPSHOT_PTR(struct MemberExpression_new_node, mexp),
+	SNAPSHOT_PTR(struct MemberExpression_new_node, args),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(new_layout, struct MemberExpression_new_node,
+	new_words);
+
+static const struct snapshot_word dot_words[] = {
+	NODE_WORDS(struct MemberExpression_dot_node, node),
+	SNAPSHOT_PTR(struct MemberExpression_dot_node, mexp),
+	SNAPSHOT_PTR(struct MemberExpression_dot_node, name),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(dot_layout, struct MemberExpression_dot_node,
+	dot_words);
+
+static const struct snapshot_word bracket_words[] = {
+	NODE_WORDS(struct MemberExpression_bracket_node, node),
+	SNAPSHOT_PTR(struct MemberExpression_bracket_node, mexp),
+	SNAPSHOT_PTR(struct MemberExpression_bracket_node, name),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(bracket_layout, struct MemberExpression_bracket_node,
+	bracket_words);
+
+static const struct snapshot_word call_words[] = {
+	NODE_WORDS(struct CallExpression_node, node),
+	SNAPSHOT_PTR(struct CallExpression_node, exp),
+	SNAPSHOT_PTR(struct CallExpression_node, args),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(call_layout, struct CallExpression_node, call_words);
+
+static const struct snapshot_word unary_words[] = {
+	NODE_WORDS(struct Unary_node, node),
+	SNAPSHOT_PTR(struct Unary_node, a),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(unary_layout, struct Unary_node, unary_words);
+
+static const struct snapshot_word binary_words[] = {
+	NODE_WORDS(struct Binary_node, node),
+	SNAPSHOT_PTR(struct Binary_node, a),
+	SNAPSHOT_PTR(struct Binary_node, b),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(binary_layout, struct Binary_node, binary_words);
+
+static const struct snapshot_word conditional_words[] = {
+	NODE_WORDS(struct ConditionalExpression_node, node),
+	SNAPSHOT_PTR(struct ConditionalExpression_node, a),
+	SNAPSHOT_PTR(struct ConditionalExpression_node, b),
+	SNAPSHOT_PTR(struct ConditionalExpression_node, c),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(conditional_layout, struct ConditionalExpression_node,
+	conditional_words);
+
+static const struct snapshot_word assignment_words[] = {
+	NODE_WORDS(struct AssignmentExpression_node, node),
+	SNAPSHOT_PTR(struct AssignmentExpression_node, lhs),
+	SNAPSHOT_PTR(struct AssignmentExpression_node, expr),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(assignment_layout, struct AssignmentExpression_node,
+	assignment_words);
+
+static const struct snapshot_word var_decl_words[] = {
+	NODE_WORDS(struct VariableDeclaration_node, node),
+	SNAPSHOT_PTR(struct VariableDeclaration_node, var),
+	SNAPSHOT_PTR(struct VariableDeclaration_node, init),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(var_decl_layout, struct VariableDeclaration_node,
+	var_decl_words);
+
+static const struct snapshot_word var_words[] = {
+	SNAPSHOT_PTR(struct var, name),
+	SNAPSHOT_PTR(struct var, next),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(var_layout, struct var, var_words);
+
+static const struct snapshot_word if_words[] = {
+	NODE_WORDS(struct IfStatement_node, node),
+	SNAPSHOT_PTR(struct IfStatement_node, cond),
+	SNAPSHOT_PTR(struct IfStatement_node, btrue),
+	SNAPSHOT_PTR(struct IfStatement_node, bfalse),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(if_layout, struct IfStatement_node, if_words);
+
+static const struct snapshot_word while_words[] = {
+	NODE_WORDS(struct IterationStatement_while_node, node),
+	SNAPSHOT_PTR(struct IterationStatement_while_node, cond),
+	SNAPSHOT_PTR(struct IterationStatement_while_node, body),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(while_layout, struct IterationStatement_while_node,
+	while_words);
+
+static const struct snapshot_word for_words[] = {
+	NODE_WORDS(struct IterationStatement_for_node, node),
+	SNAPSHOT_PTR(struct IterationStatement_for_node, init),
+	SNAPSHOT_PTR(struct IterationStatement_for_node, cond),
+	SNAPSHOT_PTR(struct IterationStatement_for_node, incr),
+	SNAPSHOT_PTR(struct IterationStatement_for_node, body),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(for_layout, struct IterationStatement_for_node,
+	for_words);
+
+static const struct snapshot_word forin_words[] = {
+	NODE_WORDS(struct IterationStatement_forin_node, node),
+	SNAPSHOT_PTR(struct IterationStatement_forin_node, lhs),
+	SNAPSHOT_PTR(struct IterationStatement_forin_node, list),
+	SNAPSHOT_PTR(struct IterationStatement_forin_node, body),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(forin_layout, struct IterationStatement_forin_node,
+	forin_words);
+
+static const struct snapshot_word continue_words[] = {
+	NODE_WORDS(struct ContinueStatement_node, node),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(continue_layout, struct ContinueStatement_node,
+	continue_words);
+
+static const struct snapshot_word break_words[] = {
+	NODE_WORDS(struct BreakStatement_node, node),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(break_layout, struct BreakStatement_node, break_words);
+
+static const struct snapshot_word return_words[] = {
+	NODE_WORDS(struct ReturnStatement_node, node),
+	SNAPSHOT_PTR(struct ReturnStatement_node, expr),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(return_layout, struct ReturnStatement_node,
+	return_words);
+
+static const struct snapshot_word switch_words[] = {
+	NODE_WORDS(struct SwitchStatement_node, node),
+	SNAPSHOT_PTR(struct SwitchStatement_node, cond),
+	SNAPSHOT_PTR(struct SwitchStatement_node, cases),
+	SNAPSHOT_PTR(struct SwitchStatement_node, defcase),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(switch_layout, struct SwitchStatement_node,
+	switch_words);
+
+static const struct snapshot_word case_list_words[] = {
+	SNAPSHOT_PTR(struct case_list, expr),
+	SNAPSHOT_PTR(struct case_list, body),
+	SNAPSHOT_PTR(struct case_list, next),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(case_list_layout, struct case_list, case_list_words);
+
+static const struct snapshot_word labelled_words[] = {
+	NODE_WORDS(struct LabelledStatement_node, unary.node),
+	SNAPSHOT_PTR(struct LabelledStatement_node, unary.a),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(labelled_layout, struct LabelledStatement_node,
+	labelled_words);
+
+static const struct snapshot_word try_words[] = {
+	NODE_WORDS(struct TryStatement_node, node),
+	SNAPSHOT_PTR(struct TryStatement_node, block),
+	SNAPSHOT_PTR(struct TryStatement_node, bcatch),
+	SNAPSHOT_PTR(struct TryStatement_node, bfinally),
+	SNAPSHOT_PTR(struct TryStatement_node, ident),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(try_layout, struct TryStatement_node, try_words);
+
+static const struct snapshot_word function_words[] = {
+	NODE_WORDS(struct Function_node, node),
+	SNAPSHOT_PTR(struct Function_node, function),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(function_layout, struct Function_node, function_words);
+
+static const struct snapshot_word function_body_words[] = {
+	NODE_WORDS(struct FunctionBody_node, u.node),
+	SNAPSHOT_PTR(struct FunctionBody_node, u.a),
+	SNAPSHOT_PTR(struct FunctionBody_node, params),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(function_body_layout, struct FunctionBody_node,
+	function_body_words);
+
+static const struct snapshot_word source_elements_words[] = {
+	NODE_WORDS(struct SourceElements_node, node),
+	SNAPSHOT_PTR(struct SourceElements_node, statements),
+	SNAPSHOT_PTR(struct SourceElements_node, functions),
+	SNAPSHOT_PTR(struct SourceElements_node, vars),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(source_elements_layout, struct SourceElements_node,
+	source_elements_words);
+
+static const struct snapshot_word source_element_words[] = {
+	SNAPSHOT_PTR(struct SourceElement, node),
+	SNAPSHOT_PTR(struct SourceElement, next),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(source_element_layout, struct SourceElement,
+	source_element_words);
+
+#undef NODE_WORDS
+
 #ifndef NDEBUG
 #define NEW_NODE(t, nc)					\
 	((t *)new_node(parser, sizeof (t), nc, #nc))
@@ -414,6 +730,7 @@ new_node_internal(interp, sz, nc, filename, lineno, dbg_nc)
 	struct node *n;
 
 	n = (struct node *)SEE_malloc(interp, sz);
+	SNAPSHOT_LAYOUT(interp, n, node_layout(nc));
 	n->nodeclass = nc;
 	n->location.filename = filename;
 	n->location.lineno = lineno;
@@ -426,6 +743,96 @@ new_node_internal(interp, sz, nc, filename, lineno, dbg_nc)
 	return n;
 }
 
+/* Returns the layout of nodes of a class */
+static const struct snapshot_layout *
+node_layout(nc)
+	enum nodeclass_enum nc;
+{
+	switch (nc) {
+	case NODECLASS_Literal:			return &literal_layout;
+	case NODECLASS_StringLiteral:		return &string_literal_layout;
+	case NODECLASS_RegularExpressionLiteral: return &regex_literal_layout;
+	case NODECLASS_PrimaryExpression_ident:	return &ident_layout;
+	case NODECLASS_ArrayLiteral:		return &array_literal_layout;
+	case NODECLASS_ObjectLiteral:		return &object_literal_layout;
+	case NODECLASS_Arguments:		return &arguments_layout;
+	case NODECLASS_MemberExpression_new:	return &new_layout;
+	case NODECLASS_MemberExpression_dot:	return &dot_layout;
+	case NODECLASS_MemberExpression_bracket: return &bracket_layout;
+	case NODECLASS_CallExpression:		return &call_layout;
+	case NODECLASS_ConditionalExpression:	return &conditional_layout;
+	case NODECLASS_VariableDeclaration:	return &var_decl_layout;
+	case NODECLASS_IfStatement:		return &if_layout;
+	case NODECLASS_ContinueStatement:	return &continue_layout;
+	case NODECLASS_BreakStatement:		return &break_layout;
+	case NODECLASS_ReturnStatement:
+	case NODECLASS_ReturnStatement_undef:	return &return_layout;
+	case NODECLASS_SwitchStatement:		return &switch_layout;
+	case NODECLASS_LabelledStatement:	return &labelled_layout;
+	case NODECLASS_Function:
+	case NODECLASS_FunctionDeclaration:
+	case NODECLASS_FunctionExpression:	return &function_layout;
+	case NODECLASS_FunctionBody:		return &function_body_layout;
+	case NODECLASS_SourceElements:		return &source_elements_layout;
+
+	case NODECLASS_IterationStatement_dowhile:
+	case NODECLASS_IterationStatement_while:
+		return &while_layout;
+	case NODECLASS_IterationStatement_for:
+	case NODECLASS_IterationStatement_forvar:
+		return &for_layout;
+	case NODECLASS_IterationStatement_forin:
+	case NODECLASS_IterationStatement_forvarin:
+		return &forin_layout;
+	case NODECLASS_TryStatement:
+	case NODECLASS_TryStatement_catch:
+	case NODECLASS_TryStatement_finally:
+	case NODECLASS_TryStatement_catchfinally:
+		return &try_layout;
+
+	case NODECLASS_Unary:
+	case NODECLASS_PostfixExpression_inc:
+	case NODECLASS_PostfixExpression_dec:
+	case NODECLASS_UnaryExpression_delete:
+	case NODECLASS_UnaryExpression_void:
+	case NODECLASS_UnaryExpression_typeof:
+	case NODECLASS_UnaryExpression_preinc:
+	case NODECLASS_UnaryExpression_predec:
+	case NODECLASS_UnaryExpression_plus:
+	case NODECLASS_UnaryExpression_minus:
+	case NODECLASS_UnaryExpression_inv:
+	case NODECLASS_UnaryExpression_not:
+	case NODECLASS_VariableStatement:
+	case NODECLASS_ExpressionStatement:
+	case NODECLASS_ThrowStatement:
+		return &unary_layout;
+
+	case NODECLASS_AssignmentExpression:
+	case NODECLASS_AssignmentExpression_simple:
+	case NODECLASS_AssignmentExpression_muleq:
+	case NODECLASS_AssignmentExpression_diveq:
+	case NODECLASS_AssignmentExpression_modeq:
+	case NODECLASS_AssignmentExpression_addeq:
+	case NODECLASS_AssignmentExpression_subeq:
+	case NODECLASS_AssignmentExpression_lshifteq:
+	case NODECLASS_AssignmentExpression_rshifteq:
+	case NODECLASS_AssignmentExpression_urshifteq:
+	case NODECLASS_AssignmentExpression_andeq:
+	case NODECLASS_AssignmentExpression_xoreq:
+	case NODECLASS_AssignmentExpression_oreq:
+		return &assignment_layout;
+
+	case NODECLASS_PrimaryExpression_this:
+	case NODECLASS_Block_empty:
+	case NODECLASS_EmptyStatement:
+	case NODECLASS_None:
+		return &leaf_layout;
+
+	default:				/* the binary operators */
+		return &binary_layout;
+	}
+}
+
 static struct node *
 new_node(parser, sz, nc, dbg_nc)
 	struct parser *parser;
@@ -461,6 +868,7 @@ parser_init(parser, interp, lex)
 	parser->noin = 0;
 	parser->is_lhs = 0;
 	parser->funcdepth = 0;
+	parser->uses_activation = 0;
 	parser->vars = NULL;
 	parser->labelsets = NULL;
 	parser->labels = NULL;
@@ -892,6 +1300,10 @@ PrimaryExpression_parse(parser)
 		i = NEW_NODE(struct PrimaryExpression_ident_node,
 			NODECLASS_PrimaryExpression_ident);
 		i->string = NEXT_VALUE->u.string;
+		/* Code that names eval or arguments may look at its
+		 * activation object, so its locals can't be in a frame */
+		if (i->string == STR(eval) || i->string == STR(arguments))
+			parser->uses_activation = 1;
 		SKIP;
 		return (struct node *)i;
 	case '[':
@@ -954,6 +1366,8 @@ ArrayLiteral_parse(parser)
 		} else {
 			*elp = SEE_NEW(parser->interpreter,
 			    struct ArrayLiteral_element);
+			SNAPSHOT_LAYOUT(parser->interpreter, *elp,
+			    &array_element_layout);
 			(*elp)->index = index;
 			(*elp)->expr = PARSE(AssignmentExpression);
 			elp = &(*elp)->next;
@@ -1001,6 +1415,7 @@ ObjectLiteral_parse(parser)
 	EXPECT('{');
 	while (NEXT != '}') {
 	    *pairp = SEE_NEW(interp, struct ObjectLiteral_pair);
+	    SNAPSHOT_LAYOUT(interp, *pairp, &object_pair_layout);
 	    switch (NEXT) {
 	    case tIDENT:
 	    case tSTRING:
@@ -1115,6 +1530,8 @@ Arguments_parse(parser)
 	while (NEXT != ')') {
 		n->argc++;
 		*argp = SEE_NEW(parser->interpreter, struct Arguments_arg);
+		SNAPSHOT_LAYOUT(parser->interpreter, *argp,
+		    &arguments_arg_layout);
 		(*argp)->expr = PARSE(AssignmentExpression);
 		argp = &(*argp)->next;
 		if (NEXT != ')')
@@ -2180,6 +2597,7 @@ VariableDeclaration_parse(parser)
 	v = NEW_NODE(struct VariableDeclaration_node, 
 		NODECLASS_VariableDeclaration);
         v->var = SEE_NEW(parser->interpreter, struct var);
+	SNAPSHOT_LAYOUT(parser->interpreter, v->var, &var_layout);
 	if (NEXT == tIDENT)
 		v->var->name = NEXT_VALUE->u.string;
 	EXPECT(tIDENT);
@@ -2542,6 +2960,7 @@ WithStatement_parse(parser)
 
 	n = NEW_NODE(struct Binary_node, NODECLASS_WithStatement);
 	EXPECT(tWITH);
+	parser->uses_activation = 1;
 	EXPECT('(');
 	n->a = PARSE(Expression);
 	EXPECT(')');
@@ -2602,6 +3021,7 @@ SwitchStatement_parse(parser)
 	n->defcase = NULL;
 	while (NEXT != '}') {
 	    c = SEE_NEW(parser->interpreter, struct case_list);
+	    SNAPSHOT_LAYOUT(parser->interpreter, c, &case_list_layout);
 	    *cp = c;
 	    cp = &c->next;
 	    switch (NEXT) {
@@ -2823,6 +3243,9 @@ FunctionDeclaration_parse(parser)
 	parser->funcdepth--;
 	EXPECT('}');
 
+	/* The enclosing function's activation is in the closure's scope */
+	parser->uses_activation = 1;
+	CAST_NODE(body, FunctionBody)->params = formal;
 	n->function = SEE_function_make(parser->interpreter, 
 		name, formal, make_body(parser->interpreter, body, 0));
 
@@ -2862,6 +3285,8 @@ FunctionExpression_parse(parser)
 	parser->funcdepth--;
 	EXPECT('}');
 
+	parser->uses_activation = 1;
+	CAST_NODE(body, FunctionBody)->params = formal;
 	n->function = SEE_function_make(parser->interpreter,
 		name, formal, make_body(parser->interpreter, body, 0));
 
@@ -2883,6 +3308,7 @@ FormalParameterList_parse(parser)
 
 	if (NEXT == tIDENT) {
 	    *p = SEE_NEW(parser->interpreter, struct var);
+	    SNAPSHOT_LAYOUT(parser->interpreter, *p, &var_layout);
 	    (*p)->name = NEXT_VALUE->u.string;
 	    p = &(*p)->next;
 	    SKIP;
@@ -2890,6 +3316,7 @@ FormalParameterList_parse(parser)
 		SKIP;
 		if (NEXT == tIDENT) {
 		    *p = SEE_NEW(parser->interpreter, struct var);
+		    SNAPSHOT_LAYOUT(parser->interpreter, *p, &var_layout);
 		    (*p)->name = NEXT_VALUE->u.string;
 		    p = &(*p)->next;
 		}
@@ -2912,6 +3339,8 @@ FunctionBody_make(interp, source_elements, is_program)
 	    NODECLASS_FunctionBody);
 	n->u.a = source_elements;
 	n->is_program = is_program;
+	n->uses_activation = 1;
+	n->params = NULL;
 	return (struct node *)n;
 }
 
@@ -2920,10 +3349,16 @@ FunctionBody_parse(parser)
 	struct parser *parser;
 {
         struct FunctionBody_node *n;
+	int uses_activation_save;
 
 	n = NEW_NODE(struct FunctionBody_node, NODECLASS_FunctionBody);
+	uses_activation_save = parser->uses_activation;
+	parser->uses_activation = 0;
 	n->u.a = PARSE(SourceElements);
 	n->is_program = 0;
+	n->uses_activation = parser->uses_activation;
+	n->params = NULL;
+	parser->uses_activation = uses_activation_save;
 	return (struct node *)n;
 }
 
@@ -3023,6 +3458,7 @@ SourceElements_make1(interp, statement)
 	struct SourceElement *s;
 
 	s = SEE_NEW(interp, struct SourceElement);
+	SNAPSHOT_LAYOUT(interp, s, &source_element_layout);
 	s->node = statement;
 	s->next = NULL;
 	ss = NEW_NODE_INTERNAL(interp, struct SourceElements_node, 
@@ -3054,6 +3490,8 @@ SourceElements_parse(parser)
 	    case tFUNCTION:
 		if (lookahead(parser, 1) != '(') {
 		    *f = SEE_NEW(parser->interpreter, struct SourceElement);
+		    SNAPSHOT_LAYOUT(parser->interpreter, *f,
+			&source_element_layout);
 		    (*f)->node = PARSE(FunctionDeclaration);
 		    f = &(*f)->next;
 #ifndef NDEBUG
@@ -3075,6 +3513,8 @@ SourceElements_parse(parser)
 	    case tWITH: case tSWITCH: case tTHROW: case tTRY:
 	    case tDIV: case tDIVEQ: /* in lieu of tREGEX */
 		*s = SEE_NEW(parser->interpreter, struct SourceElement);
+		SNAPSHOT_LAYOUT(parser->interpreter, *s,
+		    &source_element_layout);
 		(*s)->node = PARSE(Statement);
 		s = &(*s)->next;
 #ifndef NDEBUG
@@ -3140,6 +3580,7 @@ SEE_parse_function(interp, name, paraminp, bodyinp)
 	parser->funcdepth--;
 	EXPECT_NOSKIP(tEND);
 
+	CAST_NODE(body, FunctionBody)->params = formal;
 	return SEE_function_make(interp, name, formal, 
 		make_body(interp, body, 0));
 }
@@ -3210,6 +3651,43 @@ SEE_eval_functionbody(f, context, res)
 	    SEE_VALUE_GET_TYPE(res) != SEE_REFERENCE);
 }
 
+/*
+ * Calls the function body in a context that has no activation object,
+ * keeping its variables in a frame. Only valid if the body has a frame.
+ */
+void
+SEE_call_functionbody(f, context, callee, argc, argv, res)
+	struct function *f;
+	struct SEE_context *context;
+	struct SEE_object *callee;
+	int argc;
+	struct SEE_value **argv;
+	struct SEE_value *res;
+{
+	SEE_ASSERT(context->interpreter, 
+	    SEE_functionbody_hasframe(context->interpreter, f));
+#if WITH_PARSER_CODEGEN
+	_SEE_codegen_call_functionbody(f->body, context, callee, argc, argv,
+	    res);
+#endif
+	SEE_ASSERT(context->interpreter,
+	    SEE_VALUE_GET_TYPE(res) != SEE_COMPLETION);
+	SEE_ASSERT(context->interpreter,
+	    SEE_VALUE_GET_TYPE(res) != SEE_REFERENCE);
+}
+
+/* Returns true if the function can be called without an activation object */
+int
+SEE_functionbody_hasframe(interp, f)
+	struct SEE_interpreter *interp;
+	struct function *f;
+{
+#if WITH_PARSER_CODEGEN
+        return _SEE_codegen_functionbody_hasframe(interp, f);
+#else
+	return 0;
+#endif
+}
 
 int
 SEE_functionbody_isempty(interp, f)
@@ -3312,7 +3790,18 @@ _SEE_eval_input(context, thisobj, inp, res)
 	struct SEE_input *inp;
 	struct SEE_value *res;  /* optional */
 {
+	_SEE_eval_parsed(context, thisobj,
+	    SEE_parse_program(context->interpreter, inp), res);
+}
+
+/* Evaluates a function parsed from program text, as _SEE_eval_input does */
+void
+_SEE_eval_parsed(context, thisobj, f, res)
+	struct SEE_context *context;
+	struct SEE_object *thisobj;
 	struct function *f;
+	struct SEE_value *res;  /* optional */
+{
 	struct SEE_context evalcontext;
 	struct SEE_interpreter *interp = context->interpreter;
         struct SEE_value ignore;
@@ -3339,11 +3828,11 @@ _SEE_eval_input(context, thisobj, inp, res)
 		evalcontext.thisobj = thisobj;
 		evalcontext.variable = thisobj;
 		evalcontext.scope = SEE_NEW(interp, struct SEE_scope);
+		SNAPSHOT_LAYOUT(interp, evalcontext.scope,
+		    &_SEE_snapshot_pointers);
 		evalcontext.scope->next = context->scope;
 		evalcontext.scope->obj = thisobj;
 	}
-	
-	f = SEE_parse_program(interp, inp);
 
 	/* Set formal params to undefined, if any exist -- redundant? */
 	SEE_function_put_args(context, f, 0, NULL);
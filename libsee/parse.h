@@ -8,6 +8,7 @@ struct SEE_value;
 struct SEE_interpreter;
 struct SEE_context;
 struct SEE_input;
+struct SEE_object;
 struct function;
 
 struct function *SEE_parse_function(struct SEE_interpreter *i,
@@ -22,6 +23,10 @@ void  SEE_functionbody_print(struct SEE_interpreter *i, struct function *f);
 struct SEE_string *SEE_functionbody_string(struct SEE_interpreter *i, 
 	struct function *f);
 int SEE_functionbody_isempty(struct SEE_interpreter *i, struct function *f);
+int SEE_functionbody_hasframe(struct SEE_interpreter *i, struct function *f);
+void SEE_call_functionbody(struct function *f, struct SEE_context *context,
+	struct SEE_object *callee, int argc, struct SEE_value **argv,
+	struct SEE_value *res);
 
 void _SEE_call_eval(struct SEE_context *context, 
         struct SEE_object *thisobj, int argc, struct SEE_value **argv, 
@@ -30,5 +35,8 @@ void _SEE_call_eval(struct SEE_context *context,
 void _SEE_eval_input(struct SEE_context *context, 
         struct SEE_object *thisobj, struct SEE_input *inp,
         struct SEE_value *res);
+void _SEE_eval_parsed(struct SEE_context *context,
+        struct SEE_object *thisobj, struct function *f,
+        struct SEE_value *res);
 
 #endif /* _SEE_h_parse_ */
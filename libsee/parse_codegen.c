@@ -66,6 +66,11 @@ struct code_context {
 	/* True when we want to disable constant folding */
 	int no_const;
 
+	/* True when the vars are kept in a frame instead of the
+	 * variable object, so that LOADLOCAL and STORELOCAL can
+	 * be used instead of VREF. */
+	int frame;
+
 	struct code_varscope *varscope;
 	unsigned int          nvarscope;
 	struct SEE_growable   gvarscope;
@@ -123,6 +128,10 @@ static unsigned int cg_var_id(struct code_context *, struct SEE_string *);
 static int cg_var_is_in_scope(struct code_context *, struct SEE_string *);
 static void cg_var_set_scope(struct code_context *, struct SEE_string *, int);
 static int cg_var_set_all_scope(struct code_context *, int);
+static void cg_frame(struct code_context *, struct var *);
+static int cg_var_is_local(struct code_context *, struct SEE_string *);
+static struct SEE_string *cg_local_ident(struct code_context *, 
+	struct node *);
 
 # define CODEGENFN(node) _SEE_nodeclass_codegen[(node)->nodeclass]
 # define CODEGEN(node)	do {				\
@@ -141,6 +150,8 @@ static int cg_var_set_all_scope(struct code_context *, int);
 # define CG_CALL(n)		_CG_OP1(CALL, n)
 # define CG_END(n)		_CG_OP1(END, n)
 # define CG_VREF(n)		_CG_OP1(VREF, n)
+# define CG_LOADLOCAL(n)	_CG_OP1(LOADLOCAL, n)
+# define CG_STORELOCAL(n)	_CG_OP1(STORELOCAL, n)
 
 /* Generic operators */
 # define _CG_OP0(name) \
@@ -385,6 +396,7 @@ cg_init(interp, cc, no_const)
 	cc->max_block_depth = 0;
 	cc->in_var_scope = 1;
 	cc->no_const = no_const;
+	cc->frame = 0;
 	SEE_GROW_INIT(interp, &cc->gvarscope, cc->varscope, cc->nvarscope);
 }
 
@@ -567,6 +579,59 @@ cg_var_set_all_scope(cc, in_scope)
 	return old_scope;
 }
 
+/*
+ * Switches the code to keep its vars in a frame, with the formal
+ * parameters in the first slots. Functions with repeated parameter
+ * names keep using the activation object.
+ */
+static void
+cg_frame(cc, params)
+	struct code_context *cc;
+	struct var *params;
+{
+	struct var *v, *w;
+	int nparams = 0;
+
+	for (v = params; v; v = v->next) {
+	    for (w = params; w != v; w = w->next)
+		if (w->name == v->name)
+		    return;
+	    nparams++;
+	}
+
+	(*cc->code->code_class->gen_frame)(cc->code, nparams);
+	cc->frame = 1;
+	for (v = params; v; v = v->next)
+	    cg_var_set_scope(cc, v->name, 1);
+#ifndef NDEBUG
+	if (SEE_parse_debug)
+	    dprintf("cg_frame: %d params\n", nparams);
+#endif
+}
+
+/* Returns true if the identifier is a var kept in the frame */
+static int
+cg_var_is_local(cc, ident)
+	struct code_context *cc;
+	struct SEE_string *ident;
+{
+	return cc->frame && cg_var_is_in_scope(cc, ident);
+}
+
+/* Returns the identifier if the node is one naming a var in the frame */
+static struct SEE_string *
+cg_local_ident(cc, node)
+	struct code_context *cc;
+	struct node *node;
+{
+	struct PrimaryExpression_ident_node *n;
+
+	if (node->nodeclass != NODECLASS_PrimaryExpression_ident)
+	    return NULL;
+	n = CAST_NODE(node, PrimaryExpression_ident);
+	return cg_var_is_local(cc, n->string) ? n->string : NULL;
+}
+
 /* Returns a body suitable for use by eval_functionbody() */
 void *
 _SEE_codegen_make_body(interp, node, no_const)
@@ -659,14 +724,17 @@ PrimaryExpression_ident_codegen(na, cc)
 	struct PrimaryExpression_ident_node *n = 
 		CAST_NODE(na, PrimaryExpression_ident);
 
-	if (cg_var_is_in_scope(cc, n->string)) 
+	n->node.is = CG_TYPE_REFERENCE;
+	if (cg_var_is_local(cc, n->string)) {
+	    CG_LOADLOCAL(cg_var_id(cc, n->string)); /* val */
+	    n->node.is = CG_TYPE_VALUE;
+	} else if (cg_var_is_in_scope(cc, n->string)) 
 	    CG_VREF(cg_var_id(cc, n->string));	/* ref */
 	else {
 	    CG_STRING(n->string);		/* str */
 	    CG_LOOKUP();			/* ref */
 	}
 
-	n->node.is = CG_TYPE_REFERENCE;
 	n->node.maxstack = 2;
 }
 
@@ -832,8 +900,7 @@ MemberExpression_bracket_codegen(na, cc)
 	    CG_TOOBJECT();	    /* val2 obj1 */
 	    CG_EXCH();		    /* obj1 val2 */
 	}
-	if (!CG_IS_STRING(n->name))
-	    CG_TOSTRING();	    /* obj1 str2 */
+	/* REF converts val2 to a string unless it indexes an array */
 	CG_REF();		    /* ref */
 
 	n->node.is = CG_TYPE_REFERENCE;
@@ -865,6 +932,19 @@ PostfixExpression_inc_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	struct SEE_string *local = cg_local_ident(cc, n->a);
+
+	n->node.is = CG_TYPE_NUMBER;
+	if (local) {
+	    CG_LOADLOCAL(cg_var_id(cc, local));	 /* val */
+	    CG_TONUMBER();			 /* num */
+	    CG_DUP();				 /* num num */
+	    CG_NUMBER(1);			 /* num num 1 */
+	    CG_ADD();				 /* num num+1 */
+	    CG_STORELOCAL(cg_var_id(cc, local)); /* num */
+	    n->node.maxstack = 3;
+	    return;
+	}
 
 	CODEGEN(n->a);		/* ref */
 	CG_DUP();		/* ref ref */
@@ -878,7 +958,6 @@ PostfixExpression_inc_codegen(na, cc)
 	CG_ADD();		/* num ref num+1 */
 	CG_PUTVALUE();		/* num */
 
-	n->node.is = CG_TYPE_NUMBER;
 	n->node.maxstack = MAX(n->a->maxstack, 4);
 
 	/*
@@ -926,6 +1005,19 @@ PostfixExpression_dec_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	struct SEE_string *local = cg_local_ident(cc, n->a);
+
+	n->node.is = CG_TYPE_NUMBER;
+	if (local) {
+	    CG_LOADLOCAL(cg_var_id(cc, local));	 /* aval */
+	    CG_TONUMBER();			 /* anum */
+	    CG_DUP();				 /* anum anum */
+	    CG_NUMBER(1);			 /* anum anum 1 */
+	    CG_SUB();				 /* anum anum-1 */
+	    CG_STORELOCAL(cg_var_id(cc, local)); /* anum */
+	    n->node.maxstack = 3;
+	    return;
+	}
 
 	CODEGEN(n->a);		/* aref */
 	CG_DUP();		/* aref aref */
@@ -939,7 +1031,6 @@ PostfixExpression_dec_codegen(na, cc)
 	CG_SUB();		/* anum aref anum-1 */
 	CG_PUTVALUE();		/* anum */
 
-	n->node.is = CG_TYPE_NUMBER;
 	n->node.maxstack = MAX(n->a->maxstack, 4);
 }
 
@@ -951,10 +1042,17 @@ UnaryExpression_delete_codegen(na, cc)
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
 
+	n->node.is = CG_TYPE_BOOLEAN;
+	if (cg_local_ident(cc, n->a)) {
+	    /* vars are DontDelete */
+	    CG_FALSE();	/* bool */
+	    n->node.maxstack = 1;
+	    return;
+	}
+
 	CODEGEN(n->a);	/* ref */
 	CG_DELETE();	/* bool */
 
-	n->node.is = CG_TYPE_BOOLEAN;
 	n->node.maxstack = n->a->maxstack;
 }
 
@@ -999,6 +1097,19 @@ UnaryExpression_preinc_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	struct SEE_string *local = cg_local_ident(cc, n->a);
+
+	n->node.is = CG_TYPE_NUMBER;
+	if (local) {
+	    CG_LOADLOCAL(cg_var_id(cc, local));	 /* aval */
+	    CG_TONUMBER();			 /* anum */
+	    CG_NUMBER(1);			 /* anum 1 */
+	    CG_ADD();				 /* anum+1 */
+	    CG_DUP();				 /* anum+1 anum+1 */
+	    CG_STORELOCAL(cg_var_id(cc, local)); /* anum+1 */
+	    n->node.maxstack = 2;
+	    return;
+	}
 
 	/* Note: Makes no sense to check n->a is already a value */
 	CODEGEN(n->a);	/* aref */
@@ -1011,7 +1122,6 @@ UnaryExpression_preinc_codegen(na, cc)
 	CG_ROLL3();	/* anum+1 aref anum+1 */
 	CG_PUTVALUE();	/* anum+1 */
 
-	n->node.is = CG_TYPE_NUMBER;
 	n->node.maxstack = MAX(n->a->maxstack, 3);
 }
 
@@ -1022,6 +1132,19 @@ UnaryExpression_predec_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	struct SEE_string *local = cg_local_ident(cc, n->a);
+
+	n->node.is = CG_TYPE_NUMBER;
+	if (local) {
+	    CG_LOADLOCAL(cg_var_id(cc, local));	 /* aval */
+	    CG_TONUMBER();			 /* anum */
+	    CG_NUMBER(1);			 /* anum 1 */
+	    CG_SUB();				 /* anum-1 */
+	    CG_DUP();				 /* anum-1 anum-1 */
+	    CG_STORELOCAL(cg_var_id(cc, local)); /* anum-1 */
+	    n->node.maxstack = 2;
+	    return;
+	}
 
 	/* Note: Makes no sense to check n->a is already a value */
 	CODEGEN(n->a);	/* aref */
@@ -1034,7 +1157,6 @@ UnaryExpression_predec_codegen(na, cc)
 	CG_ROLL3();   	/* anum-1 aref anum-1 */
 	CG_PUTVALUE();	/* anum-1 */
 
-	n->node.is = CG_TYPE_NUMBER;
 	n->node.maxstack = MAX(n->a->maxstack, 3);
 }
 
@@ -1578,14 +1700,29 @@ ConditionalExpression_codegen(na, cc)
 	n->node.maxstack = MAX3(n->a->maxstack, n->b->maxstack, n->c->maxstack);
 }
 
+/* The ref is omitted when the lhs is a var kept in the frame */
+static void
+AssignmentExpression_common_codegen_lhs(n, cc)	/* - | ref val */
+	struct AssignmentExpression_node *n;
+	struct code_context *cc;
+{
+	struct SEE_string *local = cg_local_ident(cc, n->lhs);
+
+	if (local)
+	    CG_LOADLOCAL(cg_var_id(cc, local));	/* val */
+	else {
+	    CODEGEN(n->lhs);	/* ref */
+	    CG_DUP();		/* ref ref */
+	    CG_GETVALUE();	/* ref val */
+	}
+}
+
 static void
 AssignmentExpression_common_codegen_pre(n, cc)	/* - | ref num num */
 	struct AssignmentExpression_node *n;
 	struct code_context *cc;
 {
-	CODEGEN(n->lhs);	/* ref */
-	CG_DUP();		/* ref ref */
-	CG_GETVALUE();		/* ref val */
+	AssignmentExpression_common_codegen_lhs(n, cc);	/* ref val */
 	CG_TONUMBER();		/* ref num */
 	CODEGEN(n->expr);	/* ref num ref */
 	if (!CG_IS_VALUE(n->expr))
@@ -1599,9 +1736,7 @@ AssignmentExpression_common_codegen_shiftpre(n, cc)	/* - | ref val val */
 	struct AssignmentExpression_node *n;
 	struct code_context *cc;
 {
-	CODEGEN(n->lhs);	/* ref */
-	CG_DUP();		/* ref ref */
-	CG_GETVALUE();		/* ref val */
+	AssignmentExpression_common_codegen_lhs(n, cc);	/* ref val */
 	CODEGEN(n->expr);	/* ref num ref */
 	if (!CG_IS_VALUE(n->expr))
 	    CG_GETVALUE();	/* ref num val */
@@ -1612,6 +1747,15 @@ AssignmentExpression_common_codegen_post(n, cc) /* ref val | val */
 	struct AssignmentExpression_node *n;
 	struct code_context *cc;
 {
+	struct SEE_string *local = cg_local_ident(cc, n->lhs);
+
+	if (local) {
+	    CG_DUP();					/* val val */
+	    CG_STORELOCAL(cg_var_id(cc, local));	/* val */
+	    n->node.maxstack = 2 + n->expr->maxstack;
+	    return;
+	}
+
 	CG_DUP();		/* ref val val */
 	CG_ROLL3();   		/* val ref val */
 	CG_PUTVALUE();		/* val */
@@ -1660,7 +1804,8 @@ AssignmentExpression_simple_codegen(na, cc)
 	struct AssignmentExpression_node *n = 
 		CAST_NODE(na, AssignmentExpression);
 
-	CODEGEN(n->lhs);	/* ref */
+	if (!cg_local_ident(cc, n->lhs))
+	    CODEGEN(n->lhs);	/* ref */
 	CODEGEN(n->expr);	/* ref ref */
 	if (!CG_IS_VALUE(n->expr))
 	    CG_GETVALUE();	/* ref val */
@@ -1722,9 +1867,7 @@ AssignmentExpression_addeq_codegen(na, cc)
 	struct AssignmentExpression_node *n = 
 		CAST_NODE(na, AssignmentExpression);
 
-	CODEGEN(n->lhs);	/* ref1 */
-	CG_DUP();		/* ref1 ref1 */
-	CG_GETVALUE();		/* ref1 val1 */
+	AssignmentExpression_common_codegen_lhs(n, cc); /* ref1 val1 */
 	CODEGEN(n->expr);	/* ref1 val1 ref2 */
 	if (!CG_IS_VALUE(n->expr))
 	    CG_GETVALUE();	/* ref1 val1 val2 */
@@ -1926,7 +2069,12 @@ VariableDeclaration_codegen(na, cc)
 {
 	struct VariableDeclaration_node *n = 
 		CAST_NODE(na, VariableDeclaration);
-	if (n->init) {
+	if (n->init && cg_var_is_local(cc, n->var->name)) {
+		CODEGEN(n->init);			    /* ref */
+		if (!CG_IS_VALUE(n->init))
+		    CG_GETVALUE();			    /* val */
+		CG_STORELOCAL(cg_var_id(cc, n->var->name)); /* - */
+	} else if (n->init) {
 		if (cg_var_is_in_scope(cc, n->var->name)) 
 		    CG_VREF(cg_var_id(cc, n->var->name));    /* ref */
 		else {
@@ -2166,6 +2314,8 @@ IterationStatement_forin_codegen(na, cc)
 		CAST_NODE(na, IterationStatement_forin);
 	SEE_code_patchable_t P1;
 	SEE_code_addr_t L1, L2, L3;
+	struct SEE_string *local = cg_local_ident(cc, n->lhs);
+	unsigned int lhs_maxstack;
 
 	CG_LOC(&na->location);
 	CODEGEN(n->list);		/* ref */
@@ -2182,9 +2332,15 @@ IterationStatement_forin_codegen(na, cc)
 	CG_B_ALWAYS_f(P1);
 
     L1 = CG_HERE();
-	CODEGEN(n->lhs);		/* str ref */
-	CG_EXCH();			/* ref str */
-	CG_PUTVALUE();			/* - */
+	if (local) {
+	    CG_STORELOCAL(cg_var_id(cc, local)); /* - */
+	    lhs_maxstack = 0;
+	} else {
+	    CODEGEN(n->lhs);		/* str ref */
+	    CG_EXCH();			/* ref str */
+	    CG_PUTVALUE();		/* - */
+	    lhs_maxstack = n->lhs->maxstack;
+	}
 
 	CODEGEN(n->body);
 
@@ -2201,7 +2357,7 @@ IterationStatement_forin_codegen(na, cc)
 	na->maxstack = MAX4(
 	    2,
 	    n->list->maxstack,
-	    1 + n->lhs->maxstack,
+	    1 + lhs_maxstack,
 	    n->body->maxstack);
 }
 
@@ -2234,14 +2390,18 @@ IterationStatement_forvarin_codegen(na, cc)
 	CG_B_ALWAYS_f(P1);
 
     L1 = CG_HERE();
-	if (cg_var_is_in_scope(cc, lhs->var->name)) 
-	    CG_VREF(cg_var_id(cc, lhs->var->name));    /* ref */
+	if (cg_var_is_local(cc, lhs->var->name))
+	    CG_STORELOCAL(cg_var_id(cc, lhs->var->name)); /* - */
 	else {
-	    CG_STRING(lhs->var->name);		    /* str */
-	    CG_LOOKUP();			    /* ref */
+	    if (cg_var_is_in_scope(cc, lhs->var->name)) 
+		CG_VREF(cg_var_id(cc, lhs->var->name));    /* ref */
+	    else {
+		CG_STRING(lhs->var->name);		    /* str */
+		CG_LOOKUP();			    	    /* ref */
+	    }
+	    CG_EXCH();			/* ref str */
+	    CG_PUTVALUE();		/* - */
 	}
-	CG_EXCH();			/* ref str */
-	CG_PUTVALUE();			/* - */
 
 	CODEGEN(n->body);
 
@@ -2640,6 +2800,12 @@ FunctionBody_codegen(na, cc)
 {
 	struct FunctionBody_node *n = CAST_NODE(na, FunctionBody);
 
+	/* Nothing can see the activation object of a function that
+	 * has no with, eval, arguments or inner functions, so its
+	 * parameters and vars can be kept in a frame. */
+	if (!n->is_program && !n->uses_activation)
+	    cg_frame(cc, n->params);
+
 	/* Note that SourceElements_codegen includes the fproc action */
 	CODEGEN(n->u.a);	/* - */
 
@@ -2714,6 +2880,29 @@ _SEE_codegen_eval_functionbody(body, context, res)
         CG_EXEC((struct SEE_code *)body, context, res);
 }
 
+/* Returns true if the codegen function body keeps its vars in a frame */
+int
+_SEE_codegen_functionbody_hasframe(interp, f)
+	struct SEE_interpreter *interp;
+	struct function *f;
+{
+	return f->body != NULL && ((struct SEE_code *)f->body)->framed;
+}
+
+void 
+_SEE_codegen_call_functionbody(body, context, callee, argc, argv, res)
+        void *body;
+        struct SEE_context *context;
+        struct SEE_object *callee;
+        int argc;
+        struct SEE_value **argv;
+        struct SEE_value *res;
+{
+	struct SEE_code *co = (struct SEE_code *)body;
+
+        (*co->code_class->call)(co, context, callee, argc, argv, res);
+}
+
 void (*_SEE_nodeclass_codegen[NODECLASS_MAX])(struct node *, 
         struct code_context *) = { 0
     ,0                                      /*Unary*/
@@ -3,6 +3,7 @@
 struct SEE_interpreter;
 struct SEE_context;
 struct SEE_value;
+struct SEE_object;
 struct function;
 struct node;
 
@@ -12,3 +13,8 @@ void * _SEE_codegen_make_body(struct SEE_interpreter *interp,
             struct node *node, int no_const);
 void _SEE_codegen_eval_functionbody(void *body, struct SEE_context *context,
             struct SEE_value *res);
+int _SEE_codegen_functionbody_hasframe(struct SEE_interpreter *interp,
+            struct function *f);
+void _SEE_codegen_call_functionbody(void *body, struct SEE_context *context,
+            struct SEE_object *callee, int argc, struct SEE_value **argv,
+            struct SEE_value *res);
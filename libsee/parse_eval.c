@@ -25,6 +25,7 @@
 #include "scope.h"
 #include "nmath.h"
 #include "compare.h"
+#include "snapshot.h"
 
 /*
 #include <see/cfunction.h>
@@ -2268,6 +2269,7 @@ WithStatement_eval(na, context, res)
 
 	/* Insert r3 in front of current scope chain */
 	s = SEE_NEW(context->interpreter, struct SEE_scope);
+	SNAPSHOT_LAYOUT(context->interpreter, s, &_SEE_snapshot_pointers);
 	s->obj = r3.u.object;
 	s->next = context->scope;
 	context->scope = s;
@@ -2396,6 +2398,7 @@ TryStatement_catch(n, context, C, res, ctxt)
 	r2 = SEE_Object_new(interp);
 	SEE_OBJECT_PUT(interp, r2, n->ident, C, SEE_ATTR_DONTDELETE);
 	s = SEE_NEW(interp, struct SEE_scope);
+	SNAPSHOT_LAYOUT(interp, s, &_SEE_snapshot_pointers);
 	s->obj = r2;
 	s->next = context->scope;
 	context->scope = s;
@@ -2545,6 +2548,7 @@ FunctionExpression_eval(na, context, res)
 	    obj = SEE_Object_new(interp);
 
 	    scope = SEE_NEW(interp, struct SEE_scope);
+	    SNAPSHOT_LAYOUT(interp, scope, &_SEE_snapshot_pointers);
 	    scope->obj = obj;
 	    scope->next = context->scope;
 	    context->scope = scope;
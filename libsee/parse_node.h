@@ -287,6 +287,8 @@ struct Function_node {
 struct FunctionBody_node {
 	struct Unary_node u;
 	int is_program;
+	int uses_activation;	/* has with, eval, arguments or functions */
+	struct var *params;	/* formal parameters, if known */
 };
 
 struct SourceElements_node {
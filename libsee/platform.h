@@ -11,6 +11,9 @@ SEE_number_t _SEE_platform_time(struct SEE_interpreter *interp);
 /* Returns the local timezone adjustment in milliseconds */
 SEE_number_t _SEE_platform_tza(struct SEE_interpreter *interp);
 
+/* Returns a number that changes when the local timezone is changed */
+unsigned int _SEE_platform_tzstamp(struct SEE_interpreter *interp);
+
 /* Returns the daylight saving time adjustment in msec for a local time */
 SEE_number_t _SEE_platform_dst(struct SEE_interpreter *interp,
 		SEE_number_t ysec, int ily, int wstart);
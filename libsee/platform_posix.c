@@ -82,27 +82,49 @@ _SEE_platform_time(interp)
 #endif
 }
 
+/*
+ * Returns a hash of the TZ environment variable. localtime() and mktime()
+ * call tzset() and so follow TZ when it is changed; a different stamp
+ * tells callers that what they cached from them is stale.
+ */
+unsigned int
+_SEE_platform_tzstamp(interp)
+	struct SEE_interpreter *interp;
+{
+	const char *tz = getenv("TZ");
+	unsigned int h;
+
+	if (!tz)
+		return 0;
+	for (h = 1; *tz; tz++)
+		h = h * 31 + (unsigned char)*tz;
+	return h;
+}
+
+/*
+ * Returns the local timezone adjustment. It is recomputed on every
+ * call so that it follows TZ; obj_Date.c keeps it with each
+ * interpreter's DST cache.
+ */
 SEE_number_t
 _SEE_platform_tza(interp)
 	struct SEE_interpreter *interp;
 {
 #if HAVE_LOCALTIME
-	static int initialized = 0;
-	static SEE_number_t tza;
-
-	if (!initialized) {	/* XXX not thread safe */
-		time_t time0 = 0;
-		int diff;
-		struct tm *tm;
-
-		tm = localtime(&time0);
-	        diff = tm->tm_sec + 60 * (tm->tm_min + tm->tm_hour * 60);
-		if (tm->tm_year < 0)
-			diff = diff - 24 * 60 * 60;
-		tza = diff * 1000.0;
-		initialized = 1;
-	}
-	return tza;
+	time_t time0 = 0;
+	int diff;
+	struct tm *tm;
+# if HAVE_LOCALTIME_R
+	struct tm tmbuf;
+
+	tm = localtime_r(&time0, &tmbuf);
+# else
+	tm = localtime(&time0);			/* XXX not thread safe */
+# endif
+	diff = tm->tm_sec + 60 * (tm->tm_min + tm->tm_hour * 60);
+	if (tm->tm_year < 70)
+		diff = diff - 24 * 60 * 60;
+	return diff * 1000.0;
 #else
  # warning "no localtime(); effective timezone has been set to UTC"
  	return 0;
@@ -117,7 +139,9 @@ _SEE_platform_tza(interp)
  * fourteen years near the current year.
  * Once the translation is done, we then figure out what
  * the difference between dst and non-dst times are, using the
- * system's timezone databases.
+ * system's timezone databases. The time within the year, ysec,
+ * is UTC (15.9.1.8), so the adjustment is the one in force at
+ * that instant of the equivalent year.
  */
 SEE_number_t
 _SEE_platform_dst(interp, ysec, ily, wstart)
@@ -125,50 +149,35 @@ _SEE_platform_dst(interp, ysec, ily, wstart)
 	SEE_number_t ysec;
 	int ily, wstart;
 {
-#if HAVE_MKTIME
+#if HAVE_MKTIME && HAVE_LOCALTIME
 	struct tm tm;
-	time_t dst_time, nodst_time;
+	time_t t, nodst_time;
 	time_t s = ysec / 1000.0;
-	int jday, mon, mday;
+	int year;
 
 	static unsigned int yearmap[2][7] = {
 	    { 2006, 2007, 2002, 2003, 2009, 1999, 2005 },
 	    { 1984, 1996, 2008, 1992, 2004, 1988, 2000 }
 	};
 
-	memset(&tm, 0, sizeof tm);
-	tm.tm_sec = s % 60;
-	tm.tm_min = (s / 60) % 60;
-	tm.tm_hour = (s / (60 * 60)) % 24;
-	jday = s / (60 * 60 * 24);
-
-        SEE_ASSERT(interp, jday >= 0);
-        SEE_ASSERT(interp, jday < 365 + ily);
-
-	if (jday < 31)           { mon =  0; mday = jday + 1; }
-	else if (jday < 59+ily)  { mon =  1; mday = jday - 30; }
-	else if (jday < 90+ily)  { mon =  2; mday = jday - 58 - ily; }
-	else if (jday < 120+ily) { mon =  3; mday = jday - 89 - ily; }
-	else if (jday < 151+ily) { mon =  4; mday = jday - 119 - ily; }
-	else if (jday < 181+ily) { mon =  5; mday = jday - 150 - ily; }
-	else if (jday < 212+ily) { mon =  6; mday = jday - 180 - ily; }
-	else if (jday < 243+ily) { mon =  7; mday = jday - 211 - ily; }
-	else if (jday < 273+ily) { mon =  8; mday = jday - 242 - ily; }
-	else if (jday < 304+ily) { mon =  9; mday = jday - 272 - ily; }
-	else if (jday < 334+ily) { mon = 10; mday = jday - 303 - ily; }
-	else                     { mon = 11; mday = jday - 334 - ily; }
-
-	tm.tm_mday = mday;
-	tm.tm_mon = mon;
-	tm.tm_year = yearmap[ily][wstart] - 1900;
-
-	tm.tm_isdst = -1;
-	dst_time = mktime(&tm);
+        SEE_ASSERT(interp, s >= 0);
+        SEE_ASSERT(interp, s < (365 + ily) * 60 * 60 * 24);
 
+	/* Seconds from the epoch to the instant in the equivalent year */
+	year = yearmap[ily][wstart];
+	t = ((year - 1970) * 365 + (year - 1969) / 4) * 
+	    (time_t)(60 * 60 * 24) + s;
+
+	/* Read its local time fields as standard time */
+# if HAVE_LOCALTIME_R
+	localtime_r(&t, &tm);
+# else
+	tm = *localtime(&t);			/* XXX not thread safe */
+# endif
 	tm.tm_isdst = 0;
 	nodst_time = mktime(&tm);
 
-	return (nodst_time - dst_time) * 1000;
+	return (nodst_time - t) * 1000;
 #else
  # warning "no mktime(); daylight savings adjustments have been disabled"
  	return 0;
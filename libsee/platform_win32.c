@@ -53,6 +53,13 @@ _SEE_platform_time(interp)
 
 }
 
+unsigned int
+_SEE_platform_tzstamp(interp)
+	struct SEE_interpreter *interp;
+{
+	return 0;
+}
+
 SEE_number_t
 _SEE_platform_tza(interp)
 	struct SEE_interpreter *interp;
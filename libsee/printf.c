@@ -323,6 +323,8 @@ _SEE_vsprintf(interp, s, fmt, ap)
 		} else /* fmtch == 'S' */ {
 		    struct SEE_string *ss = va_arg(ap, struct SEE_string *);
 		    static SEE_char_t snull[] = { '(','N','U','L','L',')' };
+		    if (ss)
+			SEE_STRING_FLATTEN(ss);
 		    slen = ss ? ss->length : (sizeof snull / sizeof snull[0]);
 		    sstr = ss ? ss->data : snull;
 		}
@@ -386,6 +388,7 @@ _SEE_vsprintf(interp, s, fmt, ap)
 		if (n >=  100) { OUTPUT('0' + (e/ 100)); e %=  100; }
 		if (n >=   10) { OUTPUT('0' + (e/  10)); e %=   10; }
 		OUTPUT('0' + e);
+		SEE_freedtoa((char *)str);
 	    }
 
 		break;
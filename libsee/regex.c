@@ -3,6 +3,9 @@
 #endif
 
 #include <string.h>
+#include <see/mem.h>
+#include <see/string.h>
+#include <see/interpreter.h>
 #include <see/system.h>
 #include <see/error.h>
 #include "regex.h"
@@ -11,6 +14,36 @@
 extern const struct SEE_regex_engine _SEE_pcre_regex_engine;
 #endif
 
+/*
+ * Compiled regexs are immutable once parsed, so RegExp objects made
+ * from the same source and flags can share them. Each interpreter keeps
+ * a small direct-mapped cache of recent compilations so that regular
+ * expression literals in loops, and string patterns passed to
+ * String.prototype.match() etc., are only parsed once.
+ */
+#define REGEX_CACHE_SIZE	64		/* entries; a power of 2 */
+
+struct regex_cache_entry {
+	const struct SEE_regex_engine *engine;
+	struct SEE_string *source;		/* unchanging copy */
+	int flags;
+	unsigned int hash;
+	struct regex *regex;
+};
+
+/* Returns a hash of the pattern text and flags */
+static unsigned int
+regex_hash(pattern, flags)
+	const struct SEE_string *pattern;
+	int flags;
+{
+	unsigned int i, h = 2166136261U;
+
+	for (i = 0; i < pattern->length; i++)
+		h = (h ^ pattern->data[i]) * 16777619U;
+	return (h ^ flags) * 16777619U;
+}
+
 /* Parses a source pattern and returns a regex structure for later use */
 struct regex *
 SEE_regex_parse(interp, pattern, flags)
@@ -18,8 +51,38 @@ SEE_regex_parse(interp, pattern, flags)
 	struct SEE_string *pattern;
 	int flags;
 {
+	struct regex_cache_entry *cache, *e;
+	struct regex *regex;
+	unsigned int h, i;
+
 	SEE_ASSERT(interp, interp->regex_engine != NULL);
-	return (*interp->regex_engine->parse)(interp, pattern, flags);
+
+	if (!interp->regex_cache) {
+		cache = SEE_NEW_ARRAY(interp, struct regex_cache_entry,
+		    REGEX_CACHE_SIZE);
+		for (i = 0; i < REGEX_CACHE_SIZE; i++)
+			cache[i].regex = NULL;
+		interp->regex_cache = cache;
+	}
+
+	SEE_STRING_FLATTEN(pattern);
+	h = regex_hash(pattern, flags);
+	e = (struct regex_cache_entry *)interp->regex_cache +
+		(h & (REGEX_CACHE_SIZE - 1));
+	if (e->regex && e->hash == h && e->flags == flags &&
+	    e->engine == interp->regex_engine &&
+	    SEE_string_cmp(e->source, pattern) == 0)
+		return e->regex;
+
+	regex = (*interp->regex_engine->parse)(interp, pattern, flags);
+
+	e->engine = interp->regex_engine;
+	e->source = (pattern->flags & SEE_STRING_FLAG_INTERNED)
+		? pattern : SEE_string_dup(interp, pattern);
+	e->flags = flags;
+	e->hash = h;
+	e->regex = regex;
+	return regex;
 }
 
 /* Returns the number of capture parentheses in the compiled regex */
@@ -53,6 +116,29 @@ SEE_regex_match(interp, regex, text, start, captures)
 	return (*regex->engine->match)(interp, regex, text, start, captures);
 }
 
+/*
+ * Finds the first index at or after start where the regex matches.
+ * Returns the index, or -1 if there is no match.
+ */
+int
+SEE_regex_search(interp, regex, text, start, captures)
+	struct SEE_interpreter *interp;
+	struct regex *regex;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *captures;
+{
+	unsigned int i;
+
+	if (regex->engine->search)
+		return (*regex->engine->search)(interp, regex, text, start, 
+		    captures);
+	for (i = start; i <= text->length; i++)
+		if ((*regex->engine->match)(interp, regex, text, i, captures))
+			return i;
+	return -1;
+}
+
 /* 
  * NOTE: Keep regex_name_list[] and regex_engine_list[] in sync!
  */
@@ -30,6 +30,9 @@ struct SEE_regex_engine {
     int (*match)(struct SEE_interpreter *interp, 
 	    struct regex *regex, struct SEE_string *text, 
 	    unsigned int start, struct capture *captures);
+    int (*search)(struct SEE_interpreter *interp,	/* optional */
+	    struct regex *regex, struct SEE_string *text, 
+	    unsigned int start, struct capture *captures);
 };
 
 extern const struct SEE_regex_engine _SEE_ecma_regex_engine;
@@ -42,6 +45,9 @@ int SEE_regex_get_flags(struct regex *regex);
 int SEE_regex_match(struct SEE_interpreter *interp,
 	struct regex *regex, struct SEE_string *text,
 	unsigned int start, struct capture *captures);
+int SEE_regex_search(struct SEE_interpreter *interp,
+	struct regex *regex, struct SEE_string *text,
+	unsigned int start, struct capture *captures);
 
 void SEE_regex_init(void);
 
@@ -52,5 +58,10 @@ int SEE_RegExp_match(struct SEE_interpreter *interp,
 	unsigned int start, struct capture *captures);
 int SEE_RegExp_count_captures(struct SEE_interpreter *interp,
 	struct SEE_object *regexp);
+int SEE_RegExp_search(struct SEE_interpreter *interp, 
+	struct SEE_object *regexp, struct SEE_string *text, 
+	unsigned int start, struct capture *captures);
+int SEE_RegExp_has_native_exec(struct SEE_interpreter *interp,
+	struct SEE_object *regexp);
 
 #endif /* _SEE_h_regex_ */
@@ -52,6 +52,7 @@
 #include "unicode.h"
 #include "stringdefs.h"
 #include "dprint.h"
+#include "snapshot.h"
 
 /*
  * Regular expression engine.
@@ -103,12 +104,13 @@ int SEE_regex_debug = 0;
 #define	OP_BACKREF	25		/* backreference match */
 
 struct charclassrange {
-	struct charclassrange *next;
 	SEE_unicode_t lo, hi;		/* simple range of chars, eg [a-z] */
 };
 
 struct charclass {
-	struct charclassrange *ranges;	/* linked list of character ranges */
+	struct charclassrange *ranges;	/* sorted array of character ranges */
+	unsigned int nranges;
+	struct SEE_growable grow;
 };
 
 struct ecma_regex {
@@ -122,10 +124,37 @@ struct ecma_regex {
 	unsigned int		cclen;
 	struct SEE_growable	ccgrow;
 	int			flags;
+
+	/* Filter on start positions, computed by optimize_regex() */
+	int			anchored;	/* only match at index 0 */
+	struct charclass       *first;		/* NULL means any char */
+	unsigned char	       *firstmap;	/* first, for ch < 256 */
+	int			firstchar;	/* sole first char, or -1 */
 };
 
 #define REGEX_CAST(aregex)   ((struct ecma_regex *)(aregex))
 
+static const struct snapshot_word charclass_words[] = {
+	SNAPSHOT_PTR(struct charclass, ranges),
+	SNAPSHOT_GROWABLE(struct charclass, grow),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(charclass_layout, struct charclass, charclass_words);
+
+static const struct snapshot_word ecma_regex_words[] = {
+	SNAPSHOT_PTR(struct ecma_regex, regex.engine),
+	SNAPSHOT_PTR(struct ecma_regex, regex.interp),
+	SNAPSHOT_PTR(struct ecma_regex, code),
+	SNAPSHOT_GROWABLE(struct ecma_regex, codegrow),
+	SNAPSHOT_PTR(struct ecma_regex, cc),
+	SNAPSHOT_GROWABLE(struct ecma_regex, ccgrow),
+	SNAPSHOT_PTR(struct ecma_regex, first),
+	SNAPSHOT_PTR(struct ecma_regex, firstmap),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(ecma_regex_layout, struct ecma_regex,
+	ecma_regex_words);
+
 struct recontext {
 	struct SEE_interpreter *interpreter;
 	struct SEE_input       *input;
@@ -232,10 +261,39 @@ cc_new(recontext)
 	struct charclass *c;
 
 	c = NEW1(struct charclass);
-	c->ranges = NULL;
+	SNAPSHOT_LAYOUT(recontext->interpreter, c, &charclass_layout);
+	SEE_GROW_INIT(recontext->interpreter, &c->grow, c->ranges, c->nranges);
+	/* Ranges hold no pointers, so must not be relocated (snapshot.c) */
+	c->grow.is_string = 1;
 	return c;
 }
 
+/* Insert the range [lo,hi) before the ith range of a charclass */
+static void
+cc_insert(recontext, c, i, lo, hi)
+	struct recontext *recontext;
+	struct charclass *c;
+	unsigned int i;
+	SEE_unicode_t lo, hi;
+{
+	SEE_grow_to(recontext->interpreter, &c->grow, c->nranges + 1);
+	memmove(&c->ranges[i + 1], &c->ranges[i], 
+	    (c->nranges - 1 - i) * sizeof c->ranges[0]);
+	c->ranges[i].lo = lo;
+	c->ranges[i].hi = hi;
+}
+
+/* Remove the ranges from i up to j of a charclass */
+static void
+cc_remove(c, i, j)
+	struct charclass *c;
+	unsigned int i, j;
+{
+	memmove(&c->ranges[i], &c->ranges[j], 
+	    (c->nranges - j) * sizeof c->ranges[0]);
+	c->nranges -= j - i;
+}
+
 /* Add a range to a charclass */
 static void
 cc_add_range(recontext, c, lo, hi)
@@ -243,30 +301,28 @@ cc_add_range(recontext, c, lo, hi)
 	struct charclass *c;
 	SEE_unicode_t lo, hi;
 {
-	struct charclassrange *s, *newr = NULL;
-	struct charclassrange **rp;
-	for (rp = &c->ranges; *rp; rp = &(*rp)->next)
-		if (lo <= (*rp)->hi)
+	struct charclassrange *r;
+	unsigned int i, j;
+
+	for (i = 0; i < c->nranges; i++)
+		if (lo <= c->ranges[i].hi)
 			break;
 
-	if (!*rp || hi < (*rp)->lo) {
-	    newr = NEW1(struct charclassrange);
-	    newr->lo = lo;
-	    newr->hi = hi;
-	    newr->next = *rp;
-	    *rp = newr;
-	} else {
-	    if (lo < (*rp)->lo)
-		(*rp)->lo = lo;
-	    if (hi > (*rp)->hi) {
-		(*rp)->hi = hi;
-		s = (*rp)->next;
-		while (s && s->hi < hi) 
-		    (*rp)->next = s = s->next;
-		if (s && s->lo <= hi) {
-		    (*rp)->hi = s->hi;
-		    (*rp)->next = s->next;
+	if (i == c->nranges || hi < c->ranges[i].lo)
+	    cc_insert(recontext, c, i, lo, hi);
+	else {
+	    r = &c->ranges[i];
+	    if (lo < r->lo)
+		r->lo = lo;
+	    if (hi > r->hi) {
+		r->hi = hi;
+		for (j = i + 1; j < c->nranges && c->ranges[j].hi < hi; j++)
+		    ;
+		if (j < c->nranges && c->ranges[j].lo <= hi) {
+		    r->hi = c->ranges[j].hi;
+		    j++;
 		}
+		cc_remove(c, i + 1, j);
 	    }
 	}
 }
@@ -277,33 +333,32 @@ cc_invert(recontext, c)
 	struct recontext *recontext;
 	struct charclass *c;
 {
-	struct charclassrange *l, *newlist, *r;
-	r = c->ranges;
-	if (r && r->lo == 0 && r->hi == ~0) {
-		c->ranges = NULL;
+	struct charclassrange *old;
+	unsigned int i, n;
+	SEE_unicode_t lo;
+
+	n = c->nranges;
+	if (n == 1 && c->ranges[0].lo == 0 && c->ranges[0].hi == ~0) {
+		c->nranges = 0;
 		return;
 	}
-	l = newlist = NEW1(struct charclassrange);
-	if (r && r->lo == 0) {
-		l->lo = r->hi;
-		r = r->next;
-	} else
-		l->lo = 0;
-	for (; r; r = r->next) {
-		l->hi = r->lo;
-		if (r->hi == ~0) {
-			l->next = NULL;
-			l = NULL;
-			break;
-		}
-		l = (l->next = NEW1(struct charclassrange));
-		l->lo = r->hi;
-	}
-	if (l) {
-	    l->hi = ~0;
-	    l->next = NULL;
+	old = SEE_STRING_ALLOCA(recontext->interpreter, 
+	    struct charclassrange, n + 1);
+	memcpy(old, c->ranges, n * sizeof c->ranges[0]);
+	c->nranges = 0;
+
+	i = 0;
+	if (n && old[0].lo == 0)
+		lo = old[i++].hi;
+	else
+		lo = 0;
+	for (; i < n; i++) {
+		cc_insert(recontext, c, c->nranges, lo, old[i].lo);
+		if (old[i].hi == ~0)
+			return;
+		lo = old[i].hi;
 	}
-	c->ranges = newlist;
+	cc_insert(recontext, c, c->nranges, lo, ~0);
 }
 
 static void
@@ -311,21 +366,19 @@ cc_add_cc(recontext, dst, src)
 	struct recontext *recontext;
 	struct charclass *dst, *src;
 {
-	struct charclassrange *r;
+	unsigned int i;
 
 	/* XXX very inefficient */
-	for (r = src->ranges; r; r = r->next)
-	    cc_add_range(recontext, dst, r->lo, r->hi);
+	for (i = 0; i < src->nranges; i++)
+	    cc_add_range(recontext, dst, src->ranges[i].lo, src->ranges[i].hi);
 }
 
 static int
 cc_issingle(c)
 	struct charclass *c;
 {
-	struct charclassrange *r = c->ranges;
-	return r != NULL &&
-	       r->next == NULL &&
-	       r->lo + 1 == r->hi;
+	return c->nranges == 1 &&
+	       c->ranges[0].lo + 1 == c->ranges[0].hi;
 }
 
 /* Return the number of characters in the class */
@@ -334,10 +387,10 @@ cc_count(c)
 	struct charclass *c;
 {
 	SEE_uint32_t count = 0;
-	struct charclassrange *r;
+	unsigned int i;
 
-	for (r = c->ranges; r; r = r->next)
-	    count += r->hi - r->lo;
+	for (i = 0; i < c->nranges; i++)
+	    count += c->ranges[i].hi - c->ranges[i].lo;
 	return count;
 }
 
@@ -346,20 +399,16 @@ static int
 cc_cmp(c1, c2)
 	struct charclass *c1, *c2;
 {
-	struct charclassrange *r1, *r2;
-
-	r1 = c1->ranges;
-	r2 = c2->ranges;
-	while (r1 && r2) {
-		if (r1->lo != r2->lo)
-			return r1->lo - r2->lo;
-		if (r1->hi != r2->hi)
-			return r1->hi - r2->hi;
-		r1 = r1->next;
-		r2 = r2->next;
+	unsigned int i;
+
+	for (i = 0; i < c1->nranges && i < c2->nranges; i++) {
+		if (c1->ranges[i].lo != c2->ranges[i].lo)
+			return c1->ranges[i].lo - c2->ranges[i].lo;
+		if (c1->ranges[i].hi != c2->ranges[i].hi)
+			return c1->ranges[i].hi - c2->ranges[i].hi;
 	}
-	if (r1) return 1;
-	if (r2) return -1;
+	if (i < c1->nranges) return 1;
+	if (i < c2->nranges) return -1;
 	return 0;
 }
 
@@ -388,12 +437,12 @@ cc_contains(c, ch)
 	struct charclass *c;
 	SEE_unicode_t ch;
 {
-	struct charclassrange *r;
+	unsigned int i;
 
-	for (r = c->ranges; r; r = r->next) {
-		if (ch >= r->lo && ch < r->hi)
+	for (i = 0; i < c->nranges; i++) {
+		if (ch >= c->ranges[i].lo && ch < c->ranges[i].hi)
 			return 1;
-		if (ch < r->lo)
+		if (ch < c->ranges[i].lo)
 			return 0;
 	}
 	return 0;
@@ -434,14 +483,14 @@ dprint_cc(c)
 	struct charclassrange *r;
 
 	dprintf("[");
-	if (c->ranges && c->ranges->lo == 0) {
+	if (c->nranges && c->ranges[0].lo == 0) {
 		dprintf("^");
-		for (r = c->ranges; r; r = r->next) {
-		    if (r->next) {
+		for (r = c->ranges; r < c->ranges + c->nranges; r++) {
+		    if (r + 1 < c->ranges + c->nranges) {
 			dprint_ch(r->hi);
-			if (r->next->lo != r->hi + 1) {
+			if (r[1].lo != r->hi + 1) {
 			    dprintf("-");
-			    dprint_ch(r->next->lo - 1);
+			    dprint_ch(r[1].lo - 1);
 			}
 		    } else if (r->hi != ~0) {
 			dprint_ch(r->hi);
@@ -450,7 +499,7 @@ dprint_cc(c)
 		    }
 		}
 	} else
-	    for (r = c->ranges; r; r = r->next) {
+	    for (r = c->ranges; r < c->ranges + c->nranges; r++) {
 		dprint_ch(r->lo);
 		if (r->hi != r->lo + 1) {
 		    dprintf("-");
@@ -476,6 +525,7 @@ regex_new(recontext)
 	struct ecma_regex *regex;
 
 	regex = NEW1(struct ecma_regex);
+	SNAPSHOT_LAYOUT(recontext->interpreter, regex, &ecma_regex_layout);
 	regex->ncaptures = 0;
 	regex->maxref = 0;
 	regex->ncounters = 0;
@@ -486,7 +536,12 @@ regex_new(recontext)
 	regex->codegrow.is_string = 1;
 	SEE_GROW_INIT(recontext->interpreter, &regex->ccgrow,
 	    regex->cc, regex->cclen);
+	regex->ccgrow.layout = &_SEE_snapshot_pointers;
 	regex->flags = 0;
+	regex->anchored = 0;
+	regex->first = NULL;
+	regex->firstmap = NULL;
+	regex->firstchar = -1;
 	return regex;
 }
 
@@ -1202,6 +1257,7 @@ CanonicalizeClass(recontext, c)
   struct charclass *ccanon;
   struct charclassrange *r;
   SEE_unicode_t ch, uch;
+  unsigned int i;
 
   if (cc_count(c) > (SEE_uint32_t)~0 / 2) {
 	CC_INVERT(c);
@@ -1215,13 +1271,13 @@ CanonicalizeClass(recontext, c)
    * there is no need to canonicalize because every uppercase character
    * is already there.
    */
-  for (r = c->ranges; r; r = r->next)
-      if (r->lo <= 'A' && r->hi > 0xf0000)
+  for (i = 0; i < c->nranges; i++)
+      if (c->ranges[i].lo <= 'A' && c->ranges[i].hi > 0xf0000)
 	return c;
 
   ccanon = CC_NEW();
-  for (r = c->ranges; r; r = r->next)
-     for (ch = r->lo; ch < r->hi; ch++) {
+  for (i = 0; i < c->nranges; i++)
+     for (r = &c->ranges[i], ch = r->lo; ch < r->hi; ch++) {
 	uch = UNICODE_TOUPPER(ch);
 	CC_ADDCHAR(ccanon, uch);
      }
@@ -1258,8 +1314,8 @@ CharacterClass_parse(recontext)
 		if (!cc_issingle(a)) SYNTAX_ERROR;
 		b = ClassAtom_parse(recontext);
 		if (!cc_issingle(b)) SYNTAX_ERROR;
-		if (b->ranges->lo < a->ranges->lo) SYNTAX_ERROR;
-		a->ranges->hi = b->ranges->hi;
+		if (b->ranges[0].lo < a->ranges[0].lo) SYNTAX_ERROR;
+		a->ranges[0].hi = b->ranges[0].hi;
 		/* free(b) */
 	    }
 out:	    CC_ADDCC(c, a);
@@ -1366,7 +1422,8 @@ dprint_regex(regex)
 		dprintf("\t\t%d = ", i);
 		dprint_cc(regex->cc[i]);
 		dprintf("\n\t\t  = { ");
-		for (r = regex->cc[i]->ranges; r; r = r->next)
+		for (r = regex->cc[i]->ranges; 
+		     r < regex->cc[i]->ranges + regex->cc[i]->nranges; r++)
 		   dprintf("%x:%x ", r->lo, r->hi);
 		dprintf("}\n");
 	}
@@ -1735,20 +1792,19 @@ pcode_run(interp, regex, addr, text, state)
 #undef index
 
 /*
- * Executes the regex on the text beginning at index.
+ * Runs the regex on the text at index, using the given state storage.
  * Returns true of a match was successful.
  */
 static int
-ecma_regex_match(interp, aregex, text, index, capture_ret)
+match_at(interp, regex, text, index, state, capture_ret)
 	struct SEE_interpreter *interp;
-	struct regex *aregex;
+	struct ecma_regex *regex;
 	struct SEE_string *text;
 	unsigned int index;
+	char *state;
 	struct capture *capture_ret;
 {
-	struct ecma_regex *regex = REGEX_CAST(aregex);
 	int i, success;
-	char *state = SEE_STRING_ALLOCA(interp, char, regex->statesz);
 	struct capture *capture = (struct capture *)state;
 
 #ifndef NDEBUG
@@ -1772,21 +1828,212 @@ ecma_regex_match(interp, aregex, text, index, capture_ret)
 	return success;
 }
 
+/*
+ * Executes the regex on the text beginning at index.
+ * Returns true of a match was successful.
+ */
+static int
+ecma_regex_match(interp, aregex, text, index, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *aregex;
+	struct SEE_string *text;
+	unsigned int index;
+	struct capture *capture_ret;
+{
+	struct ecma_regex *regex = REGEX_CAST(aregex);
+	char *state = SEE_STRING_ALLOCA(interp, char, regex->statesz);
+
+	return match_at(interp, regex, text, index, state, capture_ret);
+}
+
+/*
+ * Returns the first index at or after i where the text could begin
+ * a match, according to the regex's first character set; or the
+ * length of the text if there is no such place.
+ */
+static unsigned int
+next_candidate(regex, text, i)
+	struct ecma_regex *regex;
+	struct SEE_string *text;
+	unsigned int i;
+{
+	const SEE_char_t *data = text->data;
+	unsigned int len = text->length;
+	SEE_unicode_t ch;
+
+	if (regex->firstchar >= 0) {
+		while (i < len && data[i] != regex->firstchar)
+			i++;
+		return i;
+	}
+	for (; i < len; i++) {
+		ch = data[i];
+		if (ch < 256) {
+			if (regex->firstmap[ch >> 3] & (1 << (ch & 7)))
+				break;
+			continue;
+		}
+		/* Same decoding as OP_CHAR */
+		if ((ch & 0xfc00) == 0xd800 && i + 1 < len &&
+		    (data[i + 1] & 0xfc00) == 0xdc00)
+			ch = (((ch & 0x3ff) << 10) | (data[i + 1] & 0x3ff)) +
+			     0x10000;
+		if (cc_contains(regex->first, Canonicalize(regex, ch)))
+			break;
+	}
+	return i;
+}
+
+/*
+ * Finds the first index at or after start where the regex matches,
+ * skipping indicies where no match can begin.
+ * Returns the index, or -1 if there is no match.
+ */
+static int
+ecma_regex_search(interp, aregex, text, start, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *aregex;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *capture_ret;
+{
+	struct ecma_regex *regex = REGEX_CAST(aregex);
+	char *state = SEE_STRING_ALLOCA(interp, char, regex->statesz);
+	unsigned int i;
+
+	if (regex->anchored)
+		return start == 0 && 
+		    match_at(interp, regex, text, 0, state, capture_ret)
+		    ? 0 : -1;
+	for (i = start; i <= text->length; i++) {
+		if (regex->first) {
+			i = next_candidate(regex, text, i);
+			if (i == text->length)
+				break;		/* a char must be consumed */
+		}
+		if (match_at(interp, regex, text, i, state, capture_ret))
+			return i;
+	}
+	return -1;
+}
+
 /*------------------------------------------------------------
  * optimizer
  */
 
+/*
+ * Adds to the charclass first every character that could be the first
+ * one consumed by running the p-code from addr. Both arms of every
+ * branch are followed, and addresses already seen are not revisited.
+ * Returns false if the p-code could succeed without consuming any
+ * character, or if the first character is too hard to determine
+ * (as with lookaheads and backreferences).
+ */
+static int
+first_chars(recontext, addr, first, seen)
+	struct recontext *recontext;
+	unsigned int addr;
+	struct charclass *first;
+	unsigned char *seen;
+{
+	struct ecma_regex *regex = recontext->regex;
+	unsigned char *code = regex->code;
+
+	for (;;) {
+	    if (seen[addr])
+		return 1;
+	    seen[addr] = 1;
+	    switch (code[addr]) {
+	    case OP_FAIL:
+		return 1;
+	    case OP_CHAR:
+		CC_ADDCC(first, regex->cc[CODE_MAKEI(code, addr + 1)]);
+		return 1;
+	    case OP_BOL:	case OP_EOL:	case OP_BRK:	case OP_NBRK:
+		addr += 1;
+		break;
+	    case OP_ZERO:	case OP_START:	case OP_END:	case OP_MARK:
+	    case OP_FDIST:
+		addr += 1 + CODE_SZI;
+		break;
+	    case OP_REACH:	case OP_NREACH:	case OP_UNDEF:
+		addr += 1 + 2 * CODE_SZI;
+		break;
+	    case OP_RDIST:
+		addr += 1 + 3 * CODE_SZI;
+		break;
+	    case OP_MNEXT:	case OP_RNEXT:
+		if (!first_chars(recontext, 
+		    CODE_MAKEA(code, addr + 1 + 2 * CODE_SZI), first, seen))
+			return 0;
+		addr += 1 + 2 * CODE_SZI + CODE_SZA;
+		break;
+	    case OP_GOTO:
+		addr = CODE_MAKEA(code, addr + 1);
+		break;
+	    case OP_GS:		case OP_NS:	case OP_GF:	case OP_NF:
+		if (!first_chars(recontext, CODE_MAKEA(code, addr + 1),
+		    first, seen))
+			return 0;
+		addr += 1 + CODE_SZA;
+		break;
+	    default:		/* OP_SUCCEED, OP_AS, OP_AF, OP_BACKREF */
+		return 0;
+	    }
+	}
+}
+
+/*
+ * Works out where in a text a match could begin, so that searches
+ * need not run the p-code at every index: either only at the start
+ * of the text, or only at characters in a 'first' set.
+ */
 static void
 optimize_regex(interp, regex)
 	struct SEE_interpreter *interp;
 	struct ecma_regex *regex;
 {
-	/*
-	 * (nothing here yet)
-	 *
-	 * possible optimisations include branch short-cuts,
-	 * and compiling the p-code to native machine instructions.
-	 */
+	struct recontext recontext_storage, *recontext = &recontext_storage;
+	struct charclass *first;
+	unsigned char *seen;
+	unsigned int addr, i, all;
+
+	recontext->interpreter = interp;
+	recontext->input = NULL;
+	recontext->regex = regex;
+
+	/* A leading '^' outside of multiline mode anchors the match */
+	addr = 0;
+	while (regex->code[addr] == OP_START || regex->code[addr] == OP_MARK ||
+	       regex->code[addr] == OP_ZERO)
+		addr += 1 + CODE_SZI;
+	if (regex->code[addr] == OP_BOL && !(regex->flags & FLAG_MULTILINE)) {
+		regex->anchored = 1;
+		return;
+	}
+
+	seen = SEE_STRING_ALLOCA(interp, unsigned char, regex->codelen);
+	memset(seen, 0, regex->codelen);
+	first = CC_NEW();
+	if (!first_chars(recontext, 0, first, seen))
+		return;
+
+	/* A bitmap, kept apart so that it is not scanned for pointers */
+	regex->firstmap = SEE_NEW_STRING_ARRAY(interp, unsigned char, 256 / 8);
+	all = 1;
+	for (i = 0; i < 256; i++)
+		if (cc_contains(first, Canonicalize(regex, i)))
+			regex->firstmap[i >> 3] |= 1 << (i & 7);
+		else {
+			regex->firstmap[i >> 3] &= ~(1 << (i & 7));
+			all = 0;
+		}
+	if (all)
+		return;			/* no better than trying everywhere */
+	regex->first = first;
+	if (cc_issingle(first) && !(regex->flags & FLAG_IGNORECASE) &&
+	    first->ranges[0].lo < 0xd800)
+		regex->firstchar = first->ranges[0].lo;
 }
 
 const struct SEE_regex_engine _SEE_ecma_regex_engine = {
@@ -1794,5 +2041,6 @@ const struct SEE_regex_engine _SEE_ecma_regex_engine = {
 	ecma_regex_parse,
 	ecma_regex_count_captures,
 	ecma_regex_get_flags,
-	ecma_regex_match
+	ecma_regex_match,
+	ecma_regex_search
 };
@@ -55,6 +55,7 @@
 
 #include "regex.h"
 #include "dprint.h"
+#include "snapshot.h"
 
 #ifndef NDEBUG
 int SEE_regex_debug;
@@ -73,6 +74,26 @@ struct regex_pcre {
 	char *		text_data;
 };
 
+static const struct snapshot_word regex_pcre_words[] = {
+	SNAPSHOT_PTR(struct regex_pcre, regex.engine),
+	SNAPSHOT_PTR(struct regex_pcre, regex.interp),
+	SNAPSHOT_PTR(struct regex_pcre, pcre),
+	SNAPSHOT_PTR(struct regex_pcre, pcre_extra),
+	SNAPSHOT_PTR(struct regex_pcre, text_string),
+	SNAPSHOT_PTR(struct regex_pcre, text_data),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(regex_pcre_layout, struct regex_pcre,
+	regex_pcre_words);
+
+static const struct snapshot_word pcre_extra_words[] = {
+	SNAPSHOT_PTR(pcre_extra, study_data),
+	SNAPSHOT_PTR(pcre_extra, callout_data),
+	SNAPSHOT_PTR(pcre_extra, tables),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(pcre_extra_layout, pcre_extra, pcre_extra_words);
+
 /* Cast from struct regex to struct regex_pcre */
 #define REGEX_CAST(r) ((struct regex_pcre *)(r))
 
@@ -90,7 +111,8 @@ const struct SEE_regex_engine _SEE_pcre_regex_engine = {
 	regex_pcre_parse,
 	regex_pcre_count_captures,
 	regex_pcre_get_flags,
-	regex_pcre_match
+	regex_pcre_match,
+	NULL				/* no search */
 };
 
 /* Called by PCRE to allocate memory */
@@ -233,12 +255,14 @@ regex_pcre_parse(interp, pattern, flags)
 
 	if (!pcre_extra) {
 	    pcre_extra = SEE_NEW(interp, struct pcre_extra);
+	    SNAPSHOT_LAYOUT(interp, pcre_extra, &pcre_extra_layout);
 	    pcre_extra->flags = 0;
 	}
 
 	/* Allocate a module-private regex structure */
 	regex = SEE_NEW_FINALIZE(interp, struct regex_pcre, 
 		regex_pcre_finalize, 0);
+	SNAPSHOT_LAYOUT(interp, regex, &regex_pcre_layout);
 	regex->regex.engine = &_SEE_pcre_regex_engine;
 	regex->regex.interp = interp;
 	regex->flags = flags;
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2007
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <see/mem.h>
+#include <see/string.h>
+#include <see/interpreter.h>
+
+#include "shape.h"
+#include "snapshot.h"
+
+/*
+ * Shapes of native objects using the small property array form a tree
+ * rooted at the empty shape. Each edge is a transition that adds one
+ * property with given attributes. The edges are kept in a per-interpreter
+ * hash table keyed on (parent, name, attr), so that objects built up
+ * the same way arrive at the same shape.
+ */
+
+struct shape_tab {
+	struct SEE_shape root;
+	struct SEE_shape **buckets;	/* [size] */
+	unsigned int size, count;
+};
+
+#define SHAPE_TAB_INITIAL	64
+
+static const struct snapshot_word shape_words[] = {
+	SNAPSHOT_PTR(struct SEE_shape, parent),
+	SNAPSHOT_PTR(struct SEE_shape, name),
+	SNAPSHOT_PTR(struct SEE_shape, next),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(shape_layout, struct SEE_shape, shape_words);
+
+static const struct snapshot_word shape_tab_words[] = {
+	SNAPSHOT_PTR(struct shape_tab, root.parent),
+	SNAPSHOT_PTR(struct shape_tab, root.name),
+	SNAPSHOT_PTR(struct shape_tab, root.next),
+	SNAPSHOT_PTR(struct shape_tab, buckets),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(shape_tab_layout, struct shape_tab, shape_tab_words);
+
+static unsigned int transition_hash(struct SEE_shape *,
+	struct SEE_string *, int);
+static void shape_tab_grow(struct SEE_interpreter *, struct shape_tab *);
+
+/* Returns a hash for a transition. Caller masks the result. */
+static unsigned int
+transition_hash(parent, name, attr)
+	struct SEE_shape *parent;
+	struct SEE_string *name;
+	int attr;
+{
+	unsigned int h;
+
+	/* Not addresses, so that copied tables stay valid (snapshot.c) */
+	h = parent->hash * 31 + name->hash + attr;
+	h *= 0x9e3779b1;
+	return h ^ (h >> 16);
+}
+
+/* Creates the shape table of a new interpreter */
+void
+_SEE_shape_init(interp)
+	struct SEE_interpreter *interp;
+{
+	struct shape_tab *tab;
+	unsigned int i;
+
+	tab = SEE_NEW(interp, struct shape_tab);
+	SNAPSHOT_LAYOUT(interp, tab, &shape_tab_layout);
+	tab->root.parent = NULL;
+	tab->root.name = NULL;
+	tab->root.attr = 0;
+	tab->root.nprops = 0;
+	tab->root.hash = 0;
+	tab->root.next = NULL;
+	tab->size = SHAPE_TAB_INITIAL;
+	tab->count = 0;
+	tab->buckets = SEE_NEW_ARRAY(interp, struct SEE_shape *, tab->size);
+	SNAPSHOT_LAYOUT(interp, tab->buckets, &_SEE_snapshot_pointers);
+	for (i = 0; i < tab->size; i++)
+		tab->buckets[i] = NULL;
+	interp->shape_tab = tab;
+}
+
+/* Returns the shape of objects with no properties */
+struct SEE_shape *
+_SEE_shape_root(interp)
+	struct SEE_interpreter *interp;
+{
+	return &((struct shape_tab *)interp->shape_tab)->root;
+}
+
+/* Doubles the number of buckets in the transition table */
+static void
+shape_tab_grow(interp, tab)
+	struct SEE_interpreter *interp;
+	struct shape_tab *tab;
+{
+	struct SEE_shape **buckets, *s, *next;
+	unsigned int i, h, size = tab->size * 2;
+
+	buckets = SEE_NEW_ARRAY(interp, struct SEE_shape *, size);
+	SNAPSHOT_LAYOUT(interp, buckets, &_SEE_snapshot_pointers);
+	for (i = 0; i < size; i++)
+		buckets[i] = NULL;
+	for (i = 0; i < tab->size; i++)
+		for (s = tab->buckets[i]; s; s = next) {
+			next = s->next;
+			h = transition_hash(s->parent, s->name, s->attr) &
+			    (size - 1);
+			s->next = buckets[h];
+			buckets[h] = s;
+		}
+	SEE_free(interp, (void **)&tab->buckets);
+	tab->buckets = buckets;
+	tab->size = size;
+}
+
+/*
+ * Returns the shape reached by adding a property to an object
+ * of the parent shape. The name must be interned.
+ */
+struct SEE_shape *
+_SEE_shape_add(interp, parent, name, attr)
+	struct SEE_interpreter *interp;
+	struct SEE_shape *parent;
+	struct SEE_string *name;
+	int attr;
+{
+	struct shape_tab *tab = (struct shape_tab *)interp->shape_tab;
+	struct SEE_shape *s;
+	unsigned int h;
+
+	h = transition_hash(parent, name, attr) & (tab->size - 1);
+	for (s = tab->buckets[h]; s; s = s->next)
+		if (s->parent == parent && s->name == name && s->attr == attr)
+			return s;
+
+	if ((tab->count + 1) * 4 > tab->size * 3) {
+		shape_tab_grow(interp, tab);
+		h = transition_hash(parent, name, attr) & (tab->size - 1);
+	}
+	s = SEE_NEW(interp, struct SEE_shape);
+	SNAPSHOT_LAYOUT(interp, s, &shape_layout);
+	s->parent = parent;
+	s->name = name;
+	s->attr = attr;
+	s->nprops = parent->nprops + 1;
+	s->hash = transition_hash(parent, name, attr);
+	s->next = tab->buckets[h];
+	tab->buckets[h] = s;
+	tab->count++;
+	return s;
+}
+
+/*
+ * Returns a new shape that is not shared with any other object.
+ * These are given to objects whose properties are in a hash table.
+ */
+struct SEE_shape *
+_SEE_shape_dictionary(interp)
+	struct SEE_interpreter *interp;
+{
+	struct SEE_shape *s;
+
+	s = SEE_NEW(interp, struct SEE_shape);
+	SNAPSHOT_LAYOUT(interp, s, &shape_layout);
+	s->parent = NULL;
+	s->name = NULL;
+	s->attr = 0;
+	s->nprops = 0;
+	s->hash = 0;
+	s->next = NULL;
+	return s;
+}
+
+/* Empties an inline cache */
+void
+_SEE_shape_cache_init(cache)
+	struct shape_cache *cache;
+{
+	unsigned int i;
+
+	cache->name = NULL;
+	cache->next = 0;
+	cache->disabled = 0;
+	for (i = 0; i < SHAPE_CACHE_WAYS; i++)
+		cache->entry[i].shape = NULL;
+}
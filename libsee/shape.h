@@ -0,0 +1,67 @@
+/* Copyright (c) 2007, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_shape_
+#define _SEE_h_shape_
+
+struct SEE_interpreter;
+struct SEE_string;
+struct SEE_object;
+struct SEE_value;
+struct SEE_native;
+
+/*
+ * A shape describes the layout of a native object's own properties:
+ * their names, attributes and the slots that hold them. Native objects
+ * that were given the same properties in the same order share a shape,
+ * so that an inline cache keyed on a shape can find a property's slot
+ * without searching for it. Objects that have switched to a hash table
+ * get a shape of their own that is discarded whenever the table changes.
+ */
+struct SEE_shape {
+	struct SEE_shape *parent;	/* shape before the last property */
+	struct SEE_string *name;	/* name of the last property */
+	int attr;			/* attributes of the last property */
+	unsigned int nprops;		/* number of properties */
+	unsigned int hash;		/* location-independent hash */
+	struct SEE_shape *next;		/* transition table chain */
+};
+
+void _SEE_shape_init(struct SEE_interpreter *interp);
+struct SEE_shape *_SEE_shape_root(struct SEE_interpreter *interp);
+struct SEE_shape *_SEE_shape_add(struct SEE_interpreter *interp,
+	struct SEE_shape *parent, struct SEE_string *name, int attr);
+struct SEE_shape *_SEE_shape_dictionary(struct SEE_interpreter *interp);
+
+/*
+ * An inline cache remembers where a property access instruction found
+ * its property for the last few receiver shapes. A property found on a
+ * prototype is only used while the receiver's prototype chain still
+ * leads to the same objects with the same shapes.
+ */
+#define SHAPE_CACHE_WAYS	4
+
+struct shape_cache {
+	struct SEE_string *name;	/* interned property name */
+	unsigned int next;		/* next entry to replace */
+	int disabled;			/* seen more than one name */
+	struct shape_cache_entry {
+	    struct SEE_shape *shape;	/* receiver shape; NULL if unused */
+	    unsigned int slot;		/* property slot in its holder */
+	    struct SEE_native *mid;	/* prototype between, or NULL */
+	    struct SEE_shape *mid_shape;
+	    struct SEE_native *holder;	/* prototype holding it, or NULL */
+	    struct SEE_shape *holder_shape;
+	} entry[SHAPE_CACHE_WAYS];
+};
+
+void _SEE_shape_cache_init(struct shape_cache *cache);
+
+/* [[Get]] and [[Put]] through an inline cache; see native.c */
+void _SEE_native_get_cached(struct SEE_interpreter *interp,
+	struct SEE_object *o, struct SEE_string *ip, struct SEE_value *res,
+	struct shape_cache *cache);
+void _SEE_native_put_cached(struct SEE_interpreter *interp,
+	struct SEE_object *o, struct SEE_string *ip, struct SEE_value *val,
+	struct shape_cache *cache);
+
+#endif /* _SEE_h_shape_ */
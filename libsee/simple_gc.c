@@ -13,7 +13,7 @@
  * 3. Neither the name of David Leonard nor the names of its contributors
  *    may be used to endorse or promote products derived from this software
  *    without specific prior written permission.
- * 
+ *
  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
  * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
  * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
@@ -29,30 +29,57 @@
  */
 
 /*
- * A simple mark-and-sweep GC that uses an AVL-tree and the system malloc.
- * Currently contains intel/unix-specific specific parts, that could
- * be replaced for other systems.
+ * A conservative mark-and-sweep collector with an optional young
+ * generation. It backs the SEE_system memory hooks when a host calls
+ * SEE_gc_install().
+ *
+ * Every interpreter gets a heap of its own, created on its first
+ * allocation. A heap is only ever used by one thread at a time (the
+ * thread running its interpreter) and so needs no locking. The state
+ * shared between heaps is the table of which heap owns each page, which
+ * the write fault handler reads without the lock, and the list of freed
+ * heaps kept for reuse.
+ *
+ * Memory is taken from the system in aligned pages of SGC_PAGE_SIZE
+ * bytes. A page holds objects of a single size class and kind (scanned,
+ * or atomic for strings); objects too large for any class get a run of
+ * pages of their own. The allocated and marked bits of each page are
+ * kept in bitmaps outside the page, so that finding the object a word
+ * points into takes a hash lookup of the word's page number and a
+ * division, and sweeping a page is a few word-wide ANDs.
+ *
+ * In a generational heap, the mark bits are left set after each
+ * collection: objects that survived are "old", and objects allocated
+ * since are "young". A minor collection only traces young objects,
+ * from the roots and from the remembered set. The remembered set is
+ * the set of dirty pages: pages of scanned objects are write-protected
+ * once a collection ends, and the first write to one takes a fault
+ * that unprotects it and marks it dirty. A major collection clears all
+ * marks and traces the whole heap.
  *
+ * sgc_heap_new - Creates an empty heap.
+ * sgc_heap_free - Runs all finalizers and releases the heap.
  * sgc_malloc - Allocates memory that will be scanned for pointers.
  * sgc_malloc_atomic - Allocates memory with content that wont be scanned.
  * sgc_malloc_finalizer - Allocates scannable with finalizer function
  *                        that will be called when collected.
- * sgc_atexit - Runs all finalizers and frees all objects.
- * sgc_collect - Perform a collection now, instead of waiting until 
- *			malloc() returns NULL.
+ * sgc_free - Releases memory known to be unreachable.
+ * sgc_collect - Performs a minor or major collection now.
  * sgc_add_root - Add foreign memory to scan.
  * sgc_remove_root - Remove memory previously added with sgc_add_root().
- *
- * TODO:
- *   stack and BSS detection for different platforms
+ * sgc_set_stack_base - Sets the stack limit to scan up to.
  */
 
-#ifdef TEST
-# include <stdio.h>
-# include <unistd.h>
+#if HAVE_CONFIG_H
+# include <config.h>
 #endif
 
-#if STDC_INCLUDES
+#if HAVE_PTHREAD_GETATTR_NP && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE		/* for pthread_getattr_np() */
+#endif
+
+#if STDC_HEADERS
+# include <stdio.h>
 # include <stdlib.h>
 #endif
 
@@ -60,474 +87,1464 @@
 # include <string.h>
 #endif
 
-#include <see/try.h>
+#include <setjmp.h>
+
+#if HAVE_SIGNAL_H
+# include <signal.h>
+#endif
+
+#if HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_MUTEX_LOCK
+# include <pthread.h>
+#endif
+
+#include <see/mem.h>
+#include <see/system.h>
+#include <see/interpreter.h>
+
+#include "dprint.h"
 #include "simple_gc.h"
 
-#if TEST
-# define IS_ROOT	,1
-# define IS_NOT_ROOT	,0
-# define TPRINTF(fmt, args...)	fprintf(stderr, fmt , ## args)
+#if !defined(MAP_ANON) && defined(MAP_ANONYMOUS)
+# define MAP_ANON MAP_ANONYMOUS
+#endif
+
+/* Write protection is needed to keep a remembered set */
+#if HAVE_MMAP && HAVE_MPROTECT && HAVE_SIGACTION && defined(MAP_ANON)
+# define SGC_WRITE_BARRIER 1
+#endif
+
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_MUTEX_LOCK
+static pthread_mutex_t sgc_lock = PTHREAD_MUTEX_INITIALIZER;
+# define LOCK()		pthread_mutex_lock(&sgc_lock)
+# define UNLOCK()	pthread_mutex_unlock(&sgc_lock)
+#else
+# define LOCK()		/* nothing */
+# define UNLOCK()	/* nothing */
+#endif
+
+/*
+ * Stores and loads of data that the fault handler reads without the
+ * lock. A store publishes everything written before it to the thread
+ * that loads the stored value.
+ */
+#if __GNUC__
+# define PUBLISH(lv, v)	__atomic_store_n(&(lv), (v), __ATOMIC_RELEASE)
+# define FETCH(lv)	__atomic_load_n(&(lv), __ATOMIC_ACQUIRE)
+#else
+# define PUBLISH(lv, v)	((lv) = (v))
+# define FETCH(lv)	(lv)
+#endif
+
+#ifndef NDEBUG
+int SEE_gc_debug = 0;
+#endif
+
+#define SGC_PAGE_SHIFT	16
+#define SGC_PAGE_SIZE	(1 << SGC_PAGE_SHIFT)
+#define PAGENO(p)	((SEE_size_t)(p) >> SGC_PAGE_SHIFT)
+
+/* All objects are a multiple of the granule, and aligned to it */
+#define GRANULE		16
+#define SMALL_MAX	8192		/* largest object kept in a class */
+
+/* Collection policy */
+#define SGC_MIN_TRIGGER	(1024 * 1024)	/* least allocation between GCs */
+#define SGC_YOUNG_SIZE	(4 * 1024 * 1024)	/* allocation between minor GCs */
+#define SGC_KEEP_EMPTY	8		/* empty pages kept after a sweep */
+
+typedef unsigned long sgc_word_t;
+#define WORD_BITS	(sizeof (sgc_word_t) * 8)
+#define BITMAP_WORDS	(SGC_PAGE_SIZE / GRANULE / WORD_BITS)
+#define NWORDS(pg)	(((pg)->nobj + WORD_BITS - 1) / WORD_BITS)
+#define ALL_ONES	(~(sgc_word_t)0)
+#define BIT(i)		((sgc_word_t)1 << ((i) % WORD_BITS))
+
+#if __GNUC__
+# define CTZ(w)		__builtin_ctzl(w)
+# define POPCOUNT(w)	__builtin_popcountl(w)
 #else
-# define IS_ROOT		/* nothing */
-# define IS_NOT_ROOT		/* nothing */
-# define TPRINTF(fmt, args...)	/* nothing */
+static int ctz(sgc_word_t);
+static int popcount(sgc_word_t);
+# define CTZ(w)		ctz(w)
+# define POPCOUNT(w)	popcount(w)
 #endif
 
+/* Object kinds */
+#define KIND_SCAN	0		/* may contain pointers */
+#define KIND_ATOMIC	1		/* never contains pointers */
+
+/* Page state flags */
+#define PAGE_LARGE	0x01		/* holds one large object */
+#define PAGE_PROTECTED	0x02		/* write-protected; not dirty */
+#define PAGE_DIRTY	0x04		/* may hold old-to-young pointers */
+#define PAGE_YOUNG	0x08		/* allocated from since last GC */
+#define PAGE_AVAIL	0x10		/* on the avail list of its class */
+#define PAGE_FINAL	0x20		/* has held finalizable objects */
+
+/* Descriptor of a page, or of a run of pages holding a large object */
+struct page {
+	char *base;			/* address of first object */
+	void *raw;			/* storage to release */
+	SEE_size_t size;		/* bytes per object */
+	unsigned int nobj;		/* objects that fit */
+	unsigned int npages;		/* pages spanned */
+	unsigned int nlive;		/* objects allocated */
+	unsigned int hint;		/* first bitmap word with a free bit */
+	unsigned char kind;		/* KIND_SCAN or KIND_ATOMIC */
+	unsigned char cls;		/* size class */
+	unsigned char state;		/* PAGE_* flags */
+	struct page *next;		/* next page of the heap */
+	struct page *avail;		/* next page of class with free objects */
+	sgc_word_t alloc[BITMAP_WORDS];	/* allocated objects */
+	sgc_word_t mark[BITMAP_WORDS];	/* marked (or old) objects */
+};
+
+/*
+ * Open-addressed hash table mapping page numbers to descriptors.
+ * Tables replaced by a larger one are kept with the heap, even after
+ * it is freed, so that the fault handler never reads released memory.
+ */
+struct pagetab {
+	unsigned int size;		/* power of two */
+	unsigned int count;
+	struct pagetab *retired;	/* older, smaller tables */
+	struct pageslot {
+		SEE_size_t pageno;
+		struct page *page;
+	} slot[1];
+};
+#define HASH(pn)	((unsigned int)(pn) * 2654435761U)
+
+/*
+ * Open-addressed hash table mapping the page numbers of generational
+ * heaps to the heap that owns them, so that the fault handler only
+ * searches the page table of the owner. It is changed with the lock
+ * held and read by the handler without it: a slot's page number is
+ * published after its heap and then never changes, a released page
+ * has its heap cleared, and replaced tables are kept forever.
+ * Page number 0 marks an empty slot.
+ */
+struct ownertab {
+	unsigned int size;		/* power of two */
+	unsigned int used;		/* slots with a page number */
+	struct ownertab *retired;	/* older tables */
+	struct ownerslot {
+		SEE_size_t pageno;
+		struct sgc_heap *heap;
+	} slot[1];
+};
+
 /* Linked list of roots. A root is a memory segment that is always reachable */
 struct root {
 	char *base;
-	unsigned int extent;
+	SEE_size_t extent;
 	struct root *next;
 };
 
-/* Binary tree of allocations. Allocations are collectable memory segments */
-struct allocation {
-	struct allocation *side[2];
-	unsigned int state;	/* mark state and AVL flags */
-	unsigned int extent;	/* sizeof of struct + allocation length */
-	void (*finalizer)(void *);
-	/* char data[]; */
+/* An object with a finalizer */
+struct final {
+	char *obj;
+	void (*fn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
 };
 
-/* State flags */
-#define STATE_AVL       3		/* AVL balance property of the node */
-#define  LEFT	           0
-#define  RIGHT	           1
-#define  BALANCED          2
-#define STATE_MARKED	4		/* Marked during scan() */
-#define STATE_ATOMIC	8		/* Guaranteed not to contain pointers */
-
-#define IS_MARKED(a)	 ((a)->state & STATE_MARKED)
-#define SET_MARK(a)	 (a)->state |= STATE_MARKED
-#define CLEAR_MARK(a)	 (a)->state &= ~STATE_MARKED
-#define IS_ATOMIC(a)	 ((a)->state & STATE_ATOMIC)
-#define GET_BALANCE(a)	 ((a)->state & STATE_AVL) 
-#define SET_BALANCE(a,b) (a)->state = ((a)->state & ~STATE_AVL) | (b)
-
-/* The allocation data immediately follows the allocation */
-#define ALLOCATION_BASE(a) ((char *)(a) + sizeof (struct allocation))
-#define ALLOCATION_LENGTH(a) ((a)->extent - sizeof (struct allocation))
-#define ALLOCATION_END(a) ((char *)(a) + (a)->extent) 
-
-#define ALIGN(a)	((a) & ~(sizeof (void *) - 1))
-
-static void sweep(void);
-static void sweep_sub(struct allocation *);
-static void run_finalizers(void);
-static void machdep_scan(void);
-#if TEST
-static void scan(char *base, unsigned int len, unsigned int isroot);
-#else
-static void scan(char *base, unsigned int len);
-#endif
-static void allocation_insert(struct allocation *);
-static void allocation_free(struct allocation *);
-static void *allocate(unsigned int sz, int state, void (*finalizer)(void *));
-
-static struct {
-	struct allocation *allocation_root;	/* allocated objects */
-	struct allocation *allocation_finalizing; /* objects pending finalizer */
-	char *allocation_min;
-	char *allocation_max;
-	unsigned int allocation_total_size;
-	unsigned int allocation_total_count;
-	unsigned int collect_at;		/* collect at this size */
-	struct root *user_roots;
-} gc;
+/* An object on the mark stack, whose contents are still to be scanned */
+struct grey {
+	char *base;
+	SEE_size_t extent;
+};
+
+/* Object sizes of the size classes */
+static const unsigned short class_size[] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+	320, 384, 448, 512, 640, 768, 896, 1024,
+	1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+	5120, 6144, 7168, 8192
+};
+#define NCLASSES	(sizeof class_size / sizeof class_size[0])
+
+struct sgc_heap {
+	int flags;			/* SGC_* */
+	struct SEE_interpreter *owner;	/* passed to finalizers */
+	struct page *pages;		/* all pages */
+	struct page *avail[2][NCLASSES];	/* pages with free objects */
+	struct page *spare;		/* unused descriptors */
+	struct pagetab *tab;		/* page number -> descriptor */
+	char *lo, *hi;			/* bounds of all pages */
+	struct root *roots;
+	char *stack_base;		/* set by sgc_set_stack_base() */
+#if HAVE_PTHREAD_GETATTR_NP && HAVE_PTHREAD_MUTEX_LOCK
+	pthread_t stack_thread;		/* thread whose stack top is known */
+	char *stack_top;
+	int stack_known;
+#endif
+	struct final *finals;		/* objects with finalizers */
+	unsigned int nfinals, maxfinals;
+	struct grey *grey;		/* the mark stack */
+	unsigned int ngrey, maxgrey;
+	int overflow;			/* mark stack could not grow */
+	int collecting;
+	int next_major;			/* next collection should be major */
+	SEE_size_t bytes;		/* bytes in allocated objects */
+	SEE_size_t since;		/* bytes allocated since last GC */
+	SEE_size_t trigger;		/* collect when since reaches this */
+	SEE_size_t major_at;		/* go major when bytes reaches this */
+	SEE_size_t live;		/* bytes after the last collection */
+	SEE_size_t heap_size;		/* bytes in pages */
+	unsigned long collections, minor_collections;
+	struct sgc_heap *next;		/* list of freed heaps */
+};
+
+/* Maps a size in granules to its class, filled in by the first heap */
+static unsigned char size_class[SMALL_MAX / GRANULE + 1];
+static int size_class_ready;
 
 /*
- * Inserts a new allocation into the AVL binary tree. Takes O(log(n))
- * but is not recursive, and uses constant stack space.
+ * Freed heaps, kept for reuse with their page tables and descriptors
+ * because the fault handler may still be reading them
+ */
+static struct sgc_heap *freed_heaps;
+
+#if SGC_WRITE_BARRIER
+static struct ownertab *owners;		/* searched by the fault handler */
+#endif
+
+static void *chunk_alloc(unsigned int, void **);
+static void chunk_free(void *, void *, unsigned int);
+static struct page *page_lookup(struct sgc_heap *, char *);
+static int pagetab_insert(struct sgc_heap *, SEE_size_t, struct page *);
+static void pagetab_remove(struct sgc_heap *, SEE_size_t);
+static struct page *page_new(struct sgc_heap *, int, int, unsigned int);
+static void page_release(struct sgc_heap *, struct page *);
+static void page_protect(struct page *);
+static void page_unprotect(struct page *);
+static void *allocate(struct sgc_heap *, SEE_size_t, int);
+static unsigned int find_free(struct page *);
+static void push(struct sgc_heap *, char *, SEE_size_t);
+static void mark_word(struct sgc_heap *, char *);
+static void mark_range(struct sgc_heap *, char *, char *);
+static void mark_stack(struct sgc_heap *);
+#if __GNUC__
+static void mark_stack_above(struct sgc_heap *)
+	__attribute__((__noinline__));
+#else
+static void mark_stack_above(struct sgc_heap *);
+#endif
+static void mark_remembered(struct sgc_heap *);
+static void mark_object_contents(struct sgc_heap *, struct page *,
+	unsigned int);
+static void drain(struct sgc_heap *);
+static void rescan_marked(struct sgc_heap *);
+static unsigned int queue_finalizers(struct sgc_heap *, struct final **);
+static void run_finalizers(struct sgc_heap *, struct final *, unsigned int);
+static void sweep(struct sgc_heap *, int);
+static void protect_old(struct sgc_heap *);
+static char *stack_top(struct sgc_heap *);
+#if SGC_WRITE_BARRIER
+static struct sgc_heap *owner_lookup(char *);
+static int owner_set(SEE_size_t, struct sgc_heap *);
+static void fault_handler(int, siginfo_t *, void *);
+#endif
+
+#if !__GNUC__
+/* Returns the index of the lowest set bit of a non-zero word */
+static int
+ctz(w)
+	sgc_word_t w;
+{
+	int n = 0;
+
+	while (!(w & 1)) {
+		w >>= 1;
+		n++;
+	}
+	return n;
+}
+
+/* Returns the number of set bits in a word */
+static int
+popcount(w)
+	sgc_word_t w;
+{
+	int n = 0;
+
+	for (; w; w &= w - 1)
+		n++;
+	return n;
+}
+#endif
+
+/*------------------------------------------------------------
+ * Pages
  */
+
+/* Obtains npages of zeroed memory aligned to SGC_PAGE_SIZE */
+static void *
+chunk_alloc(npages, rawp)
+	unsigned int npages;
+	void **rawp;
+{
+	SEE_size_t len = (SEE_size_t)npages * SGC_PAGE_SIZE;
+	char *raw, *base;
+
+#if HAVE_MMAP && defined(MAP_ANON)
+	raw = (char *)mmap(NULL, len + SGC_PAGE_SIZE, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (raw == (char *)MAP_FAILED)
+	    return NULL;
+	base = (char *)(((SEE_size_t)raw + SGC_PAGE_SIZE - 1) &
+	    ~(SEE_size_t)(SGC_PAGE_SIZE - 1));
+	/* Trim the unaligned head and tail */
+	if (base > raw)
+	    munmap(raw, base - raw);
+	if (base < raw + SGC_PAGE_SIZE)
+	    munmap(base + len, raw + SGC_PAGE_SIZE - base);
+	*rawp = base;
+#else
+	raw = (char *)malloc(len + SGC_PAGE_SIZE);
+	if (!raw)
+	    return NULL;
+	base = (char *)(((SEE_size_t)raw + SGC_PAGE_SIZE - 1) &
+	    ~(SEE_size_t)(SGC_PAGE_SIZE - 1));
+	memset(base, 0, len);
+	*rawp = raw;
+#endif
+	return base;
+}
+
+/* Returns memory obtained from chunk_alloc() to the system */
 static void
-allocation_insert(new_node)
-	struct allocation *new_node;
-{
-	struct allocation **root = &gc.allocation_root;
-	struct allocation **last_imbalance = NULL;
-	struct allocation **n;
-
-	SET_BALANCE(new_node, BALANCED);
-	new_node->side[RIGHT] = NULL;
-	new_node->side[LEFT] = NULL;
-
-	/*
-	 * Search the tree, looking for the leaf to
-	 * attach the new_node too. At the same time,
-	 * we take note of the closest imbalanced
-	 * ancestor.
-	 */
-	n = root;
-	while (*n) {
-	    if (GET_BALANCE(*n) != BALANCED)
-	    	last_imbalance = n;
-	    n = &(*n)->side[new_node < *n];
-	}
-	*n = new_node;
-
-	if (last_imbalance) {
-	    n = last_imbalance;
-	    if (GET_BALANCE(*n) == BALANCED) {
-	    	/* nothing to do, root node is balanced */
-	    } else {
-	    	unsigned int dir = new_node < *n;
-		struct allocation **n1 = &(*n)->side[dir];
-	        if (GET_BALANCE(*n) != dir) {
-		    /* counter-imbalance is corrected to balanced */
-		    SET_BALANCE(*n, BALANCED);
-		    n = n1;
-		} else {
-		    unsigned int dir1 = new_node < *n1;
-		    struct allocation **n2 = &(*n1)->side[dir1];
-		    if (dir == dir1) {
-			/* aggravated imbalance corrected by single rotation */
-		        struct allocation **n2o = &(*n1)->side[!dir1];
-		    	struct allocation *t = *n;
-			*n = *n1;
-			*n1 = *n2o;
-			*n2o = t;
-			n = n2;
-			SET_BALANCE(t, BALANCED);
-		    } else {
-			/* aggravated imbalance corrected by double rotation */
-		        struct allocation *p = (*n2)->side[dir1];
-		        struct allocation *q = (*n2)->side[dir];
-			unsigned int dir2 = new_node < *n2;
-			(*n2)->side[dir1] = *n;
-			(*n2)->side[dir] = *n1;
-			if (*n2 == new_node) {
-			    SET_BALANCE(*n, BALANCED);
-			    SET_BALANCE(*n1, BALANCED);
-			} else if (dir2 == dir1) {
-			    SET_BALANCE(*n, BALANCED);
-			    SET_BALANCE(*n1, dir);
-			} else {
-			    SET_BALANCE(*n, dir1);
-			    SET_BALANCE(*n1, BALANCED);
-			}
-			*n = *n2;
-			*n1 = p;
-			*n2 = q;
-			n = dir2 == dir1 ? n1 : n2;
+chunk_free(base, raw, npages)
+	void *base, *raw;
+	unsigned int npages;
+{
+#if HAVE_MMAP && defined(MAP_ANON)
+	munmap(base, (SEE_size_t)npages * SGC_PAGE_SIZE);
+#else
+	free(raw);
+#endif
+}
+
+/* Returns the descriptor of the page holding an address, or NULL */
+static struct page *
+page_lookup(heap, p)
+	struct sgc_heap *heap;
+	char *p;
+{
+	struct pagetab *tab = heap->tab;
+	SEE_size_t pn = PAGENO(p);
+	unsigned int i, mask;
+
+	if (!tab)
+	    return NULL;
+	mask = tab->size - 1;
+	for (i = HASH(pn) & mask; tab->slot[i].page; i = (i + 1) & mask)
+	    if (tab->slot[i].pageno == pn)
+		return tab->slot[i].page;
+	return NULL;
+}
+
+/* Adds a page number to the page table, growing it when half full */
+static int
+pagetab_insert(heap, pn, page)
+	struct sgc_heap *heap;
+	SEE_size_t pn;
+	struct page *page;
+{
+	struct pagetab *tab = heap->tab, *ntab;
+	unsigned int i, j, mask, size;
+
+	if (!tab || 2 * (tab->count + 1) > tab->size) {
+	    size = tab ? tab->size * 2 : 256;
+	    ntab = (struct pagetab *)calloc(1, sizeof (struct pagetab) +
+		(size - 1) * sizeof (struct pageslot));
+	    if (!ntab)
+		return 0;
+	    ntab->size = size;
+	    mask = size - 1;
+	    if (tab) {
+		for (i = 0; i < tab->size; i++)
+		    if (tab->slot[i].page) {
+			for (j = HASH(tab->slot[i].pageno) & mask;
+			     ntab->slot[j].page; j = (j + 1) & mask)
+			    ;
+			ntab->slot[j] = tab->slot[i];
 		    }
-		}
+		ntab->count = tab->count;
 	    }
-	} else
-	    n = root;
+	    ntab->retired = tab;
+	    heap->tab = tab = ntab;
+	}
+	mask = tab->size - 1;
+	for (i = HASH(pn) & mask; tab->slot[i].page; i = (i + 1) & mask)
+	    ;
+	tab->slot[i].pageno = pn;
+	tab->slot[i].page = page;
+	tab->count++;
+	return 1;
+}
 
-	/* 
-	 * Correct the remainder chain of balanced nodes by
-	 * making them all imbalanced towards the new node
-	 */
-	while (*n && *n != new_node) {
-	    SET_BALANCE(*n, new_node < *n);
-	    n = &(*n)->side[new_node < *n];
+/* Removes a page number from the page table */
+static void
+pagetab_remove(heap, pn)
+	struct sgc_heap *heap;
+	SEE_size_t pn;
+{
+	struct pagetab *tab = heap->tab;
+	unsigned int i, j, k, mask = tab->size - 1;
+
+	for (i = HASH(pn) & mask; tab->slot[i].pageno != pn ||
+	    !tab->slot[i].page; i = (i + 1) & mask)
+	    ;
+	tab->count--;
+
+	/* Shift back later entries of the probe sequence into the gap */
+	for (;;) {
+	    tab->slot[i].page = NULL;
+	    for (j = i;;) {
+		j = (j + 1) & mask;
+		if (!tab->slot[j].page)
+		    return;
+		k = HASH(tab->slot[j].pageno) & mask;
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+		    continue;
+		tab->slot[i] = tab->slot[j];
+		i = j;
+		break;
+	    }
 	}
+}
 
+/*
+ * Creates a page for objects of one size class, or a run of pages
+ * for one large object when cls is NCLASSES.
+ */
+static struct page *
+page_new(heap, kind, cls, npages)
+	struct sgc_heap *heap;
+	int kind, cls;
+	unsigned int npages;
+{
+	struct page *pg;
+	unsigned int i;
 
+	if (heap->spare) {
+	    pg = heap->spare;
+	    heap->spare = pg->next;
+	} else {
+	    pg = (struct page *)malloc(sizeof (struct page));
+	    if (!pg)
+		return NULL;
+	}
+
+	pg->base = (char *)chunk_alloc(npages, &pg->raw);
+	if (!pg->base) {
+	    pg->next = heap->spare;
+	    heap->spare = pg;
+	    return NULL;
+	}
+	for (i = 0; i < npages; i++)
+	    if (!pagetab_insert(heap, PAGENO(pg->base) + i, pg)) {
+		while (i--)
+		    pagetab_remove(heap, PAGENO(pg->base) + i);
+		chunk_free(pg->base, pg->raw, npages);
+		pg->next = heap->spare;
+		heap->spare = pg;
+		return NULL;
+	    }
+#if SGC_WRITE_BARRIER
+	if (heap->flags & SGC_GENERATIONAL) {
+	    LOCK();
+	    for (i = 0; i < npages; i++)
+		if (!owner_set(PAGENO(pg->base) + i, heap))
+		    break;
+	    if (i < npages)
+		while (i--)
+		    owner_set(PAGENO(pg->base) + i, NULL);
+	    UNLOCK();
+	    if (i < npages) {
+		for (i = 0; i < npages; i++)
+		    pagetab_remove(heap, PAGENO(pg->base) + i);
+		chunk_free(pg->base, pg->raw, npages);
+		pg->next = heap->spare;
+		heap->spare = pg;
+		return NULL;
+	    }
+	}
+#endif
+
+	pg->kind = kind;
+	pg->cls = cls;
+	pg->npages = npages;
+	pg->nlive = 0;
+	pg->hint = 0;
+	pg->avail = NULL;
+	/* A new page holds no old objects, so it is trivially dirty */
+	pg->state = PAGE_DIRTY;
+	if (cls < NCLASSES) {
+	    pg->size = class_size[cls];
+	    pg->nobj = SGC_PAGE_SIZE / pg->size;
+	    pg->state |= PAGE_AVAIL;
+	    pg->avail = heap->avail[kind][cls];
+	    heap->avail[kind][cls] = pg;
+	} else {
+	    pg->size = (SEE_size_t)npages * SGC_PAGE_SIZE;
+	    pg->nobj = 1;
+	    pg->state |= PAGE_LARGE;
+	}
+	memset(pg->alloc, 0, sizeof pg->alloc);
+	memset(pg->mark, 0, sizeof pg->mark);
+
+	pg->next = heap->pages;
+	heap->pages = pg;
+	if (!heap->lo || pg->base < heap->lo)
+	    heap->lo = pg->base;
+	if (pg->base + (SEE_size_t)npages * SGC_PAGE_SIZE > heap->hi)
+	    heap->hi = pg->base + (SEE_size_t)npages * SGC_PAGE_SIZE;
+	heap->heap_size += (SEE_size_t)npages * SGC_PAGE_SIZE;
+	return pg;
 }
 
 /*
- * Machine-dependent root scan.
+ * Returns a page's memory to the system. The caller unlinks it from
+ * the heap's page list; the descriptor is kept for reuse.
  */
-#if __unix__
 static void
-machdep_scan()
-{
-	/* 1. Stack */
-#if __i386__ && __GNUC__
-	/* Intel; assumes stack top never changes (ie no threads) */
-	char *bottom;
-	static char *top = NULL;
-	__asm__("mov %%ebp, %0" : "=g"(bottom));
-	if (!top) {
-		char *sp = bottom;
-		while (*(char **)sp > sp)
-			sp = *(char **)sp;
-		top = sp;
-	}
-	TPRINTF("{stack}");
-	scan(bottom, top - bottom  IS_ROOT);
-#else
-  /* TODO - stack finders for other architectures */
- # warning "Unable to add stack to root set on this architecture"
+page_release(heap, pg)
+	struct sgc_heap *heap;
+	struct page *pg;
+{
+	unsigned int i;
+
+	if (pg->state & PAGE_AVAIL) {
+	    struct page **a;
+
+	    for (a = &heap->avail[pg->kind][pg->cls]; *a != pg;
+		 a = &(*a)->avail)
+		;
+	    *a = pg->avail;
+	}
+#if SGC_WRITE_BARRIER
+	if (heap->flags & SGC_GENERATIONAL) {
+	    LOCK();
+	    for (i = 0; i < pg->npages; i++)
+		owner_set(PAGENO(pg->base) + i, NULL);
+	    UNLOCK();
+	}
+#endif
+	for (i = 0; i < pg->npages; i++)
+	    pagetab_remove(heap, PAGENO(pg->base) + i);
+	pg->state = 0;
+	chunk_free(pg->base, pg->raw, pg->npages);
+	heap->heap_size -= (SEE_size_t)pg->npages * SGC_PAGE_SIZE;
+	pg->next = heap->spare;
+	heap->spare = pg;
+}
+
+/* Write-protects a page so that the next write to it is noticed */
+static void
+page_protect(pg)
+	struct page *pg;
+{
+#if SGC_WRITE_BARRIER
+	mprotect(pg->base, (SEE_size_t)pg->npages * SGC_PAGE_SIZE, PROT_READ);
+#endif
+	pg->state = (pg->state | PAGE_PROTECTED) & ~PAGE_DIRTY;
+}
+
+/* Makes a page writable again, adding it to the remembered set */
+static void
+page_unprotect(pg)
+	struct page *pg;
+{
+#if SGC_WRITE_BARRIER
+	mprotect(pg->base, (SEE_size_t)pg->npages * SGC_PAGE_SIZE,
+	    PROT_READ | PROT_WRITE);
 #endif
+	pg->state = (pg->state | PAGE_DIRTY) & ~PAGE_PROTECTED;
+}
 
-#if 0 /* Turned off because malloc's own pointers are found */
-      /* Better to have the application add static roots */
+#if SGC_WRITE_BARRIER
+/* Returns the generational heap owning the page holding an address */
+static struct sgc_heap *
+owner_lookup(p)
+	char *p;
+{
+	struct ownertab *tab = FETCH(owners);
+	SEE_size_t pn = PAGENO(p), k;
+	unsigned int i, mask;
 
-	/* 2. Static variables */
-#if __unix__ || unix
-# if __linux__ || sun
-#  define __fini _fini
+	if (!tab)
+	    return NULL;
+	mask = tab->size - 1;
+	for (i = HASH(pn) & mask; (k = FETCH(tab->slot[i].pageno));
+	     i = (i + 1) & mask)
+	    if (k == pn)
+		return FETCH(tab->slot[i].heap);
+	return NULL;
+}
+
+/*
+ * Records the heap owning a page, or that it has none when heap is
+ * NULL. Tables are only replaced when adding a page, to drop the
+ * slots of released pages and grow when half full. Called with the
+ * lock held; returns 0 if memory ran out.
+ */
+static int
+owner_set(pn, heap)
+	SEE_size_t pn;
+	struct sgc_heap *heap;
+{
+	struct ownertab *tab = owners, *ntab;
+	unsigned int i, j, mask, size, live;
+
+	if (tab) {
+	    mask = tab->size - 1;
+	    for (i = HASH(pn) & mask; tab->slot[i].pageno; i = (i + 1) & mask)
+		if (tab->slot[i].pageno == pn) {
+		    PUBLISH(tab->slot[i].heap, heap);
+		    return 1;
+		}
+	}
+	if (!heap)
+	    return 1;
+
+	if (!tab || 2 * (tab->used + 1) > tab->size) {
+	    live = 0;
+	    if (tab)
+		for (i = 0; i < tab->size; i++)
+		    if (tab->slot[i].heap)
+			live++;
+	    for (size = 256; size < 4 * (live + 1); size *= 2)
+		;
+	    ntab = (struct ownertab *)calloc(1, sizeof (struct ownertab) +
+		(size - 1) * sizeof (struct ownerslot));
+	    if (!ntab)
+		return 0;
+	    ntab->size = size;
+	    mask = size - 1;
+	    if (tab)
+		for (i = 0; i < tab->size; i++)
+		    if (tab->slot[i].heap) {
+			for (j = HASH(tab->slot[i].pageno) & mask;
+			     ntab->slot[j].pageno; j = (j + 1) & mask)
+			    ;
+			ntab->slot[j] = tab->slot[i];
+			ntab->used++;
+		    }
+	    ntab->retired = tab;
+	    PUBLISH(owners, ntab);
+	    tab = ntab;
+	}
+	mask = tab->size - 1;
+	for (i = HASH(pn) & mask; tab->slot[i].pageno; i = (i + 1) & mask)
+	    ;
+	tab->slot[i].heap = heap;
+	PUBLISH(tab->slot[i].pageno, pn);
+	tab->used++;
+	return 1;
+}
+
+static struct sigaction old_segv;
+# ifdef SIGBUS
+static struct sigaction old_bus;
 # endif
-# if hppa || __hppa__
-#  define _init	__data_start
-#  define __fini _edata
+
+/* Passes faults to sgc_fault() and the rest to the previous handler */
+static void
+fault_handler(sig, info, ctx)
+	int sig;
+	siginfo_t *info;
+	void *ctx;
+{
+	struct sigaction *old;
+
+	if (sgc_fault(info->si_addr))
+	    return;
+
+# ifdef SIGBUS
+	old = sig == SIGBUS ? &old_bus : &old_segv;
+# else
+	old = &old_segv;
+# endif
+	if (old->sa_flags & SA_SIGINFO)
+	    (*old->sa_sigaction)(sig, info, ctx);
+	else if (old->sa_handler == SIG_DFL || old->sa_handler == SIG_IGN)
+	    /* Restore the default; the faulting instruction will re-fault */
+	    sigaction(sig, old, NULL);
+	else
+	    (*old->sa_handler)(sig);
+}
+#endif /* SGC_WRITE_BARRIER */
+
+/*
+ * Installs the write fault handler for SIGSEGV and SIGBUS, once.
+ * Generational heaps need it before their first collection.
+ */
+void
+sgc_fault_install()
+{
+#if SGC_WRITE_BARRIER
+	static int installed = 0;
+	struct sigaction sa;
+
+	LOCK();
+	if (!installed) {
+	    installed = 1;
+	    memset(&sa, 0, sizeof sa);
+	    sa.sa_sigaction = fault_handler;
+	    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	    sigemptyset(&sa.sa_mask);
+	    sigaction(SIGSEGV, &sa, &old_segv);
+# ifdef SIGBUS
+	    sigaction(SIGBUS, &sa, &old_bus);
 # endif
-# define data_start	_init
-# define data_end	__fini
-# define bss_start	_edata
-# define bss_end	_end
-	{
-	    extern char data_start[], data_end[], bss_start[], bss_end[];
-	    TPRINTF("{data}");
-	    scan(data_start, data_end - data_start  IS_ROOT);
-	    TPRINTF("{bss}");
-	    scan(bss_start, bss_end - bss_start  IS_ROOT);
 	}
-#else /* not unix */
- # warning "Unable to add static storage to root set on this system"
-#endif 
+	UNLOCK();
 #endif
-
-    /* Dynamically loaded libraries */
-    /* TODO - detected shared libraries? */
 }
-#endif /* unix */
 
-/* Scans the stack, BSS and user roots and then sweeps the allocation tree */
-void
-sgc_collect() 
+/*
+ * Handles a write fault at addr. If addr is in a protected page of a
+ * heap, unprotects the page, marks it dirty and returns true.
+ * The owner table is read without locking, and then only the page
+ * table of the heap owning the address: only the thread using a heap
+ * writes to its protected pages, so that is the faulting thread, and
+ * nothing else changes the table meanwhile. Heaps that other threads
+ * free are kept, so a stale owner is never released memory.
+ */
+int
+sgc_fault(addr)
+	void *addr;
 {
-	struct root *root;
-	_SEE_JMPBUF jmpbuf;
-#if TEST
-	unsigned int osize = gc.allocation_total_size;
-	unsigned int ocount = gc.allocation_total_count;
+#if SGC_WRITE_BARRIER
+	struct sgc_heap *heap;
+	struct page *pg;
+
+	heap = owner_lookup((char *)addr);
+	if (heap) {
+	    pg = page_lookup(heap, (char *)addr);
+	    if (pg && (pg->state & PAGE_PROTECTED)) {
+		page_unprotect(pg);
+		return 1;
+	    }
+	}
 #endif
+	return 0;
+}
 
-	TPRINTF("[collecting...");
+/*------------------------------------------------------------
+ * Allocation
+ */
 
-	/*
-	 * Phase 1: Scan and mark
-	 */
+/* Returns the index of a free object in a page that has one */
+static unsigned int
+find_free(pg)
+	struct page *pg;
+{
+	unsigned int w, nw = NWORDS(pg);
+	sgc_word_t bits;
+
+	for (w = pg->hint;; w = (w + 1) % nw) {
+	    bits = pg->alloc[w];
+	    if (w == nw - 1 && pg->nobj % WORD_BITS)
+		bits |= ALL_ONES << (pg->nobj % WORD_BITS);
+	    if (bits != ALL_ONES) {
+		pg->hint = w;
+		return w * WORD_BITS + CTZ(~bits);
+	    }
+	}
+}
 
-	/* Scan the unspilt registers */
-	memset(&jmpbuf, 0, sizeof jmpbuf);
-	_SEE_SETJMP(jmpbuf);
-        TPRINTF("{registers}");
-        scan((char *)&jmpbuf, sizeof jmpbuf  IS_ROOT);
+/* Allocates an object, collecting first if enough has been allocated */
+static void *
+allocate(heap, size, kind)
+	struct sgc_heap *heap;
+	SEE_size_t size;
+	int kind;
+{
+	struct page *pg;
+	unsigned int i, cls, npages;
+	int collected;
+	char *obj;
 
-	/* Scan the stack, data and BSS */
-	machdep_scan();
+	if (size == 0)
+	    return NULL;
+	if (heap->since >= heap->trigger && !heap->collecting)
+	    sgc_collect(heap, heap->next_major);
+
+	if (size > SMALL_MAX) {
+	    npages = (size + SGC_PAGE_SIZE - 1) / SGC_PAGE_SIZE;
+	    if (npages >= (unsigned int)-1 / SGC_PAGE_SIZE)
+		return NULL;
+	    pg = page_new(heap, kind, NCLASSES, npages);
+	    if (!pg && !heap->collecting) {
+		sgc_collect(heap, 1);
+		pg = page_new(heap, kind, NCLASSES, npages);
+	    }
+	    if (!pg)
+		return NULL;
+	    pg->size = (size + GRANULE - 1) & ~(SEE_size_t)(GRANULE - 1);
+	    pg->alloc[0] = 1;
+	    pg->nlive = 1;
+	    pg->state |= PAGE_YOUNG;
+	    heap->bytes += pg->size;
+	    heap->since += pg->size;
+	    return pg->base;
+	}
 
-	/* Scan the user-supplied roots */
-        TPRINTF("{users}");
-	for (root = gc.user_roots; root; root = root->next)
-		scan(root->base, root->extent  IS_ROOT);
+	cls = size_class[(size + GRANULE - 1) / GRANULE];
+	for (collected = 0;;) {
+	    pg = heap->avail[kind][cls];
+	    if (!pg) {
+		pg = page_new(heap, kind, cls, 1);
+		if (!pg && !collected && !heap->collecting) {
+		    sgc_collect(heap, 1);
+		    collected = 1;
+		    continue;
+		}
+		if (!pg)
+		    return NULL;
+		break;
+	    }
+	    if (pg->nlive < pg->nobj)
+		break;
+	    heap->avail[kind][cls] = pg->avail;
+	    pg->state &= ~PAGE_AVAIL;
+	}
+
+	if (pg->state & PAGE_PROTECTED)
+	    page_unprotect(pg);
+	i = find_free(pg);
+	pg->alloc[i / WORD_BITS] |= BIT(i);
+	pg->mark[i / WORD_BITS] &= ~BIT(i);	/* young */
+	pg->nlive++;
+	pg->state |= PAGE_YOUNG;
+	heap->bytes += pg->size;
+	heap->since += pg->size;
+	obj = pg->base + i * pg->size;
+	if (kind == KIND_SCAN)
+	    memset(obj, 0, pg->size);
+	return obj;
+}
 
-	/*
-	 * Phase 2: Sweep and release
-	 */
+/* Creates an empty heap, whose finalizers will be passed owner */
+struct sgc_heap *
+sgc_heap_new(flags, owner)
+	int flags;
+	struct SEE_interpreter *owner;
+{
+	struct sgc_heap *heap, fresh;
+	unsigned int g, cls;
+
+	LOCK();
+	heap = freed_heaps;
+	if (heap)
+	    freed_heaps = heap->next;
+	else {
+	    heap = (struct sgc_heap *)calloc(1, sizeof (struct sgc_heap));
+	    if (!heap) {
+		UNLOCK();
+		return NULL;
+	    }
+	}
 
-	/* Rebuild the allocation tree with marked nodes only */
-        TPRINTF("{sweep}");
-	sweep();
+	/* A reused heap keeps its (empty) page table and descriptors */
+	memset(&fresh, 0, sizeof fresh);
+	fresh.tab = heap->tab;
+	fresh.spare = heap->spare;
+#if !SGC_WRITE_BARRIER
+	flags &= ~SGC_GENERATIONAL;
+#endif
+	fresh.flags = flags;
+	fresh.owner = owner;
+	fresh.trigger = (flags & SGC_GENERATIONAL) ? SGC_YOUNG_SIZE
+						   : SGC_MIN_TRIGGER;
+	fresh.major_at = 4 * SGC_MIN_TRIGGER;
+	*heap = fresh;
+
+	if (!size_class_ready) {
+	    for (g = 0, cls = 0; g <= SMALL_MAX / GRANULE; g++) {
+		while (class_size[cls] < g * GRANULE)
+		    cls++;
+		size_class[g] = cls;
+	    }
+	    size_class_ready = 1;
+	}
+	UNLOCK();
+	return heap;
+}
 
-	/* Deal with objects left on the finalizing list */
-        TPRINTF("{final}");
-	run_finalizers();
+/* Allocates collectable memory */
+void *
+sgc_malloc(heap, len)
+	struct sgc_heap *heap;
+	SEE_size_t len;
+{
+	return allocate(heap, len, KIND_SCAN);
+}
 
-	TPRINTF(" freed %d objects %d bytes]\n", 
-		ocount - gc.allocation_total_count,
-		osize - gc.allocation_total_size);
+/* Allocates collectable memory caller guarantees never to contain pointers */
+void *
+sgc_malloc_atomic(heap, len)
+	struct sgc_heap *heap;
+	SEE_size_t len;
+{
+	return allocate(heap, len, KIND_ATOMIC);
 }
 
-/*
- * Scans the allocation tree, removing nodes that aren't marked, and
- * removing the mark from those that are. Runs in O(n.log(n)).
- * Calling this without a scan frees everything allocated.
+/* Allocates collectable memory attaching a finalizer callback function */
+void *
+sgc_malloc_finalizer(heap, len, fn, closure)
+	struct sgc_heap *heap;
+	SEE_size_t len;
+	void (*fn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
+{
+	struct final *nf;
+	struct page *pg;
+	char *obj;
+
+	if (heap->nfinals == heap->maxfinals) {
+	    unsigned int n = heap->maxfinals ? heap->maxfinals * 2 : 64;
+	    nf = (struct final *)realloc(heap->finals, n * sizeof *nf);
+	    if (!nf)
+		return NULL;
+	    heap->finals = nf;
+	    heap->maxfinals = n;
+	}
+	obj = (char *)allocate(heap, len, KIND_SCAN);
+	if (!obj)
+	    return NULL;
+	nf = &heap->finals[heap->nfinals++];
+	nf->obj = obj;
+	nf->fn = fn;
+	nf->closure = closure;
+	pg = page_lookup(heap, obj);
+	pg->state |= PAGE_FINAL;
+	return obj;
+}
+
+/* Releases an object that the caller knows to be unreachable */
+void
+sgc_free(heap, ptr)
+	struct sgc_heap *heap;
+	void *ptr;
+{
+	struct page *pg, **pgp;
+	char *p = (char *)ptr;
+	unsigned int i, w;
+
+	if (p < heap->lo || p >= heap->hi || heap->collecting)
+	    return;
+	pg = page_lookup(heap, p);
+	if (!pg || (SEE_size_t)(p - pg->base) % pg->size)
+	    return;
+	i = (p - pg->base) / pg->size;
+	w = i / WORD_BITS;
+	if (i >= pg->nobj || !(pg->alloc[w] & BIT(i)))
+	    return;
+
+	if (pg->state & PAGE_FINAL) {
+	    for (i = 0; i < heap->nfinals; i++)
+		if (heap->finals[i].obj == p) {
+		    heap->finals[i] = heap->finals[--heap->nfinals];
+		    break;
+		}
+	    i = (p - pg->base) / pg->size;
+	}
+
+	pg->alloc[w] &= ~BIT(i);
+	pg->mark[w] &= ~BIT(i);
+	pg->nlive--;
+	heap->bytes -= pg->size;
+	if (pg->state & PAGE_LARGE) {
+	    for (pgp = &heap->pages; *pgp != pg; pgp = &(*pgp)->next)
+		;
+	    *pgp = pg->next;
+	    page_release(heap, pg);
+	    return;
+	}
+	if (w < pg->hint)
+	    pg->hint = w;
+	if (!(pg->state & PAGE_AVAIL)) {
+	    pg->state |= PAGE_AVAIL;
+	    pg->avail = heap->avail[pg->kind][pg->cls];
+	    heap->avail[pg->kind][pg->cls] = pg;
+	}
+}
+
+/*------------------------------------------------------------
+ * Marking
  */
+
+/* Pushes an object's contents onto the mark stack */
+static void
+push(heap, base, extent)
+	struct sgc_heap *heap;
+	char *base;
+	SEE_size_t extent;
+{
+	struct grey *ng;
+	unsigned int n;
+
+	if (heap->ngrey == heap->maxgrey) {
+	    n = heap->maxgrey ? heap->maxgrey * 2 : 1024;
+	    ng = (struct grey *)realloc(heap->grey, n * sizeof *ng);
+	    if (!ng) {
+		/* Recover later by rescanning every marked object */
+		heap->overflow = 1;
+		return;
+	    }
+	    heap->grey = ng;
+	    heap->maxgrey = n;
+	}
+	heap->grey[heap->ngrey].base = base;
+	heap->grey[heap->ngrey].extent = extent;
+	heap->ngrey++;
+}
+
+/* Marks the object that a word points into, if any */
 static void
-sweep()
+mark_word(heap, p)
+	struct sgc_heap *heap;
+	char *p;
 {
-	struct allocation *old_root = gc.allocation_root;
-	
-	gc.allocation_root = NULL;
-	if (old_root)
-	    sweep_sub(old_root);
+	struct page *pg;
+	unsigned int i, w;
+
+	if (p < heap->lo || p >= heap->hi)
+	    return;
+	pg = page_lookup(heap, p);
+	if (!pg)
+	    return;
+	i = (p - pg->base) / pg->size;
+	if (i >= pg->nobj)
+	    return;
+	w = i / WORD_BITS;
+	if (!(pg->alloc[w] & BIT(i)) || (pg->mark[w] & BIT(i)))
+	    return;
+	pg->mark[w] |= BIT(i);
+	if (pg->kind == KIND_SCAN)
+	    push(heap, pg->base + i * pg->size, pg->size);
 }
 
-/* Note that this function recurses to a depth of approx 1.5 * log(n). */
+/* Conservatively marks everything that a segment of memory points into */
 static void
-sweep_sub(a)
-	struct allocation *a;
-{
-	struct allocation *side[2];
-
-	side[0] = a->side[0];
-	side[1] = a->side[1];
-
-	if (!IS_MARKED(a)) {
-	    gc.allocation_total_size -= ALLOCATION_LENGTH(a);
-	    gc.allocation_total_count--;
-	    if (a->finalizer) {
-	    	/* Add to the list of finalizers to run later */
-	        a->side[0] = gc.allocation_finalizing;
-	        gc.allocation_finalizing = a;
-	    } else
-	        allocation_free(a);
-	} else {
-	    CLEAR_MARK(a);
-	    allocation_insert(a);
+mark_range(heap, base, end)
+	struct sgc_heap *heap;
+	char *base, *end;
+{
+	char **p;
+
+	for (p = (char **)(((SEE_size_t)base + sizeof *p - 1) &
+		~(SEE_size_t)(sizeof *p - 1));
+	     (char *)(p + 1) <= end; p++)
+	    mark_word(heap, *p);
+}
+
+/* Marks from the registers and the stack of the calling thread */
+static void
+mark_stack(heap)
+	struct sgc_heap *heap;
+{
+	jmp_buf regs;
+
+	/* Spill the callee-saved registers where they can be scanned */
+	memset(&regs, 0, sizeof regs);
+#if __GNUC__
+	__builtin_unwind_init();
+#endif
+	setjmp(regs);
+	mark_range(heap, (char *)&regs, (char *)(&regs + 1));
+	mark_stack_above(heap);
+}
+
+/* Marks from the stack above this function's frame, which is below
+ * the frame of mark_stack() that holds the spilled registers */
+static void
+mark_stack_above(heap)
+	struct sgc_heap *heap;
+{
+	char *sp, *top;
+
+	sp = (char *)&sp;
+	top = stack_top(heap);
+	if (sp < top)
+	    mark_range(heap, sp, top);
+	else
+	    mark_range(heap, top, sp);
+}
+
+/* Scans the object at index i of a page */
+static void
+mark_object_contents(heap, pg, i)
+	struct sgc_heap *heap;
+	struct page *pg;
+	unsigned int i;
+{
+	char *obj = pg->base + i * pg->size;
+
+	mark_range(heap, obj, obj + pg->size);
+}
+
+/* Marks from the old objects of the remembered set (dirty pages) */
+static void
+mark_remembered(heap)
+	struct sgc_heap *heap;
+{
+	struct page *pg;
+	unsigned int w;
+	sgc_word_t bits;
+
+	for (pg = heap->pages; pg; pg = pg->next) {
+	    if (pg->kind != KIND_SCAN || !(pg->state & PAGE_DIRTY))
+		continue;
+	    for (w = 0; w < NWORDS(pg); w++)
+		for (bits = pg->alloc[w] & pg->mark[w]; bits;
+		     bits &= bits - 1)
+		    mark_object_contents(heap, pg,
+			w * WORD_BITS + CTZ(bits));
 	}
-	if (side[0])
-	    sweep_sub(side[0]);
-	if (side[1])
-	    sweep_sub(side[1]);
 }
 
-/* Finalize the allocations on the gc.allocation_finalizing list then free them */
+/* Scans every marked object; used to recover from mark stack overflow */
 static void
-run_finalizers()
+rescan_marked(heap)
+	struct sgc_heap *heap;
 {
-	struct allocation *a, *anext;
+	struct page *pg;
+	unsigned int w;
+	sgc_word_t bits;
+
+	for (pg = heap->pages; pg; pg = pg->next) {
+	    if (pg->kind != KIND_SCAN)
+		continue;
+	    for (w = 0; w < NWORDS(pg); w++)
+		for (bits = pg->alloc[w] & pg->mark[w]; bits;
+		     bits &= bits - 1)
+		    mark_object_contents(heap, pg,
+			w * WORD_BITS + CTZ(bits));
+	}
+}
 
-	a = gc.allocation_finalizing;
-	gc.allocation_finalizing = NULL;
+/* Scans objects on the mark stack until it is empty */
+static void
+drain(heap)
+	struct sgc_heap *heap;
+{
+	struct grey g;
 
-	while (a) {
-	    anext = a->side[0];
-	    (*a->finalizer)((void *)ALLOCATION_BASE(a));
-	    allocation_free(a);
-	    a = anext;
+	for (;;) {
+	    while (heap->ngrey) {
+		g = heap->grey[--heap->ngrey];
+		mark_range(heap, g.base, g.base + g.extent);
+	    }
+	    if (!heap->overflow)
+		break;
+	    heap->overflow = 0;
+	    rescan_marked(heap);
+	}
+}
+
+/*
+ * Takes the finalizable objects that were not reached off the list,
+ * and marks them (and what they reach) so they survive until their
+ * finalizers have run. Returns the count and a malloc'd array.
+ */
+static unsigned int
+queue_finalizers(heap, runp)
+	struct sgc_heap *heap;
+	struct final **runp;
+{
+	struct final *run = NULL;
+	struct page *pg;
+	unsigned int i, j, n = 0;
+
+	for (i = 0; i < heap->nfinals; i++) {
+	    pg = page_lookup(heap, heap->finals[i].obj);
+	    j = (heap->finals[i].obj - pg->base) / pg->size;
+	    if (pg->mark[j / WORD_BITS] & BIT(j))
+		continue;
+	    if (!run) {
+		run = (struct final *)malloc(heap->nfinals * sizeof *run);
+		if (!run)
+		    break;	/* try again next time */
+	    }
+	    run[n++] = heap->finals[i];
+	    heap->finals[i--] = heap->finals[--heap->nfinals];
 	}
+	for (i = 0; i < n; i++)
+	    mark_word(heap, run[i].obj);
+	drain(heap);
+	*runp = run;
+	return n;
 }
 
-/* Scans a segment of memory and recursively marks/scans reached allocations */
+/* Calls finalizers queued by queue_finalizers() */
 static void
-#if TEST
-scan(base, len, isroot)
-	char *base;
-	unsigned int len, isroot;
-#else
-scan(base, len)
-	char *base;
-	unsigned int len;
-#endif
+run_finalizers(heap, run, n)
+	struct sgc_heap *heap;
+	struct final *run;
+	unsigned int n;
 {
-	char **p;
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+	    (*run[i].fn)(heap->owner, run[i].obj, run[i].closure);
+	free(run);
+}
+
+/*------------------------------------------------------------
+ * Collection
+ */
 
-	for (p = (char **)ALIGN((unsigned int)base); 
-	     (char *)p + sizeof *p < base + len; 
-	     p++)
-	{
-	    /* Don't scan GC-private storage */
-	    if (p >= (char **)&gc && p < (char **)(&gc + 1))
-	    	continue;
-	    if (*p >= gc.allocation_min && *p < gc.allocation_max)
+/*
+ * Frees unmarked objects. A minor sweep only visits pages that were
+ * allocated from since the last collection, because the objects of
+ * other pages are all old.
+ */
+static void
+sweep(heap, major)
+	struct sgc_heap *heap;
+	int major;
+{
+	struct page *pg, **pgp;
+	unsigned int w, live, nempty = 0;
+
+	for (pgp = &heap->pages; (pg = *pgp);) {
+	    if (!major && !(pg->state & PAGE_YOUNG)) {
+		pgp = &pg->next;
+		continue;
+	    }
+	    pg->state &= ~PAGE_YOUNG;
+	    live = 0;
+	    for (w = 0; w < NWORDS(pg); w++) {
+		pg->alloc[w] &= pg->mark[w];
+		live += POPCOUNT(pg->alloc[w]);
+	    }
+	    heap->bytes -= (pg->nlive - live) * pg->size;
+	    pg->nlive = live;
+	    if (live == 0 &&
+	        ((pg->state & PAGE_LARGE) || ++nempty > SGC_KEEP_EMPTY))
 	    {
-	    	/* Looks like a pointer into an allocation; search O(log(n)) */
-	    	struct allocation *a = gc.allocation_root;
-	        while (a) 
-			if (*p < (char *)a)
-				a = a->side[RIGHT];
-			else if (*p >= ALLOCATION_END(a))
-				a = a->side[LEFT];
-			else {
-			    /* Found the allocation pointed to */
-			    if (!IS_MARKED(a) && *p >= ALLOCATION_BASE(a)) {
-#if TEST
-				if (isroot) 
-				    TPRINTF("%p reached by %p in [%p/%u]\n", 
-				        ALLOCATION_BASE(a), p, base, len);
-#endif
-				SET_MARK(a);
-				if (!IS_ATOMIC(a))
-				    scan(ALLOCATION_BASE(a), 
-				         ALLOCATION_LENGTH(a) IS_NOT_ROOT);
-			    }
-			    break;
-			}
-	     }
-	}
-}
-
-/* Creates a new allocation */
-static void *
-allocate(len, init_state, finalizer)
-	unsigned int len;
-	int init_state;
-	void (*finalizer)(void *);
+		*pgp = pg->next;
+		page_release(heap, pg);
+		continue;
+	    }
+	    pg->hint = 0;
+	    if (live < pg->nobj && !(pg->state & (PAGE_AVAIL | PAGE_LARGE))) {
+		pg->state |= PAGE_AVAIL;
+		pg->avail = heap->avail[pg->kind][pg->cls];
+		heap->avail[pg->kind][pg->cls] = pg;
+	    }
+	    pgp = &pg->next;
+	}
+}
+
+/* Write-protects the dirty pages that now only hold old objects */
+static void
+protect_old(heap)
+	struct sgc_heap *heap;
+{
+	struct page *pg;
+
+	for (pg = heap->pages; pg; pg = pg->next)
+	    if (pg->kind == KIND_SCAN && pg->nlive &&
+		(pg->state & PAGE_DIRTY))
+		    page_protect(pg);
+}
+
+/* Returns the address beyond which the current thread's stack is unused */
+static char *
+stack_top(heap)
+	struct sgc_heap *heap;
 {
-	struct allocation *newa;
+#if HAVE_PTHREAD_GETATTR_NP && HAVE_PTHREAD_MUTEX_LOCK
+	pthread_t self;
+	pthread_attr_t attr;
+	void *addr;
+	size_t size;
+#endif
 
-	/* Don't allocate empty objects */
-	if (len == 0) {
-	    /* NB: finalizer is NOT run */
+	if (heap->stack_base)
+	    return heap->stack_base;
+#if HAVE_PTHREAD_GETATTR_NP && HAVE_PTHREAD_MUTEX_LOCK
+	self = pthread_self();
+	if (heap->stack_known && pthread_equal(self, heap->stack_thread))
+	    return heap->stack_top;
+	if (pthread_getattr_np(self, &attr) != 0)
+	    return NULL;
+	if (pthread_attr_getstack(&attr, &addr, &size) != 0) {
+	    pthread_attr_destroy(&attr);
 	    return NULL;
 	}
+	pthread_attr_destroy(&attr);
+	heap->stack_thread = self;
+	heap->stack_top = (char *)addr + size;	/* stack grows down */
+	heap->stack_known = 1;
+	return heap->stack_top;
+#else
+	return NULL;
+#endif
+}
 
-	/* Collect when we have allocated twice as much as last time */
-	if (gc.allocation_total_size >= gc.collect_at) {
-	    sgc_collect();
-	    gc.collect_at = gc.collect_at * 3 / 2;
-	    if (gc.collect_at == 0) gc.collect_at = 1024;
-	}
+/*
+ * Performs a collection. A minor collection frees young objects
+ * unreachable from the roots and the remembered set; a major one
+ * frees every unreachable object. Heaps that are not generational
+ * always collect fully.
+ */
+void
+sgc_collect(heap, major)
+	struct sgc_heap *heap;
+	int major;
+{
+	struct page *pg;
+	struct root *root;
+	struct final *run;
+	unsigned int nrun;
 
-	/* Call system malloc; if exhausted, collect and retry */
-	newa = (struct allocation *)malloc(sizeof *newa + len);
-	if (!newa) {
-	    sgc_collect();
-	    newa = (struct allocation *)malloc(sizeof *newa + len);
-	    if (!newa)
-	        return NULL;
+	if (heap->collecting)
+	    return;
+	if (!stack_top(heap)) {
+	    /* Without the stack bounds, nothing can be known unreachable */
+#ifndef NDEBUG
+	    if (SEE_gc_debug)
+		dprintf("sgc: stack base unknown; not collecting\n");
+#endif
+	    heap->since = 0;
+	    heap->trigger = ~(SEE_size_t)0;
+	    return;
 	}
+	heap->collecting = 1;
+	if (!(heap->flags & SGC_GENERATIONAL))
+	    major = 1;
+
+#ifndef NDEBUG
+	if (SEE_gc_debug)
+	    dprintf("sgc: %s collection: %lu bytes in use, %lu new\n",
+		major ? "major" : "minor", (unsigned long)heap->bytes,
+		(unsigned long)heap->since);
+#endif
 
-	/* Fill in the allocation header and insert into allocation tree */
-	newa->extent = sizeof *newa + len;
-	newa->state = init_state;
-	newa->finalizer = finalizer;
-	allocation_insert(newa); /* O(log(n)) */
-
-	/* Accounting */
-	gc.allocation_total_size += ALLOCATION_LENGTH(newa);
-	gc.allocation_total_count++;
-	if (!gc.allocation_min || ALLOCATION_BASE(newa) < gc.allocation_min)
-		gc.allocation_min = ALLOCATION_BASE(newa);
-	if (ALLOCATION_END(newa) >= gc.allocation_max)
-		gc.allocation_max = ALLOCATION_END(newa);
+	if (major) {
+	    for (pg = heap->pages; pg; pg = pg->next) {
+		memset(pg->mark, 0, NWORDS(pg) * sizeof (sgc_word_t));
+		pg->state |= PAGE_YOUNG;	/* everything is swept */
+	    }
+	} else
+	    mark_remembered(heap);
+
+	mark_stack(heap);
+	for (root = heap->roots; root; root = root->next)
+	    mark_range(heap, root->base, root->base + root->extent);
+	drain(heap);
+
+	nrun = queue_finalizers(heap, &run);
+	sweep(heap, major);
+	if (heap->flags & SGC_GENERATIONAL)
+	    protect_old(heap);
+
+	heap->collections++;
+	if (!major)
+	    heap->minor_collections++;
+	heap->live = heap->bytes;
+	heap->since = 0;
+	if (heap->flags & SGC_GENERATIONAL) {
+	    if (major)
+		heap->major_at = heap->bytes * 2 > 4 * SGC_MIN_TRIGGER
+		    ? heap->bytes * 2 : 4 * SGC_MIN_TRIGGER;
+	    heap->next_major = heap->bytes >= heap->major_at;
+	} else
+	    heap->trigger = heap->bytes > SGC_MIN_TRIGGER
+		    ? heap->bytes : SGC_MIN_TRIGGER;
+	heap->collecting = 0;
+
+#ifndef NDEBUG
+	if (SEE_gc_debug)
+	    dprintf("sgc: %lu bytes in use, %lu in pages, %u finalizers\n",
+		(unsigned long)heap->bytes, (unsigned long)heap->heap_size,
+		nrun);
+#endif
 
-	return ALLOCATION_BASE(newa);
+	if (nrun)
+	    run_finalizers(heap, run, nrun);
 }
 
-/* Called when an allocation is deemed unreachable after sweeping */
-static void
-allocation_free(a)
-	struct allocation *a;
+/*
+ * Runs all finalizers, then releases all the heap's objects. The heap
+ * itself, its page table and its page descriptors are kept for reuse
+ * by sgc_heap_new(), because the fault handler of another thread may
+ * have found the heap just before its pages were released.
+ */
+void
+sgc_heap_free(heap)
+	struct sgc_heap *heap;
 {
-	free(a);
+	struct page *pg;
+	struct root *root;
+	struct final *run;
+	unsigned int nrun;
+
+	/* Finalize everything as if unreachable */
+	while ((nrun = heap->nfinals)) {
+	    run = heap->finals;
+	    heap->finals = NULL;
+	    heap->nfinals = heap->maxfinals = 0;
+	    run_finalizers(heap, run, nrun);
+	}
+
+	while ((pg = heap->pages)) {
+	    heap->pages = pg->next;
+	    page_release(heap, pg);
+	}
+	while ((root = heap->roots)) {
+	    heap->roots = root->next;
+	    free(root);
+	}
+	free(heap->finals);
+	free(heap->grey);
+
+	LOCK();
+	heap->next = freed_heaps;
+	freed_heaps = heap;
+	UNLOCK();
 }
 
 /* Adds a memory segment to the list of roots scanned during collect */
 void
-sgc_add_root(base, extent)
+sgc_add_root(heap, base, extent)
+	struct sgc_heap *heap;
 	void *base;
-	unsigned int extent;
+	SEE_size_t extent;
 {
 	struct root *root;
-	
+
 	if (!extent)
 	    return;
 	root = (struct root *)malloc(sizeof (struct root));
 	if (root) {
 	    root->base = (char *)base;
 	    root->extent = extent;
-	    root->next = gc.user_roots;
-	    gc.user_roots = root;
+	    root->next = heap->roots;
+	    heap->roots = root;
 	}
 }
 
 /* Removes a previously added memory segment */
 void
-sgc_remove_root(base)
+sgc_remove_root(heap, base)
+	struct sgc_heap *heap;
 	void *base;
 {
 	struct root **r;
 
-	for (r = &gc.user_roots; *r; r = &(*r)->next)
+	for (r = &heap->roots; *r; r = &(*r)->next)
 	    if ((*r)->base == (char *)base) {
 	    	struct root *root = *r;
 		*r = root->next;
@@ -536,137 +1553,249 @@ sgc_remove_root(base)
 	    }
 }
 
-/* Allocates collectable memory */
-void *
-sgc_malloc(len)
-	unsigned int len;
+/*
+ * Sets the highest stack address to scan. Needed when the system
+ * cannot say where the stack of the current thread begins, or when
+ * the heap is used from a coroutine with a stack of its own.
+ */
+void
+sgc_set_stack_base(heap, base)
+	struct sgc_heap *heap;
+	void *base;
 {
-	return allocate(len, 0, NULL);
+	heap->stack_base = (char *)base;
+	if (heap->trigger == ~(SEE_size_t)0)
+	    heap->trigger = (heap->flags & SGC_GENERATIONAL)
+		? SGC_YOUNG_SIZE : SGC_MIN_TRIGGER;
 }
 
-/* Allocates collectable memory caller guarantees never to contain pointers */
-void *
-sgc_malloc_atomic(len)
-	unsigned int len;
+/* Fills in statistics about a heap */
+void
+sgc_stats(heap, stats)
+	struct sgc_heap *heap;
+	struct SEE_gc_stats *stats;
 {
-	return allocate(len, STATE_ATOMIC, NULL);
+	stats->heap_size = heap->heap_size;
+	stats->in_use = heap->bytes;
+	stats->live = heap->live;
+	stats->collections = heap->collections;
+	stats->minor_collections = heap->minor_collections;
 }
 
-/* Allocates collectable memory attaching a finalizer callback function */
-void *
-sgc_malloc_finalizer(len, finalizer)
-	unsigned int len;
-	void (*finalizer)(void *);
+/*------------------------------------------------------------
+ * SEE_system hooks
+ *
+ * Allocations made without an interpreter (such as the strings of
+ * the global intern table) live for the life of the process, and so
+ * are taken from the system malloc().
+ */
+
+static int gc_flags;
+
+static struct sgc_heap *gc_heap(struct SEE_interpreter *);
+static void *gc_malloc(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static void *gc_malloc_string(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static void *gc_malloc_finalize(struct SEE_interpreter *, SEE_size_t,
+        void (*)(struct SEE_interpreter *, void *, void *), void *,
+		const char *, int);
+static void gc_free(struct SEE_interpreter *, void *,
+	const char *, int);
+static void gc_gcollect(struct SEE_interpreter *);
+
+/* Returns the interpreter's heap, creating it on first use */
+static struct sgc_heap *
+gc_heap(interp)
+	struct SEE_interpreter *interp;
 {
-	return allocate(len, 0, finalizer);
+	struct sgc_heap *heap = (struct sgc_heap *)interp->gc_heap;
+
+	if (!heap) {
+	    heap = sgc_heap_new(gc_flags, interp);
+	    if (heap) {
+		sgc_add_root(heap, interp, sizeof *interp);
+		interp->gc_heap = heap;
+	    }
+	}
+	return heap;
 }
 
-/* Marks all objects as unreachable and runs finalizers */
-void
-sgc_atexit()
+static void *
+gc_malloc(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
 {
-	sweep();
-	run_finalizers();
-	sweep();
-	run_finalizers();
+	struct sgc_heap *heap;
+	void *p;
+
+	if (!interp) {
+	    p = malloc(size);
+	    if (p)
+		memset(p, 0, size);
+	    return p;
+	}
+	heap = gc_heap(interp);
+	return heap ? sgc_malloc(heap, size) : NULL;
 }
 
-/*------------------------------------------------------------
- * Test stubs
- */
-#ifdef TEST
+static void *
+gc_malloc_string(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	struct sgc_heap *heap;
 
-static void myfinalizer(void *);
-static void info(void);
+	if (!interp)
+	    return malloc(size);
+	heap = gc_heap(interp);
+	return heap ? sgc_malloc_atomic(heap, size) : NULL;
+}
 
-static void
-info()
+static void *
+gc_malloc_finalize(interp, size, finalizefn, closure, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+        void (*finalizefn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
+	const char *file;
+	int line;
 {
-	printf("[in use: %u bytes in %u objects]\n\n",
-		gc.allocation_total_size, gc.allocation_total_count);
+	struct sgc_heap *heap;
+
+	if (!interp)
+	    return malloc(size);	/* never finalized */
+	heap = gc_heap(interp);
+	return heap ? sgc_malloc_finalizer(heap, size, finalizefn, closure)
+		    : NULL;
 }
 
-static void 
-myfinalizer(p)
-	void *p;
+static void
+gc_free(interp, ptr, file, line)
+	struct SEE_interpreter *interp;
+	void *ptr;
+	const char *file;
+	int line;
 {
-	printf("Finalizer called for %p!\n", p);
+	if (!interp)
+	    free(ptr);
+	else if (interp->gc_heap)
+	    sgc_free((struct sgc_heap *)interp->gc_heap, ptr);
 }
 
-static double
-now()
+static void
+gc_gcollect(interp)
+	struct SEE_interpreter *interp;
 {
-	struct timeval t;
+	if (interp && interp->gc_heap)
+	    sgc_collect((struct sgc_heap *)interp->gc_heap, 1);
+}
 
-	gettimeofday(&t, NULL);
-	return (double)t.tv_sec + (double)t.tv_usec * 1e-6;
+/**
+ * Makes the built-in collector back the SEE_system memory hooks.
+ * Must be called before any interpreters are created. With
+ * SEE_GC_GENERATIONAL, young objects are collected separately where
+ * the system supports page protection, and the collector installs
+ * handlers for SIGSEGV and SIGBUS.
+ */
+void
+SEE_gc_install(flags)
+	int flags;
+{
+	gc_flags = (flags & SEE_GC_GENERATIONAL) ? SGC_GENERATIONAL : 0;
+	if (gc_flags & SGC_GENERATIONAL)
+	    sgc_fault_install();
+	SEE_system.malloc = gc_malloc;
+	SEE_system.malloc_finalize = gc_malloc_finalize;
+	SEE_system.malloc_string = gc_malloc_string;
+	SEE_system.free = gc_free;
+	SEE_system.gcollect = gc_gcollect;
 }
 
-int
-main()
-{
-	void *p, *p2;
-	unsigned long i;
-	double start;
-
-	setbuf(stdout, NULL);
-	atexit(info);
-	atexit(sgc_atexit);
-
-	printf("calling: p = allocate(100)\n");
-	p = sgc_malloc(100);
-	printf("  -> p = %p\n", p);
-	info();
-
-	printf("calling collect\n");
-	sgc_collect();
-	info();
-
-	printf("setting p = NULL\n");
-	p = NULL;
-	sgc_collect();
-	info();
-
-#define COUNT 1024*256
-#define SIZE  1024*2
-	printf("allocating %u objects of size %u:\n", COUNT, SIZE);
-	p2 = NULL;
-	for (i = 0; i < COUNT; i++) {
-/*	    printf("\r\t%7u", i); */
-	    p = sgc_malloc(SIZE);
-	    if (!p) {
-	    	printf("Out of memory at count=%lu\n", i);
-		break;
-	    } else {
-	    	memset(p, 0, SIZE);
-		*(void **)p = p2;
-		p2 = p;
-	    }
-	}
-/*	printf(" done\n"); */
-	info();
+/**
+ * Sets the highest stack address that the collector scans for the
+ * interpreter. Only needed where the system cannot tell the collector
+ * where the stack of the thread running the interpreter begins.
+ */
+void
+SEE_gc_stack_base(interp, base)
+	struct SEE_interpreter *interp;
+	void *base;
+{
+	struct sgc_heap *heap = gc_heap(interp);
+
+	if (heap)
+	    sgc_set_stack_base(heap, base);
+}
 
-	printf("calling collect\n");
-	start = now();
-	sgc_collect();
-	printf(" collect took %f seconds\n", now() - start);
-	info();
+/**
+ * Adds memory outside the heap that holds pointers to the
+ * interpreter's objects, such as a host's static variables.
+ */
+void
+SEE_gc_add_root(interp, base, len)
+	struct SEE_interpreter *interp;
+	void *base;
+	SEE_size_t len;
+{
+	struct sgc_heap *heap = gc_heap(interp);
 
-	p = p2 = NULL;
+	if (heap)
+	    sgc_add_root(heap, base, len);
+}
 
-	printf("calling collect\n");
-	start = now();
-	sgc_collect();
-	printf(" collect took %f seconds\n", now() - start);
-	info();
+/** Removes memory added with SEE_gc_add_root() */
+void
+SEE_gc_remove_root(interp, base)
+	struct SEE_interpreter *interp;
+	void *base;
+{
+	if (interp->gc_heap)
+	    sgc_remove_root((struct sgc_heap *)interp->gc_heap, base);
+}
 
-	printf("calling malloc_finalizer(300, myfinalizer)\n");
-	p2 = sgc_malloc_finalizer(300, myfinalizer);
-	info();
+/** Fills in statistics about the interpreter's heap */
+void
+SEE_gc_stats(interp, stats)
+	struct SEE_interpreter *interp;
+	struct SEE_gc_stats *stats;
+{
+	if (interp->gc_heap)
+	    sgc_stats((struct sgc_heap *)interp->gc_heap, stats);
+	else
+	    memset(stats, 0, sizeof *stats);
+}
 
-	printf("p=%p p2=%p\n", p, p2);
+/**
+ * Runs the finalizers of all the interpreter's objects and releases
+ * its heap. The interpreter must not be used afterwards (unless it
+ * is initialised again).
+ */
+void
+SEE_gc_release(interp)
+	struct SEE_interpreter *interp;
+{
+	struct sgc_heap *heap = (struct sgc_heap *)interp->gc_heap;
 
-	exit(0);
+	if (heap) {
+	    sgc_heap_free(heap);
+	    interp->gc_heap = NULL;
+	}
 }
 
-#endif /* TEST */
+/**
+ * Lets a host's own SIGSEGV or SIGBUS handler pass on a fault at addr
+ * (its si_addr) to a generational collector. Returns true if the fault
+ * was the collector's write barrier and the faulting write can simply
+ * be retried; false if it belongs to the host.
+ */
+int
+SEE_gc_fault(addr)
+	void *addr;
+{
+	return sgc_fault(addr);
+}
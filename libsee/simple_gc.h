@@ -1,12 +1,29 @@
+/* Copyright (c) 2006, David Leonard. All rights reserved. */
+
 #ifndef _h_simple_gc_
 #define _h_simple_gc_
 
-void  sgc_collect(void);
-void *sgc_malloc(unsigned int sz);
-void *sgc_malloc_atomic(unsigned int sz);
-void *sgc_malloc_finalizer(unsigned int sz, void (*finalizer)(void *));
-void  sgc_atexit(void);
-void  sgc_add_root(void *base, unsigned int sz);
-void  sgc_remove_root(void *base);
+struct SEE_interpreter;
+struct SEE_gc_stats;
+struct sgc_heap;
+
+/* Heap flags */
+#define SGC_GENERATIONAL	0x01	/* minor collections of young objects */
+
+struct sgc_heap *sgc_heap_new(int flags, struct SEE_interpreter *owner);
+void  sgc_heap_free(struct sgc_heap *heap);
+void  sgc_collect(struct sgc_heap *heap, int major);
+void *sgc_malloc(struct sgc_heap *heap, SEE_size_t sz);
+void *sgc_malloc_atomic(struct sgc_heap *heap, SEE_size_t sz);
+void *sgc_malloc_finalizer(struct sgc_heap *heap, SEE_size_t sz,
+	void (*finalizer)(struct SEE_interpreter *, void *, void *),
+	void *closure);
+void  sgc_free(struct sgc_heap *heap, void *p);
+void  sgc_add_root(struct sgc_heap *heap, void *base, SEE_size_t sz);
+void  sgc_remove_root(struct sgc_heap *heap, void *base);
+void  sgc_set_stack_base(struct sgc_heap *heap, void *base);
+void  sgc_stats(struct sgc_heap *heap, struct SEE_gc_stats *stats);
+void  sgc_fault_install(void);
+int   sgc_fault(void *addr);
 
 #endif /* _h_simple_gc_ */
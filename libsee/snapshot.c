@@ -0,0 +1,1024 @@
+/*
+ * Copyright (c) 2007
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#if STDC_HEADERS
+# include <stddef.h>
+# include <stdlib.h>
+#endif
+
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include <see/mem.h>
+#include <see/value.h>
+#include <see/string.h>
+#include <see/intern.h>
+#include <see/interpreter.h>
+#include <see/native.h>
+#include <see/error.h>
+#include <see/system.h>
+
+#include "snapshot.h"
+#include "dprint.h"
+
+/*
+ * Interpreter templates.
+ *
+ * Initialising an interpreter builds several hundred objects, and for
+ * short scripts that is most of the work. A template is an interpreter
+ * that is initialised once; new interpreters are then cloned from it
+ * by copying its heap instead of building their own.
+ *
+ * From SEE_interpreter_init_template() until it is first cloned, a
+ * template records each block allocated for it. The first clone
+ * freezes the template: the recorded blocks reachable from its
+ * interpreter structure are laid out one after another in an image.
+ * Each pointer-sized word of a scanned block that points into a
+ * recorded block is stored in the image as the offset of its target,
+ * and its position is put on a relocation list. Words that point into
+ * the template's interpreter structure (the interpreter field of a
+ * string, say) go on a second list.
+ *
+ * A clone allocates one block the size of the image, copies the image
+ * into it, and adds the block's address to each word on the first list
+ * and its own address to each word on the second. The intern table,
+ * shapes and property tables are copied with everything else; they
+ * stay valid because they hash contents, not addresses.
+ *
+ * Compiled programs are images too. A clone records what it allocates
+ * while it parses a program, and the blocks reachable from the parsed
+ * function become the program's image. Words that point into the
+ * clone's copy of the template image go on a third list, to be
+ * relocated against the copy of whichever clone loads the program.
+ * Interned strings that the program refers to are copied with it, and
+ * a fourth list holds the words that point to them; loading interns
+ * each copy in the loading clone and sets those words to the result,
+ * so that identical strings stay identical.
+ *
+ * A template made with SEE_interpreter_init_shared_template() also
+ * lets its clones share its cfunction objects. These are never written
+ * after they are made: a cfunction has no properties of its own, and
+ * its [[Put]] and [[Delete]] do nothing. Freezing such a template
+ * copies the reachable cfunctions into one segment, outside the image,
+ * and words of the image that point to them are made to point into
+ * the segment instead of being relocated. Clones, and the programs
+ * they compile, then all use the one copy. The objects a script can
+ * change by assigning to a builtin (String.prototype, Math, ...) are
+ * native objects, and each clone still gets its own copy of those. The
+ * [[Prototype]] a shared cfunction was made with belongs to the
+ * template, so its users take the Function.prototype of the
+ * interpreter at hand instead (see _SEE_CFUNCTION_PROTOTYPE).
+ *
+ * Unlike a collector's, the scan cannot be conservative: a word that
+ * happened to hold the address of a recorded block would be relocated,
+ * and so corrupted, if it were not really a pointer. Data that holds
+ * no pointers (bytecode, character ranges, bitmaps) is allocated with
+ * the string allocators, whose blocks are copied without being
+ * scanned. Every other block that an image reaches must have been
+ * given a layout (see SNAPSHOT_LAYOUT()), which lists the offsets of
+ * its pointers and values; only those words are relocated, and only
+ * the words of values whose type says they hold pointers. Reaching a
+ * scanned block without a layout is a fatal error. Recorded blocks
+ * are cleared when they are allocated, so that the fields an object
+ * has not set yet hold no stale addresses.
+ *
+ * Images store offsets in place of pointers, which assumes that any
+ * offset fits in a pointer word; templates are refused on hosts with
+ * pointers narrower than 64 bits.
+ *
+ * Finalizers are not copied; the template keeps ownership of the
+ * resources they release (compiled PCRE patterns, for instance) and
+ * so must outlive its clones.
+ */
+
+struct record {
+	char *base;			/* start of the block */
+	SEE_size_t size;		/* bytes asked for */
+	unsigned int seq;		/* allocation order */
+	unsigned char atomic;		/* holds no pointers */
+	unsigned char interned;		/* is an interned string */
+	unsigned char shared;		/* goes in the shared segment */
+	const struct snapshot_layout *layout;	/* or NULL */
+	SEE_size_t offset;		/* position in the image or segment */
+};
+
+/* A root word that points into the image or segment */
+struct root {
+	unsigned int word;		/* index of the word among the roots */
+	SEE_size_t offset;		/* image offset it points to */
+	unsigned char shared;		/* offset is in the segment instead */
+};
+
+/* A block of memory that a clone cannot free piecemeal */
+struct range {
+	char *base;
+	SEE_size_t size;
+};
+
+/* A recorded block that was freed before recording stopped */
+struct freed {
+	char *base;
+	unsigned int seq;		/* next allocation's seq at the time */
+};
+
+/* Positions in an image of the words to fix up when it is placed */
+struct image {
+	char *data;
+	SEE_size_t size;
+	char *segment;			/* shared blocks, not copied */
+	unsigned int *reloc;		/* words holding image offsets */
+	unsigned int *ireloc;		/* words holding interp offsets */
+	unsigned int *breloc;		/* words holding template offsets */
+	unsigned int *sreloc;		/* words holding string indicies */
+	unsigned int *strings;		/* offsets of interned strings */
+	struct root *root;		/* root words to set */
+	unsigned int nreloc, nireloc, nbreloc, nsreloc, nstrings, nroot;
+};
+
+struct snapshot {
+	int recording;			/* recording allocations */
+	int share;			/* clones share cfunctions */
+	int busy;			/* growing rec[]; don't record that */
+	struct record *rec;		/* blocks allocated while recording */
+	unsigned int nrec, nsorted, seq;
+	struct SEE_growable grec;
+	struct freed *freed;		/* blocks freed while recording */
+	unsigned int nfreed;
+	struct SEE_growable gfreed;
+	struct image *image;		/* a template's image, once frozen */
+
+	/* Clones only */
+	struct SEE_interpreter *origin;	/* the template cloned */
+	struct range template;		/* copy of the template's image */
+	struct range *placed;		/* copies of images, by address */
+	unsigned int nplaced;
+	struct SEE_growable gplaced;
+};
+
+struct SEE_program {
+	struct SEE_interpreter *origin;	/* template of the compiling clone */
+	struct image image;
+};
+
+/* Record offsets before the blocks are placed in the image */
+#define UNREACHED	((SEE_size_t)-1)
+#define REACHED		0
+
+/* Word size and alignment of blocks in the image */
+union align { double d; void *p; long l; };
+#define ALIGN(n) \
+	(((n) + sizeof (union align) - 1) & ~(sizeof (union align) - 1))
+#define WORD(p)		(*(char **)(p))
+
+static void start(struct SEE_interpreter *, struct snapshot *);
+static void clear_private(struct SEE_interpreter *);
+static int record_cmp(const void *, const void *);
+static int freed_cmp(const void *, const void *);
+static int was_freed(struct snapshot *, struct record *);
+static void sort_records(struct snapshot *);
+static struct record *lookup(struct snapshot *, char *);
+static void add_record(struct SEE_interpreter *, struct snapshot *, void *,
+	SEE_size_t, int, int);
+static int may_point(const struct snapshot_layout *, char *, SEE_size_t,
+	SEE_size_t);
+static void mark_range(struct snapshot *, const struct snapshot_layout *,
+	char *, SEE_size_t, struct record **, unsigned int *);
+static void *export(struct SEE_interpreter *, void *, SEE_size_t);
+static void make_image(struct SEE_interpreter *, struct snapshot *,
+	char *, SEE_size_t, const struct snapshot_layout *,
+	struct SEE_interpreter *, struct image *);
+static char *place(struct SEE_interpreter *, struct snapshot *,
+	struct image *);
+static void add_string(struct SEE_string *, void *);
+
+static const struct snapshot_word pointer_words[] = {
+	{ 0, SNAPSHOT_POINTER },
+	SNAPSHOT_WORDS_END
+};
+const struct snapshot_layout _SEE_snapshot_pointers =
+	{ sizeof (void *), pointer_words };
+
+static const struct snapshot_word value_words[] = {
+	{ 0, SNAPSHOT_VALUE },
+	SNAPSHOT_WORDS_END
+};
+const struct snapshot_layout _SEE_snapshot_values =
+	{ sizeof (struct SEE_value), value_words };
+
+static const struct snapshot_word string_words[] = {
+	SNAPSHOT_PTR(struct SEE_string, data),
+	SNAPSHOT_PTR(struct SEE_string, stringclass),
+	SNAPSHOT_PTR(struct SEE_string, interpreter),
+	SNAPSHOT_WORDS_END
+};
+const struct snapshot_layout _SEE_snapshot_string =
+	{ sizeof (struct SEE_string), string_words };
+
+static const struct snapshot_word native_words[] = {
+	SNAPSHOT_OBJECT(struct SEE_native, object),
+	SNAPSHOT_PTR(struct SEE_native, props.small[0]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[1]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[2]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[3]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[4]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[5]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[6]),
+	SNAPSHOT_PTR(struct SEE_native, props.small[7]),
+	SNAPSHOT_PTR(struct SEE_native, lru),
+	SNAPSHOT_PTR(struct SEE_native, shape),
+	SNAPSHOT_WORDS_END
+};
+const struct snapshot_layout _SEE_snapshot_native =
+	{ sizeof (struct SEE_native), native_words };
+
+/* The roots of a template: its copy of the interpreter's pointers */
+#define ROOT(f)	SNAPSHOT_PTR(struct SEE_interpreter, f)
+static const struct snapshot_word interpreter_words[] = {
+	ROOT(Global), ROOT(Object), ROOT(Object_prototype), ROOT(Error),
+	ROOT(EvalError), ROOT(RangeError), ROOT(ReferenceError),
+	ROOT(SyntaxError), ROOT(TypeError), ROOT(URIError), ROOT(String),
+	ROOT(String_prototype), ROOT(Function), ROOT(Function_prototype),
+	ROOT(Array), ROOT(Array_prototype), ROOT(Number),
+	ROOT(Number_prototype), ROOT(Boolean), ROOT(Boolean_prototype),
+	ROOT(Math), ROOT(RegExp), ROOT(RegExp_prototype), ROOT(Date),
+	ROOT(Date_prototype), ROOT(Global_eval), ROOT(Global_scope),
+	ROOT(module_private), ROOT(intern_tab), ROOT(shape_tab),
+	ROOT(locale), ROOT(sec_domain),
+	SNAPSHOT_WORDS_END
+};
+#undef ROOT
+SNAPSHOT_LAYOUT_DEFINE(interpreter_layout, struct SEE_interpreter,
+	interpreter_words);
+
+/* Starts recording the allocations of a new template */
+void
+_SEE_snapshot_begin(interp, share)
+	struct SEE_interpreter *interp;
+	int share;
+{
+	struct snapshot *snap;
+
+	if (sizeof (void *) < 8)
+		SEE_ABORT(interp, "interpreter templates need 64-bit pointers");
+	snap = SEE_NEW(interp, struct snapshot);
+	snap->recording = 0;
+	snap->share = share;
+	snap->image = NULL;
+	snap->origin = NULL;
+	snap->nplaced = 0;
+	interp->snapshot = snap;
+	start(interp, snap);
+}
+
+/*
+ * Starts recording the allocations of a clone compiling a program.
+ * Throws an Error if the interpreter is not a clone.
+ */
+void
+_SEE_snapshot_record(interp)
+	struct SEE_interpreter *interp;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+
+	if (!snap || !snap->origin)
+		SEE_error_throw(interp, interp->Error,
+		    "programs can only be compiled in a clone");
+	SEE_ASSERT(interp, !snap->recording);
+	start(interp, snap);
+}
+
+static void
+start(interp, snap)
+	struct SEE_interpreter *interp;
+	struct snapshot *snap;
+{
+	snap->busy = 0;
+	snap->seq = 0;
+	snap->nsorted = 0;
+	SEE_GROW_INIT(interp, &snap->grec, snap->rec, snap->nrec);
+	SEE_GROW_INIT(interp, &snap->gfreed, snap->freed, snap->nfreed);
+	snap->gfreed.is_string = 1;
+	snap->recording = 1;
+}
+
+/*
+ * Records a block just allocated. A block that may be scanned is
+ * cleared, so that what its owner leaves unset is not taken for a
+ * pointer.
+ */
+void
+_SEE_snapshot_alloc(interp, p, size, atomic)
+	struct SEE_interpreter *interp;
+	void *p;
+	SEE_size_t size;
+	int atomic;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+
+	if (!snap->recording || snap->busy)
+		return;
+	if (!atomic)
+		memset(p, 0, size);
+	/*
+	 * rec[] is scanned, so it keeps every recorded block alive
+	 * and a collector cannot hand the same memory out twice.
+	 */
+	snap->busy = 1;
+	add_record(interp, snap, p, size, atomic, 0);
+	snap->busy = 0;
+}
+
+/*
+ * Notes that a block is being freed; its record is dropped when the
+ * records are next sorted. Returns false if the block is part of a
+ * clone's copy of an image, which cannot be freed piecemeal.
+ */
+int
+_SEE_snapshot_free(interp, p)
+	struct SEE_interpreter *interp;
+	void *p;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+	unsigned int lo = 0, hi = snap->nplaced, mid;
+	struct range *r;
+
+	if (snap->recording && !snap->busy) {
+		snap->busy = 1;
+		SEE_GROW_TO(interp, &snap->gfreed, snap->nfreed + 1);
+		snap->freed[snap->nfreed - 1].base = (char *)p;
+		snap->freed[snap->nfreed - 1].seq = snap->seq;
+		snap->busy = 0;
+	}
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		r = &snap->placed[mid];
+		if ((char *)p < r->base)
+			hi = mid;
+		else if ((char *)p >= r->base + r->size)
+			lo = mid + 1;
+		else
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Marks the block just allocated at p as one that the clones of a
+ * sharing template can share. It must not be written after the
+ * template is first cloned.
+ */
+void
+_SEE_snapshot_share(interp, p)
+	struct SEE_interpreter *interp;
+	void *p;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+	unsigned int i;
+
+	if (!snap->share || !snap->recording)
+		return;
+	for (i = snap->nrec; i-- > 0; )
+		if (snap->rec[i].base == (char *)p) {
+		    snap->rec[i].shared = 1;
+		    break;
+		}
+}
+
+/*
+ * Gives the block just allocated at p a layout, which says where its
+ * pointers are.
+ */
+void
+_SEE_snapshot_layout(interp, p, layout)
+	struct SEE_interpreter *interp;
+	void *p;
+	const struct snapshot_layout *layout;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+	unsigned int i;
+
+	if (!snap->recording)
+		return;
+	for (i = snap->nrec; i-- > 0; )
+		if (snap->rec[i].base == (char *)p) {
+		    SEE_ASSERT(interp, snap->rec[i].size >= layout->size);
+		    snap->rec[i].layout = layout;
+		    break;
+		}
+}
+
+/* Clears the fields that belong to one interpreter and are not copied */
+static void
+clear_private(interp)
+	struct SEE_interpreter *interp;
+{
+	interp->host_data = NULL;
+	interp->try_context = NULL;
+	interp->try_location = NULL;
+	interp->traceback = NULL;
+	interp->gc_heap = NULL;
+	interp->regex_cache = NULL;
+	interp->number_cache = NULL;
+	interp->dst_cache = NULL;
+	interp->snapshot = NULL;
+}
+
+static int
+record_cmp(a, b)
+	const void *a, *b;
+{
+	const struct record *ra = (const struct record *)a;
+	const struct record *rb = (const struct record *)b;
+
+	return ra->base < rb->base ? -1 : ra->base > rb->base;
+}
+
+static int
+freed_cmp(a, b)
+	const void *a, *b;
+{
+	const struct freed *fa = (const struct freed *)a;
+	const struct freed *fb = (const struct freed *)b;
+
+	if (fa->base != fb->base)
+		return fa->base < fb->base ? -1 : 1;
+	return fa->seq < fb->seq ? -1 : fa->seq > fb->seq;
+}
+
+/* Returns true if a recorded block was freed after it was allocated */
+static int
+was_freed(snap, r)
+	struct snapshot *snap;
+	struct record *r;
+{
+	unsigned int lo = 0, hi = snap->nfreed, mid;
+
+	/* Find the last time the address was freed */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (snap->freed[mid].base <= r->base)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo && snap->freed[lo - 1].base == r->base &&
+	    snap->freed[lo - 1].seq > r->seq;
+}
+
+/*
+ * Sorts the records by address, dropping those of blocks that were
+ * freed. Memory that was freed and allocated again can leave an older
+ * record overlapping a newer one; keep the newer.
+ */
+static void
+sort_records(snap)
+	struct snapshot *snap;
+{
+	struct record *r;
+	unsigned int i, n;
+
+	qsort(snap->rec, snap->nrec, sizeof snap->rec[0], record_cmp);
+	qsort(snap->freed, snap->nfreed, sizeof snap->freed[0], freed_cmp);
+	for (i = n = 0; i < snap->nrec; i++) {
+		r = &snap->rec[i];
+		if (was_freed(snap, r))
+			continue;
+		if (n && r->base < snap->rec[n - 1].base +
+				   snap->rec[n - 1].size)
+		{
+			if (r->seq < snap->rec[n - 1].seq)
+				continue;
+			n--;
+		}
+		snap->rec[n++] = *r;
+	}
+	snap->nrec = snap->nsorted = n;
+}
+
+/* Returns the record of the block containing p, or NULL */
+static struct record *
+lookup(snap, p)
+	struct snapshot *snap;
+	char *p;
+{
+	unsigned int lo = 0, hi = snap->nsorted, mid;
+	struct record *r;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		r = &snap->rec[mid];
+		if (p < r->base)
+			hi = mid;
+		else if (p >= r->base + r->size)
+			lo = mid + 1;
+		else
+			return r;
+	}
+	return NULL;
+}
+
+/* Appends a record */
+static void
+add_record(interp, snap, p, size, atomic, interned)
+	struct SEE_interpreter *interp;
+	struct snapshot *snap;
+	void *p;
+	SEE_size_t size;
+	int atomic, interned;
+{
+	struct record *r;
+
+	SEE_GROW_TO(interp, &snap->grec, snap->nrec + 1);
+	r = &snap->rec[snap->nrec - 1];
+	r->base = (char *)p;
+	r->size = size;
+	r->seq = snap->seq++;
+	r->atomic = atomic;
+	r->interned = interned;
+	r->shared = 0;
+	r->layout = NULL;
+}
+
+/*
+ * Returns true if the word at offset j of a block of the given size
+ * holds a pointer, according to the block's layout. Bytes after the
+ * last whole element hold none.
+ */
+static int
+may_point(layout, base, size, j)
+	const struct snapshot_layout *layout;
+	char *base;
+	SEE_size_t size, j;
+{
+	const struct snapshot_word *w;
+	struct SEE_value *v;
+	SEE_size_t e, o;
+
+	e = j % layout->size;
+	if (j - e + layout->size > size)
+		return 0;
+	for (w = layout->words; w->kind != SNAPSHOT_END; w++)
+	    if (w->kind == SNAPSHOT_POINTER) {
+		if (e == w->offset)
+		    return 1;
+	    } else if (e >= w->offset &&
+		       e < w->offset + sizeof (struct SEE_value))
+	    {
+		o = e - w->offset;
+		v = (struct SEE_value *)(base + j - o);
+		switch (SEE_VALUE_GET_TYPE(v)) {
+		case SEE_STRING:
+		case SEE_OBJECT:
+		    return o == offsetof(struct SEE_value, u);
+		case SEE_REFERENCE:
+		    return o == offsetof(struct SEE_value, u.reference.base) ||
+			o == offsetof(struct SEE_value, u.reference.property);
+		case SEE_COMPLETION:
+		    return o == offsetof(struct SEE_value, u.completion.value);
+		default:
+		    return 0;
+		}
+	    }
+	return 0;
+}
+
+/*
+ * Pushes the unmarked blocks that the pointers in a block point into.
+ */
+static void
+mark_range(snap, layout, base, size, stack, nstackp)
+	struct snapshot *snap;
+	const struct snapshot_layout *layout;
+	char *base;
+	SEE_size_t size;
+	struct record **stack;
+	unsigned int *nstackp;
+{
+	SEE_size_t j;
+	struct record *r;
+
+	for (j = 0; j + sizeof (char *) <= size; j += sizeof (char *))
+		if (may_point(layout, base, size, j) &&
+		    (r = lookup(snap, WORD(base + j))) &&
+		    r->offset == UNREACHED)
+		{
+			r->offset = REACHED;
+			stack[(*nstackp)++] = r;
+		}
+}
+
+/* Returns a copy of an array, allocated against owner */
+static void *
+export(owner, p, size)
+	struct SEE_interpreter *owner;
+	void *p;
+	SEE_size_t size;
+{
+	void *copy;
+
+	if (!size)
+		return NULL;
+	copy = SEE_malloc_string(owner, size);
+	memcpy(copy, p, size);
+	return copy;
+}
+
+#define ADD(interp, g, list, n, value) do {			\
+	SEE_GROW_TO(interp, g, (n) + 1);			\
+	(list)[(n) - 1] = (value);				\
+    } while (0)
+
+/*
+ * Lays out the sorted records reachable from the pointers in a block
+ * of roots as a relocatable image. The image and its lists are
+ * allocated against owner; interp is the recording interpreter.
+ * A scanned block that is reached must have a layout.
+ */
+static void
+make_image(interp, snap, roots, rsize, rlayout, owner, img)
+	struct SEE_interpreter *interp, *owner;
+	struct snapshot *snap;
+	char *roots;
+	SEE_size_t rsize;
+	const struct snapshot_layout *rlayout;
+	struct image *img;
+{
+	struct record *r, *t, **stack;
+	unsigned int i, nstack, *strings;
+	SEE_size_t j, size, ssize;
+	char *p, *w, *tbase = NULL, *tend = NULL;
+	struct image l;
+	struct SEE_growable gr, gi, gb, gs, gst, gro;
+
+	if (snap->origin) {
+		tbase = snap->template.base;
+		tend = tbase + snap->template.size;
+	}
+
+	/* Find the blocks reachable from the roots */
+	for (i = 0; i < snap->nrec; i++)
+		snap->rec[i].offset = UNREACHED;
+	stack = SEE_NEW_ARRAY(interp, struct record *, snap->nrec + 1);
+	nstack = 0;
+	mark_range(snap, rlayout, roots, rsize, stack, &nstack);
+	while (nstack) {
+		r = stack[--nstack];
+		if (r->atomic || r->shared)
+			continue;
+		if (!r->layout) {
+#ifndef NDEBUG
+			dprintf("snapshot: %u byte block at %p\n",
+			    (unsigned int)r->size, r->base);
+#endif
+			SEE_ABORT(interp, "snapshot: block has no layout");
+		}
+		mark_range(snap, r->layout, r->base, r->size, stack, &nstack);
+	}
+	SEE_free(interp, (void **)&stack);
+
+	/* Give them places in the image or segment, in address order */
+	size = ssize = 0;
+	for (i = 0; i < snap->nrec; i++)
+		if (snap->rec[i].offset == UNREACHED)
+			continue;
+		else if (snap->rec[i].shared) {
+			snap->rec[i].offset = ssize;
+			ssize += ALIGN(snap->rec[i].size);
+		} else {
+			snap->rec[i].offset = size;
+			size += ALIGN(snap->rec[i].size);
+		}
+	img->size = size;
+	img->data = (char *)SEE_malloc_string(owner, size);
+	img->segment = ssize ? (char *)SEE_malloc(owner, ssize) : NULL;
+
+	/* Give the interned strings numbers */
+	strings = SEE_NEW_STRING_ARRAY(interp, unsigned int, snap->nrec + 1);
+	SEE_GROW_INIT(interp, &gst, l.strings, l.nstrings);
+	gst.is_string = 1;
+	for (i = 0; i < snap->nrec; i++)
+		if (snap->rec[i].interned &&
+		    snap->rec[i].offset != UNREACHED)
+		{
+			strings[i] = l.nstrings;
+			ADD(interp, &gst, l.strings, l.nstrings,
+			    snap->rec[i].offset);
+		}
+
+	/* Copy them, replacing pointers with offsets and indicies */
+	SEE_GROW_INIT(interp, &gr, l.reloc, l.nreloc);
+	gr.is_string = 1;
+	SEE_GROW_INIT(interp, &gi, l.ireloc, l.nireloc);
+	gi.is_string = 1;
+	SEE_GROW_INIT(interp, &gb, l.breloc, l.nbreloc);
+	gb.is_string = 1;
+	SEE_GROW_INIT(interp, &gs, l.sreloc, l.nsreloc);
+	gs.is_string = 1;
+	SEE_GROW_INIT(interp, &gro, l.root, l.nroot);
+	gro.is_string = 1;
+	for (i = 0; i < snap->nrec; i++) {
+	    r = &snap->rec[i];
+	    if (r->offset == UNREACHED)
+		continue;
+	    if (r->shared) {
+		/* Left as they are, pointing into the template */
+		memcpy(img->segment + r->offset, r->base, r->size);
+		continue;
+	    }
+	    memcpy(img->data + r->offset, r->base, r->size);
+	    if (r->atomic)
+		continue;
+	    for (j = 0; j + sizeof (char *) <= r->size; j += sizeof (char *)) {
+		if (!may_point(r->layout, r->base, r->size, j))
+		    continue;
+		p = WORD(r->base + j);
+		w = img->data + r->offset + j;
+		if (p >= (char *)interp && p < (char *)(interp + 1)) {
+		    *(SEE_size_t *)w = p - (char *)interp;
+		    ADD(interp, &gi, l.ireloc, l.nireloc, r->offset + j);
+		} else if ((t = lookup(snap, p)) && t->shared) {
+		    WORD(w) = img->segment + t->offset + (p - t->base);
+		} else if (t && t->interned &&
+			   p == t->base)
+		{
+		    *(SEE_size_t *)w = strings[t - snap->rec];
+		    ADD(interp, &gs, l.sreloc, l.nsreloc, r->offset + j);
+		} else if (t) {
+		    *(SEE_size_t *)w = t->offset + (p - t->base);
+		    ADD(interp, &gr, l.reloc, l.nreloc, r->offset + j);
+		} else if (p >= tbase && p < tend) {
+		    *(SEE_size_t *)w = p - tbase;
+		    ADD(interp, &gb, l.breloc, l.nbreloc, r->offset + j);
+		}
+	    }
+	}
+	SEE_free(interp, (void **)&strings);
+
+	/* Note which roots point into the image or segment */
+	for (j = 0; j + sizeof (char *) <= rsize; j += sizeof (char *))
+		if (may_point(rlayout, roots, rsize, j) &&
+		    (t = lookup(snap, p = WORD(roots + j))))
+		{
+			SEE_GROW_TO(interp, &gro, l.nroot + 1);
+			l.root[l.nroot - 1].word = j / sizeof (char *);
+			l.root[l.nroot - 1].offset = t->offset + (p - t->base);
+			l.root[l.nroot - 1].shared = t->shared;
+		}
+
+#define EXPORT(f) \
+	img->f = export(owner, l.f, l.n##f * sizeof l.f[0]); \
+	img->n##f = l.n##f
+	EXPORT(reloc);
+	EXPORT(ireloc);
+	EXPORT(breloc);
+	EXPORT(sreloc);
+	EXPORT(strings);
+	EXPORT(root);
+#undef EXPORT
+}
+
+/*
+ * Copies an image into a new block of a clone, relocates it and
+ * interns its strings. Returns the copy.
+ */
+static char *
+place(interp, snap, img)
+	struct SEE_interpreter *interp;
+	struct snapshot *snap;
+	struct image *img;
+{
+	char *base, *tbase, *w;
+	struct SEE_string **strings, *s;
+	unsigned int i, lo, hi, mid;
+
+	base = (char *)SEE_malloc(interp, img->size);
+	memcpy(base, img->data, img->size);
+	tbase = snap->template.base;
+	for (i = 0; i < img->nreloc; i++) {
+		w = base + img->reloc[i];
+		WORD(w) = base + *(SEE_size_t *)w;
+	}
+	for (i = 0; i < img->nireloc; i++) {
+		w = base + img->ireloc[i];
+		WORD(w) = (char *)interp + *(SEE_size_t *)w;
+	}
+	for (i = 0; i < img->nbreloc; i++) {
+		w = base + img->breloc[i];
+		WORD(w) = tbase + *(SEE_size_t *)w;
+	}
+
+	/* Keep the copies in address order, for _SEE_snapshot_free() */
+	lo = 0;
+	hi = snap->nplaced;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (snap->placed[mid].base < base)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	SEE_GROW_TO(interp, &snap->gplaced, snap->nplaced + 1);
+	memmove(&snap->placed[lo + 1], &snap->placed[lo],
+	    (snap->nplaced - 1 - lo) * sizeof snap->placed[0]);
+	snap->placed[lo].base = base;
+	snap->placed[lo].size = img->size;
+
+	if (img->nstrings) {
+	    /* Use the clone's own string where it has one already */
+	    strings = SEE_ALLOCA(interp, struct SEE_string *, img->nstrings);
+	    for (i = 0; i < img->nstrings; i++) {
+		s = (struct SEE_string *)(base + img->strings[i]);
+		s->flags &= ~SEE_STRING_FLAG_INTERNED;
+		strings[i] = SEE_intern(interp, s);
+	    }
+	    for (i = 0; i < img->nsreloc; i++) {
+		w = base + img->sreloc[i];
+		WORD(w) = (char *)strings[*(SEE_size_t *)w];
+	    }
+	}
+	return base;
+}
+
+/* Makes interp a copy of the template from */
+void
+_SEE_snapshot_clone(interp, from)
+	struct SEE_interpreter *interp, *from;
+{
+	struct snapshot *snap = (struct snapshot *)from->snapshot;
+	struct snapshot *copy;
+	struct SEE_interpreter roots;
+	void *host_data = interp->host_data;
+	unsigned int i;
+	char *base;
+
+	SEE_ASSERT(from, !snap->origin);
+	if (!snap->image) {
+		/* Freeze the template */
+		snap->recording = 0;
+		sort_records(snap);
+		roots = *from;
+		clear_private(&roots);
+		snap->image = SEE_NEW(from, struct image);
+		make_image(from, snap, (char *)&roots, sizeof roots,
+		    &interpreter_layout, from, snap->image);
+		SEE_free(from, (void **)&snap->rec);
+		SEE_free(from, (void **)&snap->freed);
+		snap->nrec = snap->nsorted = snap->nfreed = 0;
+	}
+
+	*interp = *from;
+	clear_private(interp);
+	interp->host_data = host_data;
+	interp->random_seed = (*SEE_system.random_seed)();
+
+	copy = SEE_NEW(interp, struct snapshot);
+	copy->recording = 0;
+	copy->share = 0;
+	copy->nrec = 0;
+	copy->image = NULL;
+	copy->origin = from;
+	copy->template.base = NULL;
+	SEE_GROW_INIT(interp, &copy->gplaced, copy->placed, copy->nplaced);
+	copy->gplaced.is_string = 1;
+
+	base = place(interp, copy, snap->image);
+	copy->template.base = base;
+	copy->template.size = snap->image->size;
+	for (i = 0; i < snap->image->nroot; i++)
+		((char **)interp)[snap->image->root[i].word] =
+		    (snap->image->root[i].shared ? snap->image->segment : base)
+		    + snap->image->root[i].offset;
+	interp->snapshot = copy;
+}
+
+/* Records the interned strings that a program may refer to */
+static void
+add_string(s, closure)
+	struct SEE_string *s;
+	void *closure;
+{
+	struct SEE_interpreter *interp = s->interpreter;
+	struct snapshot *snap = (struct snapshot *)closure;
+	struct record *r;
+	char *tbase = snap->template.base;
+	char *p = (char *)s;
+
+	if (p >= tbase && p < tbase + snap->template.size)
+		return;			/* every clone has these */
+	if ((r = lookup(snap, p))) {
+		if (r->base == p)
+			r->interned = 1;
+		return;
+	}
+	/* Interned before recording began */
+	add_record(interp, snap, s, sizeof *s, 0, 1);
+	snap->rec[snap->nrec - 1].layout = &_SEE_snapshot_string;
+	p = (char *)s->data;
+	if (s->length && !lookup(snap, p) &&
+	    !(p >= tbase && p < tbase + snap->template.size))
+		add_record(interp, snap, p, s->length * sizeof s->data[0],
+		    1, 0);
+}
+
+/*
+ * Stops recording and makes a program image of the function f and
+ * the blocks reachable from it. Returns NULL if f is NULL.
+ */
+struct SEE_program *
+_SEE_snapshot_program(interp, f)
+	struct SEE_interpreter *interp;
+	void *f;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+	struct SEE_program *program = NULL;
+	char *root = (char *)f;
+
+	snap->recording = 0;
+	if (f) {
+		sort_records(snap);
+		_SEE_intern_foreach(interp, add_string, snap);
+		sort_records(snap);
+
+		/* Programs outlive the interpreters that compile them */
+		program = SEE_NEW(NULL, struct SEE_program);
+		program->origin = snap->origin;
+		make_image(interp, snap, (char *)&root, sizeof root,
+		    &_SEE_snapshot_pointers, NULL, &program->image);
+	}
+	SEE_free(interp, (void **)&snap->rec);
+	SEE_free(interp, (void **)&snap->freed);
+	snap->nrec = snap->nsorted = snap->nfreed = 0;
+	return program;
+}
+
+/*
+ * Copies a program into a clone, returning its function. Throws an
+ * Error if the interpreter is not a clone of the program's template.
+ */
+void *
+_SEE_snapshot_load(interp, program)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+{
+	struct snapshot *snap = (struct snapshot *)interp->snapshot;
+	char *base;
+
+	if (!snap || !snap->origin || snap->origin != program->origin)
+		SEE_error_throw(interp, interp->Error,
+		    "program was compiled for another template");
+	base = place(interp, snap, &program->image);
+	return base + program->image.root[0].offset;
+}
+
+/*
+ * Frees a program's image. Clones that have run it keep their copies,
+ * but may still point into its segment.
+ */
+void
+_SEE_snapshot_program_free(program)
+	struct SEE_program *program;
+{
+	struct image *img = &program->image;
+
+	SEE_free(NULL, (void **)&img->data);
+	SEE_free(NULL, (void **)&img->segment);
+	SEE_free(NULL, (void **)&img->reloc);
+	SEE_free(NULL, (void **)&img->ireloc);
+	SEE_free(NULL, (void **)&img->breloc);
+	SEE_free(NULL, (void **)&img->sreloc);
+	SEE_free(NULL, (void **)&img->strings);
+	SEE_free(NULL, (void **)&img->root);
+	SEE_free(NULL, (void **)&program);
+}
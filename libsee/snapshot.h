@@ -0,0 +1,102 @@
+/* Copyright (c) 2007, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_snapshot_
+#define _SEE_h_snapshot_
+
+#include <stddef.h>
+#include <see/type.h>
+
+struct SEE_interpreter;
+struct SEE_program;
+struct snapshot_layout;
+
+/*
+ * A template interpreter records the blocks it allocates, so that
+ * the heap reachable from it can be copied into new interpreters.
+ * The allocation hooks below are called from mem.c only when the
+ * interpreter's snapshot field is set.
+ */
+void	_SEE_snapshot_begin(struct SEE_interpreter *interp, int share);
+void	_SEE_snapshot_alloc(struct SEE_interpreter *interp, void *p,
+		SEE_size_t size, int atomic);
+int	_SEE_snapshot_free(struct SEE_interpreter *interp, void *p);
+void	_SEE_snapshot_share(struct SEE_interpreter *interp, void *p);
+void	_SEE_snapshot_layout(struct SEE_interpreter *interp, void *p,
+		const struct snapshot_layout *layout);
+void	_SEE_snapshot_clone(struct SEE_interpreter *interp,
+		struct SEE_interpreter *from);
+
+/*
+ * The layout of a scanned block that can be copied into an image.
+ * The block is an array of elements of the given size, and only the
+ * words listed for an element are relocated: pointers, and the
+ * pointers that values hold. Every scanned block that an image
+ * reaches must have a layout.
+ */
+struct snapshot_word {
+	SEE_size_t offset;
+	int kind;
+};
+#define SNAPSHOT_END		0
+#define SNAPSHOT_POINTER	1	/* a pointer */
+#define SNAPSHOT_VALUE		2	/* a struct SEE_value */
+
+struct snapshot_layout {
+	SEE_size_t size;		/* of an element */
+	const struct snapshot_word *words;	/* ends with SNAPSHOT_END */
+};
+
+/* Entries of a struct snapshot_word list */
+#define SNAPSHOT_PTR(t, f)	{ offsetof(t, f), SNAPSHOT_POINTER }
+#define SNAPSHOT_VAL(t, f)	{ offsetof(t, f), SNAPSHOT_VALUE }
+#define SNAPSHOT_WORDS_END	{ 0, SNAPSHOT_END }
+
+/* The pointers of a struct SEE_growable member */
+#define SNAPSHOT_GROWABLE(t, f)						\
+	SNAPSHOT_PTR(t, f.data_ptr), SNAPSHOT_PTR(t, f.length_ptr)
+
+/* The pointers of a struct SEE_object member */
+#define SNAPSHOT_OBJECT(t, f)						\
+	SNAPSHOT_PTR(t, f.objectclass), SNAPSHOT_PTR(t, f.Prototype),	\
+	SNAPSHOT_PTR(t, f.host_data)
+
+/* The pointers of a struct SEE_native member (SEE_NATIVE_SMALL is 8) */
+#define SNAPSHOT_NATIVE(t, f)						\
+	SNAPSHOT_OBJECT(t, f.object),					\
+	SNAPSHOT_PTR(t, f.props.small[0]), SNAPSHOT_PTR(t, f.props.small[1]), \
+	SNAPSHOT_PTR(t, f.props.small[2]), SNAPSHOT_PTR(t, f.props.small[3]), \
+	SNAPSHOT_PTR(t, f.props.small[4]), SNAPSHOT_PTR(t, f.props.small[5]), \
+	SNAPSHOT_PTR(t, f.props.small[6]), SNAPSHOT_PTR(t, f.props.small[7]), \
+	SNAPSHOT_PTR(t, f.lru), SNAPSHOT_PTR(t, f.shape)
+
+/* Defines a layout for structures of type t from a list of words */
+#define SNAPSHOT_LAYOUT_DEFINE(name, t, words)				\
+	static const struct snapshot_layout name = { sizeof (t), words }
+
+/*
+ * Layouts of arrays of pointers and of values, of plain strings and of
+ * plain native objects
+ */
+extern const struct snapshot_layout _SEE_snapshot_pointers;
+extern const struct snapshot_layout _SEE_snapshot_values;
+extern const struct snapshot_layout _SEE_snapshot_string;
+extern const struct snapshot_layout _SEE_snapshot_native;
+
+/* Gives the block just allocated at p a layout, if it is recorded */
+#define SNAPSHOT_LAYOUT(interp, p, layout) do {				\
+	if ((interp) && (interp)->snapshot)				\
+	    _SEE_snapshot_layout(interp, p, layout);			\
+    } while (0)
+
+/*
+ * A clone records what it allocates while it compiles a program, so
+ * that the program can be copied into other clones of its template.
+ */
+void	_SEE_snapshot_record(struct SEE_interpreter *interp);
+struct SEE_program *_SEE_snapshot_program(struct SEE_interpreter *interp,
+		void *f);
+void   *_SEE_snapshot_load(struct SEE_interpreter *interp,
+		struct SEE_program *program);
+void	_SEE_snapshot_program_free(struct SEE_program *program);
+
+#endif /* _SEE_h_snapshot_ */
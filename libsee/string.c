@@ -53,13 +53,15 @@
 
 #include "stringdefs.h"
 #include "printf.h"
+#include "snapshot.h"
 
 static void growby(struct SEE_string *s, unsigned int extra);
 static void simple_growby(struct SEE_string *s, unsigned int extra);
 static void string_append_int(struct SEE_string *s, unsigned int i);
 
 static struct SEE_stringclass fixed_stringclass = {
-	0						/* growby */
+	0,						/* growby */
+	0						/* flatten */
 };
 
 #define IS_GROWABLE(s)	((s)->stringclass && (s)->stringclass->growby)
@@ -117,11 +119,13 @@ _SEE_string_dup_fix(interp, s)
 {
 	struct SEE_string *cp;
 
+	SEE_STRING_FLATTEN(s);
 	if (s->interpreter == interp && !IS_GROWABLE(s))
 	    return s;
 	if (!s->length)
 	    return STR(empty_string);
 	cp = SEE_NEW(interp, struct SEE_string);
+	SNAPSHOT_LAYOUT(interp, cp, &_SEE_snapshot_string);
 	cp->length = s->length;
 	cp->data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, cp->length);
 	memcpy(cp->data, s->data, sizeof *cp->data * cp->length);
@@ -162,7 +166,9 @@ SEE_string_substr(interp, s, start, len)
 	 || (unsigned int)(start + len) > s->length)
 		SEE_error_throw_string(interp, interp->Error, STR(bad_arg));
 
+	SEE_STRING_FLATTEN(s);
 	subs = SEE_NEW(interp, struct SEE_string);
+	SNAPSHOT_LAYOUT(interp, subs, &_SEE_snapshot_string);
 	subs->length = len;
 	subs->data = s->data + start;
 	subs->interpreter = interp;
@@ -187,6 +193,8 @@ SEE_string_cmp(a, b)
 	if (a == b)
 		return 0;
 
+	SEE_STRING_FLATTEN(a);
+	SEE_STRING_FLATTEN(b);
 	ap = a->data; alen = a->length;
 	bp = b->data; blen = b->length;
 
@@ -218,6 +226,7 @@ SEE_string_cmp_ascii(a, b)
 {
 	unsigned int i;
 
+	SEE_STRING_FLATTEN(a);
 	for (i = 0; i < a->length && b[i]; i++) {
 	    if (b[i] & 0x80)
 		return -1;
@@ -229,6 +238,148 @@ SEE_string_cmp_ascii(a, b)
 	return 1;
 }
 
+/*
+ * Substring search.
+ *
+ * A needle shorter than SEARCH_LONG characters is found by scanning
+ * the haystack for its first character, four characters to a 64-bit
+ * word, and comparing the rest of the needle wherever that character
+ * turns up. Longer needles use Horspool's method: the character under
+ * the end of the needle picks how far the needle can slide before it
+ * could next match. The skip table is indexed by the low byte of each
+ * character, which keeps it small and only ever shortens a skip.
+ */
+
+#define SEARCH_LONG	8
+
+/* Returns the index of the first c in p[0..n-1], or -1 */
+static int
+search_char(p, n, c)
+	const SEE_char_t *p;
+	unsigned int n;
+	SEE_char_t c;
+{
+	SEE_uint64_t ones, highs, pattern, w;
+	unsigned int i = 0;
+
+	if (sizeof w == 4 * sizeof *p) {
+		ones = ((SEE_uint64_t)0x00010001 << 16 << 16) | 0x00010001;
+		highs = ones << 15;
+		pattern = ones * c;
+		/* Stop at the first word with a lane equal to c */
+		for (; i + 4 <= n; i += 4) {
+			memcpy(&w, p + i, sizeof w);
+			w ^= pattern;
+			if ((w - ones) & ~w & highs)
+				break;
+		}
+	}
+	for (; i < n; i++)
+		if (p[i] == c)
+			return i;
+	return -1;
+}
+
+/*
+ * Returns the index of the first occurrence of t in s at or after
+ * start, or -1 if there is none.
+ */
+int
+_SEE_string_search(s, t, start)
+	const struct SEE_string *s, *t;
+	unsigned int start;
+{
+	const SEE_char_t *hp, *np;
+	unsigned int n, m, k, last, i;
+	unsigned int skip[256];
+	int found;
+
+	n = s->length;
+	m = t->length;
+	if (m > n || start > n - m)
+		return -1;
+	if (m == 0)
+		return start;
+	SEE_STRING_FLATTEN(s);
+	SEE_STRING_FLATTEN(t);
+	hp = s->data;
+	np = t->data;
+	last = n - m;
+
+	if (m < SEARCH_LONG) {
+		for (k = start; k <= last; k++) {
+			found = search_char(hp + k, last - k + 1, np[0]);
+			if (found < 0)
+				break;
+			k += found;
+			if (memcmp(hp + k + 1, np + 1, 
+			    (m - 1) * sizeof (SEE_char_t)) == 0)
+				return k;
+		}
+		return -1;
+	}
+
+	for (i = 0; i < 256; i++)
+		skip[i] = m;
+	for (i = 0; i < m - 1; i++)
+		skip[np[i] & 0xff] = m - 1 - i;
+	for (k = start; k <= last; k += skip[hp[k + m - 1] & 0xff])
+		if (hp[k + m - 1] == np[m - 1] &&
+		    memcmp(hp + k, np, (m - 1) * sizeof (SEE_char_t)) == 0)
+			return k;
+	return -1;
+}
+
+/*
+ * Returns the index of the last occurrence of t in s that starts
+ * at or before start, or -1 if there is none.
+ */
+int
+_SEE_string_rsearch(s, t, start)
+	const struct SEE_string *s, *t;
+	unsigned int start;
+{
+	const SEE_char_t *hp, *np;
+	unsigned int n, m, k, i;
+	unsigned int skip[256];
+
+	n = s->length;
+	m = t->length;
+	if (m > n)
+		return -1;
+	k = start < n - m ? start : n - m;
+	if (m == 0)
+		return k;
+	SEE_STRING_FLATTEN(s);
+	SEE_STRING_FLATTEN(t);
+	hp = s->data;
+	np = t->data;
+
+	if (m < SEARCH_LONG) {
+		for (;; k--) {
+			if (hp[k] == np[0] && memcmp(hp + k + 1, np + 1,
+			    (m - 1) * sizeof (SEE_char_t)) == 0)
+				return k;
+			if (k == 0)
+				return -1;
+		}
+	}
+
+	/* Horspool backwards, keyed on the character under the needle's start */
+	for (i = 0; i < 256; i++)
+		skip[i] = m;
+	for (i = m - 1; i > 0; i--)
+		skip[np[i] & 0xff] = i;
+	for (;;) {
+		if (hp[k] == np[0] && memcmp(hp + k + 1, np + 1,
+		    (m - 1) * sizeof (SEE_char_t)) == 0)
+			return k;
+		if (skip[hp[k] & 0xff] > k)
+			return -1;
+		k -= skip[hp[k] & 0xff];
+	}
+}
+
 /*
  * Appends character c to the end of string s.
  */
@@ -270,6 +421,7 @@ SEE_string_append(s, t)
 {
 	ASSERT_GROWABLE(s);
 	if (t->length) {
+	    SEE_STRING_FLATTEN(t);
 	    growby(s, t->length);
 	    memcpy(s->data + s->length, t->data, 
 		t->length * sizeof (SEE_char_t));
@@ -342,6 +494,7 @@ SEE_string_fputs(s, f)
 
 #define OUTPUT(c) do { if (fputc(c, f) == EOF) goto error; } while (0)
 
+	SEE_STRING_FLATTEN(s);
 	for (i = 0; i < s->length; i++) {
 		ch = s->data[i];
 		if ((ch & 0xff80) == 0) 
@@ -383,6 +536,16 @@ struct simple_string {
 	struct SEE_growable grow;
 };
 
+static const struct snapshot_word simple_string_words[] = {
+	SNAPSHOT_PTR(struct simple_string, string.data),
+	SNAPSHOT_PTR(struct simple_string, string.stringclass),
+	SNAPSHOT_PTR(struct simple_string, string.interpreter),
+	SNAPSHOT_GROWABLE(struct simple_string, grow),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(simple_string_layout, struct simple_string,
+	simple_string_words);
+
 /* 
  * Grows the string storage to have at least current+extra elements of storage.
  * Simple strings never shrink. 
@@ -406,7 +569,8 @@ simple_growby(s, extra)
 }
 
 static struct SEE_stringclass simple_stringclass = {
-	simple_growby					/* growby */
+	simple_growby,					/* growby */
+	0						/* flatten */
 };
 
 /*
@@ -421,6 +585,7 @@ SEE_string_new(interp, space)
 {
 	struct simple_string *ss = SEE_NEW(interp, struct simple_string);
 
+	SNAPSHOT_LAYOUT(interp, ss, &simple_string_layout);
 	ss->string.interpreter = interp;
 	ss->string.flags = 0;
 	SEE_GROW_INIT(interp, &ss->grow, ss->string.data, ss->string.length);
@@ -477,6 +642,7 @@ SEE_string_literal(interp, s)
 	if (s == NULL)
 		return NULL;
 
+	SEE_STRING_FLATTEN(s);
 	lit = SEE_string_new(interp, 0);
 	SEE_string_addch(lit, '\"');
 	for (i = 0; i < s->length; i++) {
@@ -555,6 +721,7 @@ SEE_string_utf8_size(interp, s)
 	unsigned int i;
 	SEE_char_t ch, ch2;
 
+	SEE_STRING_FLATTEN(s);
 	len = 0;
 	for (i = 0; i < s->length; i++) {
 		ch = s->data[i];
@@ -600,6 +767,7 @@ SEE_string_toutf8(interp, buf, buflen, s)
 	buflen--; 				\
     } while (0)
 
+	SEE_STRING_FLATTEN(s);
 	for (i = 0; i < s->length; i++) {
 		ch = s->data[i];
 		if ((ch & 0xff80) == 0) 
@@ -651,6 +819,7 @@ simple_concat(interp, a, b)
 
 	/* Copy a to cp, carefully moving the SEE_growable structure  */
 	cp = SEE_NEW(interp, struct simple_string);
+	SNAPSHOT_LAYOUT(interp, cp, &simple_string_layout);
 	memcpy(cp, a, sizeof (struct simple_string));
 	cp->grow.data_ptr = /* (void**) */&cp->string.data;
 	cp->grow.length_ptr = &cp->string.length;
@@ -664,6 +833,117 @@ simple_concat(interp, a, b)
 	return (struct SEE_string *)cp;
 }
 
+/*------------------------------------------------------------
+ * The rope string class
+ *
+ * A rope is the concatenation of two other strings, made without
+ * copying either of them. Its content is assembled the first time
+ * it is needed, after which the rope becomes a growable simple
+ * string so that appending to it again is cheap. Building a long
+ * string from many pieces therefore copies each piece only once,
+ * whichever end the pieces are added to.
+ */
+struct rope_string {
+	struct simple_string simple;	/* becomes this once flattened */
+	struct SEE_string *left, *right;
+	unsigned int depth;		/* longest path to a leaf */
+};
+
+static const struct snapshot_word rope_string_words[] = {
+	SNAPSHOT_PTR(struct rope_string, simple.string.data),
+	SNAPSHOT_PTR(struct rope_string, simple.string.stringclass),
+	SNAPSHOT_PTR(struct rope_string, simple.string.interpreter),
+	SNAPSHOT_GROWABLE(struct rope_string, simple.grow),
+	SNAPSHOT_PTR(struct rope_string, left),
+	SNAPSHOT_PTR(struct rope_string, right),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(rope_string_layout, struct rope_string,
+	rope_string_words);
+
+/* Concatenations shorter than this are copied immediately */
+#define ROPE_MIN	128
+
+static void rope_flatten(struct SEE_string *s);
+
+static struct SEE_stringclass rope_stringclass = {
+	0,						/* growby */
+	rope_flatten					/* flatten */
+};
+
+#define IS_ROPE(s)	((s)->stringclass == &rope_stringclass)
+#define ROPE_DEPTH(s)	(IS_ROPE(s) ? ((struct rope_string *)(s))->depth : 0)
+
+/* Makes a rope of two strings */
+static struct SEE_string *
+rope_new(interp, a, b)
+	struct SEE_interpreter *interp;
+	struct SEE_string *a, *b;
+{
+	struct rope_string *rs = SEE_NEW(interp, struct rope_string);
+	unsigned int da = ROPE_DEPTH(a), db = ROPE_DEPTH(b);
+
+	SNAPSHOT_LAYOUT(interp, rs, &rope_string_layout);
+	rs->simple.string.length = a->length + b->length;
+	rs->simple.string.data = NULL;
+	rs->simple.string.stringclass = &rope_stringclass;
+	rs->simple.string.interpreter = interp;
+	rs->simple.string.flags = 0;
+	rs->left = a;
+	rs->right = b;
+	rs->depth = (da > db ? da : db) + 1;
+	return (struct SEE_string *)rs;
+}
+
+/*
+ * Copies the leaves of a rope into a new array, last leaf first.
+ * The stack of pending subtrees never holds more than one left
+ * subtree for each level of the tree, so it is bounded by the depth.
+ */
+static void
+rope_flatten(s)
+	struct SEE_string *s;
+{
+	struct rope_string *rs = (struct rope_string *)s;
+	struct SEE_interpreter *interp = s->interpreter;
+	struct SEE_string **stack, *t;
+	struct SEE_growable grow;
+	SEE_char_t *data;
+	unsigned int sp, pos, len;
+
+	/* Storage is grown aside so that a failure leaves the rope intact */
+	SEE_GROW_INIT(interp, &grow, data, len);
+	grow.is_string = 1;
+	SEE_grow_to(interp, &grow, s->length);
+
+	stack = SEE_NEW_ARRAY(interp, struct SEE_string *, rs->depth + 1);
+	sp = 0;
+	stack[sp++] = rs->left;
+	stack[sp++] = rs->right;
+	pos = len;
+	while (sp) {
+	    t = stack[--sp];
+	    if (IS_ROPE(t)) {
+		stack[sp++] = ((struct rope_string *)t)->left;
+		stack[sp++] = ((struct rope_string *)t)->right;
+	    } else if (t->length) {
+		pos -= t->length;
+		memcpy(data + pos, t->data, t->length * sizeof (SEE_char_t));
+	    }
+	}
+	SEE_ASSERT(interp, pos == 0);
+	SEE_free(interp, (void **)&stack);
+
+	s->data = data;
+	rs->simple.grow = grow;
+	rs->simple.grow.data_ptr = (void **)&s->data;
+	rs->simple.grow.length_ptr = &s->length;
+	s->stringclass = &simple_stringclass;
+
+	/* Let the parts be collected */
+	rs->left = rs->right = NULL;
+}
+
 /*
  * Concatenates two strings together and return the resulting string.
  * May return one of the original strings, or a new string altogether.
@@ -684,6 +964,11 @@ SEE_string_concat(interp, a, b)
 	if (a->stringclass == &simple_stringclass) 
 		return simple_concat(interp, (struct simple_string *)a, b);
 
+	if (a->length + b->length >= ROPE_MIN)
+		return rope_new(interp, a, b);
+
+	SEE_STRING_FLATTEN(a);
+	SEE_STRING_FLATTEN(b);
 	s = SEE_string_new(interp, a->length + b->length);
 	if (a->length)
 		memcpy(s->data, a->data, a->length * sizeof (SEE_char_t));
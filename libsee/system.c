@@ -56,6 +56,7 @@
 
 #include <see/interpreter.h>
 #include <see/system.h>
+#include <see/intern.h>
 
 #include "dprint.h"
 #include "platform.h"
@@ -389,4 +390,6 @@ SEE_init()
 	initialised = 1;
 
 	SEE_regex_init();
+	/* Before threads can race to create the first interpreters */
+	_SEE_intern_global_init();
 }
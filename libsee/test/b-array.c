@@ -0,0 +1,87 @@
+#include "bench.inc"
+
+/*
+ * Measures filling, reading and updating array elements from scripts,
+ * with numeric indices, and the Array.prototype methods on them.
+ */
+
+static const char setup[] =
+	"function fill(n) {\n"
+	"  var a = [], i;\n"
+	"  for (i = 0; i < n; i++) a[i] = i;\n"
+	"  return a;\n"
+	"}\n"
+	"var data = fill(1000);\n"
+	"function sum(n) {\n"
+	"  var s = 0, i;\n"
+	"  for (i = 0; i < n; i++) s += data[i % 1000];\n"
+	"  return s;\n"
+	"}\n"
+	"function update(n) {\n"
+	"  var i;\n"
+	"  for (i = 0; i < n; i++) data[i % 1000]++;\n"
+	"  return data[0];\n"
+	"}\n"
+	"function push(n) {\n"
+	"  var a = [], i;\n"
+	"  for (i = 0; i < n; i++) a.push(i);\n"
+	"  return a.length;\n"
+	"}\n"
+	"function records(n) {\n"
+	"  var a = [], i, x = 1;\n"
+	"  for (i = 0; i < n; i++) { x = (x * 69069 + 1) % 65536; a[i] = x; }\n"
+	"  return a;\n"
+	"}\n"
+	"function sort(n) { return records(n).sort().length; }\n"
+	"function sortfn(n) {\n"
+	"  return records(n).sort(function (a, b) { return a - b; }).length;\n"
+	"}\n"
+	"function join(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i += 1000) s += data.join().length;\n"
+	"  return s;\n"
+	"}\n"
+	"function queue(n) {\n"
+	"  var q = fill(100), i;\n"
+	"  for (i = 0; i < n; i++) q.push(q.shift());\n"
+	"  return q[0];\n"
+	"}\n";
+
+/* Times a script function called with n */
+static void
+time_call(interp, fn, n, label)
+	struct SEE_interpreter *interp;
+	const char *fn;
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_value res;
+	char buf[80];
+
+	sprintf(buf, "%s(%lu)", fn, n);
+	BENCH_START();
+	bench_eval(interp, buf, &res);
+	BENCH_STOP(label, n);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(200000);
+
+	BENCH_DESCRIBE("array elements");
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	time_call(interp, "fill", n, "fill a[i] = i");
+	time_call(interp, "sum", n, "read a[i]");
+	time_call(interp, "update", n, "update a[i]++");
+	time_call(interp, "push", n, "push()");
+	time_call(interp, "sort", n / 2, "sort() numbers, per element");
+	time_call(interp, "sortfn", n / 2, "sort(fn) numbers, per element");
+	time_call(interp, "join", n, "join(), per element");
+	time_call(interp, "queue", n, "push(shift()) on 100 elements");
+}
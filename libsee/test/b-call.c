@@ -0,0 +1,89 @@
+#include "bench.inc"
+
+/*
+ * Measures calls to script functions and the use of their parameters 
+ * and vars, which are kept in a frame when nothing can observe the
+ * function's activation object, and the cost of try blocks and
+ * exceptions around them.
+ */
+
+static const char setup[] =
+	"function fib(n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+	"function add3(a, b, c) { var t = a + b; return t + c; }\n"
+	"function calls(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s = add3(s, i, 1);\n"
+	"  return s;\n"
+	"}\n"
+	"function locals(n) {\n"
+	"  var i, a = 0, b = 1, t;\n"
+	"  for (i = 0; i < n; i++) { t = a + b; a = b; b = t % 1000; }\n"
+	"  return a;\n"
+	"}\n"
+	"function observed(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s = s + arguments.length;\n"
+	"  return s;\n"
+	"}\n"
+	"function argc() { return arguments.length; }\n"
+	"function actcalls(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s += argc(i, s);\n"
+	"  return s;\n"
+	"}\n"
+	"function guarded(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) try { s = add3(s, i, 1); } catch (e) { }\n"
+	"  return s;\n"
+	"}\n"
+	"function thrower(i) { throw i; }\n"
+	"function catches(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) try { throw i; } catch (e) { s += e; }\n"
+	"  for (i = 0; i < n; i++) try { thrower(i); } catch (e) { s += e; }\n"
+	"  return s;\n"
+	"}\n";
+
+/* Times a script expression that performs ops operations */
+static void
+time_expr(interp, expr, ops, label)
+	struct SEE_interpreter *interp;
+	const char *expr;
+	unsigned long ops;
+	const char *label;
+{
+	struct SEE_value res;
+
+	BENCH_START();
+	bench_eval(interp, expr, &res);
+	BENCH_STOP(label, ops);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(200000);
+	char buf[80];
+
+	BENCH_DESCRIBE("script function calls and local variables");
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	/* fib(k) makes 2 * fib(k + 1) - 1 calls */
+	time_expr(interp, "fib(20)", 21891, "call, recursive");
+	sprintf(buf, "calls(%lu)", n);
+	time_expr(interp, buf, n, "call, three arguments");
+	sprintf(buf, "locals(%lu)", n);
+	time_expr(interp, buf, n, "loop over locals");
+	sprintf(buf, "observed(%lu)", n);
+	time_expr(interp, buf, n, "loop, activation object");
+	sprintf(buf, "actcalls(%lu)", n);
+	time_expr(interp, buf, n, "call, activation object");
+	sprintf(buf, "guarded(%lu)", n);
+	time_expr(interp, buf, n, "call inside try");
+	sprintf(buf, "catches(%lu)", n / 2);
+	time_expr(interp, buf, n, "throw and catch");
+}
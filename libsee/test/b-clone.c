@@ -0,0 +1,142 @@
+#include "bench.inc"
+
+/*
+ * Compares the cost of starting an interpreter from scratch with
+ * cloning one from a template, as a server would for each request,
+ * and of evaluating a script with running it precompiled. Also
+ * compares the memory each clone takes when it has its own copy of the
+ * built-in functions with when it shares the template's.
+ * Like ssp, each request's interpreter allocates from a pool that is
+ * emptied when the request is done.
+ */
+
+#define POOL_SIZE	(1024 * 1024)
+
+static const char page[] =
+	"function row(k, v) { return '<tr><td>' + k + '</td><td>' + v +\n"
+	"    '</td></tr>'; }\n"
+	"var out = [], data = { name: 'see', kind: 'engine', year: 2007 };\n"
+	"for (var k in data) out.push(row(k, data[k]));\n"
+	"out.join('\\n');\n";
+
+static char *pool;
+static SEE_size_t pool_used;
+static void *(*system_malloc)(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+
+/* Allocates from the pool for request interpreters */
+static void *
+pool_malloc(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	void *p;
+
+	if (!interp || !interp->host_data)
+		return (*system_malloc)(interp, size, file, line);
+	size = (size + 7) & ~(SEE_size_t)7;
+	if (pool_used + size > POOL_SIZE)
+		return NULL;
+	p = pool + pool_used;
+	pool_used += size;
+	return p;
+}
+
+static void
+pool_free(interp, p, file, line)
+	struct SEE_interpreter *interp;
+	void *p;
+	const char *file;
+	int line;
+{
+}
+
+void
+bench()
+{
+	struct SEE_interpreter tmpl, stmpl, interp;
+	struct SEE_input *input;
+	struct SEE_program *program;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(20000), i;
+
+	BENCH_DESCRIBE("interpreter start-up, initialised against cloned");
+
+	tmpl.host_data = NULL;
+	SEE_interpreter_init_template(&tmpl, SEE_system.default_compat_flags);
+	stmpl.host_data = NULL;
+	SEE_interpreter_init_shared_template(&stmpl,
+	    SEE_system.default_compat_flags);
+
+	pool = (char *)malloc(POOL_SIZE);
+	system_malloc = SEE_system.malloc;
+	SEE_system.malloc = pool_malloc;
+	SEE_system.malloc_string = pool_malloc;
+	SEE_system.free = pool_free;
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    pool_used = 0;
+	    interp.host_data = &interp;
+	    SEE_interpreter_init(&interp);
+	}
+	BENCH_STOP("SEE_interpreter_init", n);
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    pool_used = 0;
+	    interp.host_data = &interp;
+	    SEE_interpreter_clone(&interp, &tmpl);
+	}
+	BENCH_STOP("SEE_interpreter_clone", n);
+	BENCH_VALUE("bytes per clone", pool_used, "bytes");
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    pool_used = 0;
+	    interp.host_data = &interp;
+	    SEE_interpreter_clone(&interp, &stmpl);
+	}
+	BENCH_STOP("SEE_interpreter_clone, shared", n);
+	BENCH_VALUE("bytes per clone, shared", pool_used, "bytes");
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    pool_used = 0;
+	    interp.host_data = &interp;
+	    SEE_interpreter_clone(&interp, &tmpl);
+	    input = SEE_input_utf8(&interp, page);
+	    SEE_Global_eval(&interp, input, &res);
+	    SEE_INPUT_CLOSE(input);
+	}
+	BENCH_STOP("clone + SEE_Global_eval", n);
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    pool_used = 0;
+	    interp.host_data = &interp;
+	    SEE_interpreter_clone(&interp, &stmpl);
+	    input = SEE_input_utf8(&interp, page);
+	    SEE_Global_eval(&interp, input, &res);
+	    SEE_INPUT_CLOSE(input);
+	}
+	BENCH_STOP("shared clone + SEE_Global_eval", n);
+
+	pool_used = 0;
+	interp.host_data = &interp;
+	SEE_interpreter_clone(&interp, &tmpl);
+	input = SEE_input_utf8(&interp, page);
+	program = SEE_program_compile(&interp, input);
+	SEE_INPUT_CLOSE(input);
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    pool_used = 0;
+	    interp.host_data = &interp;
+	    SEE_interpreter_clone(&interp, &tmpl);
+	    SEE_program_run(&interp, program, &res);
+	}
+	BENCH_STOP("clone + SEE_program_run", n);
+}
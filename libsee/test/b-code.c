@@ -0,0 +1,80 @@
+#include "bench.inc"
+#include "../code.h"
+
+/*
+ * Compares the bytecode backends: the byte-at-a-time loop of code1
+ * and the threaded loop that runs code1's decoded instructions.
+ */
+
+static const char setup[] =
+	"function arith(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s = (s + i * 3 - 1) % 65536;\n"
+	"  return s;\n"
+	"}\n"
+	"function fib(n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+	"function add3(a, b, c) { return a + b + c; }\n"
+	"function calls(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s = add3(s, i, 1);\n"
+	"  return s;\n"
+	"}\n"
+	"function props(n) {\n"
+	"  var i, o = { x: 1, y: 2 };\n"
+	"  for (i = 0; i < n; i++) o.x = o.x + o.y;\n"
+	"  return o.x;\n"
+	"}\n";
+
+/* Times a script expression that performs ops operations */
+static void
+time_expr(interp, expr, ops, label)
+	struct SEE_interpreter *interp;
+	const char *expr;
+	unsigned long ops;
+	const char *label;
+{
+	struct SEE_value res;
+
+	BENCH_START();
+	bench_eval(interp, expr, &res);
+	BENCH_STOP(label, ops);
+}
+
+/* Runs the loops on code made by the given backend */
+static void
+run(code_alloc, name)
+	struct SEE_code *(*code_alloc)(struct SEE_interpreter *);
+	const char *name;
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(200000);
+	char buf[80], label[80];
+
+	SEE_system.code_alloc = code_alloc;
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	sprintf(buf, "arith(%lu)", n);
+	sprintf(label, "%s, arithmetic loop", name);
+	time_expr(interp, buf, n, label);
+	/* fib(k) makes 2 * fib(k + 1) - 1 calls */
+	sprintf(label, "%s, call, recursive", name);
+	time_expr(interp, "fib(20)", 21891, label);
+	sprintf(buf, "calls(%lu)", n);
+	sprintf(label, "%s, call, three arguments", name);
+	time_expr(interp, buf, n, label);
+	sprintf(buf, "props(%lu)", n);
+	sprintf(label, "%s, property access", name);
+	time_expr(interp, buf, n, label);
+}
+
+void
+bench()
+{
+	BENCH_DESCRIBE("bytecode dispatch, byte loop against threaded loop");
+#if WITH_PARSER_CODEGEN
+	run(_SEE_code1_alloc, "byte");
+	run(_SEE_code1_threaded_alloc, "threaded");
+#endif
+}
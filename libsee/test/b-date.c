@@ -0,0 +1,74 @@
+#include "bench.inc"
+
+/*
+ * Measures Date: reading the local calendar fields of many different
+ * time values, as when formatting a table of timestamps, toString(),
+ * the UTC getters, and making dates from local calendar fields. The
+ * local timezone is whatever TZ says.
+ */
+
+static const char setup[] =
+	"function pad(x) { return x < 10 ? '0' + x : x; }\n"
+	"function table(n) {\n"
+	"  var i, d, s = 0;\n"
+	"  for (i = 0; i < n; i++) {\n"
+	"    d = new Date(1.2e12 + i * 7654321);\n"
+	"    s += (d.getFullYear() + '-' + pad(d.getMonth() + 1) + '-' +\n"
+	"      pad(d.getDate()) + ' ' + pad(d.getHours()) + ':' +\n"
+	"      pad(d.getMinutes()) + ':' + pad(d.getSeconds())).length;\n"
+	"  }\n"
+	"  return s;\n"
+	"}\n"
+	"function strings(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s += new Date(i * 86400000).toString().length;\n"
+	"  return s;\n"
+	"}\n"
+	"function utc(n) {\n"
+	"  var i, d, s = 0;\n"
+	"  for (i = 0; i < n; i++) {\n"
+	"    d = new Date(i * 3600000);\n"
+	"    s += d.getUTCFullYear() + d.getUTCMonth() + d.getUTCHours();\n"
+	"  }\n"
+	"  return s;\n"
+	"}\n"
+	"function local(n) {\n"
+	"  var i, s = 0;\n"
+	"  for (i = 0; i < n; i++) s += new Date(2000, i % 12, 1, i % 24) - 0;\n"
+	"  return s;\n"
+	"}\n";
+
+/* Times a call to one of the setup functions with argument n */
+static void
+time_call(interp, fn, n, label)
+	struct SEE_interpreter *interp;
+	const char *fn;
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_value res;
+	char buf[80];
+
+	sprintf(buf, "%s(%lu)", fn, n);
+	BENCH_START();
+	bench_eval(interp, buf, &res);
+	BENCH_STOP(label, n);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(50000);
+
+	BENCH_DESCRIBE("Date fields and formatting");
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	time_call(interp, "table", n, "table of local fields");
+	time_call(interp, "strings", n, "toString");
+	time_call(interp, "utc", n, "UTC getters");
+	time_call(interp, "local", n, "new Date(local fields)");
+}
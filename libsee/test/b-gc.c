@@ -0,0 +1,109 @@
+#include "bench.inc"
+
+/*
+ * Compares the built-in collector's full and generational modes on a
+ * script that keeps a large structure alive while it makes short-lived
+ * garbage. Reports throughput, the number of collections, and the
+ * longest time a single allocation took, which includes any
+ * collection that it triggered.
+ */
+
+static const char setup[] =
+	"function mk(n) {\n"
+	"  var a = [], i;\n"
+	"  for (i = 0; i < n; i++) a.push({i: i, s: 'x' + i});\n"
+	"  return a;\n"
+	"}\n"
+	"function churn(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += [i, {v: i}].length;\n"
+	"  return t;\n"
+	"}\n"
+	"var keep = mk(40000);\n";
+
+static void *(*inner_malloc)(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static void *(*inner_malloc_string)(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static double max_pause;
+
+/* Allocates with the collector, noting the longest allocation */
+static void *
+timed_malloc(interp, sz, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t sz;
+	const char *file;
+	int line;
+{
+	double t0 = _bench_now(), dt;
+	void *p = (*inner_malloc)(interp, sz, file, line);
+
+	if ((dt = _bench_now() - t0) > max_pause)
+	    max_pause = dt;
+	return p;
+}
+
+static void *
+timed_malloc_string(interp, sz, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t sz;
+	const char *file;
+	int line;
+{
+	double t0 = _bench_now(), dt;
+	void *p = (*inner_malloc_string)(interp, sz, file, line);
+
+	if ((dt = _bench_now() - t0) > max_pause)
+	    max_pause = dt;
+	return p;
+}
+
+/* Runs the churn loop in a fresh interpreter using the given mode */
+static void
+run(flags, n, label)
+	int flags;
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	struct SEE_gc_stats stats;
+	char buf[80];
+
+	SEE_gc_install(flags);
+	inner_malloc = SEE_system.malloc;
+	inner_malloc_string = SEE_system.malloc_string;
+	SEE_system.malloc = timed_malloc;
+	SEE_system.malloc_string = timed_malloc_string;
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+	SEE_gcollect(interp);
+
+	sprintf(buf, "churn(%lu)", n);
+	max_pause = 0;
+	BENCH_START();
+	bench_eval(interp, buf, &res);
+	BENCH_STOP(label, n);
+
+	SEE_gc_stats(interp, &stats);
+	BENCH_VALUE("  longest allocation", max_pause * 1e3, "ms");
+	BENCH_VALUE("  collections", stats.collections, "");
+	BENCH_VALUE("  minor collections", stats.minor_collections, "");
+	BENCH_VALUE("  heap size", stats.heap_size / 1024, "kB");
+
+	SEE_gc_release(interp);
+	SEE_system.malloc = inner_malloc;
+	SEE_system.malloc_string = inner_malloc_string;
+}
+
+void
+bench()
+{
+	unsigned long n = BENCH_N(200000);
+
+	BENCH_DESCRIBE("collector modes with a large live heap");
+
+	run(0, n, "churn, full collections");
+	run(SEE_GC_GENERATIONAL, n, "churn, generational");
+}
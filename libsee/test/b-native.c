@@ -0,0 +1,121 @@
+#include "bench.inc"
+
+/*
+ * Measures the memory footprint of native objects, and the speed
+ * of property get/put on small and large native objects.
+ */
+
+static void *(*system_malloc)(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static unsigned long allocated_bytes;
+
+/* An allocator that counts the bytes it hands out */
+static void *
+counting_malloc(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	allocated_bytes += size;
+	return (*system_malloc)(interp, size, file, line);
+}
+
+/* Returns the average bytes allocated for an object with nprops props */
+static double
+bytes_per_object(interp, names, nprops)
+	struct SEE_interpreter *interp;
+	struct SEE_string **names;
+	int nprops;
+{
+	struct SEE_object *o;
+	struct SEE_value v;
+	unsigned long before;
+	int i, j, count = 1000;
+
+	SEE_SET_NUMBER(&v, 1);
+	before = allocated_bytes;
+	for (i = 0; i < count; i++) {
+	    o = SEE_native_new(interp);
+	    for (j = 0; j < nprops; j++)
+		SEE_OBJECT_PUT(interp, o, names[j], &v, 0);
+	}
+	return (double)(allocated_bytes - before) / count;
+}
+
+/* Times a mix of gets and puts that cycle through nprops names */
+static void
+time_get_put(interp, names, nprops, label)
+	struct SEE_interpreter *interp;
+	struct SEE_string **names;
+	int nprops;
+	const char *label;
+{
+	struct SEE_object *o;
+	struct SEE_value v;
+	unsigned long i, n = BENCH_N(2000000);
+	char buf[80];
+	int j;
+
+	o = SEE_native_new(interp);
+	SEE_SET_NUMBER(&v, 0);
+	for (j = 0; j < nprops; j++)
+	    SEE_OBJECT_PUT(interp, o, names[j], &v, 0);
+
+	sprintf(buf, "put, %s", label);
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    SEE_SET_NUMBER(&v, i);
+	    SEE_OBJECT_PUT(interp, o, names[i % nprops], &v, 0);
+	}
+	BENCH_STOP(buf, n);
+
+	sprintf(buf, "get, %s", label);
+	BENCH_START();
+	for (i = 0; i < n; i++)
+	    SEE_OBJECT_GET(interp, o, names[i % nprops], &v);
+	BENCH_STOP(buf, n);
+
+	sprintf(buf, "get missing, %s", label);
+	BENCH_START();
+	for (i = 0; i < n; i++)
+	    SEE_OBJECT_GET(interp, o, names[nprops + i % 4], &v);
+	BENCH_STOP(buf, n);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_string *names[260];
+	char buf[32];
+	int i;
+
+	BENCH_DESCRIBE("native object size and property access");
+
+	system_malloc = SEE_system.malloc;
+	SEE_system.malloc = counting_malloc;
+
+	SEE_interpreter_init(interp);
+	for (i = 0; i < 260; i++) {
+	    sprintf(buf, "prop_%d", i);
+	    names[i] = SEE_intern_ascii(interp, buf);
+	}
+
+	BENCH_VALUE("sizeof (struct SEE_native)",
+	    sizeof (struct SEE_native), "bytes");
+	BENCH_VALUE("empty object", bytes_per_object(interp, names, 0),
+	    "bytes");
+	BENCH_VALUE("object with 4 properties",
+	    bytes_per_object(interp, names, 4), "bytes");
+	BENCH_VALUE("object with 16 properties",
+	    bytes_per_object(interp, names, 16), "bytes");
+	BENCH_VALUE("object with 256 properties",
+	    bytes_per_object(interp, names, 256), "bytes");
+
+	time_get_put(interp, names, 4, "4 properties");
+	time_get_put(interp, names, 16, "16 properties");
+	time_get_put(interp, names, 256, "256 properties");
+
+	SEE_system.malloc = system_malloc;
+}
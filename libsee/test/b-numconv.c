@@ -0,0 +1,136 @@
+#include "bench.inc"
+
+/*
+ * Measures converting numbers to strings and back: the small integers
+ * of loop counters and array indices, large integers, fractions, and
+ * the strings that come back from forms and property names.
+ */
+
+static const char setup[] =
+	"function keys(n) {\n"
+	"  var o = {}, i, s = 0;\n"
+	"  for (i = 0; i < n; i++) o[i & 1023] = i;\n"
+	"  for (i in o) s += +i;\n"
+	"  return s;\n"
+	"}\n";
+
+/* Times SEE_ToString() on n numbers made by f() */
+static void
+time_tostring(interp, f, n, label)
+	struct SEE_interpreter *interp;
+	SEE_number_t (*f)(unsigned long);
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_value v, s;
+	unsigned long i, len = 0;
+
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    SEE_SET_NUMBER(&v, (*f)(i));
+	    SEE_ToString(interp, &v, &s);
+	    len += s.u.string->length;
+	}
+	BENCH_STOP(label, n);
+	if (!len)
+	    abort();
+}
+
+/* Times SEE_ToNumber() on a rotating set of strings */
+static void
+time_tonumber(interp, texts, ntexts, n, label)
+	struct SEE_interpreter *interp;
+	const char * const *texts;
+	unsigned int ntexts;
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_value s[8], v;
+	unsigned long i;
+	SEE_number_t sum = 0;
+
+	for (i = 0; i < ntexts; i++)
+	    SEE_SET_STRING(&s[i], SEE_string_sprintf(interp, "%s", texts[i]));
+	BENCH_START();
+	for (i = 0; i < n; i++) {
+	    SEE_ToNumber(interp, &s[i % ntexts], &v);
+	    sum += v.u.number;
+	}
+	BENCH_STOP(label, n);
+	if (sum != sum)
+	    abort();
+}
+
+/* Number generators for time_tostring() */
+static SEE_number_t
+small_int(i)
+	unsigned long i;
+{
+	return i & 255;
+}
+
+static SEE_number_t
+large_int(i)
+	unsigned long i;
+{
+	return i * 7919.0 + 1e6;
+}
+
+static SEE_number_t
+negative(i)
+	unsigned long i;
+{
+	return -(SEE_number_t)i;
+}
+
+static SEE_number_t
+fraction(i)
+	unsigned long i;
+{
+	return (i + 1) / 7.0;
+}
+
+static SEE_number_t
+tiny(i)
+	unsigned long i;
+{
+	return (i + 1) * 1e-30;
+}
+
+static const char * const ints[] = { "0", "17", "255", "-4096", "65535" };
+static const char * const decimals[] = { "0.5", "3.25", "-12.75", "99.9" };
+static const char * const others[] = { " 42 ", "1e3", "0x1F", "6.02e23" };
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	struct SEE_input *input;
+	unsigned long n = BENCH_N(1000000);
+	char buf[80];
+
+	BENCH_DESCRIBE("number/string conversion");
+
+	SEE_interpreter_init(interp);
+	input = SEE_input_utf8(interp, setup);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+
+	time_tostring(interp, small_int, n, "ToString, small integers");
+	time_tostring(interp, large_int, n, "ToString, large integers");
+	time_tostring(interp, negative, n, "ToString, negative integers");
+	time_tostring(interp, fraction, n, "ToString, fractions");
+	time_tostring(interp, tiny, n, "ToString, exponent form");
+
+	time_tonumber(interp, ints, 5, n, "ToNumber, integers");
+	time_tonumber(interp, decimals, 4, n, "ToNumber, decimals");
+	time_tonumber(interp, others, 4, n, "ToNumber, other forms");
+
+	sprintf(buf, "keys(%lu)", n);
+	input = SEE_input_utf8(interp, buf);
+	BENCH_START();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_STOP("script, integer property names", n);
+	SEE_INPUT_CLOSE(input);
+}
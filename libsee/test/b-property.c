@@ -0,0 +1,67 @@
+#include "bench.inc"
+
+/*
+ * Measures property access from scripts, which the bytecode serves
+ * from its inline caches: own properties of objects of one shape or
+ * of several shapes, properties found on a prototype, and stores.
+ */
+
+static const char setup[] =
+	"function P(x, y) { this.x = x; this.y = y; }\n"
+	"P.prototype.z = 1;\n"
+	"function mono(n) {\n"
+	"  var p = new P(1, 2), s = 0, i;\n"
+	"  for (i = 0; i < n; i++) s = s + p.x + p.y;\n"
+	"  return s;\n"
+	"}\n"
+	"function poly(n) {\n"
+	"  var a = [ new P(1, 2), {x:1, y:2}, {y:2, x:1}, {w:0, x:1, y:2} ];\n"
+	"  var s = 0, i, p;\n"
+	"  for (i = 0; i < n; i++) { p = a[i & 3]; s = s + p.x + p.y; }\n"
+	"  return s;\n"
+	"}\n"
+	"function proto(n) {\n"
+	"  var p = new P(1, 2), s = 0, i;\n"
+	"  for (i = 0; i < n; i++) s = s + p.z + p.z;\n"
+	"  return s;\n"
+	"}\n"
+	"function store(n) {\n"
+	"  var p = new P(1, 2), i;\n"
+	"  for (i = 0; i < n; i++) { p.x = i; p.y = i; }\n"
+	"  return p.x;\n"
+	"}\n";
+
+/* Times a call to one of the setup functions; each iteration
+ * performs two property accesses */
+static void
+time_loop(interp, fn, label)
+	struct SEE_interpreter *interp;
+	const char *fn;
+	const char *label;
+{
+	struct SEE_value res;
+	unsigned long n = BENCH_N(500000);
+	char buf[80];
+
+	sprintf(buf, "%s(%lu)", fn, n);
+	BENCH_START();
+	bench_eval(interp, buf, &res);
+	BENCH_STOP(label, 2 * n);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+
+	BENCH_DESCRIBE("property access from scripts");
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	time_loop(interp, "mono", "get, one shape");
+	time_loop(interp, "poly", "get, four shapes");
+	time_loop(interp, "proto", "get, from prototype");
+	time_loop(interp, "store", "put, one shape");
+}
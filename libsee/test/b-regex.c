@@ -0,0 +1,90 @@
+#include "bench.inc"
+
+/*
+ * Measures script code that makes regular expressions repeatedly from
+ * the same sources: a literal evaluated in a loop, and string patterns
+ * handed to String.prototype.match() and replace(). Also measures
+ * searching a long text for a pattern that occurs rarely in it, and
+ * global replace(), match() and split() over the whole of that text.
+ */
+
+static const char setup[] =
+	"function literal(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++)\n"
+	"    t += /^([a-z]+)=(\\d+)(?:&|$)/.exec('key=' + i)[2].length;\n"
+	"  return t;\n"
+	"}\n"
+	"function match(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += ('key=' + i).match('[0-9]+')[0].length;\n"
+	"  return t;\n"
+	"}\n"
+	"function replace(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += 'a-b-c'.replace(/-/g, '+').length;\n"
+	"  return t;\n"
+	"}\n"
+	"var log = [], i;\n"
+	"for (i = 0; i < 2000; i++)\n"
+	"  log.push('2024-01-01 12:00:00 INFO request ' + i + ' served');\n"
+	"log = log.join('\\n') + '\\nERROR 42: out of cheese\\n';\n"
+	"function scan(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += /ERROR (\\d+)/.exec(log)[1].length;\n"
+	"  return t;\n"
+	"}\n"
+	"function gsub(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++)\n"
+	"    t += log.replace(/request (\\d+)/g, 'req #$1').length;\n"
+	"  return t;\n"
+	"}\n"
+	"function gmatch(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += log.match(/\\d+ served/g).length;\n"
+	"  return t;\n"
+	"}\n"
+	"function split(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += log.split(/\\n/).length;\n"
+	"  return t;\n"
+	"}\n";
+
+/* Times a script function called with n */
+static void
+time_call(interp, fn, n, label)
+	struct SEE_interpreter *interp;
+	const char *fn;
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_value res;
+	char buf[80];
+
+	sprintf(buf, "%s(%lu)", fn, n);
+	BENCH_START();
+	bench_eval(interp, buf, &res);
+	BENCH_STOP(label, n);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(100000);
+
+	BENCH_DESCRIBE("regular expressions made from the same source");
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	time_call(interp, "literal", n, "literal exec in a loop");
+	time_call(interp, "match", n, "String.match with a string");
+	time_call(interp, "replace", n, "String.replace with a literal");
+	time_call(interp, "scan", n / 100, "exec over 90k characters");
+	time_call(interp, "gsub", n / 1000, "global replace over 90k");
+	time_call(interp, "gmatch", n / 1000, "global match over 90k");
+	time_call(interp, "split", n / 1000, "split over 90k");
+}
@@ -0,0 +1,140 @@
+#include "bench.inc"
+
+/*
+ * Measures building long strings by repeated concatenation, which
+ * should take time linear in the number of pieces whichever end they
+ * are added to, and whether or not the partial results are shared.
+ * Also measures searching within strings: walking the fields of a CSV
+ * line with indexOf(), splitting it, and looking for a short and a long
+ * needle in a long log text. Then tokenizing that line a character at
+ * a time, indexing an object with small integers, and normalizing
+ * the case of header names, most of which are already lower case.
+ */
+
+static const char setup[] =
+	"function append(n) {\n"
+	"  var s = '', i;\n"
+	"  for (i = 0; i < n; i++) s += 'ab';\n"
+	"  return s.length;\n"
+	"}\n"
+	"function prepend(n) {\n"
+	"  var s = '', i;\n"
+	"  for (i = 0; i < n; i++) s = 'ab' + s;\n"
+	"  return s.length;\n"
+	"}\n"
+	"function shared(n) {\n"
+	"  var s = '', t, i;\n"
+	"  for (i = 0; i < n; i++) { t = s; s += 'ab'; }\n"
+	"  return s.length + t.length;\n"
+	"}\n"
+	"var csv = [], log = [], i;\n"
+	"for (i = 0; i < 20; i++) csv.push('field' + i + '=' + i * 12345);\n"
+	"csv = csv.join(',');\n"
+	"for (i = 0; i < 2000; i++)\n"
+	"  log.push('2024-01-01 12:00:00 INFO request ' + i + ' served');\n"
+	"log = log.join('\\n') + '\\nERROR 42: out of cheese\\n';\n"
+	"function fields(n) {\n"
+	"  var i, p, q, t = 0;\n"
+	"  for (i = 0; i < n; i++)\n"
+	"    for (p = 0; (q = csv.indexOf(',', p)) >= 0; p = q + 1) t += q - p;\n"
+	"  return t;\n"
+	"}\n"
+	"function split(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += csv.split(',').length;\n"
+	"  return t;\n"
+	"}\n"
+	"function find(n, needle) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++)\n"
+	"    t += log.indexOf(needle) + log.lastIndexOf(needle, 50000);\n"
+	"  return t;\n"
+	"}\n"
+	"function find_short(n) { return find(n, 'ERR'); }\n"
+	"function find_long(n) { return find(n, 'out of cheese'); }\n"
+	"function chars(n) {\n"
+	"  var i, j, c, t = 0;\n"
+	"  for (i = 0; i < n; i++)\n"
+	"    for (j = 0; j < csv.length; j++) {\n"
+	"      c = csv.charAt(j);\n"
+	"      if (c >= '0' && c <= '9') t++;\n"
+	"    }\n"
+	"  return t;\n"
+	"}\n"
+	"function codes(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += String.fromCharCode(32 + i % 96).length;\n"
+	"  return t;\n"
+	"}\n"
+	"function keys(n) {\n"
+	"  var i, o = {}, t = 0;\n"
+	"  for (i = 0; i < 500; i++) o[i] = i;\n"
+	"  for (i = 0; i < n; i++) t += o[i % 500];\n"
+	"  return t;\n"
+	"}\n"
+	"var headers = ['Content-Type', 'content-length', 'accept-encoding',\n"
+	"  'X-Forwarded-For', 'user-agent', 'cache-control', 'Host', 'cookie'];\n"
+	"function lower(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += headers[i & 7].toLowerCase().length;\n"
+	"  return t;\n"
+	"}\n"
+	"function upper(n) {\n"
+	"  var i, t = 0;\n"
+	"  for (i = 0; i < n; i++) t += log.toUpperCase().length;\n"
+	"  return t;\n"
+	"}\n";
+
+/* Times a script function called with n, then uses its result */
+static void
+time_call(interp, fn, n, label)
+	struct SEE_interpreter *interp;
+	const char *fn;
+	unsigned long n;
+	const char *label;
+{
+	struct SEE_value res;
+	char buf[80];
+
+	sprintf(buf, "%s(%lu)", fn, n);
+	BENCH_START();
+	bench_eval(interp, buf, &res);
+	BENCH_STOP(label, n);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_string *piece, *s;
+	struct SEE_value res;
+	unsigned long n = BENCH_N(1000000), i;
+
+	BENCH_DESCRIBE("string concatenation");
+
+	SEE_interpreter_init(interp);
+	bench_eval(interp, setup, &res);
+
+	/* SEE_string_concat() on a string that cannot grow in place */
+	piece = SEE_intern_ascii(interp, "ab");
+	BENCH_START();
+	s = piece;
+	for (i = 1; i < n; i++)
+	    s = SEE_string_concat(interp, piece, s);
+	SEE_STRING_FLATTEN(s);
+	BENCH_STOP("SEE_string_concat, prepend", n);
+
+	time_call(interp, "append", n, "script, append");
+	time_call(interp, "prepend", n, "script, prepend");
+	time_call(interp, "shared", n, "script, append to shared");
+
+	time_call(interp, "fields", n / 100, "indexOf, CSV fields");
+	time_call(interp, "split", n / 100, "split, CSV line");
+	time_call(interp, "find_short", n / 1000, "indexOf, 3 chars in 90k");
+	time_call(interp, "find_long", n / 1000, "indexOf, 13 chars in 90k");
+	time_call(interp, "chars", n / 1000, "charAt, CSV line");
+	time_call(interp, "codes", n, "String.fromCharCode");
+	time_call(interp, "keys", n, "object indexed by integers");
+	time_call(interp, "lower", n, "toLowerCase, header names");
+	time_call(interp, "upper", n / 10000, "toUpperCase, 90k");
+}
@@ -0,0 +1,203 @@
+#include "test.inc"
+#include <see/see.h>
+
+/*
+ * Clones interpreters from a template: the clones start with what
+ * the host and scripts added to the template, work like freshly
+ * initialised interpreters, and do not see each other's changes.
+ */
+
+static const char setup[] =
+	"var counter = 0;\n"
+	"function greet(n) { return 'hello ' + n; }\n"
+	"var table = { a: 1, b: 2, c: [1, 2, 3] };\n";
+
+/* twice(n): a host function added to the template */
+static void
+twice_fn(interp, self, thisobj, argc, argv, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *self, *thisobj;
+	int argc;
+	struct SEE_value **argv, *res;
+{
+	struct SEE_value v;
+
+	SEE_ToNumber(interp, argv[0], &v);
+	SEE_SET_NUMBER(res, v.u.number * 2);
+}
+
+
+/* Evaluates a script that results in an object */
+static struct SEE_object *
+eval_object(interp, text)
+	struct SEE_interpreter *interp;
+	const char *text;
+{
+	struct SEE_input *input;
+	struct SEE_value res;
+
+	input = SEE_input_utf8(interp, text);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+	return SEE_VALUE_GET_TYPE(&res) == SEE_OBJECT ? res.u.object : NULL;
+}
+
+/* Runs the checks with whichever allocator is installed */
+static void
+run()
+{
+	struct SEE_interpreter tmpl, a, b, c;
+	struct SEE_string *name;
+	struct SEE_value v;
+	union { SEE_number_t n; struct SEE_object *p; } lookalike;
+	int i, ok;
+
+	SEE_interpreter_init_template(&tmpl, SEE_system.default_compat_flags);
+	SEE_CFUNCTION_PUTA(&tmpl, tmpl.Global, "twice", twice_fn, 1, 0);
+	test_eval(&tmpl, setup);
+	name = SEE_intern_ascii(&tmpl, "template_only_name");
+
+	/* A number whose bits are the address of a template object */
+	lookalike.n = 0;
+	lookalike.p = tmpl.Global;
+	SEE_SET_NUMBER(&v, lookalike.n);
+	SEE_OBJECT_PUTA(&tmpl, tmpl.Global, "lookalike", &v, 0);
+
+	a.host_data = &a;
+	SEE_interpreter_clone(&a, &tmpl);
+	b.host_data = &b;
+	SEE_interpreter_clone(&b, &tmpl);
+	TEST_EQ_PTR(a.host_data, &a);
+	TEST_EQ_PTR(b.host_data, &b);
+	TEST_NOT_EQ_PTR(a.Global, tmpl.Global);
+	TEST_NOT_EQ_PTR(a.Global, b.Global);
+
+	/* What was added to the template is in each clone */
+	TEST_EVAL(&a, "greet('a')", "hello a");
+	TEST_EVAL(&b, "twice(21)", "42");
+	TEST_EVAL(&b, "table.c.length + table.b", "5");
+
+	/* Values that are not pointers are copied unchanged */
+	SEE_OBJECT_GETA(&a, a.Global, "lookalike", &v);
+	TEST_EQ_INT(SEE_VALUE_GET_TYPE(&v), SEE_NUMBER);
+	TEST(memcmp(&v.u.number, &lookalike.n, sizeof lookalike.n) == 0);
+
+	/* Interned strings belong to the clone and are found again */
+	TEST_NOT_EQ_PTR(SEE_intern_ascii(&a, "template_only_name"), name);
+	TEST_EQ_PTR(SEE_intern_ascii(&a, "template_only_name"),
+	    SEE_intern_ascii(&a, "template_only_name"));
+	TEST_EQ_PTR(SEE_intern_ascii(&a, "template_only_name")->interpreter,
+	    &a);
+
+	/* The built-in objects work */
+	TEST_EVAL(&a, "'a1b22c'.replace(/\\d+/g, '#')", "a#b#c");
+	TEST_EVAL(&a, "[3, 1, 2].sort().join('-')", "1-2-3");
+	TEST_EVAL(&a, "Math.max(1, 7, 3) + parseInt('10', 16)", "23");
+	TEST_EVAL(&a, "new Date(0).getTime()", "0");
+	TEST_EVAL(&a, "try { null.x } catch (e) { e.name }", "TypeError");
+	TEST_EVAL(&a, "var k = [], p; for (p in table) k.push(p); k.sort()",
+	    "a,b,c");
+
+	/* Changes made in one clone are not seen by the others */
+	test_eval(&a, "counter = 5; table.a = 'x'; Array.prototype.extra = 1;"
+	    "String.prototype.shout = function () { return 'hey'; };"
+	    "Object.prototype.more = true; delete Math.PI;");
+	TEST_EVAL(&a, "counter + table.a + [].extra + 'z'.shout()", "5x1hey");
+	TEST_EVAL(&b, "counter + table.a", "1");
+	TEST_EVAL(&b, "typeof [].extra + typeof ''.shout + typeof ({}).more",
+	    "undefinedundefinedundefined");
+	TEST_EVAL(&b, "Math.PI > 3", "true");
+
+	/* Later clones start from the template, not from other clones */
+	SEE_interpreter_clone(&c, &tmpl);
+	TEST_EVAL(&c, "counter + typeof [].extra", "0undefined");
+
+	/* Many short-lived clones */
+	ok = 1;
+	for (i = 0; i < 200; i++) {
+	    SEE_interpreter_clone(&c, &tmpl);
+	    test_eval(&c, "counter += 1; var o = {}; for (var j = 0; j < 50; j++)"
+		" o['p' + j] = j;");
+	    if (SEE_string_cmp_ascii(test_eval(&c, "counter + o.p49"), "50") != 0)
+		ok = 0;
+	}
+	TEST(ok);
+
+	/* Clones survive a collection of their own heap */
+	SEE_gcollect(&a);
+	TEST_EVAL(&a, "greet(counter)", "hello 5");
+
+	/* Each clone of an ordinary template has its own functions */
+	TEST_NOT_EQ_PTR(eval_object(&a, "Math.max"),
+	    eval_object(&b, "Math.max"));
+}
+
+/* Runs the checks of a template whose clones share its cfunctions */
+static void
+run_shared()
+{
+	struct SEE_interpreter tmpl, a, b;
+
+	SEE_interpreter_init_shared_template(&tmpl, SEE_COMPAT_JS15);
+	SEE_CFUNCTION_PUTA(&tmpl, tmpl.Global, "twice", twice_fn, 1, 0);
+	test_eval(&tmpl, setup);
+
+	a.host_data = &a;
+	SEE_interpreter_clone(&a, &tmpl);
+	b.host_data = &b;
+	SEE_interpreter_clone(&b, &tmpl);
+
+	/* The clones have one copy of each cfunction between them */
+	TEST_EQ_PTR(eval_object(&a, "Math.max"), eval_object(&b, "Math.max"));
+	TEST_EQ_PTR(eval_object(&a, "twice"), eval_object(&b, "twice"));
+	TEST_EQ_PTR(eval_object(&a, "String.prototype.charAt"),
+	    eval_object(&b, "String.prototype.charAt"));
+	TEST_NOT_EQ_PTR(eval_object(&a, "String.prototype"),
+	    eval_object(&b, "String.prototype"));
+	TEST_EVAL(&a, "twice(21) + Math.max(1, 7, 3)", "49");
+	TEST_EVAL(&b, "'abc'.charAt(1) + greet('b')", "bhello b");
+
+	/* Direct eval() is recognised as the clone's eval function */
+	TEST_EQ_PTR(eval_object(&a, "eval"), a.Global_eval);
+	TEST_EVAL(&a, "eval('1 + 1')", "2");
+	TEST_EVAL(&b, "(function (x) { return eval('x * 2'); })(4)", "8");
+
+	/* A shared function's prototype is the using clone's */
+	TEST_EVAL(&a, "Math.max instanceof Function", "true");
+	TEST_EVAL(&a, "Math.max.__proto__ === Function.prototype", "true");
+	TEST_EVAL(&a, "Function.prototype.isPrototypeOf(twice)", "true");
+	test_eval(&a, "Function.prototype.tag = 'a';");
+	TEST_EVAL(&a, "Math.max.tag + typeof Math.max.call", "afunction");
+	TEST_EVAL(&a, "var k = [], p; for (p in Math.max) k.push(p); k", "tag");
+	TEST_EVAL(&b, "typeof Math.max.tag", "undefined");
+	TEST_EVAL(&b, "var k = [], p; for (p in Math.max) k.push(p); k", "");
+
+	/* Writes to shared functions change nothing */
+	test_eval(&a, "Math.max.length = 9; Math.max.x = 1; delete Math.max.length;");
+	TEST_EVAL(&a, "Math.max.length + typeof Math.max.x", "2undefined");
+
+	/* Replacing a shared function is seen only by that clone */
+	test_eval(&a, "Math.max = function () { return 'mine'; };"
+	    "String.prototype.charAt = Math.max;");
+	TEST_EVAL(&a, "Math.max(1, 2) + 'x'.charAt(0)", "minemine");
+	TEST_EVAL(&b, "Math.max(1, 2) + 'x'.charAt(0)", "2x");
+
+	/* Shared functions outlive collections of the clones' heaps */
+	SEE_gcollect(&b);
+	TEST_EVAL(&b, "[3, 1, 2].sort().join('-') + twice(2)", "1-2-34");
+}
+
+void
+test()
+{
+	TEST_DESCRIBE("interpreter templates and clones");
+
+	SEE_init();
+	run();
+	run_shared();
+
+	/* Clone images are single blocks of the built-in collector's heap */
+	SEE_gc_install(SEE_GC_GENERATIONAL);
+	run();
+	run_shared();
+}
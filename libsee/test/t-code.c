@@ -0,0 +1,99 @@
+#include "test.inc"
+#include <see/see.h>
+#include "../code.h"
+
+/*
+ * Runs the instruction sequences that code1 fuses into superinstructions,
+ * and the branch chains it threads, on both of its loops: the byte loop,
+ * and the threaded loop that is the only one to run the fused forms.
+ */
+
+static const char setup[] =
+	"var gv = 7;\n"
+	"function below(a, b) { var n = 0; while (a < b) { a++; n++; }"
+	"  return n; }\n"
+	"function plus1(x) { return x + 1; }\n"
+	"function member(o) { return o.p + o.q; }\n"
+	"function scoped(o) { with (o) return p; }\n"
+	"function unframed() { var v = 3; eval(''); return v + 1; }\n"
+	"function nested(a, b) {\n"
+	"  var r = 0;\n"
+	"  while (true) {\n"
+	"    if (a) { if (b) r = 1; else r = 2; } else r = 3;\n"
+	"    break;\n"
+	"  }\n"
+	"  return r;\n"
+	"}\n"
+	"function odd(n) {\n"
+	"  var s = 0, i;\n"
+	"  for (i = 0; i < n; i++)\n"
+	"    for (;;) { if (i & 1) break; else { s++; break; } }\n"
+	"  return s;\n"
+	"}\n"
+	"function keys(o) { var k = [], p; for (p in o) k.push(p);"
+	"  return k.sort().join(); }\n"
+	"function caught(f) { try { return f(); } catch (e) { return e.name; }"
+	"  finally { gv++; } }\n";
+
+/* Expressions run after the setup, and their results as strings */
+static const struct {
+	const char *expr, *expected;
+} cases[] = {
+	/* LT_B_TRUE: comparisons that branch */
+	{ "below(0, 5)", "5" },
+	{ "below(0, NaN)", "0" },
+	{ "below('a', 'c')", "1" },
+	{ "below({ valueOf: function () { return 1; } }, 3)", "2" },
+	/* LITERAL_ADD */
+	{ "plus1(2)", "3" },
+	{ "plus1('2')", "21" },
+	{ "plus1(null)", "1" },
+	/* LOOKUP_GETVALUE, REF_GETVALUE and VREF_GETVALUE */
+	{ "gv + 1", "8" },
+	{ "member({ p: 1, q: 2 })", "3" },
+	{ "member({ p: 'a', q: 'b' })", "ab" },
+	{ "scoped({ p: 4 })", "4" },
+	{ "unframed()", "4" },
+	/* Exceptions raised inside fused instructions */
+	{ "caught(function () { return nosuchvar; })", "ReferenceError" },
+	{ "caught(function () { return below({ valueOf: "
+	  "function () { throw new TypeError(); } }, 1); })", "TypeError" },
+	{ "gv", "9" },
+	/* Branches to branches, and branches converted to indices */
+	{ "[nested(1, 1), nested(1, 0), nested(0, 0)].join()", "1,2,3" },
+	{ "odd(10)", "5" },
+	{ "keys({ b: 1, a: 2, c: 3 })", "a,b,c" },
+};
+
+/* Runs the cases on code made by the given backend */
+static void
+run(code_alloc)
+	struct SEE_code *(*code_alloc)(struct SEE_interpreter *);
+{
+	struct SEE_interpreter interp;
+	struct SEE_string *res;
+	unsigned int i;
+
+	SEE_system.code_alloc = code_alloc;
+	SEE_interpreter_init(&interp);
+	test_eval(&interp, setup);
+	for (i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+	    /* Evaluated once, as some cases have side effects */
+	    res = test_eval(&interp, cases[i].expr);
+	    TEST_EQ_INT(SEE_string_cmp_ascii(res, cases[i].expected), 0);
+	}
+}
+
+void
+test()
+{
+	TEST_DESCRIBE("fused instructions on the byte and threaded loops");
+
+	SEE_init();
+#if WITH_PARSER_CODEGEN
+	run(_SEE_code1_alloc);
+	run(_SEE_code1_threaded_alloc);
+#else
+	TEST_EXIT_IGNORE();
+#endif
+}
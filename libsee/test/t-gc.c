@@ -0,0 +1,228 @@
+#include "test.inc"
+#include <see/see.h>
+
+#if HAVE_SIGACTION
+# include <signal.h>
+#endif
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_MUTEX_LOCK
+# include <pthread.h>
+# define NTHREADS 4
+# define NROUNDS 3
+#endif
+
+/*
+ * Exercises the built-in collector: objects reachable from scripts,
+ * the stack and the interpreter survive minor and major collections,
+ * finalizers run, a host's own fault handler can pass faults on to
+ * the collector, and interpreters in separate threads collect their
+ * own heaps, while other threads free and reuse theirs.
+ */
+
+/* Builds a live structure, then makes garbage and checks the structure */
+static const char script[] =
+	"function mk(n) {\n"
+	"  var a = [], i;\n"
+	"  for (i = 0; i < n; i++) a.push({i: i, s: 'x' + i, o: [i, i + 1]});\n"
+	"  return a;\n"
+	"}\n"
+	"var keep = mk(5000), big = [], r, i, e, ok = true;\n"
+	"for (r = 0; r < 60; r++) {\n"
+	"  mk(1000);\n"
+	"  keep[r * 7] = {i: r * 7, s: 'x' + r * 7, o: [r * 7, r * 7 + 1]};\n"
+	"  big[r % 4] = new Array(20000).join('y');\n"
+	"}\n"
+	"for (i = 0; i < keep.length; i++) {\n"
+	"  e = keep[i];\n"
+	"  if (e.i != i || e.s != 'x' + i || e.o[0] != i || e.o[1] != i + 1)\n"
+	"    ok = false;\n"
+	"}\n"
+	"ok && big[3].length == 19999 ? keep.length : -1\n";
+
+static unsigned int finalized;
+
+static void
+finalize(interp, p, closure)
+	struct SEE_interpreter *interp;
+	void *p;
+	void *closure;
+{
+	finalized++;
+}
+
+/* Evaluates the script, returning its numeric result */
+static SEE_number_t
+run(interp)
+	struct SEE_interpreter *interp;
+{
+	struct SEE_input *input;
+	struct SEE_value res;
+
+	input = SEE_input_utf8(interp, script);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+	return SEE_VALUE_GET_TYPE(&res) == SEE_NUMBER ? res.u.number : -2;
+}
+
+/* Objects reachable only through a registered root */
+static void *rooted[100];
+
+/* Fills an array with finalizable objects */
+static void
+finalizable(interp, a, n)
+	struct SEE_interpreter *interp;
+	void **a;
+	int n;
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	    a[i] = SEE_malloc_finalize(interp, 4 * sizeof (void *),
+		finalize, NULL);
+}
+
+/* Overwrites dead stack frames that may still refer to objects */
+static void
+clear_stack()
+{
+	volatile char buf[8192];
+	unsigned int i;
+
+	for (i = 0; i < sizeof buf; i++)
+	    buf[i] = 0;
+}
+
+#if HAVE_SIGACTION
+static unsigned int forwarded;
+
+/* A host's SIGSEGV handler, installed after the collector's */
+static void
+host_fault(sig, info, ctx)
+	int sig;
+	siginfo_t *info;
+	void *ctx;
+{
+	if (SEE_gc_fault(info->si_addr)) {
+	    forwarded++;
+	    return;
+	}
+	abort();
+}
+#endif
+
+#ifdef NTHREADS
+static void *
+thread_main(arg)
+	void *arg;
+{
+	struct SEE_interpreter interp;
+	SEE_number_t *result = (SEE_number_t *)arg;
+	int round;
+
+	*result = 0;
+	for (round = 0; round < NROUNDS; round++) {
+	    SEE_interpreter_init(&interp);
+	    *result += run(&interp);
+	    SEE_gcollect(&interp);
+	    *result += run(&interp);
+	    SEE_gc_release(&interp);
+	}
+	return NULL;
+}
+#endif
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_gc_stats stats;
+	SEE_size_t before;
+	void *p;
+#if HAVE_SIGACTION
+	struct sigaction sa, old_segv;
+#endif
+#ifdef NTHREADS
+	pthread_t thread[NTHREADS];
+	SEE_number_t result[NTHREADS];
+	int i, error;
+#endif
+
+	TEST_DESCRIBE("built-in collector");
+
+	SEE_init();
+	SEE_gc_install(SEE_GC_GENERATIONAL);
+	SEE_interpreter_init(interp);
+
+	TEST(run(interp) == 5000);
+	SEE_gc_stats(interp, &stats);
+	TEST(stats.collections > 0);
+#if HAVE_MMAP && HAVE_MPROTECT && HAVE_SIGACTION
+	TEST(stats.minor_collections > 0);
+#endif
+	TEST(stats.in_use <= stats.heap_size);
+
+	/* A major collection frees the old garbage */
+	before = stats.in_use;
+	SEE_gcollect(interp);
+	SEE_gc_stats(interp, &stats);
+	TEST(stats.in_use < before);
+	TEST(stats.live == stats.in_use);
+
+	/* Scripts still work after collecting */
+	TEST(run(interp) == 5000);
+
+	/* Faults that are not the collector's are left to the host */
+	TEST(!SEE_gc_fault(&before));
+#if HAVE_SIGACTION
+	memset(&sa, 0, sizeof sa);
+	sa.sa_sigaction = host_fault;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGSEGV, &sa, &old_segv);
+	TEST(run(interp) == 5000);
+	sigaction(SIGSEGV, &old_segv, NULL);
+# if HAVE_MMAP && HAVE_MPROTECT
+	TEST(forwarded > 0);
+# endif
+#endif
+
+	/* Finalizers run only once their objects are unreachable */
+	SEE_gc_add_root(interp, rooted, sizeof rooted);
+	finalizable(interp, rooted, 100);
+	clear_stack();
+	SEE_gcollect(interp);
+	TEST_EQ_INT(finalized, 0);
+
+	/* Stale registers or stack words may keep an object or two */
+	memset(rooted, 0, sizeof rooted);
+	clear_stack();
+	SEE_gcollect(interp);
+	TEST(finalized >= 95);
+	SEE_gc_remove_root(interp, rooted);
+
+	/* Explicitly freed memory is no longer in use */
+	SEE_gc_stats(interp, &stats);
+	before = stats.in_use;
+	p = SEE_malloc(interp, 100000);
+	SEE_gc_stats(interp, &stats);
+	TEST(stats.in_use > before);
+	SEE_free(interp, &p);
+	SEE_gc_stats(interp, &stats);
+	TEST(stats.in_use == before);
+
+	/* Releasing the heap runs the outstanding finalizers */
+	finalizable(interp, rooted, 10);
+	SEE_gc_release(interp);
+	TEST_EQ_INT(finalized, 110);
+
+#ifdef NTHREADS
+	/* Each thread's interpreters have heaps of their own */
+	for (i = 0; i < NTHREADS; i++) {
+	    error = pthread_create(&thread[i], NULL, thread_main, &result[i]);
+	    TEST_EQ_INT(error, 0);
+	}
+	for (i = 0; i < NTHREADS; i++) {
+	    pthread_join(thread[i], NULL);
+	    TEST(result[i] == NROUNDS * 10000);
+	}
+#endif
+}
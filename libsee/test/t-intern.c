@@ -0,0 +1,68 @@
+#include "test.inc"
+#include <see/see.h>
+
+/*
+ * Interns many names that share a long prefix, and checks that they
+ * stay distinct, are found again, and that the table grew to fit them.
+ */
+
+#define N	10000
+
+static struct SEE_string *names[N];
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_intern_stats stats;
+	struct SEE_string *s, *is;
+	char buf[40];
+	int i, ok;
+
+	TEST_DESCRIBE("intern table tests");
+
+	SEE_interpreter_init(interp);
+	SEE_intern_stats(interp, &stats);
+	TEST(stats.global_count > 0);
+	TEST(stats.count < 1000);
+
+	for (i = 0; i < N; i++) {
+		sprintf(buf, "config_value_%d", i);
+		names[i] = SEE_intern_ascii(interp, buf);
+	}
+
+	/* Interned names are unique, whichever way they are interned */
+	ok = 1;
+	for (i = 0; i < N; i++) {
+		sprintf(buf, "config_value_%d", i);
+		if (SEE_intern_ascii(interp, buf) != names[i])
+			ok = 0;
+		s = SEE_string_sprintf(interp, "%s", buf);
+		is = SEE_intern(interp, s);
+		if (is != names[i] || is == s)
+			ok = 0;
+		if (SEE_intern(interp, is) != is)
+			ok = 0;
+	}
+	TEST(ok);
+	TEST_NOT_EQ_PTR(names[1], names[10]);
+
+	/* Strings in the global table are found before local ones */
+	is = SEE_intern_ascii(interp, "prototype");
+	TEST_NULL(is->interpreter);
+	s = SEE_string_sprintf(interp, "prototype");
+	TEST_EQ_PTR(SEE_intern(interp, s), is);
+
+	/* Single characters and small integers are shared and interned */
+	TEST_EQ_PTR(_SEE_intern_chars['x'], SEE_intern_ascii(interp, "x"));
+	TEST_EQ_PTR(_SEE_intern_chars['7'], _SEE_intern_ints[7]);
+	TEST_EQ_PTR(_SEE_intern_ints[0], SEE_intern_ascii(interp, "0"));
+	TEST_EQ_PTR(_SEE_intern_ints[1000], SEE_intern_ascii(interp, "1000"));
+	TEST_EQ_INT(_SEE_intern_chars[0xe9]->data[0], 0xe9);
+	TEST_NULL(_SEE_intern_ints[42]->interpreter);
+
+	SEE_intern_stats(interp, &stats);
+	TEST(stats.count >= N);
+	TEST(stats.size >= stats.count);
+	TEST(stats.longest < 16);
+}
@@ -0,0 +1,123 @@
+#include "test.inc"
+#include <see/see.h>
+
+/*
+ * Exercises native object property storage across the change
+ * from the small inline array to the hash table.
+ */
+
+/* Counts the properties reported by an object's enumerator */
+static int
+count_enum(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	struct SEE_enum *e;
+	int count = 0;
+
+	e = SEE_OBJECT_ENUMERATOR(interp, o);
+	while (SEE_ENUM_NEXT(interp, e, NULL))
+	    count++;
+	return count;
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_object *o, *proto;
+	struct SEE_string *names[100], *s;
+	struct SEE_value v;
+	char buf[32];
+	int i, ok;
+
+	TEST_DESCRIBE("native object property storage");
+
+	SEE_interpreter_init(interp);
+	for (i = 0; i < 100; i++) {
+	    sprintf(buf, "p%d", i);
+	    names[i] = SEE_intern_ascii(interp, buf);
+	}
+
+	proto = SEE_native_new(interp);
+	o = SEE_native_new(interp);
+	o->Prototype = proto;
+	TEST_EQ_INT(count_enum(interp, o), 0);
+
+	/* Inherited properties are found through the prototype */
+	SEE_SET_NUMBER(&v, -1);
+	SEE_OBJECT_PUT(interp, proto, names[99], &v, 0);
+	SEE_OBJECT_GET(interp, o, names[99], &v);
+	TEST_EQ_TYPE(SEE_VALUE_GET_TYPE(&v), SEE_NUMBER);
+	TEST_EQ_FLOAT(v.u.number, -1);
+
+	/* Fill well past the inline array */
+	for (i = 0; i < 90; i++) {
+	    SEE_SET_NUMBER(&v, i);
+	    SEE_OBJECT_PUT(interp, o, names[i], &v, 0);
+	}
+	TEST_EQ_INT(count_enum(interp, o), 90);
+
+	ok = 1;
+	for (i = 0; i < 90; i++) {
+	    SEE_OBJECT_GET(interp, o, names[i], &v);
+	    if (SEE_VALUE_GET_TYPE(&v) != SEE_NUMBER || v.u.number != i)
+		ok = 0;
+	}
+	TEST(ok);
+	TEST(!SEE_native_hasownproperty(interp, o, names[95]));
+	TEST(SEE_OBJECT_HASPROPERTY(interp, o, names[99]));
+
+	/* Delete every other property, then re-add some */
+	for (i = 0; i < 90; i += 2)
+	    TEST_EQ_INT(SEE_OBJECT_DELETE(interp, o, names[i]), 1);
+	TEST_EQ_INT(count_enum(interp, o), 45);
+	ok = 1;
+	for (i = 0; i < 90; i++)
+	    if (SEE_native_hasownproperty(interp, o, names[i]) != (i & 1))
+		ok = 0;
+	TEST(ok);
+	for (i = 0; i < 20; i += 2) {
+	    SEE_SET_NUMBER(&v, 1000 + i);
+	    SEE_OBJECT_PUT(interp, o, names[i], &v, 0);
+	}
+	TEST_EQ_INT(count_enum(interp, o), 55);
+	SEE_OBJECT_GET(interp, o, names[10], &v);
+	TEST_EQ_FLOAT(v.u.number, 1010);
+	SEE_OBJECT_GET(interp, o, names[11], &v);
+	TEST_EQ_FLOAT(v.u.number, 11);
+
+	/* Attributes are kept, and DontDelete is honoured */
+	SEE_SET_BOOLEAN(&v, 1);
+	SEE_OBJECT_PUT(interp, o, names[2], &v,
+	    SEE_ATTR_READONLY | SEE_ATTR_DONTDELETE);
+	TEST_FALSE(SEE_OBJECT_CANPUT(interp, o, names[2]));
+	TEST_EQ_INT(SEE_OBJECT_DELETE(interp, o, names[2]), 0);
+	SEE_SET_BOOLEAN(&v, 0);
+	SEE_OBJECT_PUT(interp, o, names[2], &v, 0);
+	SEE_OBJECT_GET(interp, o, names[2], &v);
+	TEST_EQ_INT(v.u.boolean, 1);
+
+	/* Small objects delete from the middle and keep their order */
+	o = SEE_native_new(interp);
+	for (i = 0; i < 4; i++) {
+	    SEE_SET_NUMBER(&v, i);
+	    SEE_OBJECT_PUT(interp, o, names[i], &v, 0);
+	}
+	SEE_OBJECT_DELETE(interp, o, names[1]);
+	{
+	    struct SEE_enum *e = SEE_OBJECT_ENUMERATOR(interp, o);
+	    s = SEE_ENUM_NEXT(interp, e, NULL);
+	    TEST_EQ_PTR(s, names[0]);
+	    s = SEE_ENUM_NEXT(interp, e, NULL);
+	    TEST_EQ_PTR(s, names[2]);
+	    s = SEE_ENUM_NEXT(interp, e, NULL);
+	    TEST_EQ_PTR(s, names[3]);
+	    s = SEE_ENUM_NEXT(interp, e, NULL);
+	    TEST_NULL(s);
+	}
+	SEE_OBJECT_GET(interp, o, names[1], &v);
+	TEST_EQ_TYPE(SEE_VALUE_GET_TYPE(&v), SEE_UNDEFINED);
+	SEE_OBJECT_GET(interp, o, names[3], &v);
+	TEST_EQ_FLOAT(v.u.number, 3);
+}
@@ -0,0 +1,145 @@
+#include "test.inc"
+#include <see/see.h>
+
+/*
+ * Compiles programs in one clone of a template and runs them in
+ * others: each run behaves as if the text had been evaluated in the
+ * running clone, and strings keep their identity.
+ */
+
+static const char page[] =
+	"var hits = (typeof hits == 'undefined' ? 0 : hits) + 1;\n"
+	"function tag(name, body) { return '<' + name + '>' + body +\n"
+	"    '</' + name + '>'; }\n"
+	"var o = { greeting: 'hi', list: [1, 2, 3] };\n"
+	"o.seen = seen;\n"
+	"tag('p', o.greeting + ' ' + o.list.join('') + ' ' + hits +\n"
+	"    ' ' + /b+/.exec('abbbc')[0]);\n";
+
+/* Compiles a script in a clone */
+static struct SEE_program *
+compile(interp, text)
+	struct SEE_interpreter *interp;
+	const char *text;
+{
+	struct SEE_input *input;
+	struct SEE_program *program;
+
+	input = SEE_input_utf8(interp, text);
+	program = SEE_program_compile(interp, input);
+	SEE_INPUT_CLOSE(input);
+	return program;
+}
+
+/* Runs a program and tests its result, which changes between runs */
+static int
+run_program(interp, program, expected)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+	const char *expected;
+{
+	struct SEE_value res, s;
+
+	SEE_program_run(interp, program, &res);
+	SEE_ToString(interp, &res, &s);
+	return SEE_string_cmp_ascii(s.u.string, expected) == 0;
+}
+
+#define TEST_RUN(interp, program, expected) \
+	TEST(run_program(interp, program, expected))
+
+/* Runs the checks with whichever allocator is installed */
+static void
+run()
+{
+	struct SEE_interpreter tmpl, other, a, b;
+	struct SEE_program *program, *bad;
+	SEE_try_context_t ctxt;
+	int i, ok;
+
+	SEE_interpreter_init_template(&tmpl, SEE_system.default_compat_flags);
+	test_eval(&tmpl, "var seen = 'template';");
+
+	/* Compile in a clone that has interned strings of its own */
+	SEE_interpreter_clone(&a, &tmpl);
+	test_eval(&a, "var greeting = 1, tag = 2;");
+	program = compile(&a, page);
+	TEST(program != NULL);
+	TEST_RUN(&a, program, "<p>hi 123 1 bbb</p>");
+
+	/* Run it in another clone; strings are the clone's own */
+	SEE_interpreter_clone(&b, &tmpl);
+	TEST_RUN(&b, program, "<p>hi 123 1 bbb</p>");
+	TEST_RUN(&b, program, "<p>hi 123 2 bbb</p>");
+	TEST_EVAL(&b, "o.seen + typeof greeting + tag('b', 'x')",
+	    "templateundefined<b>x</b>");
+	TEST_EQ_PTR(SEE_intern_ascii(&b, "greeting"),
+	    SEE_intern_ascii(&b, "greeting"));
+	TEST_EQ_PTR(SEE_intern_ascii(&b, "greeting")->interpreter, &b);
+	TEST_EVAL(&b, "var g = {}; g.greeting = 1; o.greeting + g.greeting",
+	    "hi1");
+
+	/* The compiling clone can go away */
+	SEE_gcollect(&a);
+	ok = 1;
+	for (i = 0; i < 100; i++) {
+	    SEE_interpreter_clone(&b, &tmpl);
+	    if (!run_program(&b, program, "<p>hi 123 1 bbb</p>"))
+		    ok = 0;
+	}
+	TEST(ok);
+
+	/* Syntax errors are thrown from SEE_program_compile */
+	SEE_interpreter_clone(&a, &tmpl);
+	bad = NULL;
+	SEE_TRY(&a, ctxt) {
+	    bad = compile(&a, "var x = ;");
+	}
+	TEST(SEE_CAUGHT(ctxt) != NULL);
+	TEST(bad == NULL);
+	SEE_program_free(program);
+	program = compile(&a, "'still ' + 'works'");
+	SEE_interpreter_clone(&b, &tmpl);
+	TEST_RUN(&b, program, "still works");
+
+	/* Interpreters that are not clones of its template are refused */
+	SEE_interpreter_init(&other);
+	bad = NULL;
+	SEE_TRY(&other, ctxt) {
+	    bad = compile(&other, "1");
+	}
+	TEST(SEE_CAUGHT(ctxt) != NULL);
+	TEST(bad == NULL);
+	SEE_TRY(&other, ctxt) {
+	    run_program(&other, program, "still works");
+	}
+	TEST(SEE_CAUGHT(ctxt) != NULL);
+	SEE_interpreter_init_template(&other,
+	    SEE_system.default_compat_flags);
+	SEE_interpreter_clone(&a, &other);
+	SEE_TRY(&a, ctxt) {
+	    run_program(&a, program, "still works");
+	}
+	TEST(SEE_CAUGHT(ctxt) != NULL);
+
+	/* Freeing a program leaves later ones working */
+	SEE_program_free(program);
+	SEE_interpreter_clone(&a, &tmpl);
+	program = compile(&a, page);
+	SEE_interpreter_clone(&b, &tmpl);
+	TEST_RUN(&b, program, "<p>hi 123 1 bbb</p>");
+	SEE_program_free(program);
+	SEE_program_free(NULL);
+}
+
+void
+test()
+{
+	TEST_DESCRIBE("programs compiled for clones of a template");
+
+	SEE_init();
+	run();
+
+	SEE_gc_install(SEE_GC_GENERATIONAL);
+	run();
+}
@@ -5,8 +5,10 @@ void
 test()
 {
 	struct SEE_interpreter interp_storage, *interp = &interp_storage;
-	struct SEE_string *s1, *s2;
-	int val;
+	struct SEE_string *s1, *s2, *r;
+	char buf[400];
+	int val, i;
+	SEE_char_t wide[3];
 
 	TEST_DESCRIBE("string tests");
 
@@ -42,4 +44,62 @@ test()
 	TEST_EQ_INT(val, +1);
 	val = SEE_string_cmp(s1, SEE_intern_ascii(interp, "helloo"));
 	TEST_EQ_INT(val, -1);
+
+	/* Long concatenations of fixed strings defer their copying */
+	s1 = SEE_intern_ascii(interp, "0123456789");
+	r = s1;
+	for (i = 0; i < 19; i++)
+	    r = SEE_string_concat(interp, s1, r);
+	TEST_EQ_INT(r->length, 200);
+	TEST_NULL(r->data);
+	s2 = SEE_string_dup(interp, r);
+	TEST_EQ_INT(SEE_string_cmp(r, s2), 0);
+	TEST_EQ_INT(r->data[199], '9');
+	r = SEE_string_concat(interp, SEE_string_concat(interp, r, s1), r);
+	TEST_EQ_INT(SEE_string_utf8_size(interp, r), 410);
+	SEE_string_toutf8(interp, buf, sizeof buf, 
+	    SEE_string_concat(interp, s1, SEE_string_substr(interp, r, 0, 190)));
+	TEST_EQ_INT(strlen(buf), 200);
+	TEST_EQ_INT(buf[199], '9');
+	TEST_EQ_PTR(SEE_intern(interp, SEE_string_concat(interp, s1, s2)),
+	    SEE_intern(interp, SEE_string_concat(interp, s2, s1)));
+
+	/* Substring search, with short and long needles */
+	s1 = SEE_string_sprintf(interp, "%s", 
+	    "abcabcabd aaaaaaaaab the quick brown fox, the quick brown ox");
+	s2 = SEE_string_sprintf(interp, "abd");
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 0), 6);
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 7), -1);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 100), 6);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 5), -1);
+	s2 = SEE_string_sprintf(interp, "quick brown ");
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 0), 25);
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 26), 46);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 100), 46);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 45), 25);
+	s2 = SEE_string_sprintf(interp, "aaaaaaaab");
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 0), 11);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 100), 11);
+	s2 = SEE_string_sprintf(interp, "brown ox");
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 0), 52);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 52), 52);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 51), -1);
+	s2 = SEE_string_sprintf(interp, "");
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 3), 3);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 1000), s1->length);
+	TEST_EQ_INT(_SEE_string_search(s2, s1, 0), -1);
+
+	/* Characters that share a low byte are still told apart */
+	wide[0] = 0x161; wide[1] = 0x61; wide[2] = 0x261;
+	s1 = SEE_string_new(interp, 0);
+	for (i = 0; i < 30; i++)
+	    SEE_string_addch(s1, wide[i % 3]);
+	s2 = SEE_string_new(interp, 0);
+	for (i = 0; i < 10; i++)
+	    SEE_string_addch(s2, wide[(i + 2) % 3]);
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 0), 2);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 100), 20);
+	s2->length = 1;
+	TEST_EQ_INT(_SEE_string_search(s1, s2, 3), 5);
+	TEST_EQ_INT(_SEE_string_rsearch(s1, s2, 28), 26);
 }
@@ -40,55 +40,20 @@
 
 #else /* WITH_UNICODE_TABLES */
 
-struct case_map {
-    SEE_char_t from, to;
-};
-
-/* Prototypes */
-static SEE_char_t search(struct case_map *, unsigned int, unsigned int);
-
 # include "unicase.inc"
 
-# define lengthof(a) (sizeof a / sizeof (a)[0])
-
-/* Binary search a map for the character. Usually done in 9 steps. */
-static SEE_char_t
-search(map, ch, maplen)
-	struct case_map *map;
-	unsigned int ch;		/* promoted from SEE_char_t */
-	unsigned int maplen;
-{
-	unsigned int a, b, m;
-
-	a = 0;
-	b = maplen;
-	for (;;) {
-	    m = (a + b) / 2;
-	    if (map[m].from == ch)
-	    	return map[m].to;
-	    if (map[m].from > ch) {
-		if (b == m) break;
-	    	b = m; 
-	    } else  {
-		if (a == m) break;
-	    	a = m;
-	    }
-	}
-	return ch;
-}
-
 SEE_char_t
 SEE_unicase_tolower(ch)
 	unsigned int ch;		/* promoted from SEE_char_t */
 {
-	return search(lowercase_map, ch, lengthof(lowercase_map));
+	return _UNICASE(ch, lower);
 }
 
 SEE_char_t
 SEE_unicase_toupper(ch)
 	unsigned int ch;		/* promoted from SEE_char_t */
 {
-	return search(uppercase_map, ch, lengthof(uppercase_map));
+	return _UNICASE(ch, upper);
 }
 
 #endif /* WITH_UNICODE_TABLES */
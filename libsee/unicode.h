@@ -44,8 +44,23 @@ extern int	      SEE_unicode_Zscodeslen;
 SEE_char_t SEE_unicase_tolower(unsigned int ch);
 SEE_char_t SEE_unicase_toupper(unsigned int ch);
 
-# define UNICODE_TOLOWER(ch)	SEE_unicase_tolower(ch)
-# define UNICODE_TOUPPER(ch)	SEE_unicase_toupper(ch)
+/*
+ * The case mappings are also two-level tables, of deltas to add to a
+ * character: its high byte picks a page of 256 deltas from the index,
+ * and its low byte picks the delta. Pages without any mappings are
+ * shared. Characters beyond 0xffff have no case mapping here.
+ * (See gencase.pl)
+ */
+extern const unsigned char SEE_unicase_lower_index[256];
+extern const unsigned char SEE_unicase_upper_index[256];
+extern const SEE_char_t SEE_unicase_lower_page[][256];
+extern const SEE_char_t SEE_unicase_upper_page[][256];
+# define _UNICASE(c, map)						\
+	((c) > 0xffff ? (c) : (SEE_char_t)((c) + SEE_unicase_##map##_page \
+	    [SEE_unicase_##map##_index[(c) >> 8]][(c) & 0xff]))
+
+# define UNICODE_TOLOWER(ch)	_UNICASE(ch, lower)
+# define UNICODE_TOUPPER(ch)	_UNICASE(ch, upper)
 
 #else /* !WITH_UNICODE_TABLES */
 
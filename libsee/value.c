@@ -49,11 +49,13 @@
 #include <see/system.h>
 #include <see/error.h>
 #include <see/interpreter.h>
+#include <see/intern.h>
 
 #include "lex.h"
 #include "stringdefs.h"
 #include "dtoa.h"
 #include "nmath.h"
+#include "snapshot.h"
 
 /*
  * Value type-converters and some numeric constants.
@@ -148,6 +150,47 @@ SEE_ToBoolean(interp, val, res)
 	SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(res) == SEE_BOOLEAN);
 }
 
+/*
+ * Converts a plain decimal string such as "42", "-7" or "0.25" without
+ * the scanner. With at most 15 significant digits the digits are exact
+ * as an integer, and dividing by an exact power of ten rounds correctly.
+ * Returns 0 for anything else (whitespace, exponents, hex, Infinity,
+ * long numbers), which is left to SEE_lex_number().
+ */
+static int
+decimal_number(s, res)
+	const struct SEE_string *s;
+	struct SEE_value *res;
+{
+	static const double tens[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15
+	};
+	const SEE_char_t *p = s->data, *end = s->data + s->length;
+	double m = 0;
+	int negative = 0, ndigits = 0, nfrac = -1;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	for (; p < end; p++)
+		if (*p >= '0' && *p <= '9') {
+			if (++ndigits > 15)
+				return 0;
+			m = m * 10 + (*p - '0');
+			if (nfrac >= 0)
+				nfrac++;
+		} else if (*p == '.' && nfrac < 0)
+			nfrac = 0;
+		else
+			return 0;
+	if (!ndigits)
+		return 0;
+	if (nfrac > 0)
+		m /= tens[nfrac];
+	SEE_SET_NUMBER(res, negative ? -m : m);
+	return 1;
+}
+
 /* 9.3 */
 void
 SEE_ToNumber(interp, val, res)
@@ -170,7 +213,9 @@ SEE_ToNumber(interp, val, res)
 	case SEE_STRING:
 	    {
 		/* Use the scanner to evaluate a StrNumericLiteral */
-		if (!SEE_lex_number(interp, val->u.string, res))
+		SEE_STRING_FLATTEN(val->u.string);
+		if (!decimal_number(val->u.string, res) &&
+		    !SEE_lex_number(interp, val->u.string, res))
 			SEE_SET_NUMBER(res, SEE_NaN);
 		break;
 	    }
@@ -257,6 +302,160 @@ SEE_ToUint16(interp, val)
 	}
 }
 
+/*
+ * Numbers are converted to strings over and over, mostly as array
+ * indices and loop counters. Each interpreter keeps a small direct-mapped
+ * cache of recently converted numbers and their strings. The strings
+ * are ungrowable, so it is safe to hand the same one out again.
+ */
+#define NUMBER_CACHE_SIZE	256		/* entries; a power of 2 */
+
+struct number_cache_entry {
+	SEE_number_t number;
+	struct SEE_string *string;
+};
+
+static const struct snapshot_word number_cache_words[] = {
+	SNAPSHOT_PTR(struct number_cache_entry, string),
+	SNAPSHOT_WORDS_END
+};
+SNAPSHOT_LAYOUT_DEFINE(number_cache_layout, struct number_cache_entry,
+	number_cache_words);
+
+/* Returns a hash of a number; small integers map to themselves */
+static unsigned int
+number_hash(n)
+	SEE_number_t n;
+{
+	unsigned int w[sizeof (SEE_number_t) / sizeof (unsigned int)];
+	unsigned int i, h;
+
+	if (n > -2147483648.0 && n < 2147483648.0 && n == (SEE_int32_t)n)
+		return (unsigned int)(SEE_int32_t)n;
+	memcpy(w, &n, sizeof w);
+	for (h = 2166136261U, i = 0; i < sizeof w / sizeof w[0]; i++)
+		h = (h ^ w[i]) * 16777619U;
+	return h ^ (h >> 16);
+}
+
+/*
+ * Formats a finite, non-zero number as ASCII (9.8.1), returning the
+ * length. buf must hold at least 32 chars.
+ */
+static int
+number_format(n, buf)
+	SEE_number_t n;
+	char *buf;
+{
+	char digits[32], *a0, *endstr;
+	int len = 0, k, dpt, i, sign, exponent;
+	SEE_uint64_t u;
+
+	if (n < 0) {
+		buf[len++] = '-';
+		n = -n;
+	}
+
+	/* Integers below 2^53 are the common case, and exact */
+	if (n < 9007199254740992.0 && n == (SEE_number_t)(u = (SEE_uint64_t)n))
+	{
+		for (k = 0; u; u /= 10)
+			digits[sizeof digits - ++k] = '0' + (int)(u % 10);
+		memcpy(buf + len, digits + sizeof digits - k, k);
+		return len + k;
+	}
+
+	/* Shortest digits that read back as n, and the decimal point */
+	k = _SEE_grisu3(n, digits, &dpt);
+	if (!k) {
+		a0 = SEE_dtoa(n, DTOA_MODE_SHORT_SW, 31, &dpt, &sign, &endstr);
+		k = (int)(endstr - a0);
+		memcpy(digits, a0, k);
+		SEE_freedtoa(a0);
+	}
+
+	if (k <= dpt && dpt <= 21) {
+		memcpy(buf + len, digits, k);
+		len += k;
+		for (i = k; i < dpt; i++)
+			buf[len++] = '0';
+	} else if (0 < dpt && dpt <= 21) {
+		memcpy(buf + len, digits, dpt);
+		len += dpt;
+		buf[len++] = '.';
+		memcpy(buf + len, digits + dpt, k - dpt);
+		len += k - dpt;
+	} else if (-6 < dpt && dpt <= 0) {
+		buf[len++] = '0';
+		buf[len++] = '.';
+		for (i = dpt; i < 0; i++)
+			buf[len++] = '0';
+		memcpy(buf + len, digits, k);
+		len += k;
+	} else {
+		buf[len++] = digits[0];
+		if (k > 1) {
+			buf[len++] = '.';
+			memcpy(buf + len, digits + 1, k - 1);
+			len += k - 1;
+		}
+		buf[len++] = 'e';
+		exponent = dpt - 1;
+		buf[len++] = exponent < 0 ? '-' : '+';
+		if (exponent < 0)
+			exponent = -exponent;
+		if (exponent >= 100)
+			buf[len++] = '0' + exponent / 100;
+		if (exponent >= 10)
+			buf[len++] = '0' + exponent / 10 % 10;
+		buf[len++] = '0' + exponent % 10;
+	}
+	return len;
+}
+
+/* Returns the string form of a finite, non-zero number */
+static struct SEE_string *
+number_string(interp, n)
+	struct SEE_interpreter *interp;
+	SEE_number_t n;
+{
+	struct number_cache_entry *cache, *e;
+	struct SEE_string *s;
+	char buf[32];
+	int i, len;
+
+	if (n > 0 && n < _SEE_INTERN_NINTS && n == (unsigned int)n)
+		return _SEE_intern_ints[(unsigned int)n];
+
+	if (!interp->number_cache) {
+		cache = SEE_NEW_ARRAY(interp, struct number_cache_entry,
+		    NUMBER_CACHE_SIZE);
+		SNAPSHOT_LAYOUT(interp, cache, &number_cache_layout);
+		for (i = 0; i < NUMBER_CACHE_SIZE; i++)
+			cache[i].string = NULL;
+		interp->number_cache = cache;
+	}
+	e = (struct number_cache_entry *)interp->number_cache +
+		(number_hash(n) & (NUMBER_CACHE_SIZE - 1));
+	if (e->string && e->number == n)
+		return e->string;
+
+	len = number_format(n, buf);
+	s = SEE_NEW(interp, struct SEE_string);
+	SNAPSHOT_LAYOUT(interp, s, &_SEE_snapshot_string);
+	s->length = len;
+	s->data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, len);
+	for (i = 0; i < len; i++)
+		s->data[i] = buf[i];
+	s->interpreter = interp;
+	s->stringclass = NULL;
+	s->flags = 0;
+
+	e->number = n;
+	e->string = s;
+	return s;
+}
+
 /* 9.8 */
 void
 SEE_ToString(interp, val, res)
@@ -274,96 +473,20 @@ SEE_ToString(interp, val, res)
 		SEE_SET_STRING(res, val->u.boolean ? STR(true) : STR(false));
 		break;
 	case SEE_NUMBER:					 /* 9.8.1 */
-		if (SEE_NUMBER_ISNAN(val)) {
+		if (SEE_NUMBER_ISNAN(val))
 			SEE_SET_STRING(res, STR(NaN));
-		} else if (val->u.number == 0) {
+		else if (val->u.number == 0)
 			SEE_SET_STRING(res, STR(zero_digit));
-		} else if (val->u.number < 0) {
-			struct SEE_value neg, negstr;
-			SEE_SET_NUMBER(&neg, -(val->u.number));
-			SEE_ToString(interp, &neg, &negstr);
-			SEE_SET_STRING(res, SEE_string_concat(interp,
-			    STR(minus), negstr.u.string));
-			SEE_string_free(interp, &negstr.u.string);
-		} else if (SEE_NUMBER_ISPINF(val)) {
+		else if (SEE_NUMBER_ISPINF(val))
 			SEE_SET_STRING(res, STR(Infinity));
-		} else {
-			char *a0, *a, *endstr;
-			struct SEE_string *s;
-			int sign, k, n, i, exponent;
-			int len;
-
-			a0 = SEE_dtoa(val->u.number, DTOA_MODE_SHORT_SW, 31, 
-				&n, &sign, &endstr);
-			k = (int)(endstr - a0);
-			a = SEE_STRING_ALLOCA(interp, char, k);
-			memcpy(a, a0, k);
-			SEE_freedtoa(a0);
-
-			/* Numbers converted to strings are generally
-			 * small and short-lived. */
-			len = 0;
-			if (k <= n && n <= 21) {
-			    len = n;
-			} else if (0 < n && n <= 21) {
-			    len = k + 1;
-			} else if (-6 < n && n <= 0) {
-			    len = 2 + -n + k;
-			} else if (k == 1) {
-			    len = 1;
-			    goto add_exponent_len;
-			} else {
-			    len = k + 1;
-	    add_exponent_len:
-			    len += 2; /* e[+-] */
-			    exponent = n > 0 ? n - 1 : 1 - n;
-			    /* n!=1 => exponent!=0 */
-			    while (exponent) {
-				len++;
-				exponent /= 10;
-			    }
-			}
-			/* --end-- */
-
-			s = SEE_string_new(interp, len);
-			SEE_ASSERT(interp, !sign);
-			if (k <= n && n <= 21) {
-			    for (i = 0; i < k; i++)
-				SEE_string_addch(s, a[i]);
-			    for (i = 0; i < n-k; i++)
-				SEE_string_addch(s, '0');
-			} else if (0 < n && n <= 21) {
-			    for (i = 0; i < n; i++)
-				SEE_string_addch(s, a[i]);
-			    SEE_string_addch(s, '.');
-			    for (; i < k; i++)
-				SEE_string_addch(s, a[i]);
-			} else if (-6 < n && n <= 0) {
-			    SEE_string_addch(s, '0');
-			    SEE_string_addch(s, '.');
-			    for (i = 0; i < -n; i++)
-				SEE_string_addch(s, '0');
-			    for (i = 0; i < k; i++)
-				SEE_string_addch(s, a[i]);
-			} else if (k == 1) {
-			    SEE_string_addch(s, a[0]);
-			    goto add_exponent;
-			} else {
-			    SEE_string_addch(s, a[0]);
-			    SEE_string_addch(s, '.');
-			    for (i = 1; i < k; i++)
-				SEE_string_addch(s, a[i]);
-	    add_exponent:   SEE_string_addch(s, 'e');
-			    exponent = n - 1;
-			    if (exponent > 0)
-				SEE_string_addch(s, '+');
-			    SEE_string_append_int(s, exponent);
-			}
-			SEE_ASSERT(interp, len == s->length);
-			SEE_SET_STRING(res, s);
-		} 
+		else if (SEE_NUMBER_ISNINF(val))
+			SEE_SET_STRING(res, SEE_string_concat(interp,
+			    STR(minus), STR(Infinity)));
+		else
+			SEE_SET_STRING(res, number_string(interp, val->u.number));
 		break;
 	case SEE_STRING:
+		SEE_STRING_FLATTEN(val->u.string);
 		SEE_VALUE_COPY(res, val);
 		break;
 	case SEE_OBJECT:
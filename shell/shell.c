@@ -17,6 +17,7 @@
  *  Shell.gcdump - calls GC_dump(), if available
  *  Shell.regex_engines - returns array of regex engines
  *  Shell.regex_engine  - sets/gets the current interp's regex engine
+ *  Shell.intern_stats  - returns statistics about the intern tables
  *
  * In HTML mode the following objects are provided:
  *
@@ -76,6 +77,9 @@ static void shell_regex_engines_fn(struct SEE_interpreter *,
 static void shell_regex_engine_fn(struct SEE_interpreter *, 
 	struct SEE_object *, struct SEE_object *, int, struct SEE_value **, 
 	struct SEE_value *);
+static void shell_intern_stats_fn(struct SEE_interpreter *, 
+	struct SEE_object *, struct SEE_object *, int, struct SEE_value **, 
+	struct SEE_value *);
 
 /*
  * Adds useful symbols into the interpreter's internal symbol table. 
@@ -102,6 +106,7 @@ shell_strings()
 	SEE_intern_global("abort");
 	SEE_intern_global("regex_engines");
 	SEE_intern_global("regex_engine");
+	SEE_intern_global("intern_stats");
 }
 
 /*
@@ -361,6 +366,35 @@ shell_regex_engine_fn(interp, self, thisobj, argc, argv, res)
 	    *names ? *names : "?"));
 }
 
+/*
+ * Return an object describing the intern tables
+ */
+static void
+shell_intern_stats_fn(interp, self, thisobj, argc, argv, res)
+        struct SEE_interpreter *interp;
+        struct SEE_object *self, *thisobj;
+        int argc;
+        struct SEE_value **argv, *res;
+{
+	struct SEE_intern_stats stats;
+	struct SEE_object *obj;
+	struct SEE_value v;
+
+	SEE_intern_stats(interp, &stats);
+	obj = SEE_Object_new(interp);
+	SEE_SET_NUMBER(&v, stats.count);
+	SEE_OBJECT_PUTA(interp, obj, "count", &v, SEE_ATTR_DEFAULT);
+	SEE_SET_NUMBER(&v, stats.size);
+	SEE_OBJECT_PUTA(interp, obj, "size", &v, SEE_ATTR_DEFAULT);
+	SEE_SET_NUMBER(&v, stats.longest);
+	SEE_OBJECT_PUTA(interp, obj, "longest", &v, SEE_ATTR_DEFAULT);
+	SEE_SET_NUMBER(&v, stats.global_count);
+	SEE_OBJECT_PUTA(interp, obj, "global_count", &v, SEE_ATTR_DEFAULT);
+	SEE_SET_NUMBER(&v, stats.global_size);
+	SEE_OBJECT_PUTA(interp, obj, "global_size", &v, SEE_ATTR_DEFAULT);
+	SEE_SET_OBJECT(res, obj);
+}
+
 static void
 add_methods(interp, object, methods)
 	struct SEE_interpreter *interp;
@@ -399,6 +433,7 @@ shell_add_globals(interp)
 		{ "abort",		shell_abort_fn,		1 },
 		{ "regex_engines",	shell_regex_engines_fn,	0 },
 		{ "regex_engine",	shell_regex_engine_fn,	1 },
+		{ "intern_stats",	shell_intern_stats_fn,	0 },
 		{0}
 	};
 
@@ -0,0 +1,54 @@
+describe("Exercises instruction sequences that the code backend combines.")
+
+/* Comparisons that branch, including those with NaN and strings */
+function below(a, b) { var n = 0; while (a < b) { a++; n++; } return n; }
+test("below(0, 5)", 5)
+test("below(0, NaN)", 0)
+test("below(NaN, 5)", 0)
+test("below('a', 'c')", 1)
+function lt(a, b) { if (a < b) return 'yes'; return 'no'; }
+test("lt('abc', 'abd')", "yes")
+test("lt('b', 'a')", "no")
+test("lt(undefined, 1)", "no")
+test("lt({ valueOf: function () { return 1; } }, 2)", "yes")
+
+/* Adding literals to numbers, strings and objects */
+function plus1(x) { return x + 1; }
+test("plus1(2)", 3)
+test("plus1('2')", "21")
+test("plus1(null)", 1)
+test("plus1({ toString: function () { return 'o'; } })", "o1")
+function tail(x) { return x + 'z'; }
+test("tail(1)", "1z")
+
+/* Property, variable and scope lookups followed by their values */
+var gv = 7;
+test("gv + 1", 8)
+function member(o) { return o.p + o.q; }
+test("member({ p: 1, q: 2 })", 3)
+test("member({ p: 'a', q: 'b' })", "ab")
+test("member({})", NaN)
+function scoped(o) { with (o) return p; }
+test("scoped({ p: 4 })", 4)
+function unframed() { var v = 3; eval(''); return v + 1; }
+test("unframed()", 4)
+
+/* Branches to branches */
+function nested(a, b) {
+	var r = 0;
+	while (true) {
+		if (a) { if (b) r = 1; else r = 2; } else r = 3;
+		break;
+	}
+	return r;
+}
+test("[nested(1, 1), nested(1, 0), nested(0, 0)].join()", "1,2,3")
+function odd(n) {
+	var s = 0, i;
+	for (i = 0; i < n; i++)
+		for (;;) { if (i & 1) break; else { s++; break; } }
+	return s;
+}
+test("odd(10)", 5)
+
+finish()
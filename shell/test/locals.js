@@ -0,0 +1,127 @@
+describe("Exercises functions whose vars are kept in a frame.")
+
+/* Functions without eval, with, arguments or inner functions keep
+ * their parameters and vars in frame slots. */
+
+function add(a, b) { return a + b; }
+test("add(1, 2)", 3)
+test("add('x', 'y')", "xy")
+test("add(1)", NaN)
+test("add(1, 2, 3)", 3)
+
+function swap(a, b) { var t = a; a = b; b = t; return [a, b].join(); }
+test("swap(1, 2)", "2,1")
+
+function count(n) { var i, s = 0; for (i = 0; i < n; i++) s += i; return s; }
+test("count(10)", 45)
+test("count(0)", 0)
+
+function fact(n) { return n <= 1 ? 1 : n * fact(n - 1); }
+test("fact(10)", 3628800)
+
+/* Vars start undefined, and a var naming a parameter is the parameter */
+function undef() { var x; return typeof x; }
+test("undef()", "undefined")
+function shadow(a) { var a; return a; }
+test("shadow(5)", 5)
+function shadow2(a) { var a = a + 1; return a; }
+test("shadow2(5)", 6)
+
+/* Repeated parameter names use the last one */
+function dup(a, a) { return a; }
+test("dup(1, 2)", 2)
+test("dup(1)", undefined)
+
+/* Increment, decrement and compound assignment */
+function ops(x) {
+	var r = [];
+	r.push(x++); r.push(x); r.push(++x); r.push(x--); r.push(--x);
+	x += 10; r.push(x); x -= 1; r.push(x); x *= 2; r.push(x);
+	x /= 4; r.push(x); x %= 3; r.push(x); x <<= 3; r.push(x);
+	x >>= 1; r.push(x); x >>>= 1; r.push(x); x &= 3; r.push(x);
+	x |= 8; r.push(x); x ^= 1; r.push(x);
+	return r.join();
+}
+test("ops(1)", "1,2,3,3,1,11,10,20,5,2,16,8,4,0,8,9")
+function catstr(s) { s += "b"; s += 1; return s; }
+test("catstr('a')", "ab1")
+function incstr(s) { var t = s++; return typeof t + s; }
+test("incstr('4')", "number5")
+
+/* delete and typeof on locals */
+function del(a) { var b = 1; return [delete a, delete b, a, b].join(); }
+test("del(2)", "false,false,2,1")
+function types(a) { var b = {}; return typeof a + typeof b + typeof c; }
+test("types(1)", "numberobjectundefined")
+
+/* for-in into locals */
+function keys(o) { var k, r = ""; for (k in o) r += k; return r; }
+test("keys({a:1, b:2})", "ab")
+function keys2(o) { var r = ""; for (var k in o) r += k; return r + k; }
+test("keys2({a:1, b:2})", "abb")
+
+/* Calling a local function value gets the global this */
+function callit(f) { return f(); }
+test("callit(function() { return this; }) === this", true)
+
+/* Names that are not locals still come from the scope chain */
+var g = "global";
+function getg() { return g; }
+test("getg()", "global")
+function setg(v) { g = v; }
+setg("changed");
+test("g", "changed")
+
+/* A catch variable hides a local of the same name */
+function catcher(e) {
+	var r = [e];
+	try { throw "thrown"; } catch (e) { r.push(e); e = "set"; r.push(e); }
+	r.push(e);
+	return r.join();
+}
+test("catcher('arg')", "arg,thrown,set,arg")
+
+/* Functions that can see their activation object still work */
+function args(a) { return arguments.length + a; }
+test("args(1, 2, 3)", 4)
+function withs(o) { var x = "local"; with (o) return x; }
+test("withs({x:'o'})", "o")
+test("withs({})", "local")
+function closure(a) { var b = 2; return function() { return a + b; }; }
+test("closure(1)()", 3)
+function evals(a) { var b = 2; return eval("a + b"); }
+test("evals(1)", 3)
+
+/* An eval reached through another name makes the activation object */
+var ev = eval;
+function indirect(a) {
+	var b = 2;
+	var r = ev("a + b");
+	ev("b = 10; var c = 5");
+	return [r, b, c, a].join();
+}
+test("indirect(1)", "3,10,5,1")
+function indirect2(a) {
+	var f = ev("(function() { return a; })");
+	a = "changed";
+	return f();
+}
+test("indirect2('arg')", "changed")
+function indirect3(a) {
+	try { throw "e"; } catch (e) { return ev("e + a"); }
+}
+test("indirect3('a')", "ea")
+test("indirect3('b')", "eb")
+
+/* Under JavaScript 1.1 compatibility, f.arguments is set */
+compat('js11')
+function fargs(a) { return fargs.arguments[0] + a; }
+test("fargs(2)", 4)
+test("add(1, 2)", 3)
+compat('')
+
+/* Functions from the Function constructor */
+var mul = new Function("a", "b", "var c = a * b; return c");
+test("mul(3, 4)", 12)
+
+finish()
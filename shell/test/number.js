@@ -0,0 +1,55 @@
+describe("Exercises conversions between numbers and strings.")
+
+/* ToString on numbers (9.8.1) */
+test("String(0) + String(-0)", "00")
+test("String(7)", "7")
+test("String(-42)", "-42")
+test("String(4294967295)", "4294967295")
+test("String(9007199254740993)", "9007199254740992")
+test("String(123456789012345680000)", "123456789012345680000")
+test("String(1e21)", "1e+21")
+test("String(-Infinity)", "-Infinity")
+test("String(NaN)", "NaN")
+test("String(0.1)", "0.1")
+test("String(0.1 + 0.2)", "0.30000000000000004")
+test("String(-1.5)", "-1.5")
+test("String(123.456)", "123.456")
+test("String(0.000001)", "0.000001")
+test("String(1e-7)", "1e-7")
+test("String(-1.25e-10)", "-1.25e-10")
+test("String(1.7976931348623157e308)", "1.7976931348623157e+308")
+test("String(5e-324)", "5e-324")
+test("String(2.2250738585072014e-308)", "2.2250738585072014e-308")
+test("String(1/3)", "0.3333333333333333")
+
+/* The same number converted again gives an equal string */
+var k = [], i;
+for (i = 0; i < 1000; i++) k[i] = String(i % 300 - 150);
+test("k[0] + k[300] + k[999]", "-150-150-51")
+test("(k[5] += 'x')", "-145x")
+test("String(-145)", "-145")
+
+/* ToNumber on strings (9.3.1) */
+test("+'0'", 0)
+test("1/+'-0'", -Infinity)
+test("+'42'", 42)
+test("+'-17'", -17)
+test("+'+3.25'", 3.25)
+test("+'.5'", 0.5)
+test("+'5.'", 5)
+test("+'007'", 7)
+test("+'0.1'", 0.1)
+test("+'123456789012345'", 123456789012345)
+test("+'1234567890123456789'", 1234567890123456789)
+test("+'0.30000000000000004'", 0.1 + 0.2)
+test("+' 12 '", 12)
+test("+''", 0)
+test("+'1e3'", 1000)
+test("+'0x1F'", 31)
+test("+'Infinity'", Infinity)
+test("isNaN(+'.')", true)
+test("isNaN(+'-')", true)
+test("isNaN(+'1.2.3')", true)
+test("isNaN(+'12abc')", true)
+
+finish()
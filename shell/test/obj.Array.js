@@ -0,0 +1,128 @@
+describe("Array element storage, by index and by name.")
+
+/* Elements reached through numbers and through strings */
+var a = [10, 20, 30];
+test("a[0] + a['1'] + a[2.0]", 60)
+test("a[3]", undefined)
+test("a[-1]", undefined)
+test("a[1.5]", undefined)
+test("(a[1.5] = 'x', a['1.5'])", "x")
+test("a.length", 3)
+test("(a[-0] = 11, a[0])", 11)
+test("(a[1]++, a[1])", 21)
+test("(a['2'] += 1, a[2])", 31)
+test("typeof a[0]", "number")
+test("a[{ toString: function () { return '2'; } }]", 31)
+
+/* Holes, deletion and length */
+var h = [1, 2, 3];
+test("delete h[1]", true)
+test("1 in h", false)
+test("h[1]", undefined)
+test("h.length", 3)
+test("String(h)", "1,,3")
+test("delete h[7]", true)
+test("(h[5] = 6, h.length)", 6)
+test("3 in h", false)
+test("(h.length = 1, String(h))", "1")
+test("h[2]", undefined)
+test("(h[2] = 'z', String(h))", "1,,z")
+
+/* Elements far apart */
+var s = [];
+s[100000] = 'far';
+s[0] = 'near';
+test("s.length", 100001)
+test("s[0] + s[100000]", "nearfar")
+test("(s.length = 1, s[100000])", undefined)
+
+/* Elements missing from the array come from its prototypes */
+Array.prototype[4] = 'proto';
+var p = [0];
+test("p[4]", "proto")
+test("4 in p", true)
+test("(p[4] = 'own', p[4])", "own")
+test("[][4]", "proto")
+delete Array.prototype[4];
+test("[][4]", undefined)
+
+/* Enumeration visits elements and other properties, but not holes */
+function keys(o) { var k = [], i; for (i in o) k.push(i); return String(k.sort()); }
+var e = [5, 6, 7];
+e.x = 1;
+delete e[1];
+test("keys(e)", "0,2,x")
+test("e.hasOwnProperty('length')", false)
+
+/* Elements called as methods */
+var f = [function () { return this === f; }];
+test("f[0]()", true)
+
+/* Methods that work through [[Get]] and [[Put]] */
+test("[3, 1, 2].sort().join()", "1,2,3")
+test("[1, 2, 3].reverse().join()", "3,2,1")
+test("[1, 2, 3, 4].slice(1, 3).join()", "2,3")
+var sp = [1, 2, 3, 4];
+test("sp.splice(1, 2).join() + ';' + sp.join()", "2,3;1,4")
+test("(sp.unshift(0), sp.join())", "0,1,4")
+test("(sp.shift(), sp.join())", "1,4")
+test("(sp.push(9), sp.pop())", 9)
+test("[1].concat([2, 3], 4).join()", "1,2,3,4")
+
+/* The same methods on arrays with holes, and on other objects */
+function like() { return { length: 4, 0: 'd', 1: 'b', 3: 'a' }; }
+function show(o) { var r = [], i; for (i = 0; i < o.length; i++)
+	r.push(i in o ? o[i] : '-'); return r.join(); }
+test("show(Array.prototype.sort.call(like()))", "a,b,d,-")
+test("show(Array.prototype.reverse.call(like()))", "a,-,b,d")
+test("Array.prototype.join.call(like(), '+')", "d+b++a")
+test("show(Array.prototype.slice.call(like(), 1))", "b,-,a")
+var lk = like();
+test("(Array.prototype.shift.call(lk), show(lk))", "b,-,a")
+test("(Array.prototype.unshift.call(lk, 'x'), show(lk))", "x,b,-,a")
+test("(Array.prototype.splice.call(lk, 1, 2, 'y'), show(lk))", "x,y,a")
+var hs = [3, , 1, undefined, 2];
+test("show(hs.sort())", "1,2,3,,-")
+test("String(hs)", "1,2,3,,")
+test("show([1, , 3].concat([, 5]))", "1,-,3,-,5")
+test("show([1, , 3].slice(0, 3))", "1,-,3")
+test("show([1, , 3].reverse())", "3,-,1")
+var hu = [1, , 3];
+test("(hu.unshift(0), show(hu))", "0,1,-,3")
+test("(hu.shift(), show(hu))", "1,-,3")
+test("(hu.splice(0, 1, 'a', 'b'), show(hu))", "a,b,-,3")
+
+/* join converts each element once, leaving out undefined and null */
+test("[1, null, 'a', undefined, { toString: function () { return 'o'; } }]" +
+	".join('-')", "1--a--o")
+test("[].join()", "")
+test("[[1, 2], [3]].join(';')", "1,2;3")
+
+/* sort is stable, and finds each element's string only once */
+var rec = [], ri;
+for (ri = 0; ri < 40; ri++) rec.push({ k: ri % 3, i: ri });
+rec.sort(function (a, b) { return a.k - b.k; });
+function stable(r) { var i; for (i = 1; i < r.length; i++)
+	if (r[i - 1].k == r[i].k && r[i - 1].i > r[i].i) return false;
+	return true; }
+test("stable(rec)", true)
+test("rec[0].k + ',' + rec[39].k", "0,2")
+var nstr = 0;
+function K(v) { this.v = v; }
+K.prototype.toString = function () { nstr++; return String(this.v); };
+var ks = [], ki;
+for (ki = 20; ki > 0; ki--) ks.push(new K(ki));
+ks.sort();
+test("nstr", 20)
+test("ks.join()", "1,10,11,12,13,14,15,16,17,18,19,2,20,3,4,5,6,7,8,9")
+test("[10, 9, 1].sort().join()", "1,10,9")
+test("[10, 9, 1].sort(function (a, b) { return a - b; }).join()", "1,9,10")
+
+/* splice through the vector */
+var sv = [0, 1, 2, 3, 4, 5];
+test("sv.splice(2, 0, 'a', 'b').length + ':' + sv", "0:0,1,a,b,2,3,4,5")
+test("sv.splice(-3, 3) + ':' + sv", "3,4,5:0,1,a,b,2")
+test("sv.splice(1, 3, 'z') + ':' + sv", "1,a,b:0,z,2")
+test("sv.length", 3)
+
+finish()
@@ -0,0 +1,100 @@
+describe("Exercises the calendar fields of Date, in UTC and local time.")
+
+/* UTC fields (15.9.1.3-15.9.1.10) */
+var d = new Date(951782400000)		/* 2000-02-29 00:00 UTC */
+test("d.getUTCFullYear()", 2000)
+test("d.getUTCMonth()", 1)
+test("d.getUTCDate()", 29)
+test("d.getUTCDay()", 2)
+test("d.getUTCHours() + d.getUTCMinutes() + d.getUTCSeconds()", 0)
+test("new Date(-1).getUTCFullYear()", 1969)
+test("new Date(-1).getUTCMonth()", 11)
+test("new Date(-1).getUTCDate()", 31)
+test("new Date(-1).getUTCDay()", 3)
+test("new Date(-1).getUTCHours()", 23)
+test("new Date(-1).getUTCMilliseconds()", 999)
+test("new Date(4107542399999).getUTCDate()", 28)	/* 2100-02-28 is not leap */
+test("new Date(4107542400000).getUTCMonth()", 2)
+test("new Date(-62135596800000).getUTCFullYear()", 1)
+test("new Date(-62135596800001).getUTCFullYear()", 0)
+test("new Date(8.64e15).getUTCFullYear()", 275760)
+test("new Date(-8.64e15).getUTCFullYear()", -271821)
+test("new Date(-8.64e15).getUTCDay()", 2)
+test("new Date(NaN).getUTCDate()", NaN)
+
+/* Fields follow a date as it changes */
+d = new Date(0)
+test("d.getUTCFullYear()", 1970)
+test("d.setTime(951782400000), d.getUTCDate()", 29)
+test("d.setUTCHours(25), d.getUTCDate() + '/' + d.getUTCMonth()", "1/2")
+test("d.setTime(NaN), d.getUTCDate()", NaN)
+
+/* Local setters on an invalid date */
+d = new Date(NaN)
+test("d.setHours(1)", NaN)
+test("d.setDate(3)", NaN)
+test("d.setFullYear(2000), d.getFullYear() + '/' + d.getMonth()", "2000/0")
+test("new Date(Infinity).getHours()", NaN)
+test("d = new Date(NaN), d.setUTCFullYear(2000), d.getUTCMonth()", 0)
+
+/* Every day of 400 years matches Date.UTC */
+function days() {
+  var t, d, y = 1800, m = 0, day = 1, n = 0;
+  for (t = Date.UTC(1800, 0, 1); y < 2200; t += 86400000) {
+    d = new Date(t);
+    if (d.getUTCFullYear() != y || d.getUTCMonth() != m || 
+        d.getUTCDate() != day)
+      return y + "-" + m + "-" + day;
+    d = new Date(Date.UTC(y, m, ++day));
+    if (d.getUTCDate() != day) { day = 1; if (++m == 12) { m = 0; y++; } }
+    n++;
+  }
+  return n;
+}
+test("days()", 146097)
+
+/* Local fields agree with the timezone offset */
+function local(t) {
+  var d = new Date(t), u = new Date(t - d.getTimezoneOffset() * 60000);
+  return d.getFullYear() == u.getUTCFullYear() &&
+    d.getMonth() == u.getUTCMonth() && d.getDate() == u.getUTCDate() &&
+    d.getDay() == u.getUTCDay() && d.getHours() == u.getUTCHours() &&
+    d.getMinutes() == u.getUTCMinutes();
+}
+function locals() {
+  var t;
+  for (t = 0; t < 2e12; t += 86400000 * 6.9)
+    if (!local(t)) return t;
+  return true;
+}
+test("locals()", true)
+test("new Date(2003, 0, 15, 13, 7).getHours()", 13)
+test("new Date(2003, 6, 15, 13, 7).getMinutes()", 7)
+test("new Date(2004, 1, 29, 12).getDate()", 29)
+
+/*
+ * Daylight saving in America/New_York, which 'make check' sets in TZ.
+ * 2009 changed at 07:00 UTC on 8 March and 06:00 UTC on 1 November;
+ * 2015 is the same kind of year and changed on the same days.
+ */
+var spring = Date.UTC(2009, 2, 8, 7), fall = Date.UTC(2009, 10, 1, 6)
+test("new Date(spring - 1).getHours()", 1)
+test("new Date(spring).getHours()", 3)
+test("new Date(spring - 1).getTimezoneOffset()", 300)
+test("new Date(spring).getTimezoneOffset()", 240)
+test("new Date(fall - 1).getHours()", 1)
+test("new Date(fall - 1).getTimezoneOffset()", 240)
+test("new Date(fall).getHours()", 1)
+test("new Date(fall).getTimezoneOffset()", 300)
+test("new Date(2009, 2, 8, 1, 30).getTime() == Date.UTC(2009, 2, 8, 6, 30)",
+    true)
+test("new Date(2009, 2, 8, 3, 30).getTime() == Date.UTC(2009, 2, 8, 7, 30)",
+    true)
+test("new Date(2009, 10, 1, 0, 30).getTime() == Date.UTC(2009, 10, 1, 4, 30)",
+    true)
+test("new Date(2009, 6, 1, 12).getTimezoneOffset()", 240)
+test("new Date(Date.UTC(2015, 2, 8, 7) - 1).getHours()", 1)
+test("new Date(Date.UTC(2015, 2, 8, 7)).getHours()", 3)
+test("new Date(Date.UTC(2015, 10, 1, 6)).getTimezoneOffset()", 300)
+
+finish()
@@ -0,0 +1,127 @@
+describe("Exercises property access through the bytecode inline caches.")
+
+/* Each function below is called repeatedly, so that its property
+ * access instructions are exercised both cold and warm. */
+
+function getx(o) { return o.x; }
+function setx(o, v) { o.x = v; }
+function getm(o) { return o.m; }
+function get(o, k) { return o[k]; }
+
+function P(x) { this.x = x; }
+P.prototype.m = "P.m";
+
+function sumx(list) {
+	var i, s = 0;
+	for (i = 0; i < list.length; i++)
+		s = s + getx(list[i]);
+	return s;
+}
+
+/* Objects of one shape, then of several shapes */
+var same = [];
+for (var i = 0; i < 10; i++) same[i] = new P(i);
+test("sumx(same)", 45)
+test("sumx(same)", 45)
+var mixed = [ {x:1}, {y:0, x:2}, {a:0, b:0, x:3}, new P(4),
+	      {b:0, x:5}, {c:0, x:6}, {d:0, x:7}, {x:8, e:0} ];
+test("sumx(mixed)", 36)
+test("sumx(mixed)", 36)
+test("sumx(same)", 45)
+
+/* Values written elsewhere are seen by cached reads */
+var o1 = new P(1);
+test("getx(o1)", 1)
+o1.x = 2;
+test("getx(o1)", 2)
+setx(o1, 3);
+test("o1.x", 3)
+setx(o1, 4);
+test("getx(o1)", 4)
+
+/* Deleting and re-adding changes the slot of a property */
+var o2 = {x:"x", y:"y"};
+test("getx(o2)", "x")
+delete o2.x;
+test("getx(o2)", undefined)
+o2.x = "x2";
+test("getx(o2)", "x2")
+test("o2.y", "y")
+
+/* Prototype changes invalidate cached prototype properties */
+var o3 = new P(0);
+test("getm(o3)", "P.m")
+test("getm(o3)", "P.m")
+P.prototype.m = "P.m2";
+test("getm(o3)", "P.m2")
+o3.m = "own";
+test("getm(o3)", "own")
+delete o3.m;
+test("getm(o3)", "P.m2")
+delete P.prototype.m;
+test("getm(o3)", undefined)
+Object.prototype.m = "Object.m";
+test("getm(o3)", "Object.m")
+test("getm(o3)", "Object.m")
+P.prototype.m = "P.m3";
+test("getm(o3)", "P.m3")
+delete P.prototype.m;
+test("getm(o3)", "Object.m")
+delete Object.prototype.m;
+test("getm(o3)", undefined)
+
+/* Replacing the prototype object of a constructor */
+function Q() {}
+Q.prototype = { m: "Q1.m" };
+var q1 = new Q();
+test("getm(q1)", "Q1.m")
+Q.prototype = { m: "Q2.m" };
+var q2 = new Q();
+test("getm(q2)", "Q2.m")
+test("getm(q1)", "Q1.m")
+
+/* Writes do not go to prototypes, and respect ReadOnly */
+var o4 = new P(0);
+delete o4.x;
+P.prototype.x = "P.x";
+test("getx(o4)", "P.x")
+setx(o4, "o4.x");
+test("getx(o4)", "o4.x")
+test("P.prototype.x", "P.x")
+delete P.prototype.x;
+function setpi(o) { o.PI = 3; return o.PI; }
+test("setpi(Math) == Math.PI", true)
+test("setpi(Math) == Math.PI", true)
+test("setpi({PI:0})", 3)
+
+/* Objects large enough to use a hash table */
+var big = {};
+for (var i = 0; i < 40; i++) big["p" + i] = i;
+big.x = "big";
+test("getx(big)", "big")
+test("getx(big)", "big")
+big.extra = 1;
+delete big.p0;
+test("getx(big)", "big")
+setx(big, "big2");
+test("getx(big)", "big2")
+test("big.p39", 39)
+
+/* Computed member names */
+var o5 = {a:1, b:2, c:3};
+test("get(o5, 'a') + get(o5, 'b') + get(o5, 'c')", 6)
+test("get(o5, 'a') + get(o5, 'b') + get(o5, 'c')", 6)
+test("get('abc', 'length')", 3)
+
+/* Non-native objects go through their own [[Get]] and [[Put]] */
+var a = [1, 2, 3];
+test("getx(a)", undefined)
+setx(a, "ax");
+test("getx(a)", "ax")
+test("a.length", 3)
+test("getx(function(){})", undefined)
+function len(o) { return o.length; }
+test("len(a) + len('ab') + len(function(p,q){})", 7)
+test("len(a) + len('ab') + len(function(p,q){})", 7)
+
+finish()
@@ -19,4 +19,75 @@ test("'$1,$2'.replace(/(\\$(\\d))/g, '$$1-$1$2')", "$1-$11,$1-$22");
 test("String('ab'.split(/a*?/))", "a,b");
 test("String('ab'.split(/a*/))", ",b");
 
+describe("RegExps sharing a compiled pattern");
+
+/* Each evaluation of a literal gives an object with its own lastIndex */
+test("(function(){ var a = [], i, r; for (i = 0; i < 3; i++) {" +
+     " r = /b/g; a.push(r.exec('abcb').index, r.lastIndex); }" +
+     " return String(a); })()", "1,2,1,2,1,2");
+test("(function(){ var r1 = new RegExp('b', 'g'), r2 = new RegExp('b', 'g');" +
+     " r1.exec('abcb'); r1.exec('abcb');" +
+     " return String([r1.lastIndex, r2.lastIndex, r2.exec('abcb').index]); })()",
+     "4,0,1");
+test("new RegExp('b', 'g').global", true);
+test("new RegExp('b').global", false);
+test("new RegExp('B', 'i').test('abc')", true);
+test("new RegExp('B').test('abc')", false);
+test("'a1b22c'.replace('2', 'x')", "a1bx2c");
+test("'a1b22c'.match('2+')[0]", "22");
+test("String('a1b22c'.split(/\\d+/))", "a,b,c");
+
+describe("Searches that skip impossible start positions");
+
+test("/b/.exec('aaab').index", 3);
+test("/x/.exec('aaab')", null);
+test("/^b/.exec('ab')", null);
+test("/^a/.exec('ab').index", 0);
+test("/^b/m.exec('a\\nb').index", 2);
+test("(function(){ var r = /^a/g; r.lastIndex = 1; return r.exec('aa'); })()",
+     null);
+test("/B/i.exec('aab').index", 2);
+test("/[xy]|bc/.exec('abcxy').index", 1);
+test("/a*c/.exec('bbc').index", 2);
+test("/a*/.exec('bbc').index", 0);
+test("/(?=c)/.exec('abc').index", 2);
+test("/(b)\\1/.exec('abbb').index", 1);
+test("/\\bc/.exec('ab c').index", 3);
+test("/[c-e]/i.exec('abC').index", 2);
+test("/\\u0100/.exec('ab\\u0100').index", 2);
+test("/b/.exec('\\ud800\\udc00b').index", 2);
+test("/$/.exec('abc').index", 3);
+test("(function(){ var r = /o/g, a = [], m;" +
+     " while ((m = r.exec('foo boo'))) a.push(m.index); return String(a); })()",
+     "1,2,5,6");
+test("'hello world'.search(/o w/)", 4);
+test("'hello world'.search(/z/)", -1);
+test("'hello world'.replace(/o/g, '0')", "hell0 w0rld");
+
+
+/* replace(), match() and split() working from the match offsets */
+test("'abcabc'.replace(/(b)(c)?/g, '[$2$1$$$&]')", "a[cb$bc]a[cb$bc]");
+test("'abcabc'.replace(/b/, \"<$`|$'>\")", "a<a|cabc>cabc");
+test("'abc'.replace(/(a)|(z)/g, '[$1$2$01$]')", "[aa$]bc");
+test("'aaa'.replace(/x*/g, '-')", "-a-a-a-");
+test("'abc'.replace(/x*/g, function (m, i) { return i; })", "0a1b2c3");
+test("'aaa'.replace(/x*/, '-')", "-aaa");
+test("'abc'.replace(/b/g, function (m) { return '{' + m + '}'; })", "a{b}c");
+test("(function(){ var r = /b/g; r.lastIndex = 2; 'abcb'.replace(r, 'x');" +
+     " return r.lastIndex; })()", 0);
+test("(function(){ var r = /b/g; r.exec = function () { return null; };" +
+     " return 'abc'.replace(r, 'x'); })()", "abc");
+test("String('abcabc'.match(/b./g))", "bc,bc");
+test("String('abc'.match(/x*/g))", ",,,");
+test("String('A<B>bold</B>and'.split(/<(\\/)?([^<>]+)>/))", "A,,B,bold,/,B,and");
+test("String('a1b2c'.split(/\\d/, 2))", "a,b");
+
+/* Character classes whose ranges overlap, merge and invert */
+test("/[a-cb-fx]+/.exec('zzabcdefxq')[0]", "abcdefx");
+test("/[c-ea-b]+/.exec('xabcdez')[0]", "abcde");
+test("/[a-ce-gi-k]/.test('d')", false);
+test("/[^a-c]+/.exec('abcxyzab')[0]", "xyz");
+test("/[^\\u0000-\\uffff]/.test('a')", false);
+test("/[a-z0-9_]+/i.exec('--Ab_9Z--')[0]", "Ab_9Z");
+
 finish()
@@ -0,0 +1,46 @@
+describe("Exercises strings built from many concatenations.")
+
+/* Long concatenations are kept as ropes until their content is used */
+
+function repeat(s, n) { var r = ''; for (var i = 0; i < n; i++) r += s; return r; }
+function prepend(s, n) { var r = ''; for (var i = 0; i < n; i++) r = s + r; return r; }
+function digits(n) { var r = ''; for (var i = 0; i < n; i++) r = (i % 10) + r; return r; }
+
+var a = repeat('ab', 1000), p = prepend('xy', 1000), d = digits(500);
+test("a.length", 2000)
+test("p.length", 2000)
+test("a.charAt(1999)", "b")
+test("p.substring(0, 4)", "xyxy")
+test("d.charAt(0) + d.charAt(499)", "90")
+test("d.indexOf('9876')", 0)
+test("p == prepend('xy', 1000)", true)
+test("p === repeat('xy', 1000)", true)
+test("p < p + 'a'", true)
+test("p + 'a' > p", true)
+test("(repeat('1', 200) + '') * 1 > 1e199", true)
+
+/* Strings made of ropes within ropes */
+var l = repeat('l', 100), r = repeat('r', 100);
+var lr = (l + r) + (r + l), rl = r + (l + (r + l));
+test("lr.length", 400)
+test("lr.lastIndexOf('rl')", 299)
+test("rl.slice(98, 102)", "rrll")
+
+/* As property names, and after being appended to again */
+var o = {}; o[repeat('k', 150)] = 1;
+test("o[repeat('kk', 75)]", 1)
+var s = prepend('<p>', 100); s.length; s += 'end';
+test("s.length", 303)
+test("s.slice(-6)", "<p>end")
+test("(s + s).split('end').length", 3)
+
+/* Case conversion, in and out of the four-character ASCII blocks */
+test("'Content-Type'.toLowerCase()", "content-type")
+test("'x-forwarded-for'.toUpperCase()", "X-FORWARDED-FOR")
+test("'already lower'.toLowerCase()", "already lower")
+test("'@[`{AZaz'.toLowerCase()", "@[`{azaz")
+test("'@[`{AZaz'.toUpperCase()", "@[`{AZAZ")
+test("'abc\\u2014DEF'.toLowerCase()", "abc\u2014def")
+test("repeat('aB', 50).toUpperCase() === repeat('AB', 50)", true)
+
+finish()
@@ -52,4 +52,16 @@ test("var s=0;b:{a:{try{s+=1;break b}finally{s+=2        }s+=4}s+=8}s", 3);
 test("var s=0;b:{a:{try{s+=1;break a}finally{s+=2;break b}s+=4}s+=8}s", 3);
 test("var s=0;   a:{try{throw 0}catch(e){s+=1; break a}s+=2}  s", 1);
 
+/* Catching restores the scope, stack and blocks of the try */
+test("var o={x:1},x=2; try{with(o){throw x}}catch(e){e+x}", 3);
+test("var s=''; try{for(var k in {a:1}){with({}){throw k}}}catch(e){s=e};s",
+								"a");
+test("var s=0; try{try{throw 1}finally{s+=2}}catch(e){s+=e} s", 3);
+test("var s=0; try{try{throw 1}catch(e){throw e+1}}catch(e){s=e} s", 2);
+test("var s=0; try{[2,1].sort(function(){throw 5})}catch(e){s=e} s", 5);
+test("var s=0; for(var i=0;i<3;i++)try{if(i)continue;s+=1}finally{s+=2} s",
+								7);
+testf("function f(n){if(!n)throw 'd';f(n-1)} try{f(40)}catch(e){return e}",
+								"d");
+
 finish()
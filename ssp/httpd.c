@@ -1,68 +1,228 @@
-
 /* David Leonard, 2006. Public domain. */
 
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <stdio.h>
 #include <pthread.h>
+#include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <err.h>
+#include <poll.h>
+#include <time.h>
 #include <unistd.h>
+#if HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #include "httpd.h"
 #include "ssp.h"
+#include "pool.h"
 
 /*
  * A simple, threaded HTTP server.
- * This is just for demonstrating the SSP layer. 
+ * This is just for demonstrating the SSP layer.
  * It's not a very standard-conformant HTTP server.
+ *
+ * A fixed pool of worker threads serves all connections. Each worker
+ * has its own SSP interpreter, memory pool and response buffer, which
+ * it reuses from one request to the next. Connections are kept open
+ * after each response (HTTP/1.1 keep-alive), and requests that arrive
+ * together are served in turn from the connection's read buffer
+ * (pipelining).
+ *
+ * Where epoll is available, the listening sockets and the idle
+ * connections wait in one epoll set, and whichever worker is free
+ * accepts the next connection or serves the next connection with
+ * data. Connections are registered one-shot, so that only one worker
+ * has a connection at a time, and are non-blocking: a worker never
+ * waits for a request, but puts the connection back in the set until
+ * the rest of it arrives. Connections that wait in the set longer than
+ * TIMEOUT are shut down. Without epoll, each worker accepts a
+ * connection and serves it until it is closed.
  */
 
+#define PORT		"8000"
+#define NWORKERS	8
+#define MAXLISTEN	8
+#define TIMEOUT		10	/* seconds to wait for a request or a write */
+#define BUFSZ		16384	/* read buffer; limits the request head size */
+#define FLUSH_SIZE	65536	/* response bytes that are sent as a chunk */
+#define COPY_SIZE	512	/* static data shorter than this is copied */
+#define MAXIOV		64	/* iovecs per writev() */
 
-#define PORT	"8000"
+/* A connection, or a listening socket */
+struct conn {
+	int fd;
+	int listener;			/* true if a listening socket */
+	size_t start, end;		/* unread data in buf[] */
+	size_t scan;			/* where to look for the end of head */
+	long skip;			/* request body bytes still to skip */
+#if HAVE_SYS_EPOLL_H
+	time_t idle;			/* when it was put in the epoll set */
+	struct conn *prev, *next;	/* on the idle list while in the set */
+#endif
+	char buf[BUFSZ];
+};
+
+/* A batch of iovecs for writev() */
+struct iobatch {
+	int fd;
+	int n;				/* iovecs used */
+	int failed;
+	struct iovec iov[MAXIOV];
+};
+
+struct worker {
+	pthread_t thread;
+	int index;
+	struct ssp_worker *ssp;
+	struct response response;
+};
 
 /* Prototypes */
-static int getline(FILE *f, char *buf, size_t bufsz);
+static int conn_fill(struct conn *c);
+static int wait_writable(int fd);
+static char *conn_head(struct conn *c);
+static char *next_line(char **pp);
 static void free_headers(struct header *header);
-static int read_headers(FILE *f, struct header **headerp);
-static void *request_thread(void *arg);
-static void *server_thread(void *arg);
-static void create_server_threads(const char *service);
+static int read_headers(char **pp, struct header **headerp);
+static const char *header_value(struct header *header, const char *name);
+static int want_keepalive(const char *version, struct header *header);
+static const char *reason(int code);
+static void batch_write(struct iobatch *b);
+static void batch_add(struct iobatch *b, const void *data, size_t len);
+static int write_response(struct conn *c, struct response *resp,
+	const char *head, size_t headlen, const char *tail, size_t taillen);
+static void response_flush(struct response *resp);
+static void response_room(struct response *resp, size_t len);
+static int send_response(struct conn *c, struct response *resp,
+	int keepalive);
+static int serve_request(struct worker *w, struct conn *c);
+static int serve(struct worker *w, struct conn *c);
+static struct conn *conn_new(int fd);
+static void conn_close(struct conn *c);
+#if HAVE_SYS_EPOLL_H
+static void conn_wait(struct conn *c, int op);
+static void conn_unwait(struct conn *c);
+static void reap_idle(void);
+#endif
+static void *worker_thread(void *arg);
+static int create_listeners(const char *service);
+
+int sflag = 0;			/* IPv4 only, one worker in the main thread */
+int vflag = 0;			/* log each request */
 
-int sflag = 0;
+static int listeners[MAXLISTEN];
+static int nlisteners;
+#if HAVE_SYS_EPOLL_H
+static int epfd;
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct conn idle_list = { -1 };	/* oldest first */
+static time_t reaped;			/* when reap_idle() last looked */
+#endif
 
 /*
- * Reads a line up to the next CRLF from a FILE. Strips the CRLF.
- * Returns 0 on success
+ * Reads more data into a connection's buffer, moving unread data to
+ * the front if the buffer is full. Returns 1 if data was read, -1 if
+ * none is available yet, or 0 on end of file, error, or if the buffer
+ * is full of unread data. A blocking read that times out returns -1.
  */
 static int
-getline(f, buf, bufsz)
-	FILE *f;
-	char *buf;
-	size_t bufsz;
+conn_fill(c)
+	struct conn *c;
 {
-	int ch;
-	int pos;
-
-	for (pos = 0; (ch = fgetc(f)) != EOF;) {
-		if (ch == '\r') {
-			ch = fgetc(f);
-			if (ch != '\n') {
-				warnx("getline: expected LF after CR");
-				return -1;
-			}
-			buf[pos] = 0;
+	ssize_t n;
+
+	if (c->start == c->end)
+		c->start = c->end = c->scan = 0;
+	if (c->end == sizeof c->buf) {
+		if (!c->start) {
+			warnx("request too long");
 			return 0;
 		}
-		if (pos >= bufsz - 1) {
-			warnx("getline: out of space");
-			return -1;
-		}
-		buf[pos++] = ch;
+		memmove(c->buf, c->buf + c->start, c->end - c->start);
+		c->end -= c->start;
+		c->scan -= c->start;
+		c->start = 0;
 	}
-	warnx("getline: bad read");
-	return -1;
+	do
+		n = read(c->fd, c->buf + c->end, sizeof c->buf - c->end);
+	while (n < 0 && errno == EINTR);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return -1;
+	if (n < 0 && errno != ECONNRESET)
+		warn("read");
+	if (n <= 0)
+		return 0;
+	c->end += n;
+	return 1;
+}
+
+/* Waits until a socket can take more output. Returns 0 on timeout. */
+static int
+wait_writable(fd)
+	int fd;
+{
+	struct pollfd pfd;
+	int n;
+
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
+	do
+		n = poll(&pfd, 1, TIMEOUT * 1000);
+	while (n < 0 && errno == EINTR);
+	if (n < 0)
+		warn("poll");
+	return n > 0;
+}
+
+/*
+ * Returns the end of the request head (the blank line that follows
+ * the headers) if all of it is in the buffer, otherwise NULL.
+ */
+static char *
+conn_head(c)
+	struct conn *c;
+{
+	char *p, *end = c->buf + c->end;
+
+	if (c->scan < c->start)
+		c->scan = c->start;
+	for (p = c->buf + c->scan; p + 4 <= end; p++)
+		if (p[0] == '\r' && p[1] == '\n' && p[2] == '\r' &&
+		    p[3] == '\n')
+			return p;
+	c->scan = p - c->buf;
+	return NULL;
+}
+
+/*
+ * Returns the line at *pp, stripping its CRLF, and advances *pp to
+ * the line after. The request head must end with a blank line.
+ */
+static char *
+next_line(pp)
+	char **pp;
+{
+	char *line = *pp, *p;
+
+	for (p = line; p[0] != '\r' || p[1] != '\n'; p++)
+		;
+	*p = 0;
+	*pp = p + 2;
+	return line;
 }
 
 /* Releases storage allocated for a header list */
@@ -86,18 +246,17 @@ free_headers(header)
  * and creates a reverse linked list of the headers.
  */
 static int
-read_headers(f, headerp)
-	FILE *f;
+read_headers(pp, headerp)
+	char **pp;
 	struct header **headerp;
 {
 	struct header *header, *h;
-	char buf[8192];
+	char *buf;
 	char *p;
 
 	header = NULL;
 	for (;;) {
-		if (getline(f, buf, sizeof buf))
-			goto fail;
+		buf = next_line(pp);
 		if (!buf[0])
 			break;
 		if (buf[0] == ' ' || buf[0] == '\t') {
@@ -106,7 +265,7 @@ read_headers(f, headerp)
 				warnx("bad header");
 				goto fail;
 			}
-			p = (char *)malloc(strlen(header->value) + 
+			p = (char *)malloc(strlen(header->value) +
 				   strlen(buf) + 1);
 			if (!p) {
 				warnx("malloc");
@@ -160,46 +319,340 @@ fail:
 	return -1;
 }
 
+/* Returns the value of a (lowercase) header, or NULL */
+static const char *
+header_value(header, name)
+	struct header *header;
+	const char *name;
+{
+	for (; header; header = header->next)
+		if (strcmp(header->name, name) == 0)
+			return header->value;
+	return NULL;
+}
+
+/* Returns true if the client wants the connection kept open */
+static int
+want_keepalive(version, header)
+	const char *version;
+	struct header *header;
+{
+	const char *connection = header_value(header, "connection");
+
+	if (strcmp(version, "HTTP/1.1") == 0)
+		return !connection || strcasecmp(connection, "close") != 0;
+	return connection && strcasecmp(connection, "keep-alive") == 0;
+}
+
+static const char *
+reason(code)
+	int code;
+{
+	switch (code) {
+	case 200: return "OK";
+	case 400: return "Bad Request";
+	case 404: return "Not Found";
+	default:  return code < 500 ? "Client Error" : "Internal Error";
+	}
+}
+
+/* Writes out a batch, retrying partial writes */
+static void
+batch_write(b)
+	struct iobatch *b;
+{
+	struct iovec *iov = b->iov;
+	int niov = b->n;
+	ssize_t n;
+
+	while (niov && !b->failed) {
+		n = writev(b->fd, iov, niov);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+		    wait_writable(b->fd))
+			continue;
+		if (n < 0) {
+			if (errno != EPIPE && errno != ECONNRESET)
+				warn("writev");
+			b->failed = 1;
+			break;
+		}
+		while (niov && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			niov--;
+		}
+		if (niov) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	b->n = 0;
+}
+
+/* Adds bytes to a batch, writing it out first if it is full */
+static void
+batch_add(b, data, len)
+	struct iobatch *b;
+	const void *data;
+	size_t len;
+{
+	if (!len)
+		return;
+	if (b->n == MAXIOV)
+		batch_write(b);
+	b->iov[b->n].iov_base = (void *)data;
+	b->iov[b->n].iov_len = len;
+	b->n++;
+}
+
 /*
- * Services a request on a socket.
- * Reads the HTTP request line and the headers.
- * Argument is a pointer to a file descriptor.
- * The pointer will be freed immediately.
- * The file descriptor will be closed when the request completes.
+ * Writes a head, then the body of a response with its static segments
+ * in between, then a tail, in as few system calls as possible.
+ * Returns 0 on success.
  */
-static void *
-request_thread(arg)
-	void *arg;
+static int
+write_response(c, resp, head, headlen, tail, taillen)
+	struct conn *c;
+	struct response *resp;
+	const char *head;
+	size_t headlen;
+	const char *tail;
+	size_t taillen;
 {
-	int t;
-	FILE *tf;
-	char line[1024], *p;
-	const char *method, *uri, *version;
-	struct header *header = NULL;
+	struct iobatch b;
+	struct segment *seg;
+	size_t off = 0;
+	unsigned int i;
+
+	b.fd = c->fd;
+	b.n = 0;
+	b.failed = 0;
+	batch_add(&b, head, headlen);
+	for (i = 0; i < resp->nsegments; i++) {
+		seg = &resp->segments[i];
+		batch_add(&b, resp->body + off, seg->offset - off);
+		batch_add(&b, seg->data, seg->len);
+		off = seg->offset;
+	}
+	batch_add(&b, resp->body + off, resp->length - off);
+	batch_add(&b, tail, taillen);
+	batch_write(&b);
+	return b.failed ? -1 : 0;
+}
 
-	t = *(int *)arg;
-	free(arg);
+/*
+ * Sends what a response holds so far as a chunk, after the status line
+ * and headers if this is the first, and empties it. Once the client
+ * has gone, further output is thrown away.
+ */
+static void
+response_flush(resp)
+	struct response *resp;
+{
+	char head[512];
+	size_t len = 0;
 
-	tf = fdopen(t, "r+b");
-	if (!tf) {
-		warn("fdopen");
-		close(t);
-		return NULL;
+	if (!resp->chunked) {
+		len = snprintf(head, sizeof head,
+			"HTTP/1.1 %d %s\r\n"
+			"Content-Type: %s\r\n"
+			"Transfer-Encoding: chunked\r\n"
+			"Connection: %s\r\n"
+			"\r\n",
+			resp->code, reason(resp->code), resp->content_type,
+			resp->keepalive ? "keep-alive" : "close");
+		resp->chunked = 1;
 	}
+	len += snprintf(head + len, sizeof head - len, "%lx\r\n",
+		(unsigned long)(resp->length + resp->seglength));
+	if (!resp->failed &&
+	    write_response(resp->conn, resp, head, len, "\r\n", 2))
+		resp->failed = 1;
+	resp->length = 0;
+	resp->nsegments = 0;
+	resp->seglength = 0;
+}
 
-	if (getline(tf, line, sizeof line))
-		goto fail;
+/* Streams out the response so far if len more bytes would be too many */
+static void
+response_room(resp, len)
+	struct response *resp;
+	size_t len;
+{
+	size_t buffered = resp->length + resp->seglength;
+
+	if (resp->conn && buffered && buffered + len > FLUSH_SIZE)
+		response_flush(resp);
+}
 
+/*
+ * Returns space for len more bytes at the end of a response body.
+ * The caller adds the bytes it uses to resp->length.
+ */
+char *
+response_reserve(resp, len)
+	struct response *resp;
+	size_t len;
+{
+	size_t size;
+	char *body;
+
+	response_room(resp, len);
+	if (resp->length + len > resp->size) {
+		size = resp->size ? resp->size : 8192;
+		while (size < resp->length + len)
+			size *= 2;
+		body = (char *)realloc(resp->body, size);
+		if (!body)
+			err(1, "realloc");
+		resp->body = body;
+		resp->size = size;
+	}
+	return resp->body + resp->length;
+}
+
+/* Appends bytes to a response body */
+void
+response_append(resp, data, len)
+	struct response *resp;
+	const void *data;
+	size_t len;
+{
+	memcpy(response_reserve(resp, len), data, len);
+	resp->length += len;
+}
+
+/*
+ * Adds bytes that will not change to a response. Unless they are
+ * few, they are sent from where they are instead of being copied.
+ */
+void
+response_static(resp, data, len)
+	struct response *resp;
+	const void *data;
+	size_t len;
+{
+	struct segment *seg;
+	unsigned int n;
+
+	if (len < COPY_SIZE) {
+		response_append(resp, data, len);
+		return;
+	}
+	response_room(resp, len);
+	if (resp->nsegments == resp->asegments) {
+		n = resp->asegments ? resp->asegments * 2 : 16;
+		seg = (struct segment *)realloc(resp->segments,
+		    n * sizeof *seg);
+		if (!seg)
+			err(1, "realloc");
+		resp->segments = seg;
+		resp->asegments = n;
+	}
+	seg = &resp->segments[resp->nsegments++];
+	seg->offset = resp->length;
+	seg->data = (const char *)data;
+	seg->len = len;
+	resp->seglength += len;
+}
+
+/*
+ * Finishes sending a response: all of it with a Content-Length if
+ * none of it has been sent yet, otherwise the last chunk.
+ * Returns 0 on success.
+ */
+static int
+send_response(c, resp, keepalive)
+	struct conn *c;
+	struct response *resp;
+	int keepalive;
+{
+	char head[256];
+	size_t len = 0, total = resp->length + resp->seglength;
+
+	if (resp->failed)
+		return -1;
+	if (resp->chunked) {
+		/* An error found after the head was sent can't be reported */
+		if (resp->code != 200)
+			return -1;
+		if (total) {
+			len = snprintf(head, sizeof head, "%lx\r\n",
+				(unsigned long)total);
+			return write_response(c, resp, head, len,
+			    "\r\n0\r\n\r\n", 7);
+		}
+		return write_response(c, resp, NULL, 0, "0\r\n\r\n", 5);
+	}
+
+	len = snprintf(head, sizeof head,
+		"HTTP/1.1 %d %s\r\n"
+		"Content-Type: %s\r\n"
+		"Content-Length: %lu\r\n"
+		"Connection: %s\r\n"
+		"\r\n",
+		resp->code, reason(resp->code), resp->content_type,
+		(unsigned long)total,
+		keepalive ? "keep-alive" : "close");
+	return write_response(c, resp, head, len, NULL, 0);
+}
+
+/*
+ * Reads one request from a connection and sends the response.
+ * Returns 1 if the connection should be kept open, 0 if it should be
+ * closed, or -1 if the rest of the request has not arrived yet.
+ */
+static int
+serve_request(w, c)
+	struct worker *w;
+	struct conn *c;
+{
+	char *eoh, *p, *line, *headers;
+	const char *method, *uri, *version, *clen;
+	struct header *header = NULL;
+	struct response *resp = &w->response;
+	size_t n;
+	int keepalive, r;
+
+	/* Skip the body of the previous request */
+	while (c->skip > 0) {
+		if (c->start == c->end && (r = conn_fill(c)) <= 0)
+			return r;
+		n = c->end - c->start;
+		if (n > (size_t)c->skip)
+			n = c->skip;
+		c->start += n;
+		c->skip -= n;
+	}
+
+	while (!(eoh = conn_head(c)))
+		if ((r = conn_fill(c)) <= 0)
+			return r;
+
+	/* Parse the request line and headers in place */
+	headers = c->buf + c->start;
+	line = next_line(&headers);
 	method = line;
 	p = strchr(line, ' ');
+	resp->length = 0;
+	resp->nsegments = 0;
+	resp->seglength = 0;
+	resp->conn = NULL;
+	resp->chunked = 0;
+	resp->failed = 0;
+	resp->content_type = "text/plain";
 	if (!p || !*p) {
 		warnx("bad req: %s", line);
-		goto fail;
+		resp->code = 400;
+		send_response(c, resp, 0);
+		return 0;
 	}
 	*p++ = '\0';
 
 	uri = p;
-	p = strchr(uri, ' ');
+	p = strchr(p, ' ');
 	if (!p || !*p)
 		version = "";
 	else {
@@ -207,96 +660,278 @@ request_thread(arg)
 		version = p;
 	}
 
-	printf("method: '%s'\nuri   : '%s'\nversion: '%s'\n",
-		method, uri, version);
+	if (vflag)
+		printf("method: '%s'\nuri   : '%s'\nversion: '%s'\n",
+			method, uri, version);
 
-	header = NULL;
-	if (read_headers(tf, &header))
-		goto fail;
+	if (read_headers(&headers, &header)) {
+		resp->code = 400;
+		send_response(c, resp, 0);
+		return 0;
+	}
+	c->start = eoh + 4 - c->buf;
+	keepalive = want_keepalive(version, header);
 
-	process_request(tf, method, uri, header);
-	goto out;
+	/* Only HTTP/1.1 clients can take a response in chunks */
+	resp->code = 200;
+	resp->keepalive = keepalive;
+	if (strcmp(version, "HTTP/1.1") == 0)
+		resp->conn = c;
+	process_request(w->ssp, resp, method, uri, header);
 
-fail:
-	fprintf(tf, "HTTP/1.0 500 Internal error \r\n\r\n");
-out:
+	if (vflag) {
+		struct pool_stats stats;
+
+		ssp_worker_stats(w->ssp, &stats);
+		printf("pool: %lu bytes in %lu blocks, peak %lu, "
+		    "%lu spare, %lu mallocs\n",
+		    (unsigned long)stats.bytes, (unsigned long)stats.blocks,
+		    (unsigned long)stats.peak, (unsigned long)stats.spare,
+		    stats.mallocs);
+	}
+
+	/* The request body is skipped before the next request is read */
+	clen = header_value(header, "content-length");
+	c->skip = clen ? strtol(clen, NULL, 10) : 0;
 	free_headers(header);
-	fclose(tf);
-	return NULL;
+
+	if (send_response(c, resp, keepalive))
+		keepalive = 0;
+	ssp_worker_done(w->ssp);
+	return keepalive;
 }
 
 /*
- * Accepts connections on a socket and starts new threads to handle them
- * Argument is pointer to a file descriptor. Pointer will be freed.
+ * Serves the requests on a connection that are already in its buffer
+ * or that can be read now. Returns as serve_request() does for the
+ * last of them.
  */
-static void *
-server_thread(arg)
-	void *arg;
+static int
+serve(w, c)
+	struct worker *w;
+	struct conn *c;
 {
-	int s, t, *tp, error;
-	struct sockaddr addr;
-	socklen_t addrlen;
-	pthread_t thread;
-	pthread_attr_t attr;
+	int r;
 
-	s = *(int *)arg;
-	free(arg);
+	do
+		r = serve_request(w, c);
+	while (r > 0 && c->start < c->end);
+	return r;
+}
 
-	printf("server listening on fd %d\n", s);
+/* Wraps an accepted socket */
+static struct conn *
+conn_new(fd)
+	int fd;
+{
+	struct conn *c;
+#if !HAVE_SYS_EPOLL_H
+	struct timeval tv;
+#endif
+	int opt = 1;
 
-	error = pthread_attr_init(&attr);
-	if (error) {
-		warnx("pthread_attr_init: %s", strerror(error));
-		close(s);
+	c = (struct conn *)malloc(sizeof *c);
+	if (!c) {
+		warnx("malloc");
+		close(fd);
 		return NULL;
 	}
+	c->fd = fd;
+	c->listener = 0;
+	c->start = c->end = c->scan = 0;
+	c->skip = 0;
 
-	error = pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-	if (error) {
-		warnx("pthread_attr_setdetachstate: %s", strerror(error));
-		pthread_attr_destroy(&attr);
-		close(s);
-		return NULL;
+	/* Don't let a slow client hold on to a worker */
+#if HAVE_SYS_EPOLL_H
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+		warn("fcntl");
+#else
+	tv.tv_sec = TIMEOUT;
+	tv.tv_usec = 0;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) < 0)
+		warn("setsockopt SO_RCVTIMEO");
+#endif
+	/* Responses are written whole; don't hold back pipelined ones */
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof opt) < 0)
+		warn("setsockopt TCP_NODELAY");
+	return c;
+}
+
+static void
+conn_close(c)
+	struct conn *c;
+{
+	close(c->fd);
+	free(c);
+}
+
+#if HAVE_SYS_EPOLL_H
+/*
+ * Puts a connection (back) in the epoll set, op being EPOLL_CTL_ADD
+ * or EPOLL_CTL_MOD, and at the end of the idle list. It goes on the
+ * list first, since another worker may take it as soon as it is set.
+ */
+static void
+conn_wait(c, op)
+	struct conn *c;
+	int op;
+{
+	struct epoll_event ev;
+
+	pthread_mutex_lock(&idle_lock);
+	c->idle = time(NULL);
+	c->prev = idle_list.prev;
+	c->next = &idle_list;
+	c->prev->next = c;
+	idle_list.prev = c;
+	pthread_mutex_unlock(&idle_lock);
+
+	ev.events = EPOLLIN | EPOLLONESHOT;
+	ev.data.ptr = c;
+	if (epoll_ctl(epfd, op, c->fd, &ev) < 0) {
+		warn("epoll_ctl");
+		conn_unwait(c);
+		conn_close(c);
 	}
+}
 
-	for (;;) {
-		addrlen = sizeof addr;
-		t = accept(s, &addr, &addrlen);
-		if (t < 0) {
+/* Takes a connection that epoll has returned off the idle list */
+static void
+conn_unwait(c)
+	struct conn *c;
+{
+	pthread_mutex_lock(&idle_lock);
+	if (c->next) {
+		c->prev->next = c->next;
+		c->next->prev = c->prev;
+		c->prev = c->next = NULL;
+	}
+	pthread_mutex_unlock(&idle_lock);
+}
+
+/*
+ * Shuts down the connections that have waited in the epoll set for
+ * longer than TIMEOUT. They are not closed here: the shutdown makes
+ * them readable, and the worker that gets them sees the end of file
+ * and closes them.
+ */
+static void
+reap_idle()
+{
+	time_t now = time(NULL);
+	struct conn *c;
+
+	pthread_mutex_lock(&idle_lock);
+	if (now != reaped) {
+		reaped = now;
+		while ((c = idle_list.next) != &idle_list &&
+		    now - c->idle >= TIMEOUT)
+		{
+			shutdown(c->fd, SHUT_RDWR);
+			idle_list.next = c->next;
+			c->next->prev = &idle_list;
+			c->prev = c->next = NULL;
+		}
+	}
+	pthread_mutex_unlock(&idle_lock);
+}
+
+/* Accepts a connection and waits for its first request */
+static void
+accept_conn(s)
+	int s;
+{
+	struct conn *c;
+	int t;
+
+	t = accept(s, NULL, NULL);
+	if (t < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR
+		    && errno != ECONNABORTED)
 			warn("accept");
+		return;
+	}
+	if (!(c = conn_new(t)))
+		return;
+	conn_wait(c, EPOLL_CTL_ADD);
+}
+
+/*
+ * Takes ready sockets from the epoll set: accepts new connections,
+ * and serves the requests on connections with data, putting them
+ * back in the set afterwards. Every second or so, shuts down the
+ * connections that have waited too long.
+ */
+static void *
+worker_thread(arg)
+	void *arg;
+{
+	struct worker *w = (struct worker *)arg;
+	struct epoll_event ev;
+	struct conn *c;
+	int n;
+
+	for (;;) {
+		n = epoll_wait(epfd, &ev, 1, 1000);
+		reap_idle();
+		if (n < 0) {
+			if (errno != EINTR)
+				warn("epoll_wait");
 			continue;
 		}
-		tp = (int *)malloc(sizeof (int));
-		if (!tp) {
-			warnx("malloc");
-			close(t);
+		if (n == 0)
+			continue;
+		c = (struct conn *)ev.data.ptr;
+		if (c->listener) {
+			accept_conn(c->fd);
 			continue;
 		}
-		*tp = t;
-		if (sflag) { request_thread(tp); return NULL; }
-		error = pthread_create(&thread, &attr, request_thread, tp);
-		if (error) {
-			warnx("pthread_create: %s", strerror(error));
-			close(t);
-			free(tp);
-		}
+		conn_unwait(c);
+		if (serve(w, c))
+			conn_wait(c, EPOLL_CTL_MOD);
+		else
+			conn_close(c);
 	}
+	return NULL;
+}
 
+#else /* !HAVE_SYS_EPOLL_H */
+/* Accepts connections and serves each until it is closed */
+static void *
+worker_thread(arg)
+	void *arg;
+{
+	struct worker *w = (struct worker *)arg;
+	struct conn *c;
+	int t;
+
+	for (;;) {
+		t = accept(listeners[w->index % nlisteners], NULL, NULL);
+		if (t < 0) {
+			if (errno != EINTR && errno != ECONNABORTED)
+				warn("accept");
+			continue;
+		}
+		if (!(c = conn_new(t)))
+			continue;
+		while (serve(w, c) > 0)
+			;
+		conn_close(c);
+	}
 	return NULL;
 }
+#endif /* !HAVE_SYS_EPOLL_H */
 
 /*
- * Creates server sockets, and a server thread for each.
+ * Creates the listening sockets. Returns the number created.
  */
-static void
-create_server_threads(service)
+static int
+create_listeners(service)
 	const char *service;
 {
 	int s;
-	int *sp;
 	int error;
 	int opt;
-	pthread_t thread;
 	struct addrinfo hints, *res, *res0;
 
 	memset(&hints, 0, sizeof(hints));
@@ -308,50 +943,41 @@ create_server_threads(service)
 		errx(1, "%s", gai_strerror(error));
 		/*NOTREACHED*/
 	}
-	for (res = res0; res; res = res->ai_next) {
+	for (res = res0; res && nlisteners < MAXLISTEN; res = res->ai_next) {
 		s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
 		if (s < 0) {
 			warn("socket");
 			continue;
 		}
 
-		if (bind(s, res->ai_addr, res->ai_addrlen) < 0) {
-			warn("bind");
-			close(s);
-			continue;
-		}
-
-		(void) listen(s, 5);
-
-		printf("listening on port %s\n", service);
-
 #ifdef SO_REUSEADDR
 		opt = 1;
-		if (setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &opt, 
+		if (setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &opt,
 		    sizeof opt) < 0)
 			warn("setsockopt SO_REUSEADDR");
 #endif
 
-#ifdef SO_REUSEPORT
+#ifdef IPV6_V6ONLY
+		/* Let the IPv4 socket have the IPv4 connections */
 		opt = 1;
-		if (setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &opt,
-		    sizeof opt) < 0)
-			warn("setsockopt SO_REUSEPORT");
+		if (res->ai_family == PF_INET6 && setsockopt(s, IPPROTO_IPV6,
+		    IPV6_V6ONLY, &opt, sizeof opt) < 0)
+			warn("setsockopt IPV6_V6ONLY");
 #endif
 
-		sp = (int *)malloc(sizeof (int));
-		if (!sp)
-			errx(1, "malloc");
-		*sp = s;
-		if (sflag) { server_thread(sp); return; }
-		error = pthread_create(&thread, NULL, server_thread, sp);
-		if (error) {
-			warnx("pthread_create: %s", strerror(error));
+		if (bind(s, res->ai_addr, res->ai_addrlen) < 0) {
+			warn("bind");
 			close(s);
-			free(sp);
+			continue;
 		}
+
+		(void) listen(s, 128);
+
+		printf("listening on port %s\n", service);
+		listeners[nlisteners++] = s;
 	}
 	freeaddrinfo(res0);
+	return nlisteners;
 }
 
 int
@@ -359,7 +985,69 @@ main(argc, argv)
 	int argc;
 	char *argv[];
 {
+	const char *port = PORT;
+	int nworkers = NWORKERS;
+	struct worker *workers;
+	int ch, i, error;
+#if HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+	struct conn *l;
+#endif
+
+	while ((ch = getopt(argc, argv, "p:svw:")) != -1)
+		switch (ch) {
+		case 'p': port = optarg; break;
+		case 's': sflag = 1; break;
+		case 'v': vflag = 1; break;
+		case 'w': nworkers = atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-sv] [-p port] "
+			    "[-w workers]\n", argv[0]);
+			exit(2);
+		}
+	if (sflag || nworkers < 1)
+		nworkers = 1;
+
 	ssp_init();
-	create_server_threads(PORT);
+	if (!create_listeners(port))
+		errx(1, "no listening sockets");
+
+#if HAVE_SYS_EPOLL_H
+	epfd = epoll_create(MAXLISTEN + 1);
+	if (epfd < 0)
+		err(1, "epoll_create");
+	idle_list.prev = idle_list.next = &idle_list;
+	for (i = 0; i < nlisteners; i++) {
+		if (fcntl(listeners[i], F_SETFL, O_NONBLOCK) < 0)
+			err(1, "fcntl");
+		l = (struct conn *)malloc(sizeof *l);
+		if (!l)
+			errx(1, "malloc");
+		l->fd = listeners[i];
+		l->listener = 1;
+		ev.events = EPOLLIN;
+		ev.data.ptr = l;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, listeners[i], &ev) < 0)
+			err(1, "epoll_ctl");
+	}
+#endif
+
+	workers = (struct worker *)calloc(nworkers, sizeof *workers);
+	if (!workers)
+		errx(1, "malloc");
+	for (i = 0; i < nworkers; i++) {
+		workers[i].index = i;
+		workers[i].ssp = ssp_worker_new();
+	}
+	if (sflag) {
+		worker_thread(&workers[0]);
+		return 0;
+	}
+	for (i = 0; i < nworkers; i++) {
+		error = pthread_create(&workers[i].thread, NULL,
+		    worker_thread, &workers[i]);
+		if (error)
+			errx(1, "pthread_create: %s", strerror(error));
+	}
 	pthread_exit(NULL);
 }
@@ -5,4 +5,40 @@ struct header {
 	struct header *next;
 };
 
+/* Bytes that are sent from where they are, between body bytes */
+struct segment {
+	size_t offset;			/* body length when it was added */
+	const char *data;
+	size_t len;
+};
+
+/*
+ * A response, built up while the request is processed. Small
+ * responses are sent with a Content-Length when they are complete;
+ * when an HTTP/1.1 response grows large, what there is so far is sent
+ * as a chunk and the rest follows in further chunks. The body buffer
+ * belongs to the worker thread and is reused for each request.
+ * Static segments are not copied, so their data must stay unchanged
+ * until the response is sent.
+ */
+struct response {
+	int code;			/* status code, usually 200 */
+	const char *content_type;
+	char *body;
+	size_t length;			/* bytes used in body */
+	size_t size;			/* bytes allocated for body */
+	struct segment *segments;
+	unsigned int nsegments;
+	unsigned int asegments;		/* segments allocated */
+	size_t seglength;		/* bytes in segments */
+
+	/* Private to httpd */
+	struct conn *conn;		/* where to stream, or NULL */
+	int keepalive;
+	int chunked;			/* true once the head is sent */
+	int failed;			/* true if the client has gone */
+};
 
+char *response_reserve(struct response *resp, size_t len);
+void response_append(struct response *resp, const void *data, size_t len);
+void response_static(struct response *resp, const void *data, size_t len);
@@ -0,0 +1,324 @@
+/* Public domain. */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <err.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * A load generator for the ssp httpd.
+ *
+ *	loadgen [-c connections] [-d depth] [-n requests] [-p port] [path]
+ *
+ * Each connection is a thread with its own HTTP/1.1 keep-alive
+ * connection to the server on the loopback interface. It sends
+ * requests for the path as fast as the responses come back, depth
+ * requests at a time (pipelined), and notes how long each response
+ * took. At the end, the throughput and latency percentiles are
+ * printed. The exit status is non-zero if any response was not
+ * 200 OK.
+ */
+
+#define BUFSZ	65536
+
+struct client {
+	pthread_t thread;
+	int fd;
+	unsigned long nreq;		/* requests to send */
+	double *latency;		/* seconds, for each request */
+	unsigned long errors;		/* responses other than 200 */
+	size_t start, end;		/* unread data in buf[] */
+	char buf[BUFSZ];
+};
+
+static const char *host = "127.0.0.1";
+static const char *port = "8000";
+static const char *path = "/test.ssp";
+static int depth = 1;
+static char request[1024];
+static size_t request_len;
+
+static double
+now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Opens a connection to the server */
+static int
+connect_server()
+{
+	struct addrinfo hints, *res, *res0;
+	int s = -1, error, opt = 1;
+
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = PF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	error = getaddrinfo(host, port, &hints, &res0);
+	if (error)
+		errx(1, "%s", gai_strerror(error));
+	for (res = res0; res; res = res->ai_next) {
+		s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+		if (s < 0)
+			continue;
+		if (connect(s, res->ai_addr, res->ai_addrlen) == 0)
+			break;
+		close(s);
+		s = -1;
+	}
+	freeaddrinfo(res0);
+	if (s < 0)
+		err(1, "connect %s:%s", host, port);
+	if (setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof opt) < 0)
+		warn("setsockopt TCP_NODELAY");
+	return s;
+}
+
+/* Reads more response data; exits if the server closes early */
+static void
+fill(cl)
+	struct client *cl;
+{
+	ssize_t n;
+
+	if (cl->start == cl->end)
+		cl->start = cl->end = 0;
+	if (cl->end == sizeof cl->buf) {
+		memmove(cl->buf, cl->buf + cl->start, cl->end - cl->start);
+		cl->end -= cl->start;
+		cl->start = 0;
+	}
+	do
+		n = read(cl->fd, cl->buf + cl->end, sizeof cl->buf - cl->end);
+	while (n < 0 && errno == EINTR);
+	if (n < 0)
+		err(1, "read");
+	if (n == 0)
+		errx(1, "server closed the connection");
+	cl->end += n;
+}
+
+/* Reads up to and including a delimiter, returning where it starts */
+static char *
+read_until(cl, delim)
+	struct client *cl;
+	const char *delim;
+{
+	char *p;
+	size_t scan = 0, len = strlen(delim);
+
+	for (;;) {
+		for (p = cl->buf + cl->start + scan;
+		     p + len <= cl->buf + cl->end; p++)
+			if (memcmp(p, delim, len) == 0)
+				return p;
+		if (cl->end - cl->start == sizeof cl->buf)
+			errx(1, "response head too long");
+		scan = cl->end - cl->start >= len - 1 ?
+		    cl->end - cl->start - (len - 1) : 0;
+		fill(cl);
+	}
+}
+
+/* Skips response body bytes */
+static void
+skip(cl, remain)
+	struct client *cl;
+	unsigned long remain;
+{
+	size_t n;
+
+	while (remain > 0) {
+		if (cl->start == cl->end)
+			fill(cl);
+		n = cl->end - cl->start;
+		if (n > remain)
+			n = remain;
+		cl->start += n;
+		remain -= n;
+	}
+}
+
+/* Reads one response, returning its status code */
+static int
+read_response(cl)
+	struct client *cl;
+{
+	char *p, *eoh, *line;
+	unsigned long remain = 0, len;
+	int code, chunked = 0;
+
+	eoh = read_until(cl, "\r\n\r\n");
+
+	*eoh = 0;
+	line = cl->buf + cl->start;
+	if (strncmp(line, "HTTP/1.", 7) != 0)
+		errx(1, "bad response");
+	code = atoi(line + 9);
+	for (p = strstr(line, "\r\n"); p; p = strstr(p + 2, "\r\n"))
+		if (strncasecmp(p + 2, "content-length:", 15) == 0)
+			remain = strtoul(p + 17, NULL, 10);
+		else if (strncasecmp(p + 2, "transfer-encoding:", 18) == 0)
+			chunked = strstr(p + 20, "chunked") != NULL;
+	cl->start = eoh + 4 - cl->buf;
+
+	/* Skip the body */
+	if (!chunked)
+		skip(cl, remain);
+	else
+		do {
+			p = read_until(cl, "\r\n");
+			len = strtoul(cl->buf + cl->start, NULL, 16);
+			cl->start = p + 2 - cl->buf;
+			skip(cl, len + 2);
+		} while (len);
+	return code;
+}
+
+/* Sends all of a buffer */
+static void
+send_all(fd, data, len)
+	int fd;
+	const char *data;
+	size_t len;
+{
+	ssize_t n;
+
+	while (len) {
+		n = write(fd, data, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			err(1, "write");
+		data += n;
+		len -= n;
+	}
+}
+
+static void *
+client_thread(arg)
+	void *arg;
+{
+	struct client *cl = (struct client *)arg;
+	char *batch;
+	unsigned long i, j, n;
+	double start;
+
+	batch = (char *)malloc(request_len * depth);
+	if (!batch)
+		errx(1, "malloc");
+	for (j = 0; j < (unsigned long)depth; j++)
+		memcpy(batch + j * request_len, request, request_len);
+
+	cl->fd = connect_server();
+	for (i = 0; i < cl->nreq; i += n) {
+		n = cl->nreq - i;
+		if (n > (unsigned long)depth)
+			n = depth;
+		start = now();
+		send_all(cl->fd, batch, n * request_len);
+		for (j = 0; j < n; j++) {
+			if (read_response(cl) != 200)
+				cl->errors++;
+			cl->latency[i + j] = now() - start;
+		}
+	}
+	close(cl->fd);
+	free(batch);
+	return NULL;
+}
+
+static int
+double_cmp(a, b)
+	const void *a, *b;
+{
+	double da = *(const double *)a, db = *(const double *)b;
+
+	return da < db ? -1 : da > db;
+}
+
+int
+main(argc, argv)
+	int argc;
+	char *argv[];
+{
+	int nclients = 8, ch, i, error;
+	unsigned long nreq = 20000, total, k, errors = 0;
+	struct client *clients;
+	double *latency, start, elapsed;
+
+	while ((ch = getopt(argc, argv, "c:d:n:p:")) != -1)
+		switch (ch) {
+		case 'c': nclients = atoi(optarg); break;
+		case 'd': depth = atoi(optarg); break;
+		case 'n': nreq = strtoul(optarg, NULL, 10); break;
+		case 'p': port = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-c connections] "
+			    "[-d depth] [-n requests] [-p port] [path]\n",
+			    argv[0]);
+			exit(2);
+		}
+	if (optind < argc)
+		path = argv[optind];
+	if (nclients < 1 || depth < 1 || nreq < (unsigned long)nclients)
+		errx(2, "bad arguments");
+
+	request_len = snprintf(request, sizeof request,
+		"GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", path, host);
+
+	clients = (struct client *)calloc(nclients, sizeof *clients);
+	latency = (double *)calloc(nreq, sizeof *latency);
+	if (!clients || !latency)
+		errx(1, "malloc");
+	for (i = 0, k = 0; i < nclients; i++) {
+		clients[i].nreq = nreq / nclients +
+		    ((unsigned long)i < nreq % nclients);
+		clients[i].latency = latency + k;
+		k += clients[i].nreq;
+	}
+
+	start = now();
+	for (i = 0; i < nclients; i++) {
+		error = pthread_create(&clients[i].thread, NULL,
+		    client_thread, &clients[i]);
+		if (error)
+			errx(1, "pthread_create: %s", strerror(error));
+	}
+	for (i = 0; i < nclients; i++) {
+		pthread_join(clients[i].thread, NULL);
+		errors += clients[i].errors;
+	}
+	elapsed = now() - start;
+
+	total = nreq;
+	qsort(latency, total, sizeof *latency, double_cmp);
+	printf("loadgen: %s: %lu requests, %d connections, depth %d: "
+	    "%.3fs, %.0f requests/sec\n", path, total, nclients, depth,
+	    elapsed, total / elapsed);
+	printf("loadgen: latency (ms): p50 %.3f  p90 %.3f  p99 %.3f  "
+	    "max %.3f\n",
+	    latency[total * 50 / 100] * 1e3, latency[total * 90 / 100] * 1e3,
+	    latency[total * 99 / 100] * 1e3, latency[total - 1] * 1e3);
+	if (errors)
+		printf("loadgen: %lu responses were not 200 OK\n", errors);
+	return errors ? 1 : 0;
+}
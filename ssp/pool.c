@@ -1,24 +1,42 @@
+
 #include <stdlib.h>
 #include "pool.h"
 
 /*
  * Simple pool memory allocator.
  * Memory is allocated from large blocks of store
- * and released in one hit, at the very end.
- * Allocations grow exponentially.
+ * and released in one hit, at the end of each request.
+ *
+ * Allocation bumps a pointer through the current block; only when
+ * that block is full is another one started. Blocks all have the
+ * same size, so that the blocks released by pool_reset() can be kept
+ * on a spare list and used again by the next request without calling
+ * malloc(). Each worker thread has its own pool, so no locking is
+ * needed. Requests larger than a quarter of a block get a block of
+ * their own, which is freed on reset instead of being kept.
+ *
+ * So that one unusually large request does not pin its memory for
+ * ever, reset keeps only as many spare blocks as a decaying high-water
+ * mark of recent requests has needed.
  */
 
-#define INITIAL_BLOCK_SIZE	8192
+#define BLOCK_SIZE	(64 * 1024)
+#define LARGE_SIZE	(BLOCK_SIZE / 4)
+#define DECAY		8	/* high-water mark loses 1/DECAY per reset */
 
 struct block {
 	struct block *next;
-	char *p;	/* Pointer into block storage */
-	int avail;	/* bytes available after p */
+	size_t size;		/* bytes of storage after the header */
 };
 
 struct pool {
-	struct block *blocks;
-	int next_alloc;	/* size of next block */
+	struct block *blocks;	/* blocks in use; the first is current */
+	char *p;		/* free space in the current block */
+	char *end;
+	struct block *spare;	/* released blocks, all BLOCK_SIZE */
+	size_t nspare;
+	size_t hiwat;		/* decaying peak of blocks used */
+	struct pool_stats stats;
 };
 
 /* Creates a new memory pool */
@@ -30,60 +48,146 @@ pool_new()
 	pool = (struct pool *)malloc(sizeof (struct pool));
 	if (pool) {
 		pool->blocks = NULL;
-		pool->next_alloc = INITIAL_BLOCK_SIZE;
+		pool->p = pool->end = NULL;
+		pool->spare = NULL;
+		pool->nspare = 0;
+		pool->hiwat = 0;
+		pool->stats.bytes = 0;
+		pool->stats.blocks = 0;
+		pool->stats.peak = 0;
+		pool->stats.spare = 0;
+		pool->stats.mallocs = 0;
 	}
 	return pool;
 }
 
-/* Destroys a memory pool */
+/*
+ * Releases everything allocated from a memory pool, keeping the pool.
+ * Standard blocks go on the spare list, up to the high-water mark.
+ */
 void
-pool_destroy(pool)
+pool_reset(pool)
 	struct pool *pool;
 {
 	struct block *block;
+	size_t used = pool->stats.blocks;
+
+	if (used > pool->hiwat)
+		pool->hiwat = used;
+	else
+		pool->hiwat -= (pool->hiwat - used + DECAY - 1) / DECAY;
 
 	while (pool->blocks) {
 		block = pool->blocks;
 		pool->blocks = block->next;
+		if (block->size == BLOCK_SIZE && pool->nspare < pool->hiwat) {
+			block->next = pool->spare;
+			pool->spare = block;
+			pool->nspare++;
+		} else
+			free(block);
+	}
+	while (pool->nspare > pool->hiwat) {
+		block = pool->spare;
+		pool->spare = block->next;
+		pool->nspare--;
+		free(block);
+	}
+	pool->p = pool->end = NULL;
+	pool->stats.bytes = 0;
+	pool->stats.blocks = 0;
+	pool->stats.spare = pool->nspare;
+}
+
+/* Destroys a memory pool */
+void
+pool_destroy(pool)
+	struct pool *pool;
+{
+	struct block *block;
+
+	pool_reset(pool);
+	while (pool->spare) {
+		block = pool->spare;
+		pool->spare = block->next;
 		free(block);
 	}
 	free(pool);
 }
 
+/* Returns a block with at least size bytes, from the spare list if it can */
+static struct block *
+get_block(pool, size)
+	struct pool *pool;
+	size_t size;
+{
+	struct block *block;
+
+	if (size == BLOCK_SIZE && pool->spare) {
+		block = pool->spare;
+		pool->spare = block->next;
+		pool->nspare--;
+	} else {
+		block = (struct block *)malloc(sizeof (struct block) + size);
+		if (!block)
+			return NULL;
+		block->size = size;
+		pool->stats.mallocs++;
+	}
+	pool->stats.blocks++;
+	return block;
+}
+
 /* Allocates from a memory pool */
 void *
 pool_malloc(pool, size)
 	struct pool *pool;
 	size_t size;
 {
-	int spc;
+	size_t spc;
 	struct block *block;
 	char *ptr;
 
 	/* Round size up to align to nearest ptr */
 	spc = (size - 1 + sizeof (void *)) & ~(sizeof (void *) - 1);
 
-  	for (;;) {
-		/* Search blocks for enough space */
-		for (block = pool->blocks; block; block = block->next)
-		    if (block->avail >= spc) {
-			ptr = block->p;
-			block->p += spc;
-			block->avail -= spc;
-			return ptr;
-		    }
-
-		/* No block had enough space. Make more blocks! */
-		while (pool->next_alloc < spc + sizeof (struct block))
-			pool->next_alloc *= 2;
-
-		block = (struct block *)malloc(pool->next_alloc);
-		if (!block)
+	if (spc <= (size_t)(pool->end - pool->p)) {
+		ptr = pool->p;
+		pool->p += spc;
+	} else if (spc > LARGE_SIZE) {
+		/* Give it a block of its own, behind the current one */
+		if (!(block = get_block(pool, spc)))
+			return NULL;
+		if (pool->blocks) {
+			block->next = pool->blocks->next;
+			pool->blocks->next = block;
+		} else {
+			block->next = NULL;
+			pool->blocks = block;
+		}
+		ptr = (char *)(block + 1);
+	} else {
+		if (!(block = get_block(pool, BLOCK_SIZE)))
 			return NULL;
-		block->p = (char *)(block + 1);
-		block->avail = pool->next_alloc - sizeof (struct block);
 		block->next = pool->blocks;
 		pool->blocks = block;
-		pool->next_alloc *= 2;
+		ptr = (char *)(block + 1);
+		pool->p = ptr + spc;
+		pool->end = ptr + BLOCK_SIZE;
 	}
+
+	pool->stats.bytes += spc;
+	if (pool->stats.bytes > pool->stats.peak)
+		pool->stats.peak = pool->stats.bytes;
+	return ptr;
+}
+
+/* Returns the pool's statistics */
+void
+pool_stats(pool, stats)
+	struct pool *pool;
+	struct pool_stats *stats;
+{
+	*stats = pool->stats;
+	stats->spare = pool->nspare;
 }
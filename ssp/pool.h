@@ -1,7 +1,15 @@
-
 struct pool;
 
+struct pool_stats {
+	size_t bytes;		/* allocated since the last reset */
+	size_t blocks;		/* blocks holding those bytes */
+	size_t peak;		/* most bytes allocated between resets */
+	size_t spare;		/* blocks kept for reuse */
+	unsigned long mallocs;	/* blocks ever obtained from malloc() */
+};
+
 struct pool *pool_new(void);
+void pool_reset(struct pool *);
 void pool_destroy(struct pool *);
 void *pool_malloc(struct pool *, size_t);
-
+void pool_stats(struct pool *, struct pool_stats *);
@@ -2,6 +2,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <err.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <see/see.h>
 #include "httpd.h"
 #include "ssp.h"
@@ -9,25 +12,31 @@
 
 /*
  * An input stream around a SSP file.
- * This does two things. First it saves segments of text from the file into 
- * global strings named __inputN, where N is an increasing number.
- * Secondly it replaces the segments with javascript statements of the
- * form 'print(__inputN);'. The idea is that executing the script
- * will print the unescaped text.
+ * This replaces segments of text from the file with javascript
+ * statements that print the text. When compiling a page, each
+ * segment's bytes are kept, already in UTF-8, in the page's texts[]
+ * and the statement is '__text(n);', which sends the nth text without
+ * converting or copying it. Otherwise (for the raw listing) the
+ * statement is 'print("...");', with the text quoted as a string
+ * literal. Either way the script can be compiled once and run for
+ * many requests.
  *
- * While processing, the input stream is in one of two states:
+ * While processing, the input stream is in one of these states:
  *	COPY	- copying through javascript code without change
  *                until a '%>' is encountered 
  *	TEXT	- emitting the content of the text[] field
+ *	LITERAL	- emitting the print statement in the literal field
  *	NLS	- emitting newlines after the text[] field
  */
 struct ssp_input {
 	struct SEE_input input;
 	FILE *f;
-	enum { SSP_COPY, SSP_TEXT, SSP_NL } state;
-	int counter;			/* text segment id genertator */
+	struct page *page;		/* page being compiled, or NULL */
+	enum { SSP_COPY, SSP_TEXT, SSP_LITERAL, SSP_NL } state;
 	char text[256];			/* inserted js code */
 	int textpos;			/* read position in text[] */
+	struct SEE_string *literal;	/* statement printing the text */
+	unsigned int literalpos;	/* read position in literal */
 	int nlcount;			/* newlines to insert after text[] */
 	int first;			/* set only when "<%" is seen */
 	int trail_needed;		/* indicates trailing ');' is needed*/
@@ -37,24 +46,87 @@ struct ssp_input {
  * A structure attached to each SEE interpreter's host_data field
  */
 struct ssp_state {
-	FILE *fp;
+	struct response *response;
 	struct pool *pool;
-	int headers_sent;		/* true if HTTP header sent */
 	int raw;			/* true if raw JS to be sent */
-	int response_code;		/* usually 200 */
+	struct page *page;		/* page running, for __text() */
+	struct page **held;		/* pages run for the response */
+	unsigned int nheld;
+	unsigned int aheld;		/* held allocated */
 };
 #define SSP_STATE(interp)  ((struct ssp_state *)(interp)->host_data)
 
+/*
+ * What a worker thread keeps from one request to the next: the
+ * interpreter structure and the pool it allocates from.
+ */
+struct ssp_worker {
+	struct SEE_interpreter interp;
+	struct ssp_state state;
+	struct pool_stats stats;	/* of the last request */
+};
+
+/*
+ * A compiled SSP file: the program and the text segments it sends.
+ * Pages are shared by all requests. Because responses may refer to
+ * their texts until they are sent, a page is counted as used by its
+ * cache entry and by each request that has run it, and is freed when
+ * the last of those lets it go. The count is kept under cache_lock.
+ */
+struct page {
+	unsigned int refs;
+	struct SEE_program *program;
+	unsigned int ntexts;
+	unsigned int atexts;		/* texts allocated */
+	struct text {
+		char *data;
+		size_t len;
+	} *texts;
+};
+
+/*
+ * Compiled SSP files. An entry is used while the file's modification
+ * time and size are unchanged; when they change, the entry is
+ * compiled again.
+ */
+struct cached_program {
+	char *path;
+	time_t mtime;
+	off_t size;
+	struct page *page;
+	struct cached_program *next;
+};
+#define CACHE_SIZE	64
+static struct cached_program *cache[CACHE_SIZE];
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * The interpreter that request interpreters are cloned from. It is
+ * set up by ssp_init() before any threads start, and its allocations
+ * come from a pool that is never released.
+ */
+static struct SEE_interpreter template;
+static struct ssp_state template_state;
+
 /* prototypes */
 static int read_text(struct ssp_input *inp);
 static struct SEE_input *ssp_input_new(struct SEE_interpreter *interp, 
-	const char *filename);
+	const char *filename, struct page *page);
 static SEE_unicode_t ssp_next(struct SEE_input *input);
 static void ssp_close(struct SEE_input *input);
 static void *ssp_malloc(struct SEE_interpreter *, SEE_size_t);
 static void  ssp_free(struct SEE_interpreter *, void *);
 static struct SEE_object *make_headers_object(struct SEE_interpreter *,
 	struct header *);
+static struct page *page_new(void);
+static unsigned int page_add(struct page *, char *, size_t);
+static void page_free(struct page *);
+static void page_release(struct page *);
+static void page_hold(struct ssp_state *, struct page *);
+static struct cached_program **cache_find(const char *);
+static struct page *cache_get(const char *, struct stat *);
+static void cache_put(const char *, struct stat *, struct page *);
+static void template_init(void);
 
 static struct SEE_inputclass ssp_inputclass = { ssp_next, ssp_close };
 
@@ -64,7 +136,8 @@ static struct SEE_inputclass ssp_inputclass = { ssp_next, ssp_close };
  * when a request is complete, we can simply dump all memory
  * associated with that interpreter. This is not a good approach
  * for long-running scripts, but for web-based applications it
- * is probably sufficient.
+ * is probably sufficient. The template interpreter is also made
+ * here, so this must be called before any threads are started.
  */
 void
 ssp_init()
@@ -74,6 +147,7 @@ ssp_init()
 	SEE_system.malloc_string   = ssp_malloc;
 	SEE_system.free            = ssp_free;
 	SEE_system.gcollect        = NULL;
+	template_init();
 }
 
 /*
@@ -102,8 +176,41 @@ ssp_free(interp, ptr)
 		free(ptr);
 }
 
+/* Appends a character to a string literal, escaping it if needed */
+static void
+add_quoted(str, ch)
+	struct SEE_string *str;
+	int ch;
+{
+	static const char hex[] = "0123456789abcdef";
+
+	if (ch == '"' || ch == '\\' || ch < ' ' || ch >= 0x7f) {
+		SEE_string_addch(str, '\\');
+		SEE_string_addch(str, 'x');
+		SEE_string_addch(str, hex[(ch >> 4) & 0xf]);
+		SEE_string_addch(str, hex[ch & 0xf]);
+	} else
+		SEE_string_addch(str, ch);
+}
+
+/* Appends a byte to a buffer allocated with malloc() */
+static void
+add_byte(bufp, lenp, sizep, ch)
+	char **bufp;
+	size_t *lenp, *sizep;
+	int ch;
+{
+	if (*lenp == *sizep) {
+		*sizep = *sizep ? *sizep * 2 : 256;
+		*bufp = (char *)realloc(*bufp, *sizep);
+		if (!*bufp)
+			err(1, "realloc");
+	}
+	(*bufp)[(*lenp)++] = ch;
+}
+
 /* Reads text up until EOF or "<%". Returns -1 if EOF was immediately 
- * read. Sets the text[] array to the JS code that will print the read
+ * read. Sets the literal field to the JS code that will print the read
  * text. Also increments nlcount by the number of newlines in the
  * text segment */
 static int
@@ -112,45 +219,48 @@ read_text(inp)
 {
 	int ch, ch2;
 	struct SEE_interpreter *interp = inp->input.interpreter;
-	struct SEE_string *str;
-	char label[32];
-	struct SEE_value v;
-	int textlen;
+	struct SEE_string *literal;
+	char *text = NULL;
+	size_t len = 0, size = 0, i;
 	
 	inp->nlcount = 0;
 	inp->first = 0;
+	inp->literal = NULL;
 	ch = getc(inp->f);
 	if (ch == EOF)
 		return -1;
-	str = SEE_string_new(interp, 0);
 	do {
 		if (ch == '<') {
 		    if ((ch2 = getc(inp->f)) == '%') {
 		    	inp->first = 1;
 		        break;
 		    }
-		    SEE_string_addch(str, '<');
+		    add_byte(&text, &len, &size, '<');
 		    ch = ch2;
 		    if (ch == EOF)
 		    	break;
 		}
-	        SEE_string_addch(str, ch);
+		add_byte(&text, &len, &size, ch);
 		if (ch == '\n')
 			inp->nlcount++;
 	} while ((ch = getc(inp->f)) != EOF);
 
-	if (str->length) {
-		inp->counter++;
-		snprintf(label, sizeof label, "__input%u", inp->counter);
-		SEE_SET_STRING(&v, str);
-		SEE_OBJECT_PUTA(interp, interp->Global, label, &v, 
-			SEE_ATTR_DONTENUM | SEE_ATTR_READONLY | 
-			SEE_ATTR_DONTDELETE);
-		textlen = strlen(inp->text);
-		snprintf(inp->text + textlen, sizeof inp->text - textlen, 
-			";print(%s);", label);
-	} else
-		inp->text[0] = 0;
+	if (len && inp->page) {
+		inp->literal = SEE_string_sprintf(interp, ";__text(%d);",
+		    (int)page_add(inp->page, text, len));
+		inp->literalpos = 0;
+	} else {
+		if (len) {
+			literal = SEE_string_new(interp, len + 16);
+			SEE_string_append_ascii(literal, ";print(\"");
+			for (i = 0; i < len; i++)
+				add_quoted(literal, (unsigned char)text[i]);
+			SEE_string_append_ascii(literal, "\");");
+			inp->literal = literal;
+			inp->literalpos = 0;
+		}
+		free(text);
+	}
 
 	inp->textpos = 0;
 	return 0;
@@ -158,9 +268,10 @@ read_text(inp)
 
 /* Creates an input object that generates JS program text from an SSP file */
 static struct SEE_input *
-ssp_input_new(interp, filename)
+ssp_input_new(interp, filename, page)
 	struct SEE_interpreter *interp;
 	const char *filename;
+	struct page *page;
 {
 	struct ssp_input *inp = SEE_NEW(interp, struct ssp_input);
 
@@ -175,7 +286,7 @@ ssp_input_new(interp, filename)
 		warn("%s", filename);
 		return NULL;
 	}
-	inp->counter = 0;
+	inp->page = page;
 	inp->trail_needed = 0;
 	inp->text[0] = 0;
 
@@ -204,7 +315,7 @@ ssp_next(input)
 	if (inp->state == SSP_TEXT) {
 		if (inp->text[inp->textpos] == 0) {
 			inp->text[0] = 0;
-			inp->state = SSP_NL;
+			inp->state = SSP_LITERAL;
 		} else {
 			inp->input.lookahead = inp->text[inp->textpos];
 			inp->textpos++;
@@ -212,6 +323,17 @@ ssp_next(input)
 		}
 	}
 
+	if (inp->state == SSP_LITERAL) {
+		if (!inp->literal || inp->literalpos == inp->literal->length) {
+			inp->literal = NULL;
+			inp->state = SSP_NL;
+		} else {
+			inp->input.lookahead = 
+			    inp->literal->data[inp->literalpos++];
+			return ret;
+		}
+	}
+
 	if (inp->state == SSP_NL) {
 		if (inp->nlcount == 0)
 			inp->state = SSP_COPY;
@@ -291,41 +413,52 @@ ssp_close(input)
 }
 
 /*
- * Writes the HTTP header if not already sent.
+ * print() function provided to the interpreter environment.
+ * Appends the string, in UTF-8, to the body of the response.
  */
 static void
-ssp_flush_header(interp)
+print_fn(interp, self, thisobj, argc, argv, res)
 	struct SEE_interpreter *interp;
+	struct SEE_object *self, *thisobj;
+	int argc;
+	struct SEE_value **argv, *res;
 {
-	if (!SSP_STATE(interp)->headers_sent) {
-		FILE *fp = SSP_STATE(interp)->fp;
-
-		fprintf(fp, "HTTP/1.0 %u\r\n", 
-			SSP_STATE(interp)->response_code);
-		fprintf(fp, "Content-Type: text/plain\r\n");
-		fprintf(fp, "\r\n");
-		SSP_STATE(interp)->headers_sent = 1;
+	struct SEE_string *s;
+	struct response *resp = SSP_STATE(interp)->response;
+	SEE_size_t len;
+
+	SEE_parse_args(interp, argc, argv, "s", &s);
+	if (s) {
+		len = SEE_string_utf8_size(interp, s);
+		SEE_string_toutf8(interp, response_reserve(resp, len + 1),
+		    len + 1, s);
+		resp->length += len;
 	}
+	SEE_SET_UNDEFINED(res);
 }
 
 /*
- * print() function provided to the interpreter environment.
- * Simply writes to the stdio file pointer given to this request.
+ * __text() function, called by compiled pages.
+ * Adds the page's nth text to the response, where it is sent from
+ * without being copied.
  */
 static void
-print_fn(interp, self, thisobj, argc, argv, res)
+text_fn(interp, self, thisobj, argc, argv, res)
 	struct SEE_interpreter *interp;
 	struct SEE_object *self, *thisobj;
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct SEE_string *s;
-
-	SEE_parse_args(interp, argc, argv, "s", &s);
-	if (s) {
-		ssp_flush_header(interp);
-		SEE_string_fputs(s, SSP_STATE(interp)->fp);
-	}
+	struct ssp_state *ssp_state = SSP_STATE(interp);
+	struct page *page = ssp_state->page;
+	SEE_uint32_t n;
+
+	SEE_parse_args(interp, argc, argv, "u", &n);
+	if (!page || n >= page->ntexts)
+		SEE_error_throw(interp, interp->RangeError, "no text %d",
+		    (int)n);
+	response_static(ssp_state->response, page->texts[n].data,
+	    page->texts[n].len);
 	SEE_SET_UNDEFINED(res);
 }
 
@@ -347,6 +480,183 @@ make_headers_object(interp, headers)
 	return obj;
 }
 
+/* Creates an empty page */
+static struct page *
+page_new()
+{
+	struct page *page;
+
+	page = (struct page *)malloc(sizeof *page);
+	if (!page)
+		err(1, "malloc");
+	page->refs = 1;
+	page->program = NULL;
+	page->ntexts = 0;
+	page->atexts = 0;
+	page->texts = NULL;
+	return page;
+}
+
+/* Adds a text, allocated with malloc(), to a page; returns its index */
+static unsigned int
+page_add(page, data, len)
+	struct page *page;
+	char *data;
+	size_t len;
+{
+	if (page->ntexts == page->atexts) {
+		page->atexts = page->atexts ? page->atexts * 2 : 16;
+		page->texts = (struct text *)realloc(page->texts,
+		    page->atexts * sizeof *page->texts);
+		if (!page->texts)
+			err(1, "realloc");
+	}
+	page->texts[page->ntexts].data = data;
+	page->texts[page->ntexts].len = len;
+	return page->ntexts++;
+}
+
+/* Frees a page that failed to compile, or that is no longer used */
+static void
+page_free(page)
+	struct page *page;
+{
+	unsigned int i;
+
+	if (!page)
+		return;
+	SEE_program_free(page->program);
+	for (i = 0; i < page->ntexts; i++)
+		free(page->texts[i].data);
+	free(page->texts);
+	free(page);
+}
+
+/* Lets go of a page, freeing it if nothing else uses it */
+static void
+page_release(page)
+	struct page *page;
+{
+	unsigned int refs;
+
+	pthread_mutex_lock(&cache_lock);
+	refs = --page->refs;
+	pthread_mutex_unlock(&cache_lock);
+	if (!refs)
+		page_free(page);
+}
+
+/* Keeps a page that the caller holds until the response is sent */
+static void
+page_hold(ssp_state, page)
+	struct ssp_state *ssp_state;
+	struct page *page;
+{
+	if (ssp_state->nheld == ssp_state->aheld) {
+		ssp_state->aheld = ssp_state->aheld ? ssp_state->aheld * 2 : 8;
+		ssp_state->held = (struct page **)realloc(ssp_state->held,
+		    ssp_state->aheld * sizeof *ssp_state->held);
+		if (!ssp_state->held)
+			err(1, "realloc");
+	}
+	ssp_state->held[ssp_state->nheld++] = page;
+}
+
+/* Returns the link that refers, or would refer, to a path's cache entry */
+static struct cached_program **
+cache_find(path)
+	const char *path;
+{
+	struct cached_program **cp;
+	unsigned int h = 0;
+	const char *s;
+
+	for (s = path; *s; s++)
+		h = h * 31 + (unsigned char)*s;
+	for (cp = &cache[h % CACHE_SIZE]; *cp; cp = &(*cp)->next)
+		if (strcmp((*cp)->path, path) == 0)
+			break;
+	return cp;
+}
+
+/*
+ * Returns the compiled page for a file, if it is up to date. The
+ * caller must let go of it with page_release().
+ */
+static struct page *
+cache_get(path, st)
+	const char *path;
+	struct stat *st;
+{
+	struct cached_program *c;
+	struct page *page = NULL;
+
+	pthread_mutex_lock(&cache_lock);
+	c = *cache_find(path);
+	if (c && c->mtime == st->st_mtime && c->size == st->st_size) {
+		page = c->page;
+		page->refs++;
+	}
+	pthread_mutex_unlock(&cache_lock);
+	return page;
+}
+
+/*
+ * Remembers the page compiled from a file, letting go of the page
+ * it replaces. That is the one compiled before the file changed, or
+ * by another request that compiled the file at the same time.
+ */
+static void
+cache_put(path, st, page)
+	const char *path;
+	struct stat *st;
+	struct page *page;
+{
+	struct cached_program **cp, *c;
+	struct page *old;
+
+	pthread_mutex_lock(&cache_lock);
+	cp = cache_find(path);
+	if (!(c = *cp)) {
+		c = (struct cached_program *)malloc(sizeof *c);
+		c->path = strdup(path);
+		c->page = NULL;
+		c->next = NULL;
+		*cp = c;
+	}
+	c->mtime = st->st_mtime;
+	c->size = st->st_size;
+	old = c->page;
+	c->page = page;
+	page->refs++;
+	pthread_mutex_unlock(&cache_lock);
+	if (old)
+		page_release(old);
+}
+
+/*
+ * Runs a compiled page, making its texts available to __text().
+ * The caller's hold on the page passes to the request.
+ */
+static void
+run_page(interp, page)
+	struct SEE_interpreter *interp;
+	struct page *page;
+{
+	struct ssp_state *ssp_state = SSP_STATE(interp);
+	struct page *outer = ssp_state->page;
+	SEE_try_context_t ctxt;
+	struct SEE_value res;
+
+	page_hold(ssp_state, page);
+	ssp_state->page = page;
+	SEE_TRY(interp, ctxt) {
+		SEE_program_run(interp, page->program, &res);
+	}
+	ssp_state->page = outer;
+	SEE_DEFAULT_CATCH(interp, ctxt);
+}
+
 /* Includes a file, treating it as SSP */
 static void
 ssp_include(interp, path)
@@ -355,34 +665,54 @@ ssp_include(interp, path)
 {
 	struct SEE_input *input;
 	SEE_try_context_t ctxt;
-	struct SEE_value res;
+	struct page *page = NULL;
+	struct stat st;
+	int raw = SSP_STATE(interp)->raw;
+	int cacheable = !raw && stat(path, &st) == 0;
+
+	/* Run the compiled file if it has not changed */
+	if (cacheable && (page = cache_get(path, &st))) {
+		run_page(interp, page);
+		return;
+	}
 
 	/* Start up the code input stream generator */
-	input = ssp_input_new(interp, path);
+	if (!raw)
+		page = page_new();
+	input = ssp_input_new(interp, path, page);
 	if (!input) {
+		page_free(page);
 		SEE_error_throw(interp, interp->Error, 
 			"cannot create input stream for %s", path);
 		return;
 	}
 
-	/* Parse and execute the input in one go; trapping exceptions */
+	/* Parse the input in one go; trapping exceptions */
 	SEE_TRY(interp, ctxt) {
-	    if (SSP_STATE(interp)->raw)
+	    if (raw)
 		/* Print the generated script (for debugging) */
 		while (!input->eof) {
-			int ch = SEE_INPUT_NEXT(input) & 0x7f;
-			putc(ch, SSP_STATE(interp)->fp);
+			char ch = SEE_INPUT_NEXT(input) & 0x7f;
+			response_append(SSP_STATE(interp)->response, &ch, 1);
 		}
-	    else
-		/* Execute the generated script */
-		SEE_Global_eval(interp, input, &res);
+	    else {
+		/* Compile the generated script for this and later requests */
+		page->program = SEE_program_compile(interp, input);
+		if (cacheable)
+			cache_put(path, &st, page);
+	    }
 	}
 	/* Finally: close the input */
 	SEE_INPUT_CLOSE(input);
-	/* Rethrow any exception */
+	/* Rethrow any exception, dropping the page */
+	if (SEE_CAUGHT(ctxt))
+		page_free(page);
 	SEE_DEFAULT_CATCH(interp, ctxt);
-}
 
+	/* Execute the generated script */
+	if (page)
+		run_page(interp, page);
+}
 
 /*
  * include(): includes and runs another file
@@ -402,24 +732,70 @@ include_fn(interp, self, thisobj, argc, argv, res)
 	SEE_SET_UNDEFINED(res);
 }
 
+/*
+ * Initialises the template interpreter with the print() and include()
+ * functions. This is called once, from ssp_init().
+ */
+static void
+template_init()
+{
+	template_state.pool = pool_new();
+	template.host_data = &template_state;
+	SEE_interpreter_init_shared_template(&template,
+	    SEE_system.default_compat_flags);
+	SEE_CFUNCTION_PUTA(&template, template.Global, "print", 
+	    print_fn, 1, 0);
+	SEE_CFUNCTION_PUTA(&template, template.Global, "include", 
+	    include_fn, 1, 0);
+	SEE_CFUNCTION_PUTA(&template, template.Global, "__text", 
+	    text_fn, 1, SEE_ATTR_DONTENUM);
+}
+
+/*
+ * Creates the state for a worker thread. Call this before starting
+ * the threads: the first clone of the template must not race.
+ */
+struct ssp_worker *
+ssp_worker_new()
+{
+	struct ssp_worker *worker;
+
+	worker = (struct ssp_worker *)malloc(sizeof *worker);
+	if (!worker)
+		err(1, "malloc");
+	worker->state.pool = pool_new();
+	worker->state.response = NULL;
+	worker->state.raw = 0;
+	worker->state.page = NULL;
+	worker->state.held = NULL;
+	worker->state.nheld = 0;
+	worker->state.aheld = 0;
+	worker->interp.host_data = &worker->state;
+	SEE_interpreter_clone(&worker->interp, &template);
+	pool_stats(worker->state.pool, &worker->stats);
+	pool_reset(worker->state.pool);
+	return worker;
+}
+
 /*
  * Processes a request for an SSP file.
  * The URI is opened as a file relative to the current directory,
  * its contents converted into a (large) SEE script, and then
- * it is executed.
+ * it is executed. Output goes to the body of the response.
  */
 void
-process_request(fp, method, uri, headers)
-	FILE *fp;
+process_request(worker, resp, method, uri, headers)
+	struct ssp_worker *worker;
+	struct response *resp;
 	const char *method;
 	const char *uri;
 	struct header *headers;
 {
-	struct SEE_interpreter interp;
+	struct SEE_interpreter *interp = &worker->interp;
+	struct ssp_state *ssp_state = &worker->state;
 	char *query_string, *s;
 	SEE_try_context_t ctxt;
 	struct SEE_value v;
-	struct ssp_state ssp_state;
 
 	s = strchr(uri, '?');
 	if (s) {
@@ -428,50 +804,47 @@ process_request(fp, method, uri, headers)
 	} else
 		query_string = "";
 
-	ssp_state.fp = fp;
-	ssp_state.headers_sent = 0;
-	ssp_state.raw = strcmp(query_string, "raw") == 0;
-	ssp_state.response_code = 200;
-	ssp_state.pool = pool_new();
+	ssp_state->response = resp;
+	ssp_state->raw = strcmp(query_string, "raw") == 0;
 
-	/* Create an interpreter instance that uses our memory allocator */
-	interp.host_data = &ssp_state;
-	SEE_interpreter_init(&interp);
-
-	/* Insert the print() function into the interpreter context */
-	SEE_CFUNCTION_PUTA(&interp, interp.Global, "print", print_fn, 1, 0);
-	SEE_CFUNCTION_PUTA(&interp, interp.Global, "include", include_fn, 1, 0);
+	/*
+	 * Reuse the worker's interpreter structure and pool for a new
+	 * interpreter, copied from the template that has the print()
+	 * and include() functions
+	 */
+	interp->host_data = ssp_state;
+	SEE_interpreter_clone(interp, &template);
 
 	/* Set QUERY_STRING and other global variable */
-	SEE_SET_STRING(&v, SEE_string_sprintf(&interp, "%s", query_string));
-	SEE_OBJECT_PUTA(&interp, interp.Global, "QUERY_STRING", &v, 
+	SEE_SET_STRING(&v, SEE_string_sprintf(interp, "%s", query_string));
+	SEE_OBJECT_PUTA(interp, interp->Global, "QUERY_STRING", &v, 
 		SEE_ATTR_DEFAULT);
-	SEE_SET_STRING(&v, SEE_string_sprintf(&interp, "%s", method));
-	SEE_OBJECT_PUTA(&interp, interp.Global, "REQUEST_METHOD", &v, 
+	SEE_SET_STRING(&v, SEE_string_sprintf(interp, "%s", method));
+	SEE_OBJECT_PUTA(interp, interp->Global, "REQUEST_METHOD", &v, 
 		SEE_ATTR_DEFAULT);
-	SEE_SET_STRING(&v, SEE_string_sprintf(&interp, "%s", uri));
-	SEE_OBJECT_PUTA(&interp, interp.Global, "REQUEST_URI", &v, 
+	SEE_SET_STRING(&v, SEE_string_sprintf(interp, "%s", uri));
+	SEE_OBJECT_PUTA(interp, interp->Global, "REQUEST_URI", &v, 
 		SEE_ATTR_DEFAULT);
-	SEE_SET_OBJECT(&v, make_headers_object(&interp, headers));
-	SEE_OBJECT_PUTA(&interp, interp.Global, "HEADER", &v, 
+	SEE_SET_OBJECT(&v, make_headers_object(interp, headers));
+	SEE_OBJECT_PUTA(interp, interp->Global, "HEADER", &v, 
 		SEE_ATTR_DEFAULT);
 
 	/* Include the file named by the URI */
-	SEE_TRY(&interp, ctxt) {
-		ssp_include(&interp, uri + 1);
+	SEE_TRY(interp, ctxt) {
+		ssp_include(interp, uri + 1);
 	}
 
 	/* Print any exceptions to stderr */
 	if (SEE_CAUGHT(ctxt)) {
 		SEE_try_context_t ctxt2;
 
-		ssp_state.response_code = 500;
-		SEE_TRY(&interp, ctxt2) {
-			SEE_ToString(&interp, SEE_CAUGHT(ctxt), &v);
+		resp->code = 500;
+		SEE_TRY(interp, ctxt2) {
+			SEE_ToString(interp, SEE_CAUGHT(ctxt), &v);
 			fprintf(stderr, "exception:  ");
 			SEE_string_fputs(v.u.string, stderr);
 			fprintf(stderr, "\n");
-			SEE_PrintContextTraceback(&interp, &ctxt, stderr);
+			SEE_PrintContextTraceback(interp, &ctxt, stderr);
 		}
 		if (SEE_CAUGHT(ctxt2)) {
 			/* Exception while printing exception! */
@@ -479,12 +852,30 @@ process_request(fp, method, uri, headers)
 		}
 	}
 
-	ssp_flush_header(interp);
-	fflush(fp);
+	/* Release memory for the next request */
+	pool_stats(ssp_state->pool, &worker->stats);
+	pool_reset(ssp_state->pool);
+}
 
+/*
+ * Lets go of the pages that the worker's last request ran. Call this
+ * once the response has been sent, as it may refer to their texts.
+ */
+void
+ssp_worker_done(worker)
+	struct ssp_worker *worker;
+{
+	struct ssp_state *ssp_state = &worker->state;
 
-	/* Release memory */
-	pool_destroy(SSP_STATE(&interp)->pool);
+	while (ssp_state->nheld)
+		page_release(ssp_state->held[--ssp_state->nheld]);
 }
 
-
+/* Returns the memory pool statistics for the worker's last request */
+void
+ssp_worker_stats(worker, stats)
+	struct ssp_worker *worker;
+	struct pool_stats *stats;
+{
+	*stats = worker->stats;
+}
@@ -1,7 +1,11 @@
-
 struct header;
+struct response;
+struct ssp_worker;
+struct pool_stats;
 
 void ssp_init(void);
-void process_request(FILE *fp, const char *method,
-	const char *uri, struct header *headers);
-
+struct ssp_worker *ssp_worker_new(void);
+void process_request(struct ssp_worker *worker, struct response *resp,
+	const char *method, const char *uri, struct header *headers);
+void ssp_worker_done(struct ssp_worker *worker);
+void ssp_worker_stats(struct ssp_worker *worker, struct pool_stats *stats);
@@ -145,25 +145,55 @@ sub gen_levels {
 #}
 
 
-#-- print case maps for binary searches
-print "
-/* This file is generated. Do not edit. */
+#-- print case maps as two-level tables of deltas
+sub print_pages {
+	my $name = shift(@_);
+	my $map = shift(@_);
+	my @index = ();
+	my @pages = ([ (0) x 256 ]);
+	my %seen = (join(',', @{$pages[0]}) => 0);
+
+	# Identical pages, such as those with no mappings, are shared
+	for my $hi (0 .. 255) {
+	    my @page = map { 
+		my $cp = ($hi << 8) | $_;
+		defined($map->{$cp}) ? ($map->{$cp} - $cp) & 0xffff : 0
+	    } (0 .. 255);
+	    my $key = join(',', @page);
+	    if (!defined($seen{$key})) {
+		push(@pages, [@page]);
+		$seen{$key} = $#pages;
+	    }
+	    $index[$hi] = $seen{$key};
+	}
+	die "too many pages" if $#pages > 255;
 
-static struct case_map lowercase_map[] = {
-";
-$first = 0;
-foreach $cp(sort { $a <=> $b } keys %lower) { 
-    if ($first++) { print ",\n"; }
-    printf("      { 0x%04x, 0x%04x }", $cp, $lower{$cp}); 
+	print "\nconst unsigned char SEE_unicase_${name}_index[256] = {";
+	for my $i (0 .. 255) {
+	    print(($i ? "," : "") . ($i % 16 ? " " : "\n\t") . $index[$i]);
+	}
+	print " };\n";
+	printf("\n/* %d pages */\n", $#pages + 1);
+	print "const SEE_char_t SEE_unicase_${name}_page[][256] = {";
+	for my $p (0 .. $#pages) {
+	    print(($p ? "," : "") . "\n    {");
+	    for my $i (0 .. 255) {
+		printf("%s%s0x%04x", $i ? "," : "", $i % 8 ? " " : "\n\t",
+		    $pages[$p][$i]);
+	    }
+	    print " }";
+	}
+	print "\n};\n";
 }
-print "\n};
 
-static struct case_map uppercase_map[] = {
-";
-$first = 0;
-foreach $cp(sort { $a <=> $b } keys %upper) { 
-    if ($first++) { print ",\n"; }
-    printf("      { 0x%04x, 0x%04x }", $cp, $upper{$cp}); 
-}
-print "\n};\n";
+print "
+/* This file is generated. Do not edit. */
 
+/*
+ * Case mappings as deltas to add to a character, modulo 0x10000.
+ * A character's high byte picks a page from the index, and its low
+ * byte picks the delta from that page.
+ */
+";
+&print_pages("lower", \%lower);
+&print_pages("upper", \%upper);